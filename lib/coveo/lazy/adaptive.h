@@ -0,0 +1,1140 @@
+/**
+ * @file
+ * @brief Definition of lazy-sorted containers that adapt to their access pattern.
+ *
+ * This file contains the definition of <tt>coveo::lazy::adaptive_container</tt>,
+ * which wraps a lazy-sorted container and switches to a node-based tree like
+ * <tt>std::map</tt> when insertions and lookups are interleaved, as well as
+ * aliases like <tt>coveo::lazy::adaptive_set</tt> and <tt>coveo::lazy::adaptive_map</tt>.
+ *
+ * @code
+ *   coveo::lazy::adaptive_map<int, std::string> m;
+ *
+ *   // Bulk phase: elements are stored in a lazy-sorted map
+ *   for (auto&& elem : input) {
+ *       m.insert(elem);
+ *   }
+ *
+ *   // Interleaved phase: after a few lookups that each had to sort
+ *   // the map again, elements are moved to a std::map
+ *   for (auto&& req : requests) {
+ *       m[req.key] = req.value;
+ *       m.find(req.other_key);
+ *   }
+ * @endcode
+ *
+ * @copyright 2015-2016, Coveo Solutions Inc.
+ *            Distributed under the Apache License, Version 2.0 (see <a href="https://github.com/coveo/lazy/blob/master/LICENSE">LICENSE</a>).
+ */
+
+#ifndef COVEO_LAZY_ADAPTIVE_H
+#define COVEO_LAZY_ADAPTIVE_H
+
+#include <coveo/lazy/exception.h>
+#include <coveo/lazy/map.h>
+#include <coveo/lazy/set.h>
+#include <coveo/lazy/tags.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <set>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace coveo {
+namespace lazy {
+
+/**
+ * @brief Storage used by an adaptive container.
+ * @headerfile adaptive.h <coveo/lazy/adaptive.h>
+ *
+ * @see coveo::lazy::adaptive_container
+ */
+enum class adaptive_mode {
+    lazy,   ///< Elements are stored in a lazy-sorted container.
+    tree    ///< Elements are stored in a node-based tree.
+};
+
+/**
+ * @brief Thresholds used by an adaptive container to switch storage.
+ * @headerfile adaptive.h <coveo/lazy/adaptive.h>
+ *
+ * @see coveo::lazy::adaptive_container
+ */
+struct adaptive_thresholds {
+    /// Number of consecutive lookups that need to sort the lazy-sorted container
+    /// after few insertions before switching to the tree.
+    std::size_t thrashing_sorts = 8;
+
+    /// A sort is considered wasteful if fewer than <tt>1 / sort_ratio</tt>
+    /// of the elements were inserted since the previous sort.
+    std::size_t sort_ratio = 16;
+
+    /// Minimum number of elements before switching to the tree; smaller
+    /// containers are cheap to sort.
+    std::size_t min_tree_size = 1024;
+
+    /// Minimum number of insertions without lookups before switching back to the
+    /// lazy-sorted container. At least <tt>1 / sort_ratio</tt> of the elements
+    /// must also have been inserted.
+    std::size_t bulk_inserts = 1024;
+};
+
+template<class Container, class Tree> class adaptive_container;
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief Trait to get the tree type used by an adaptive container.
+ * @headerfile adaptive.h <coveo/lazy/adaptive.h>
+ *
+ * Given a lazy-sorted container type, has a @c type member set to the standard
+ * container with the same semantics (<tt>std::set</tt>, <tt>std::multiset</tt>,
+ * <tt>std::map</tt> or <tt>std::multimap</tt>). Also has a @c mapped_type member
+ * (@c void for sets) and @c multi and @c non_multi_map members to describe the
+ * container.
+ *
+ * @tparam Container Type of lazy-sorted container.
+ */
+template<class Container> struct adaptive_tree_type;
+template<class K, class T, class V, class PubV, class VToK, class KCmp, class KEq, class Alloc,
+         template<class _ImplT, class _ImplAlloc> class Impl,
+         bool Multi, class Sort, class Stats, class Search, class Dup, class Append, bool _IsNonMultiMap>
+struct adaptive_tree_type<lazy_sorted_container<K, T, V, PubV, VToK, KCmp, KEq, Alloc, Impl,
+                                                Multi, Sort, Stats, Search, Dup, Append, _IsNonMultiMap>>
+{
+    using mapped_type = T;
+    static const bool multi = Multi;
+    static const bool non_multi_map = _IsNonMultiMap;
+    using type = std::conditional_t<std::is_void<T>::value,
+                                    std::conditional_t<Multi, std::multiset<K, KCmp>, std::set<K, KCmp>>,
+                                    std::conditional_t<Multi, std::multimap<K, T, KCmp>, std::map<K, T, KCmp>>>;
+};
+
+/**
+ * @internal
+ * @brief Iterator for adaptive containers.
+ * @headerfile adaptive.h <coveo/lazy/adaptive.h>
+ *
+ * Bidirectional iterator that wraps either an iterator of a lazy-sorted container
+ * or an iterator of a tree, depending on where the container stores its elements.
+ * Both must return the same type of references.
+ *
+ * @tparam LazyIt Iterator type of the lazy-sorted container.
+ * @tparam TreeIt Iterator type of the tree.
+ */
+template<class LazyIt, class TreeIt>
+class adaptive_iterator
+{
+    template<class, class> friend class adaptive_iterator;
+    template<class, class> friend class coveo::lazy::adaptive_container;
+
+    static_assert(std::is_same<typename std::iterator_traits<LazyIt>::reference,
+                               typename std::iterator_traits<TreeIt>::reference>::value,
+                  "lazy-sorted container and tree must return the same type of references");
+
+public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = typename std::iterator_traits<LazyIt>::value_type;
+    using difference_type = typename std::iterator_traits<LazyIt>::difference_type;
+    using pointer = std::add_pointer_t<typename std::iterator_traits<LazyIt>::reference>;
+    using reference = typename std::iterator_traits<LazyIt>::reference;
+
+private:
+    LazyIt lazy_it_;    // Iterator in lazy-sorted container, if !in_tree_.
+    TreeIt tree_it_;    // Iterator in tree, if in_tree_.
+    bool in_tree_;      // Whether this iterator points in the tree.
+
+public:
+    adaptive_iterator()
+        : lazy_it_(), tree_it_(), in_tree_(false) { }
+    explicit adaptive_iterator(LazyIt it)
+        : lazy_it_(std::move(it)), tree_it_(), in_tree_(false) { }
+    explicit adaptive_iterator(TreeIt it)
+        : lazy_it_(), tree_it_(std::move(it)), in_tree_(true) { }
+    template<class OLazyIt, class OTreeIt,
+             class = std::enable_if_t<std::is_convertible<OLazyIt, LazyIt>::value &&
+                                      std::is_convertible<OTreeIt, TreeIt>::value>>
+    adaptive_iterator(const adaptive_iterator<OLazyIt, OTreeIt>& obj)
+        : lazy_it_(obj.lazy_it_), tree_it_(obj.tree_it_), in_tree_(obj.in_tree_) { }
+
+    reference operator*() const {
+        return in_tree_ ? *tree_it_ : *lazy_it_;
+    }
+    pointer operator->() const {
+        return std::addressof(**this);
+    }
+
+    adaptive_iterator& operator++() {
+        if (in_tree_) {
+            ++tree_it_;
+        } else {
+            ++lazy_it_;
+        }
+        return *this;
+    }
+    adaptive_iterator operator++(int) {
+        adaptive_iterator it(*this);
+        ++*this;
+        return it;
+    }
+    adaptive_iterator& operator--() {
+        if (in_tree_) {
+            --tree_it_;
+        } else {
+            --lazy_it_;
+        }
+        return *this;
+    }
+    adaptive_iterator operator--(int) {
+        adaptive_iterator it(*this);
+        --*this;
+        return it;
+    }
+
+    template<class OLazyIt, class OTreeIt>
+    bool operator==(const adaptive_iterator<OLazyIt, OTreeIt>& right) const {
+        return in_tree_ == right.in_tree_ && (in_tree_ ? tree_it_ == right.tree_it_ : lazy_it_ == right.lazy_it_);
+    }
+    template<class OLazyIt, class OTreeIt>
+    bool operator!=(const adaptive_iterator<OLazyIt, OTreeIt>& right) const {
+        return !(*this == right);
+    }
+};
+
+} // detail
+
+/**
+ * @brief Lazy-sorted container that adapts to its access pattern.
+ * @headerfile adaptive.h <coveo/lazy/adaptive.h>
+ *
+ * Wrapper around a lazy-sorted container that moves its elements to a node-based
+ * tree (like <tt>std::map</tt>) when insertions and lookups are interleaved, and
+ * back to the lazy-sorted container when insertions are performed in bulk.
+ *
+ * Lazy-sorted containers are best when elements are inserted in batches, between
+ * which lookups are performed: each batch is sorted once. When a few elements are
+ * inserted before each lookup, however, each lookup needs to merge them with all
+ * other elements, which is linear in the size of the container. In a tree, inserting
+ * or looking for an element is always logarithmic, but elements are not contiguous,
+ * which makes lookups and iteration slower.
+ *
+ * This class counts insertions and the lookups that need to sort the lazy-sorted
+ * container to choose where to store elements (see <tt>coveo::lazy::adaptive_thresholds</tt>):
+ *
+ * - If @c thrashing_sorts lookups in a row need to sort the lazy-sorted container
+ *   after fewer than <tt>1 / sort_ratio</tt> of its elements were inserted, elements
+ *   are moved to the tree (unless there are fewer than @c min_tree_size elements).
+ * - In the tree, if @c bulk_inserts elements (and at least <tt>1 / sort_ratio</tt> of
+ *   the elements) are inserted without lookups in between, elements are moved back
+ *   to the lazy-sorted container.
+ *
+ * Moving elements is linear in the size of the container. Since it is only done as part
+ * of an insertion or of the first lookup after an insertion, iterators are invalidated
+ * by insertions, like for lazy-sorted containers. When the elements are in the tree,
+ * duplicates are resolved using <tt>Container::duplicate_policy</tt>, like in the
+ * lazy-sorted container.
+ *
+ * This class offers the methods of lazy-sorted containers that make sense whatever
+ * the storage used: iteration (including reverse iteration), insertion (including
+ * with hints, which are ignored like in lazy-sorted containers), removal by iterator,
+ * by key or lazily, lookups (including with any type of key if @c key_compare is
+ * transparent) and, for maps, <tt>at()</tt>, <tt>operator[]()</tt>,
+ * <tt>try_emplace()</tt> and <tt>insert_or_assign()</tt>. The following methods of
+ * lazy-sorted containers are deliberately left out:
+ *
+ * - Methods that control the lazy-sorted storage, like <tt>sort()</tt>,
+ *   <tt>sorted()</tt>, <tt>reserve()</tt>, <tt>shrink_to_fit()</tt> or
+ *   <tt>set_pending_limit()</tt>, as well as sort statistics: they have no
+ *   equivalent in the tree, and calling them would defeat the purpose of
+ *   letting this class choose the storage.
+ * - Insertion of sorted ranges (with tags like <tt>coveo::lazy::sorted_unique</tt>),
+ *   <tt>splice()</tt> and <tt>merge()</tt>: their benefit comes from appending to
+ *   contiguous storage, which the tree cannot do; insert ranges instead.
+ * - <tt>freeze()</tt> and <tt>serialize()</tt>, which rely on the elements being
+ *   stored contiguously, which they are not in the tree.
+ * - Custom allocators (<tt>get_allocator()</tt> and allocator-extended constructors),
+ *   since the tree uses its own allocator type.
+ * - Comparison operators, which can be performed on the iterators instead.
+ *
+ * Like lazy-sorted containers, this class is not thread-safe, and its lookup
+ * methods are @c const but can modify the container's storage.
+ *
+ * @tparam Container Type of lazy-sorted container to wrap, like <tt>coveo::lazy::map</tt>.
+ * @tparam Tree Type of node-based tree to use. Defaults to the standard container with
+ *              the same semantics and key comparator as @c Container, e.g. <tt>std::map</tt>
+ *              for a <tt>coveo::lazy::map</tt>.
+ */
+template<class Container,
+         class Tree = typename detail::adaptive_tree_type<Container>::type>
+class adaptive_container : public detail::mapped_type_base<typename detail::adaptive_tree_type<Container>::mapped_type>
+{
+    using traits = detail::adaptive_tree_type<Container>;
+
+public:
+    /// Type of lazy-sorted container wrapped.
+    using container_type = Container;
+    /// Type of node-based tree used when insertions and lookups are interleaved.
+    using tree_type = Tree;
+    /// Type of keys.
+    using key_type = typename Container::key_type;
+    /// Type of elements.
+    using value_type = typename Container::value_type;
+    /// Predicate used to compare keys.
+    using key_compare = typename Container::key_compare;
+    /// Type used for sizes.
+    using size_type = typename Container::size_type;
+    /// Type used for differences between iterators.
+    using difference_type = typename Container::difference_type;
+    /// Type of references to elements.
+    using reference = typename Container::reference;
+    /// Type of const references to elements.
+    using const_reference = typename Container::const_reference;
+    /// Iterator type for the container.
+    using iterator = detail::adaptive_iterator<typename Container::iterator, typename Tree::iterator>;
+    /// Const iterator type for the container.
+    using const_iterator = detail::adaptive_iterator<typename Container::const_iterator, typename Tree::const_iterator>;
+    /// Reverse iterator type for the container.
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    /// Const reverse iterator type for the container.
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+private:
+    mutable Container lazy_;                // Elements, if mode_ is lazy.
+    mutable Tree tree_;                     // Elements, if mode_ is tree.
+    mutable adaptive_mode mode_;            // Where elements are currently stored.
+    adaptive_thresholds thresholds_;        // Thresholds used to switch storage.
+    mutable size_type inserts_;             // Insertions since last sort (lazy) or last lookup (tree).
+    mutable size_type thrashing_sorts_;     // Consecutive lookups that sorted after few insertions.
+
+    // Used to disable methods accepting any type of key when passed a key_type or an iterator.
+    template<class OK> using enable_if_other_key_t = std::enable_if_t<!std::is_same<std::decay_t<OK>, key_type>::value &&
+                                                                      !std::is_convertible<OK, const_iterator>::value &&
+                                                                      !std::is_convertible<OK, iterator>::value>;
+
+public:
+    /**
+     * @brief Default constructor.
+     *
+     * Creates an empty container, storing its elements in a lazy-sorted container.
+     *
+     * @param kcmp @c key_compare instance to use for this container.
+     * @param thresholds Thresholds used to choose where elements are stored.
+     */
+    explicit adaptive_container(const key_compare& kcmp = key_compare(),
+                                const adaptive_thresholds& thresholds = adaptive_thresholds())
+        : lazy_(kcmp), tree_(kcmp), mode_(adaptive_mode::lazy), thresholds_(thresholds),
+          inserts_(0), thrashing_sorts_(0) { }
+
+    /**
+     * @brief Range constructor.
+     *
+     * Creates a container with the elements in <tt>[first, last[</tt>,
+     * storing them in a lazy-sorted container.
+     *
+     * @param first Beginning of the range of elements to insert (inclusive).
+     * @param last End of the range of elements to insert (exclusive).
+     * @param kcmp @c key_compare instance to use for this container.
+     * @param thresholds Thresholds used to choose where elements are stored.
+     */
+    template<class It> adaptive_container(It first, It last,
+                                          const key_compare& kcmp = key_compare(),
+                                          const adaptive_thresholds& thresholds = adaptive_thresholds())
+        : adaptive_container(kcmp, thresholds) {
+        insert(first, last);
+    }
+
+    /**
+     * @brief Initializer list constructor.
+     *
+     * @param init @c initializer_list containing container's initial elements.
+     * @param kcmp @c key_compare instance to use for this container.
+     * @param thresholds Thresholds used to choose where elements are stored.
+     */
+    adaptive_container(std::initializer_list<value_type> init,
+                       const key_compare& kcmp = key_compare(),
+                       const adaptive_thresholds& thresholds = adaptive_thresholds())
+        : adaptive_container(init.begin(), init.end(), kcmp, thresholds) { }
+
+    /**
+     * @brief Returns where elements are currently stored.
+     *
+     * @return Storage currently used.
+     */
+    adaptive_mode mode() const {
+        return mode_;
+    }
+
+    /**
+     * @brief Returns thresholds used to switch storage.
+     *
+     * @return Thresholds used by this container.
+     */
+    const adaptive_thresholds& thresholds() const {
+        return thresholds_;
+    }
+
+    /**
+     * @brief Changes thresholds used to switch storage.
+     *
+     * Does not move elements; new thresholds are taken into account
+     * by the following insertions and lookups.
+     *
+     * @param thresholds New thresholds to use.
+     */
+    void set_thresholds(const adaptive_thresholds& thresholds) {
+        thresholds_ = thresholds;
+    }
+
+    /**
+     * @brief Iterator to beginning of container.
+     *
+     * Sorts the lazy-sorted container if needed; like lookups, this can move
+     * elements to the tree if the container is sorted too often.
+     *
+     * @return Iterator pointing to first element.
+     */
+    iterator begin() {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? iterator(tree_.begin()) : iterator(lazy_.begin());
+    }
+    /// @brief Iterator to beginning of container (const version).
+    const_iterator begin() const {
+        return cbegin();
+    }
+    /// @brief Iterator to beginning of container (const version).
+    const_iterator cbegin() const {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? const_iterator(tree_.cbegin()) : const_iterator(lazy_.cbegin());
+    }
+
+    /**
+     * @brief Iterator to end of container.
+     *
+     * @return Iterator pointing after the last element.
+     */
+    iterator end() {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? iterator(tree_.end()) : iterator(lazy_.end());
+    }
+    /// @brief Iterator to end of container (const version).
+    const_iterator end() const {
+        return cend();
+    }
+    /// @brief Iterator to end of container (const version).
+    const_iterator cend() const {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? const_iterator(tree_.cend()) : const_iterator(lazy_.cend());
+    }
+
+    /**
+     * @brief Reverse iterator to beginning of container.
+     *
+     * @return Reverse iterator pointing to last element.
+     */
+    reverse_iterator rbegin() {
+        return reverse_iterator(end());
+    }
+    /// @brief Reverse iterator to beginning of container (const version).
+    const_reverse_iterator rbegin() const {
+        return crbegin();
+    }
+    /// @brief Reverse iterator to beginning of container (const version).
+    const_reverse_iterator crbegin() const {
+        return const_reverse_iterator(cend());
+    }
+
+    /**
+     * @brief Reverse iterator to end of container.
+     *
+     * @return Reverse iterator pointing before the first element.
+     */
+    reverse_iterator rend() {
+        return reverse_iterator(begin());
+    }
+    /// @brief Reverse iterator to end of container (const version).
+    const_reverse_iterator rend() const {
+        return crend();
+    }
+    /// @brief Reverse iterator to end of container (const version).
+    const_reverse_iterator crend() const {
+        return const_reverse_iterator(cbegin());
+    }
+
+    /**
+     * @brief Checks if container is empty.
+     *
+     * @return @c true if container has no elements.
+     */
+    bool empty() const {
+        return mode_ == adaptive_mode::tree ? tree_.empty() : lazy_.empty();
+    }
+
+    /**
+     * @brief Returns number of elements in the container.
+     *
+     * @return Number of elements.
+     */
+    size_type size() const {
+        return mode_ == adaptive_mode::tree ? tree_.size() : lazy_.size();
+    }
+
+    /**
+     * @brief Inserts an element.
+     *
+     * @param value Element to insert.
+     */
+    void insert(const value_type& value) {
+        emplace(value);
+    }
+
+    /**
+     * @brief Inserts an element (move version).
+     *
+     * @param value Element to move in the container.
+     */
+    void insert(value_type&& value) {
+        emplace(std::move(value));
+    }
+
+    /**
+     * @brief Inserts an element with a hint iterator.
+     *
+     * The hint is ignored, like in <tt>Container::insert()</tt>.
+     *
+     * @param hint Hint iterator; unused.
+     * @param value Element to insert.
+     */
+    void insert(const_iterator hint, const value_type& value) {
+        emplace(value);
+    }
+
+    /**
+     * @brief Inserts an element with a hint iterator (move version).
+     *
+     * @param hint Hint iterator; unused.
+     * @param value Element to move in the container.
+     */
+    void insert(const_iterator hint, value_type&& value) {
+        emplace(std::move(value));
+    }
+
+    /**
+     * @brief Inserts a range of elements.
+     *
+     * @param first Beginning of the range of elements to insert (inclusive).
+     * @param last End of the range of elements to insert (exclusive).
+     */
+    template<class It> void insert(It first, It last) {
+        for (; first != last; ++first) {
+            emplace(*first);
+        }
+    }
+
+    /**
+     * @brief Inserts elements from an initializer list.
+     *
+     * @param init @c initializer_list containing the elements to insert.
+     */
+    void insert(std::initializer_list<value_type> init) {
+        insert(init.begin(), init.end());
+    }
+
+    /**
+     * @brief Constructs an element in the container.
+     *
+     * @param args Arguments to pass to the element's constructor.
+     */
+    template<class... Args> void emplace(Args&&... args) {
+        ++inserts_;
+        if (mode_ == adaptive_mode::tree && is_bulk_insert()) {
+            move_to_lazy();
+        }
+        if (mode_ == adaptive_mode::tree) {
+            tree_emplace(std::integral_constant<bool, traits::multi>(), std::forward<Args>(args)...);
+        } else {
+            lazy_.emplace(std::forward<Args>(args)...);
+        }
+    }
+
+    /**
+     * @brief Constructs an element in the container with a hint iterator.
+     *
+     * The hint is ignored, like in <tt>Container::emplace_hint()</tt>.
+     *
+     * @param hint Hint iterator; unused.
+     * @param args Arguments to pass to the element's constructor.
+     */
+    template<class... Args> void emplace_hint(const_iterator hint, Args&&... args) {
+        emplace(std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Removes an element from the container.
+     *
+     * @param pos Iterator pointing at element to remove.
+     * @return Iterator pointing at element following the removed element.
+     */
+    iterator erase(const_iterator pos) {
+        return pos.in_tree_ ? iterator(tree_.erase(pos.tree_it_)) : iterator(lazy_.erase(pos.lazy_it_));
+    }
+
+    /**
+     * @brief Removes many elements from the container.
+     *
+     * @param first Beginning of range of elements to remove.
+     * @param last End of range of elements to remove.
+     * @return Iterator pointing at element following the last element removed.
+     */
+    iterator erase(const_iterator first, const_iterator last) {
+        return first.in_tree_ ? iterator(tree_.erase(first.tree_it_, last.tree_it_))
+                              : iterator(lazy_.erase(first.lazy_it_, last.lazy_it_));
+    }
+
+    /**
+     * @brief Removes elements by key.
+     *
+     * @param key Key of element(s) to remove.
+     * @return Number of elements removed.
+     */
+    size_type erase(const key_type& key) {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? tree_.erase(key) : lazy_.erase(key);
+    }
+
+    /**
+     * @brief Removes elements using any type of key.
+     *
+     * @param key Key of element(s) to remove.
+     * @return Number of elements removed.
+     * @remark This method is only available if @c key_compare is transparent.
+     */
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent,
+             class = enable_if_other_key_t<OK>>
+    size_type erase(const OK& key) {
+        before_lookup();
+        if (mode_ == adaptive_mode::tree) {
+            // Trees only support erasing with any type of key since C++23.
+            auto range = tree_.equal_range(key);
+            const size_type dist = std::distance(range.first, range.second);
+            tree_.erase(range.first, range.second);
+            return dist;
+        }
+        return lazy_.erase(key);
+    }
+
+    /**
+     * @brief Removes elements by key, lazily.
+     *
+     * Like <tt>Container::lazy_erase()</tt> when elements are in the lazy-sorted
+     * container; when they are in the tree, elements are removed right away,
+     * which is already logarithmic.
+     *
+     * @param key Key of element(s) to remove.
+     */
+    void lazy_erase(const key_type& key) {
+        if (mode_ == adaptive_mode::tree) {
+            tree_.erase(key);
+        } else {
+            lazy_.lazy_erase(key);
+        }
+    }
+
+    /**
+     * @brief Removes all elements.
+     *
+     * Also moves back to the lazy-sorted container.
+     */
+    void clear() {
+        lazy_.clear();
+        tree_.clear();
+        mode_ = adaptive_mode::lazy;
+        inserts_ = 0;
+        thrashing_sorts_ = 0;
+    }
+
+    /**
+     * @brief Swaps the contents of two containers.
+     *
+     * @param obj Container to swap with.
+     */
+    void swap(adaptive_container& obj) {
+        using std::swap;
+        swap(lazy_, obj.lazy_);
+        swap(tree_, obj.tree_);
+        swap(mode_, obj.mode_);
+        swap(thresholds_, obj.thresholds_);
+        swap(inserts_, obj.inserts_);
+        swap(thrashing_sorts_, obj.thrashing_sorts_);
+    }
+
+    /// @brief Swaps the contents of two containers (ADL version).
+    friend void swap(adaptive_container& obj1, adaptive_container& obj2) {
+        obj1.swap(obj2);
+    }
+
+    /**
+     * @brief Returns number of elements associated to a key.
+     *
+     * @param key Key of element(s) to count.
+     * @return Number of elements associated with @c key.
+     */
+    size_type count(const key_type& key) const {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? tree_.count(key) : lazy_.count(key);
+    }
+
+    /**
+     * @brief Finds an element in the container.
+     *
+     * @param key Key of element to find.
+     * @return Iterator pointing to element with key @c key, or <tt>end()</tt> if none.
+     */
+    iterator find(const key_type& key) {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? iterator(tree_.find(key)) : iterator(lazy_.find(key));
+    }
+    /// @brief Finds an element in the container (const version).
+    const_iterator find(const key_type& key) const {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? const_iterator(tree_.find(key)) : const_iterator(lazy_.find(key));
+    }
+
+    /**
+     * @brief Finds lower bound of a key.
+     *
+     * @param key Key to look for.
+     * @return Iterator pointing to first element not less than @c key.
+     */
+    iterator lower_bound(const key_type& key) {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? iterator(tree_.lower_bound(key)) : iterator(lazy_.lower_bound(key));
+    }
+    /// @brief Finds lower bound of a key (const version).
+    const_iterator lower_bound(const key_type& key) const {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? const_iterator(tree_.lower_bound(key)) : const_iterator(lazy_.lower_bound(key));
+    }
+
+    /**
+     * @brief Finds upper bound of a key.
+     *
+     * @param key Key to look for.
+     * @return Iterator pointing to first element greater than @c key.
+     */
+    iterator upper_bound(const key_type& key) {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? iterator(tree_.upper_bound(key)) : iterator(lazy_.upper_bound(key));
+    }
+    /// @brief Finds upper bound of a key (const version).
+    const_iterator upper_bound(const key_type& key) const {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? const_iterator(tree_.upper_bound(key)) : const_iterator(lazy_.upper_bound(key));
+    }
+
+    /**
+     * @brief Finds range of elements matching a key.
+     *
+     * @param key Key to look for.
+     * @return Pair containing the lower and upper bounds of @c key.
+     */
+    std::pair<iterator, iterator> equal_range(const key_type& key) {
+        before_lookup();
+        if (mode_ == adaptive_mode::tree) {
+            auto range = tree_.equal_range(key);
+            return std::make_pair(iterator(range.first), iterator(range.second));
+        }
+        auto range = lazy_.equal_range(key);
+        return std::make_pair(iterator(range.first), iterator(range.second));
+    }
+    /// @brief Finds range of elements matching a key (const version).
+    std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const {
+        before_lookup();
+        if (mode_ == adaptive_mode::tree) {
+            auto range = tree_.equal_range(key);
+            return std::make_pair(const_iterator(range.first), const_iterator(range.second));
+        }
+        auto range = lazy_.equal_range(key);
+        return std::make_pair(const_iterator(range.first), const_iterator(range.second));
+    }
+
+    /**
+     * @brief Returns number of elements associated to any type of key.
+     *
+     * @param key Key of element(s) to count.
+     * @return Number of elements associated with @c key.
+     * @remark This method is only available if @c key_compare is transparent.
+     */
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent>
+    size_type count(const OK& key) const {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? tree_.count(key) : lazy_.count(key);
+    }
+
+    /**
+     * @brief Finds an element in the container using any type of key.
+     *
+     * @param key Key of element to find.
+     * @return Iterator pointing to element with key @c key, or <tt>end()</tt> if none.
+     * @remark This method is only available if @c key_compare is transparent.
+     */
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent>
+    iterator find(const OK& key) {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? iterator(tree_.find(key)) : iterator(lazy_.find(key));
+    }
+    /// @brief Finds an element in the container using any type of key (const version).
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent>
+    const_iterator find(const OK& key) const {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? const_iterator(tree_.find(key)) : const_iterator(lazy_.find(key));
+    }
+
+    /**
+     * @brief Finds lower bound of any type of key.
+     *
+     * @param key Key to look for.
+     * @return Iterator pointing to first element not less than @c key.
+     * @remark This method is only available if @c key_compare is transparent.
+     */
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent>
+    iterator lower_bound(const OK& key) {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? iterator(tree_.lower_bound(key)) : iterator(lazy_.lower_bound(key));
+    }
+    /// @brief Finds lower bound of any type of key (const version).
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent>
+    const_iterator lower_bound(const OK& key) const {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? const_iterator(tree_.lower_bound(key)) : const_iterator(lazy_.lower_bound(key));
+    }
+
+    /**
+     * @brief Finds upper bound of any type of key.
+     *
+     * @param key Key to look for.
+     * @return Iterator pointing to first element greater than @c key.
+     * @remark This method is only available if @c key_compare is transparent.
+     */
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent>
+    iterator upper_bound(const OK& key) {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? iterator(tree_.upper_bound(key)) : iterator(lazy_.upper_bound(key));
+    }
+    /// @brief Finds upper bound of any type of key (const version).
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent>
+    const_iterator upper_bound(const OK& key) const {
+        before_lookup();
+        return mode_ == adaptive_mode::tree ? const_iterator(tree_.upper_bound(key)) : const_iterator(lazy_.upper_bound(key));
+    }
+
+    /**
+     * @brief Finds range of elements matching any type of key.
+     *
+     * @param key Key to look for.
+     * @return Pair containing the lower and upper bounds of @c key.
+     * @remark This method is only available if @c key_compare is transparent.
+     */
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent>
+    std::pair<iterator, iterator> equal_range(const OK& key) {
+        before_lookup();
+        if (mode_ == adaptive_mode::tree) {
+            auto range = tree_.equal_range(key);
+            return std::make_pair(iterator(range.first), iterator(range.second));
+        }
+        auto range = lazy_.equal_range(key);
+        return std::make_pair(iterator(range.first), iterator(range.second));
+    }
+    /// @brief Finds range of elements matching any type of key (const version).
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent>
+    std::pair<const_iterator, const_iterator> equal_range(const OK& key) const {
+        before_lookup();
+        if (mode_ == adaptive_mode::tree) {
+            auto range = tree_.equal_range(key);
+            return std::make_pair(const_iterator(range.first), const_iterator(range.second));
+        }
+        auto range = lazy_.equal_range(key);
+        return std::make_pair(const_iterator(range.first), const_iterator(range.second));
+    }
+
+    /**
+     * @brief Returns mapped value of element with key.
+     *
+     * @param key Key of element to look for.
+     * @return Reference to mapped value of element with key @c key.
+     * @throw coveo::lazy::out_of_range If there is no element with key @c key.
+     * @remark This method is only available for maps that do not accept duplicates.
+     */
+    template<class _T = typename traits::mapped_type,
+             class _TRef = std::enable_if_t<traits::non_multi_map, _T&>>
+    _TRef at(const key_type& key) {
+        auto it = find(key);
+        if (it == end()) {
+            throw coveo::lazy::out_of_range("out_of_range");
+        }
+        return it->second;
+    }
+    /// @brief Returns mapped value of element with key (const version).
+    template<class _T = typename traits::mapped_type,
+             class _CTRef = std::enable_if_t<traits::non_multi_map, const _T&>>
+    _CTRef at(const key_type& key) const {
+        auto it = find(key);
+        if (it == end()) {
+            throw coveo::lazy::out_of_range("out_of_range");
+        }
+        return it->second;
+    }
+
+    /**
+     * @brief Returns mapped value of element with key, inserting it if needed.
+     *
+     * Like <tt>Container::operator[]()</tt>: if there is no element with key @c key,
+     * inserts one with a default-constructed mapped value.
+     *
+     * @param key Key of element to look for.
+     * @return Reference to mapped value of element with key @c key.
+     * @remark This method is only available for maps that do not accept duplicates.
+     */
+    template<class _T = typename traits::mapped_type,
+             class _TRef = std::enable_if_t<traits::non_multi_map, _T&>>
+    _TRef operator[](const key_type& key) {
+        return try_emplace(key).first->second;
+    }
+
+    /**
+     * @brief Inserts an element or assigns to its mapped value.
+     *
+     * @param key Key of element to insert or assign.
+     * @param val Mapped value to insert or assign.
+     * @return Pair containing an iterator to the element and whether it was inserted.
+     * @remark This method is only available for maps that do not accept duplicates.
+     */
+    template<class OT,
+             bool _Enabled = traits::non_multi_map,
+             class = std::enable_if_t<_Enabled, void>>
+    std::pair<iterator, bool> insert_or_assign(const key_type& key, OT&& val) {
+        auto res = try_emplace(key, std::forward<OT>(val));
+        if (!res.second) {
+            res.first->second = std::forward<OT>(val);
+        }
+        return res;
+    }
+
+    /**
+     * @brief Inserts an element if its key does not exist.
+     *
+     * Like <tt>Container::try_emplace()</tt>: if there is no element with key @c key,
+     * inserts one whose mapped value is constructed with @c args; otherwise, does nothing.
+     *
+     * @param key Key of element to insert.
+     * @param args Arguments to pass to the constructor of the mapped value.
+     * @return Pair containing an iterator to the element and whether it was inserted.
+     * @remark This method is only available for maps that do not accept duplicates.
+     */
+    template<class... Args,
+             bool _Enabled = traits::non_multi_map,
+             class = std::enable_if_t<_Enabled, void>>
+    std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args) {
+        // May insert, but cannot create duplicates, so we count this as a lookup.
+        before_lookup();
+        if (mode_ == adaptive_mode::tree) {
+            auto it = tree_.lower_bound(key);
+            if (it != tree_.end() && !tree_.key_comp()(key, it->first)) {
+                return std::make_pair(iterator(it), false);
+            }
+            it = tree_.emplace_hint(it, std::piecewise_construct,
+                                    std::forward_as_tuple(key),
+                                    std::forward_as_tuple(std::forward<Args>(args)...));
+            return std::make_pair(iterator(it), true);
+        }
+        auto res = lazy_.try_emplace(key, std::forward<Args>(args)...);
+        return std::make_pair(iterator(res.first), res.second);
+    }
+
+    /**
+     * @brief Returns key comparator.
+     *
+     * @return Copy of @c key_compare predicate used by the container.
+     */
+    key_compare key_comp() const {
+        return lazy_.key_comp();
+    }
+
+private:
+    // Internal method called before lookups. In lazy mode, sorts the container if the lookup
+    // would and checks if we are sorting too often; in tree mode, ends the current bulk insert.
+    void before_lookup() const {
+        if (mode_ == adaptive_mode::tree) {
+            inserts_ = 0;
+            return;
+        }
+        if (inserts_ <= lazy_.pending_limit() || lazy_.sorted()) {
+            // Lookup will not sort (or only scan a few pending elements).
+            return;
+        }
+        lazy_.sort();
+        const size_type size = lazy_.size();
+        if (inserts_ * thresholds_.sort_ratio < size) {
+            ++thrashing_sorts_;
+        } else {
+            thrashing_sorts_ = 0;
+        }
+        inserts_ = 0;
+        if (thrashing_sorts_ >= thresholds_.thrashing_sorts && size >= thresholds_.min_tree_size) {
+            move_to_tree();
+        }
+    }
+
+    // Internal method that checks if enough elements were inserted in the tree
+    // without lookups in between to move back to the lazy-sorted container.
+    bool is_bulk_insert() const {
+        return inserts_ >= thresholds_.bulk_inserts && inserts_ * thresholds_.sort_ratio >= tree_.size();
+    }
+
+    // Internal method to move elements from the lazy-sorted container to the tree. Container must be sorted.
+    void move_to_tree() const {
+        for (auto it = lazy_.begin(), end = lazy_.end(); it != end; ++it) {
+            tree_.emplace_hint(tree_.end(), std::move(*it));
+        }
+        Container(lazy_.key_comp()).swap(lazy_);
+        mode_ = adaptive_mode::tree;
+        inserts_ = 0;
+        thrashing_sorts_ = 0;
+    }
+
+    // Internal method to move elements from the tree to the lazy-sorted container.
+    void move_to_lazy() const {
+        // Elements of the tree are sorted, no need to sort them again.
+        lazy_.insert(check_sorted, std::make_move_iterator(tree_.begin()), std::make_move_iterator(tree_.end()));
+        tree_.clear();
+        mode_ = adaptive_mode::lazy;
+        thrashing_sorts_ = 0;
+    }
+
+    using is_map = std::integral_constant<bool, !std::is_void<typename traits::mapped_type>::value>;
+
+    // Internal methods that return the key of an element.
+    static const key_type& key_of(const value_type& value, std::true_type) {
+        return value.first;
+    }
+    static const key_type& key_of(const value_type& value, std::false_type) {
+        return value;
+    }
+
+    // Internal method to insert an element in the tree. If the container does not accept
+    // duplicates, resolves them using the lazy-sorted container's duplicate policy.
+    template<class... Args> void tree_emplace(std::true_type, Args&&... args) {
+        tree_.emplace(std::forward<Args>(args)...);
+    }
+    template<class... Args> void tree_emplace(std::false_type, Args&&... args) {
+        value_type value(std::forward<Args>(args)...);
+        const auto& key = key_of(value, is_map());
+        auto it = tree_.lower_bound(key);
+        if (it == tree_.end() || tree_.key_comp()(key, key_of(*it, is_map()))) {
+            tree_.emplace_hint(it, std::move(value));
+        } else if (!std::is_same<typename Container::duplicate_policy, default_duplicate_policy>::value &&
+                   !std::is_same<typename Container::duplicate_policy, first_wins_duplicate_policy>::value) {
+            resolve_in_tree(it, value, is_map());
+        }
+    }
+    void resolve_in_tree(typename Tree::iterator it, value_type& dup, std::true_type) {
+        typename Container::duplicate_policy().resolve(it->second, std::move(dup.second));
+    }
+    void resolve_in_tree(typename Tree::iterator it, value_type& dup, std::false_type) {
+        // Elements of sets are const in the tree, so we need to replace them.
+        value_type kept(*it);
+        typename Container::duplicate_policy().resolve(kept, std::move(dup));
+        tree_.insert(tree_.erase(it), std::move(kept));
+    }
+};
+
+/**
+ * @brief Lazy set that adapts to its access pattern.
+ * @headerfile adaptive.h <coveo/lazy/adaptive.h>
+ *
+ * <tt>coveo::lazy::adaptive_container</tt> wrapping a <tt>coveo::lazy::set</tt>.
+ *
+ * @tparam K Type of elements stored in the set.
+ * @tparam _Cmp Predicate used to sort the elements.
+ *              Defaults to <tt>std::less<K></tt>.
+ */
+template<class K,
+         class _Cmp = std::less<K>>
+using adaptive_set = adaptive_container<set<K, _Cmp>>;
+
+/**
+ * @brief Lazy multiset that adapts to its access pattern.
+ * @headerfile adaptive.h <coveo/lazy/adaptive.h>
+ *
+ * <tt>coveo::lazy::adaptive_container</tt> wrapping a <tt>coveo::lazy::multiset</tt>.
+ *
+ * @tparam K Type of elements stored in the multiset.
+ * @tparam _Cmp Predicate used to sort the elements.
+ *              Defaults to <tt>std::less<K></tt>.
+ */
+template<class K,
+         class _Cmp = std::less<K>>
+using adaptive_multiset = adaptive_container<multiset<K, _Cmp>>;
+
+/**
+ * @brief Lazy map that adapts to its access pattern.
+ * @headerfile adaptive.h <coveo/lazy/adaptive.h>
+ *
+ * <tt>coveo::lazy::adaptive_container</tt> wrapping a <tt>coveo::lazy::map</tt>.
+ *
+ * @tparam K Type of keys stored in the map.
+ * @tparam T Type of values stored in the map.
+ * @tparam _Cmp Predicate used to sort the keys.
+ *              Defaults to <tt>std::less<K></tt>.
+ */
+template<class K,
+         class T,
+         class _Cmp = std::less<K>>
+using adaptive_map = adaptive_container<map<K, T, _Cmp>>;
+
+/**
+ * @brief Lazy multimap that adapts to its access pattern.
+ * @headerfile adaptive.h <coveo/lazy/adaptive.h>
+ *
+ * <tt>coveo::lazy::adaptive_container</tt> wrapping a <tt>coveo::lazy::multimap</tt>.
+ *
+ * @tparam K Type of keys stored in the multimap.
+ * @tparam T Type of values stored in the multimap.
+ * @tparam _Cmp Predicate used to sort the keys.
+ *              Defaults to <tt>std::less<K></tt>.
+ */
+template<class K,
+         class T,
+         class _Cmp = std::less<K>>
+using adaptive_multimap = adaptive_container<multimap<K, T, _Cmp>>;
+
+} // lazy
+} // coveo
+
+#endif // COVEO_LAZY_ADAPTIVE_H
@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @brief Append policies used by lazy-sorted associative containers.
+ *
+ * This file contains the append policies that can be used to customize how
+ * lazy-sorted containers keep track of the order of elements inserted at
+ * their end, e.g. using <tt>insert()</tt> or <tt>emplace()</tt>. An append
+ * policy is specified through the @c _Append template parameter of
+ * containers like <tt>coveo::lazy::set</tt> or <tt>coveo::lazy::map</tt>:
+ *
+ * @code
+ *   // Time series whose producer always appends increasing timestamps
+ *   coveo::lazy::map<std::int64_t, double, std::less<std::int64_t>, std::vector,
+ *                    coveo::lazy::detail::equal_to_using_less_if_needed<std::int64_t, std::less<std::int64_t>>,
+ *                    coveo::lazy::map_allocator<std::int64_t, double>,
+ *                    coveo::lazy::default_sort_policy,
+ *                    coveo::lazy::no_sort_stats,
+ *                    coveo::lazy::binary_search_policy,
+ *                    coveo::lazy::default_duplicate_policy,
+ *                    coveo::lazy::monotonic_append_policy> series;
+ * @endcode
+ *
+ * An append policy must be a type with the following members:
+ *
+ * - <tt>static const bool trusted</tt>: if @c true, new elements are assumed to
+ *   belong after the last element of the container and are never compared with
+ *   it, except by an @c assert in debug builds.
+ * - <tt>static const bool tracks_tail</tt>: if @c true, new elements are compared
+ *   with the last element even when the container is not sorted, to count how
+ *   many sorted runs its unsorted tail contains. Ignored if @c trusted is @c true.
+ * - <tt>static const std::size_t max_tail_runs</tt>: if @c tracks_tail is @c true,
+ *   unsorted tails made of at most this many sorted runs are merged run by run
+ *   instead of being sorted.
+ *
+ * @copyright 2015-2016, Coveo Solutions Inc.
+ *            Distributed under the Apache License, Version 2.0 (see <a href="https://github.com/coveo/lazy/blob/master/LICENSE">LICENSE</a>).
+ */
+
+#ifndef COVEO_LAZY_APPEND_POLICY_H
+#define COVEO_LAZY_APPEND_POLICY_H
+
+#include <cstddef>
+
+namespace coveo {
+namespace lazy {
+
+/**
+ * @brief Default append policy.
+ * @headerfile append_policy.h <coveo/lazy/append_policy.h>
+ *
+ * Append policy that compares each new element with the last one while the
+ * container is sorted, so that it remains sorted if elements are inserted in
+ * order. Once an element is inserted out of order, new elements are no longer
+ * compared until the container is sorted again, so unordered inserts cost at
+ * most one comparison between sorts. This is the default append policy of
+ * lazy-sorted containers.
+ */
+struct default_append_policy
+{
+    static const bool trusted = false;
+    static const bool tracks_tail = false;
+    static const std::size_t max_tail_runs = 0;
+};
+
+/**
+ * @brief Monotonic append policy.
+ * @headerfile append_policy.h <coveo/lazy/append_policy.h>
+ *
+ * Append policy for producers that always insert elements in order, like
+ * time series appending increasing timestamps. New elements are not compared
+ * with the last one; the container assumes they keep it sorted, as if they
+ * were inserted using the <tt>coveo::lazy::sorted_unique</tt> or
+ * <tt>coveo::lazy::sorted_equivalent</tt> tags. This is only checked in debug builds.
+ *
+ * @warning Inserting an element out of order (or, for containers that do
+ *          not accept duplicates, an element equivalent to the last one)
+ *          results in undefined behavior.
+ */
+struct monotonic_append_policy
+{
+    static const bool trusted = true;
+    static const bool tracks_tail = false;
+    static const std::size_t max_tail_runs = 0;
+};
+
+/**
+ * @brief Run-tracking append policy.
+ * @headerfile append_policy.h <coveo/lazy/append_policy.h>
+ *
+ * Append policy for producers that insert elements mostly in order, like
+ * several interleaved sources that are each sorted. Each new element is
+ * compared with the last one, even when the container is not sorted, and
+ * elements inserted out of order are counted. When the container is sorted,
+ * if its unsorted tail is made of at most @c MaxTailRuns sorted runs, the
+ * runs are merged in <tt>O(n log runs)</tt> instead of being sorted.
+ *
+ * @tparam MaxTailRuns Maximum number of sorted runs to merge instead of
+ *                     sorting. Defaults to 8.
+ */
+template<std::size_t MaxTailRuns = 8>
+struct run_tracking_append_policy
+{
+    static const bool trusted = false;
+    static const bool tracks_tail = true;
+    static const std::size_t max_tail_runs = MaxTailRuns;
+};
+
+} // lazy
+} // coveo
+
+#endif // COVEO_LAZY_APPEND_POLICY_H
@@ -0,0 +1,405 @@
+/**
+ * @file
+ * @brief Definition of lazy-sorted containers that can be shared between threads.
+ *
+ * This file contains the definition of <tt>coveo::lazy::concurrent_container</tt>,
+ * which wraps a lazy-sorted container so that multiple threads can insert elements
+ * and look for them at the same time, as well as aliases like
+ * <tt>coveo::lazy::concurrent_set</tt> and <tt>coveo::lazy::concurrent_map</tt>.
+ *
+ * @code
+ *   coveo::lazy::concurrent_set<int> s;
+ *
+ *   // In writer threads
+ *   s.insert(42);
+ *
+ *   // In reader threads
+ *   auto snap = s.snapshot();
+ *   if (snap.find(42) != snap.end()) {
+ *       // ...
+ *   }
+ * @endcode
+ *
+ * @copyright 2015-2016, Coveo Solutions Inc.
+ *            Distributed under the Apache License, Version 2.0 (see <a href="https://github.com/coveo/lazy/blob/master/LICENSE">LICENSE</a>).
+ */
+
+#ifndef COVEO_LAZY_CONCURRENT_H
+#define COVEO_LAZY_CONCURRENT_H
+
+#include <coveo/lazy/map.h>
+#include <coveo/lazy/set.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+// std::atomic<std::shared_ptr> is available in C++20; before that, we use the
+// std::atomic_load/std::atomic_store overloads for std::shared_ptr instead.
+#if defined(__cpp_lib_atomic_shared_ptr) && __cpp_lib_atomic_shared_ptr >= 201711L
+#  define COVEO_LAZY_HAS_ATOMIC_SHARED_PTR 1
+#endif
+
+namespace coveo {
+namespace lazy {
+
+/**
+ * @brief Lazy-sorted container that can be shared between threads.
+ * @headerfile concurrent.h <coveo/lazy/concurrent.h>
+ *
+ * Wrapper around a lazy-sorted container that can be used by multiple
+ * threads at once without external locking. It works as follows:
+ *
+ * - Inserted elements are appended to one of @c Shards pending containers,
+ *   chosen according to the inserting thread. Each pending container has its
+ *   own lock, so threads inserting at the same time usually do not wait
+ *   for each other.
+ * - Lookups are performed on a <em>snapshot</em>: an immutable, sorted
+ *   <tt>Container::view_type</tt> that shares ownership of its elements.
+ *   Reading from a snapshot never sorts nor locks, so any number of threads
+ *   can use snapshots at once. Snapshots stay valid (along with their iterators)
+ *   for as long as they are kept, even when elements are inserted afterwards.
+ * - When a snapshot is requested after elements were inserted, pending elements
+ *   are merged with those of the last snapshot and sorted, once, under a lock.
+ *   Other threads requesting a snapshot at the same time wait for the new one;
+ *   when no element was inserted, getting a snapshot does not lock.
+ *
+ * Elements inserted by a thread are always part of the snapshots this thread
+ * requests afterwards. As with <tt>Container::merge()</tt>, for containers that
+ * do not accept duplicates, elements whose keys are already in the last snapshot
+ * are discarded.
+ *
+ * Costs to be aware of:
+ *
+ * - Publishing a new snapshot copies <em>all</em> the elements of the previous
+ *   one (and then sorts the pending ones into the copy), so each publication
+ *   is linear in the size of the container, not in the number of elements
+ *   inserted since the last one. This class is therefore best suited for
+ *   workloads where elements are inserted in batches, between which many
+ *   lookups are performed.
+ * - <tt>snapshot()</tt> is not free, even when nothing was inserted: it
+ *   atomically loads a <tt>std::shared_ptr</tt> and returns a copy of the
+ *   snapshot, which increments (and later decrements) a shared reference count.
+ *   When <tt>std::atomic<std::shared_ptr></tt> is available (C++20), it is used;
+ *   it is usually not lock-free, but only contends with threads touching the
+ *   same pointer. Otherwise, <tt>std::atomic_load</tt> is used, which on common
+ *   standard libraries locks a mutex taken from a small global pool shared by
+ *   all <tt>std::shared_ptr</tt> atomic operations in the program. In both cases,
+ *   the reference count is a cache line written by every reader. Threads that
+ *   perform many lookups should therefore keep a snapshot and reuse it rather
+ *   than calling <tt>snapshot()</tt> (or <tt>count()</tt>, <tt>size()</tt>) for
+ *   each lookup.
+ *
+ * @tparam Container Type of lazy-sorted container to wrap, like <tt>coveo::lazy::set</tt>.
+ *                   Must store its elements contiguously (which is the case with the default
+ *                   <tt>std::vector</tt> internal container).
+ * @tparam Shards Number of pending containers. Defaults to 16.
+ */
+template<class Container,
+         std::size_t Shards = 16>
+class concurrent_container
+{
+    static_assert(Shards > 0, "concurrent_container needs at least one shard");
+
+public:
+    /// Type of lazy-sorted container wrapped.
+    using container_type = Container;
+    /// Type of immutable snapshot returned by <tt>snapshot()</tt>.
+    using snapshot_type = typename Container::view_type;
+    /// Type of keys.
+    using key_type = typename Container::key_type;
+    /// Type of elements.
+    using value_type = typename Container::value_type;
+    /// Predicate used to compare keys.
+    using key_compare = typename Container::key_compare;
+    /// Type used for sizes.
+    using size_type = typename Container::size_type;
+
+private:
+    // Pending elements inserted by some threads. Padded so that
+    // threads using different shards do not share cache lines.
+    struct shard {
+        std::mutex mutex;
+        Container elements;
+        char padding[64];
+
+        explicit shard(const key_compare& kcmp) : mutex(), elements(kcmp) { }
+    };
+
+    key_compare kcmp_;                                  // Key comparator.
+    std::array<std::unique_ptr<shard>, Shards> shards_; // Pending elements.
+    std::atomic<std::uint64_t> inserted_gen_;           // Number of insertions performed.
+    std::atomic<std::uint64_t> published_gen_;          // Number of insertions included in last snapshot.
+    std::mutex publish_mutex_;                          // Lock to publish snapshots.
+    std::shared_ptr<const Container> committed_;       // Elements of the last snapshot; protected by publish_mutex_.
+#ifdef COVEO_LAZY_HAS_ATOMIC_SHARED_PTR
+    std::atomic<std::shared_ptr<const snapshot_type>> snapshot_; // Last snapshot.
+#else
+    std::shared_ptr<const snapshot_type> snapshot_;     // Last snapshot; accessed with std::atomic_load/std::atomic_store.
+#endif
+
+public:
+    /**
+     * @brief Default constructor.
+     *
+     * Creates an empty container.
+     *
+     * @param kcmp @c key_compare instance to use for this container.
+     */
+    explicit concurrent_container(const key_compare& kcmp = key_compare())
+        : kcmp_(kcmp), shards_(), inserted_gen_(0), published_gen_(0), publish_mutex_(),
+          committed_(std::make_shared<const Container>(kcmp)),
+          snapshot_(std::make_shared<const snapshot_type>(kcmp))
+    {
+        for (auto& s : shards_) {
+            s.reset(new shard(kcmp));
+        }
+    }
+
+    /// @brief Deleted copy constructor; containers used by multiple threads cannot be copied.
+    concurrent_container(const concurrent_container&) = delete;
+    /// @brief Deleted assignment operator; containers used by multiple threads cannot be copied.
+    concurrent_container& operator=(const concurrent_container&) = delete;
+
+    /**
+     * @brief Inserts an element.
+     *
+     * Appends a copy of @c value to pending elements. It will be part of
+     * the next snapshot.
+     *
+     * @param value Element to insert.
+     */
+    void insert(const value_type& value) {
+        with_shard([&](Container& elements) { elements.insert(value); });
+    }
+
+    /**
+     * @brief Inserts an element (move version).
+     *
+     * @param value Element to move in the container.
+     */
+    void insert(value_type&& value) {
+        with_shard([&](Container& elements) { elements.insert(std::move(value)); });
+    }
+
+    /**
+     * @brief Inserts a range of elements.
+     *
+     * Appends copies of the elements in <tt>[first, last[</tt> to pending elements.
+     * They will be part of the next snapshot.
+     *
+     * @param first Beginning of the range of elements to insert (inclusive).
+     * @param last End of the range of elements to insert (exclusive).
+     */
+    template<class It> void insert(It first, It last) {
+        with_shard([&](Container& elements) { elements.insert(first, last); });
+    }
+
+    /**
+     * @brief Constructs an element in the container.
+     *
+     * @param args Arguments to pass to the element's constructor.
+     */
+    template<class... Args> void emplace(Args&&... args) {
+        with_shard([&](Container& elements) { elements.emplace(std::forward<Args>(args)...); });
+    }
+
+    /**
+     * @brief Returns a snapshot of the container.
+     *
+     * Returns an immutable, sorted view of all the elements inserted before
+     * this call (by this thread) that can be read without locking. If elements
+     * were inserted since the last snapshot, they are merged and sorted first,
+     * which copies all elements of the previous snapshot.
+     *
+     * Even when no element was inserted, this performs an atomic load of a
+     * <tt>std::shared_ptr</tt> (which may lock, see class documentation) and
+     * a reference count increment; keep the returned snapshot to perform
+     * several lookups.
+     *
+     * @return Snapshot of the container's elements.
+     */
+    snapshot_type snapshot() {
+        if (published_gen_.load(std::memory_order_acquire) != inserted_gen_.load(std::memory_order_acquire)) {
+            publish();
+        }
+        return *load_snapshot();
+    }
+
+    /**
+     * @brief Returns number of elements associated to a key.
+     *
+     * Shortcut for <tt>snapshot().count(key)</tt>.
+     *
+     * @param key Key of element(s) to count.
+     * @return Number of elements associated with @c key.
+     */
+    size_type count(const key_type& key) {
+        return snapshot().count(key);
+    }
+
+    /**
+     * @brief Returns number of elements in the container.
+     *
+     * Shortcut for <tt>snapshot().size()</tt>.
+     *
+     * @return Number of elements, including those inserted but not yet part of a snapshot.
+     */
+    size_type size() {
+        return snapshot().size();
+    }
+
+    /**
+     * @brief Removes all elements.
+     *
+     * Removes pending elements and publishes an empty snapshot. Existing
+     * snapshots are not affected.
+     */
+    void clear() {
+        std::lock_guard<std::mutex> lock(publish_mutex_);
+        const std::uint64_t target_gen = inserted_gen_.load(std::memory_order_acquire);
+        for (auto& s : shards_) {
+            std::lock_guard<std::mutex> shard_lock(s->mutex);
+            s->elements.clear();
+        }
+        committed_ = std::make_shared<const Container>(kcmp_);
+        store_snapshot(std::make_shared<const snapshot_type>(kcmp_));
+        published_gen_.store(target_gen, std::memory_order_release);
+    }
+
+private:
+    // Atomically loads the last snapshot.
+    std::shared_ptr<const snapshot_type> load_snapshot() const {
+#ifdef COVEO_LAZY_HAS_ATOMIC_SHARED_PTR
+        return snapshot_.load(std::memory_order_acquire);
+#else
+        return std::atomic_load_explicit(&snapshot_, std::memory_order_acquire);
+#endif
+    }
+
+    // Atomically replaces the last snapshot.
+    void store_snapshot(std::shared_ptr<const snapshot_type> snap) {
+#ifdef COVEO_LAZY_HAS_ATOMIC_SHARED_PTR
+        snapshot_.store(std::move(snap), std::memory_order_release);
+#else
+        std::atomic_store_explicit(&snapshot_, std::move(snap), std::memory_order_release);
+#endif
+    }
+
+    // Calls f with the pending elements of this thread's shard, locked.
+    template<class F> void with_shard(const F& f) {
+        shard& s = *shards_[std::hash<std::thread::id>()(std::this_thread::get_id()) % Shards];
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            f(s.elements);
+        }
+        inserted_gen_.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    // Merges pending elements with those of the last snapshot and publishes a new snapshot.
+    void publish() {
+        std::lock_guard<std::mutex> lock(publish_mutex_);
+
+        // All insertions counted in target_gen have been performed before we drain shards,
+        // so the new snapshot includes them (and maybe more).
+        const std::uint64_t target_gen = inserted_gen_.load(std::memory_order_acquire);
+        if (published_gen_.load(std::memory_order_relaxed) == target_gen) {
+            // Another thread published while we waited.
+            return;
+        }
+        auto next = std::make_shared<Container>(*committed_);
+        for (auto& s : shards_) {
+            Container pending(kcmp_);
+            {
+                std::lock_guard<std::mutex> shard_lock(s->mutex);
+                swap(pending, s->elements);
+            }
+            next->splice(std::move(pending));
+        }
+        next->sort();
+        auto first = next->empty() ? nullptr : std::addressof(*next->cbegin());
+        auto snap = std::make_shared<const snapshot_type>(first, first + next->size(), next, kcmp_);
+        committed_ = std::move(next);
+        store_snapshot(std::move(snap));
+        published_gen_.store(target_gen, std::memory_order_release);
+    }
+};
+
+/**
+ * @brief Lazy set that can be shared between threads.
+ * @headerfile concurrent.h <coveo/lazy/concurrent.h>
+ *
+ * <tt>coveo::lazy::concurrent_container</tt> wrapping a <tt>coveo::lazy::set</tt>.
+ *
+ * @tparam K Type of elements stored in the set.
+ * @tparam _Cmp Predicate used to sort the elements.
+ *              Defaults to <tt>std::less<K></tt>.
+ * @tparam Shards Number of pending containers. Defaults to 16.
+ */
+template<class K,
+         class _Cmp = std::less<K>,
+         std::size_t Shards = 16>
+using concurrent_set = concurrent_container<set<K, _Cmp>, Shards>;
+
+/**
+ * @brief Lazy multiset that can be shared between threads.
+ * @headerfile concurrent.h <coveo/lazy/concurrent.h>
+ *
+ * <tt>coveo::lazy::concurrent_container</tt> wrapping a <tt>coveo::lazy::multiset</tt>.
+ *
+ * @tparam K Type of elements stored in the multiset.
+ * @tparam _Cmp Predicate used to sort the elements.
+ *              Defaults to <tt>std::less<K></tt>.
+ * @tparam Shards Number of pending containers. Defaults to 16.
+ */
+template<class K,
+         class _Cmp = std::less<K>,
+         std::size_t Shards = 16>
+using concurrent_multiset = concurrent_container<multiset<K, _Cmp>, Shards>;
+
+/**
+ * @brief Lazy map that can be shared between threads.
+ * @headerfile concurrent.h <coveo/lazy/concurrent.h>
+ *
+ * <tt>coveo::lazy::concurrent_container</tt> wrapping a <tt>coveo::lazy::map</tt>.
+ *
+ * @tparam K Type of keys stored in the map.
+ * @tparam T Type of values stored in the map.
+ * @tparam _Cmp Predicate used to sort the keys.
+ *              Defaults to <tt>std::less<K></tt>.
+ * @tparam Shards Number of pending containers. Defaults to 16.
+ */
+template<class K,
+         class T,
+         class _Cmp = std::less<K>,
+         std::size_t Shards = 16>
+using concurrent_map = concurrent_container<map<K, T, _Cmp>, Shards>;
+
+/**
+ * @brief Lazy multimap that can be shared between threads.
+ * @headerfile concurrent.h <coveo/lazy/concurrent.h>
+ *
+ * <tt>coveo::lazy::concurrent_container</tt> wrapping a <tt>coveo::lazy::multimap</tt>.
+ *
+ * @tparam K Type of keys stored in the multimap.
+ * @tparam T Type of values stored in the multimap.
+ * @tparam _Cmp Predicate used to sort the keys.
+ *              Defaults to <tt>std::less<K></tt>.
+ * @tparam Shards Number of pending containers. Defaults to 16.
+ */
+template<class K,
+         class T,
+         class _Cmp = std::less<K>,
+         std::size_t Shards = 16>
+using concurrent_multimap = concurrent_container<multimap<K, T, _Cmp>, Shards>;
+
+} // lazy
+} // coveo
+
+#endif // COVEO_LAZY_CONCURRENT_H
@@ -0,0 +1,298 @@
+/**
+ * @file
+ * @brief Branchless binary search used by lazy-sorted containers.
+ *
+ * This header file contains an implementation of binary search that avoids
+ * unpredictable branches. It is used by <tt>coveo::lazy::binary_search_policy</tt>
+ * to look for elements with arithmetic keys. It should not be necessary to
+ * use types defined in this header directly.
+ *
+ * @copyright 2015-2016, Coveo Solutions Inc.
+ *            Distributed under the Apache License, Version 2.0 (see <a href="https://github.com/coveo/lazy/blob/master/LICENSE">LICENSE</a>).
+ */
+
+#ifndef COVEO_LAZY_DETAIL_BRANCHLESS_SEARCH_H
+#define COVEO_LAZY_DETAIL_BRANCHLESS_SEARCH_H
+
+#include <coveo/lazy/detail/radix_sort.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace coveo {
+namespace lazy {
+namespace detail {
+
+/**
+ * @internal
+ * @brief Trait to detect if a branchless search can be used.
+ * @headerfile branchless_search.h <coveo/lazy/detail/branchless_search.h>
+ *
+ * Has a @c value member set to @c true if elements referred to by @c RandIt
+ * and compared by @c Cmp can be searched for keys of type @c OK using
+ * @c branchless_lower_bound and @c branchless_upper_bound. This is the case if
+ * @c Cmp is a value predicate (like <tt>lazy_value_pred_proxy</tt>) that gives
+ * access to its "value to key" predicate and its key predicate, if keys are
+ * arithmetic, if @c OK is the key type and if the key predicate is
+ * <tt>std::less</tt> or <tt>std::greater</tt>. For such keys, comparisons
+ * are cheap and can be turned into conditional moves.
+ *
+ * @tparam RandIt Type of iterator to elements to search.
+ * @tparam Cmp Predicate used to compare elements.
+ * @tparam OK Type of key to look for.
+ */
+template<class RandIt, class Cmp, class OK, class = void>
+struct is_branchless_searchable {
+    static const bool value = false;
+};
+template<class RandIt, class Cmp, class OK>
+struct is_branchless_searchable<RandIt, Cmp, OK,
+                                typename make_void<decltype(std::declval<const Cmp&>().value_to_key()),
+                                                   decltype(std::declval<const Cmp&>().key_predicate())>::type>
+{
+    using element_type = typename std::iterator_traits<RandIt>::value_type;
+    using value_to_key = std::decay_t<decltype(std::declval<const Cmp&>().value_to_key())>;
+    using key_predicate = std::decay_t<decltype(std::declval<const Cmp&>().key_predicate())>;
+    using key_type = std::decay_t<decltype(std::declval<const value_to_key&>()(std::declval<const element_type&>()))>;
+
+    static const bool value = std::is_base_of<std::random_access_iterator_tag,
+                                              typename std::iterator_traits<RandIt>::iterator_category>::value &&
+                              std::is_arithmetic<key_type>::value &&
+                              std::is_same<std::decay_t<OK>, key_type>::value &&
+                              radix_key_order<key_predicate, key_type>::value;
+};
+
+/**
+ * @internal
+ * @brief Number of elements under which branchless search switches to a linear scan.
+ * @headerfile branchless_search.h <coveo/lazy/detail/branchless_search.h>
+ *
+ * When that few elements remain, counting them with a straight loop (which
+ * compilers can vectorize) is faster than continuing to halve the range.
+ */
+const std::size_t branchless_search_scan_size = 16;
+
+/**
+ * @internal
+ * @brief Branchless partition point of a sorted range.
+ * @headerfile branchless_search.h <coveo/lazy/detail/branchless_search.h>
+ *
+ * Returns the position of the first element in <tt>[first, last[</tt> for
+ * which @c before returns @c false, assuming the range is partitioned
+ * according to @c before. The range is halved without branching on the
+ * result of @c before until few elements remain; those are then counted
+ * in a single loop without early exit.
+ *
+ * @param first Beginning of range to search.
+ * @param last End of range to search.
+ * @param before Predicate returning @c true for elements that come before the partition point.
+ * @return Position of the partition point, relative to @c first.
+ */
+template<class RandIt, class Before>
+std::size_t branchless_partition_point(RandIt first, RandIt last, const Before& before)
+{
+    auto len = static_cast<std::size_t>(std::distance(first, last));
+    RandIt base = first;
+    while (len > branchless_search_scan_size) {
+        const std::size_t half = len / 2;
+#if defined(__GNUC__) || defined(__clang__)
+        // Prefetch both possible middles of the next iteration, since we don't branch.
+        __builtin_prefetch(std::addressof(base[half / 2]));
+        __builtin_prefetch(std::addressof(base[half + half / 2]));
+#endif
+        base = before(base[half]) ? base + half : base;
+        len -= half;
+    }
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < len; ++i) {
+        count += before(base[i]) ? 1 : 0;
+    }
+    return static_cast<std::size_t>(std::distance(first, base)) + count;
+}
+
+/**
+ * @internal
+ * @brief Number of keys searched together by @c branchless_lower_bound_each.
+ * @headerfile branchless_search.h <coveo/lazy/detail/branchless_search.h>
+ */
+const std::size_t branchless_search_batch_size = 8;
+
+/**
+ * @internal
+ * @brief Branchless lower bounds of many keys.
+ * @headerfile branchless_search.h <coveo/lazy/detail/branchless_search.h>
+ *
+ * Looks for the lower bounds of keys in <tt>[kfirst, klast[</tt> by groups of
+ * @c branchless_search_batch_size. Since all searches are performed on the same
+ * range, they take the same number of steps; the steps of the searches of a group
+ * are interleaved, so that the memory accesses of one search overlap those of the
+ * others instead of waiting for them. Can only be used if
+ * <tt>is_branchless_searchable<RandIt, Cmp, K></tt> is @c true, where @c K is
+ * the type of keys.
+ *
+ * @param first Beginning of range to search.
+ * @param last End of range to search.
+ * @param kfirst Beginning of range of keys to look for.
+ * @param klast End of range of keys to look for.
+ * @param cmp Value predicate used to compare elements with keys.
+ * @param found Called with each key and the position of its lower bound, relative
+ *              to @c first, in the order of keys. Must return @c false to stop.
+ * @return @c false if @c found returned @c false, @c true otherwise.
+ */
+template<class RandIt, class KeyIt, class Cmp, class Found>
+bool branchless_lower_bound_each(RandIt first, RandIt last, KeyIt kfirst, KeyIt klast, const Cmp& cmp, const Found& found)
+{
+    using key_type = std::decay_t<decltype(*kfirst)>;
+    const std::size_t batch_size = branchless_search_batch_size;
+
+    const auto vtok = cmp.value_to_key();
+    const auto kcmp = cmp.key_predicate();
+    const auto size = static_cast<std::size_t>(std::distance(first, last));
+    key_type keys[batch_size];
+    std::size_t bases[batch_size];
+    while (kfirst != klast) {
+        std::size_t num_keys = 0;
+        for (; num_keys < batch_size && kfirst != klast; ++num_keys, ++kfirst) {
+            keys[num_keys] = *kfirst;
+            bases[num_keys] = 0;
+        }
+        std::size_t len = size;
+        while (len > branchless_search_scan_size) {
+            const std::size_t half = len / 2;
+            for (std::size_t i = 0; i < num_keys; ++i) {
+#if defined(__GNUC__) || defined(__clang__)
+                __builtin_prefetch(std::addressof(first[bases[i] + half / 2]));
+                __builtin_prefetch(std::addressof(first[bases[i] + half + half / 2]));
+#endif
+                bases[i] = kcmp(vtok(first[bases[i] + half]), keys[i]) ? bases[i] + half : bases[i];
+            }
+            len -= half;
+        }
+        for (std::size_t i = 0; i < num_keys; ++i) {
+            std::size_t count = 0;
+            for (std::size_t j = 0; j < len; ++j) {
+                count += kcmp(vtok(first[bases[i] + j]), keys[i]) ? 1 : 0;
+            }
+            if (!found(keys[i], bases[i] + count)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @internal
+ * @brief Branchless equivalent of <tt>std::lower_bound</tt>.
+ * @headerfile branchless_search.h <coveo/lazy/detail/branchless_search.h>
+ *
+ * Can only be used if <tt>is_branchless_searchable<RandIt, Cmp, OK>::value</tt> is @c true.
+ *
+ * @return Position of the first element not less than @c key, relative to @c first.
+ */
+template<class RandIt, class OK, class Cmp>
+std::size_t branchless_lower_bound(RandIt first, RandIt last, const OK& key, const Cmp& cmp)
+{
+    using element_type = typename std::iterator_traits<RandIt>::value_type;
+    const auto vtok = cmp.value_to_key();
+    const auto kcmp = cmp.key_predicate();
+    return branchless_partition_point(first, last, [&](const element_type& elem) {
+        return kcmp(vtok(elem), key);
+    });
+}
+
+/**
+ * @internal
+ * @brief Branchless equivalent of <tt>std::upper_bound</tt>.
+ * @headerfile branchless_search.h <coveo/lazy/detail/branchless_search.h>
+ *
+ * Can only be used if <tt>is_branchless_searchable<RandIt, Cmp, OK>::value</tt> is @c true.
+ *
+ * @return Position of the first element greater than @c key, relative to @c first.
+ */
+template<class RandIt, class OK, class Cmp>
+std::size_t branchless_upper_bound(RandIt first, RandIt last, const OK& key, const Cmp& cmp)
+{
+    using element_type = typename std::iterator_traits<RandIt>::value_type;
+    const auto vtok = cmp.value_to_key();
+    const auto kcmp = cmp.key_predicate();
+    return branchless_partition_point(first, last, [&](const element_type& elem) {
+        return !kcmp(key, vtok(elem));
+    });
+}
+
+/**
+ * @internal
+ * @brief Lower bound of a key, using a branchless search if possible.
+ * @headerfile branchless_search.h <coveo/lazy/detail/branchless_search.h>
+ *
+ * @return Position of the first element not less than @c key, relative to @c first.
+ */
+template<class RandIt, class OK, class Cmp>
+std::size_t lower_bound_position(RandIt first, RandIt last, const OK& key, const Cmp& cmp, std::true_type) {
+    return branchless_lower_bound(first, last, key, cmp);
+}
+template<class RandIt, class OK, class Cmp>
+std::size_t lower_bound_position(RandIt first, RandIt last, const OK& key, const Cmp& cmp, std::false_type) {
+    return static_cast<std::size_t>(std::distance(first, std::lower_bound(first, last, key, cmp)));
+}
+template<class RandIt, class OK, class Cmp>
+std::size_t lower_bound_position(RandIt first, RandIt last, const OK& key, const Cmp& cmp) {
+    return lower_bound_position(first, last, key, cmp,
+                                std::integral_constant<bool, is_branchless_searchable<RandIt, Cmp, OK>::value>());
+}
+
+/**
+ * @internal
+ * @brief Upper bound of a key, using a branchless search if possible.
+ * @headerfile branchless_search.h <coveo/lazy/detail/branchless_search.h>
+ *
+ * @return Position of the first element greater than @c key, relative to @c first.
+ */
+template<class RandIt, class OK, class Cmp>
+std::size_t upper_bound_position(RandIt first, RandIt last, const OK& key, const Cmp& cmp, std::true_type) {
+    return branchless_upper_bound(first, last, key, cmp);
+}
+template<class RandIt, class OK, class Cmp>
+std::size_t upper_bound_position(RandIt first, RandIt last, const OK& key, const Cmp& cmp, std::false_type) {
+    return static_cast<std::size_t>(std::distance(first, std::upper_bound(first, last, key, cmp)));
+}
+template<class RandIt, class OK, class Cmp>
+std::size_t upper_bound_position(RandIt first, RandIt last, const OK& key, const Cmp& cmp) {
+    return upper_bound_position(first, last, key, cmp,
+                                std::integral_constant<bool, is_branchless_searchable<RandIt, Cmp, OK>::value>());
+}
+
+/**
+ * @internal
+ * @brief Equal range of a key, using a branchless search if possible.
+ * @headerfile branchless_search.h <coveo/lazy/detail/branchless_search.h>
+ *
+ * @return Positions of the lower and upper bounds of @c key, relative to @c first.
+ */
+template<class RandIt, class OK, class Cmp>
+std::pair<std::size_t, std::size_t> equal_range_positions(RandIt first, RandIt last, const OK& key, const Cmp& cmp, std::true_type) {
+    const std::size_t lower = branchless_lower_bound(first, last, key, cmp);
+    return std::make_pair(lower, lower + branchless_upper_bound(first + lower, last, key, cmp));
+}
+template<class RandIt, class OK, class Cmp>
+std::pair<std::size_t, std::size_t> equal_range_positions(RandIt first, RandIt last, const OK& key, const Cmp& cmp, std::false_type) {
+    auto range = std::equal_range(first, last, key, cmp);
+    return std::make_pair(static_cast<std::size_t>(std::distance(first, range.first)),
+                          static_cast<std::size_t>(std::distance(first, range.second)));
+}
+template<class RandIt, class OK, class Cmp>
+std::pair<std::size_t, std::size_t> equal_range_positions(RandIt first, RandIt last, const OK& key, const Cmp& cmp) {
+    return equal_range_positions(first, last, key, cmp,
+                                 std::integral_constant<bool, is_branchless_searchable<RandIt, Cmp, OK>::value>());
+}
+
+} // detail
+} // lazy
+} // coveo
+
+#endif // COVEO_LAZY_DETAIL_BRANCHLESS_SEARCH_H
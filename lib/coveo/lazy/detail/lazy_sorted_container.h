@@ -96,18 +96,42 @@
 #ifndef COVEO_LAZY_DETAIL_LAZY_SORTED_CONTAINER_H
 #define COVEO_LAZY_DETAIL_LAZY_SORTED_CONTAINER_H
 
+#include <coveo/lazy/append_policy.h>
+#include <coveo/lazy/duplicate_policy.h>
 #include <coveo/lazy/exception.h>
+#include <coveo/lazy/memory_stats.h>
+#include <coveo/lazy/search_policy.h>
+#include <coveo/lazy/sort_policy.h>
+#include <coveo/lazy/sort_stats.h>
+#include <coveo/lazy/sorted_view.h>
+#include <coveo/lazy/tags.h>
 
 #include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <functional>
+#include <future>
 #include <initializer_list>
 #include <iterator>
 #include <memory>
+#include <ostream>
 #include <stdexcept>
+#include <thread>
 #include <tuple>
 #include <type_traits>
 #include <utility>
+#include <vector>
+
+// Polymorphic allocators (std::pmr) are available since C++17.
+#if defined(__has_include)
+#  if __has_include(<memory_resource>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#    include <memory_resource>
+#    define COVEO_LAZY_HAS_MEMORY_RESOURCE 1
+#  endif
+#endif
 
 namespace coveo {
 namespace lazy {
@@ -204,6 +228,68 @@ public:
     static const bool value = sizeof(test<T>(nullptr)) == sizeof(std::int_least8_t);
 };
 
+/**
+ * @internal
+ * @brief Trait to detect @c data method.
+ * @headerfile lazy_sorted_container.h <coveo/lazy/detail/lazy_sorted_container.h>
+ *
+ * Type trait that can be used to know if a type has a <tt>data() const</tt>
+ * method that returns a pointer, like containers that store their elements
+ * contiguously (e.g. <tt>std::vector</tt>).
+ */
+template<class T>
+class has_data_const_method
+{
+    static_assert(sizeof(std::int_least8_t) != sizeof(std::int_least32_t),
+                  "has_data_const_method only works if int_least8_t has a different size than int_least32_t");
+
+    template<class C> static std::int_least8_t  test(std::enable_if_t<std::is_pointer<decltype(std::declval<const C>().data())>::value, void*>);  // Will be selected if C has data() that returns a pointer
+    template<class C> static std::int_least32_t test(...);                                                                                         // Will be selected otherwise
+public:
+    static const bool value = sizeof(test<T>(nullptr)) == sizeof(std::int_least8_t);
+};
+
+/**
+ * @internal
+ * @brief Trait to get inline capacity of a container.
+ * @headerfile lazy_sorted_container.h <coveo/lazy/detail/lazy_sorted_container.h>
+ *
+ * Type trait that can be used to know how many elements a container can
+ * store without allocating memory, if it has a static @c inline_capacity
+ * member like <tt>coveo::lazy::small_vector</tt>. Otherwise, @c value is 0.
+ */
+template<class T>
+class inline_capacity_of
+{
+    template<class C> static constexpr std::size_t get(decltype(C::inline_capacity)*) { return C::inline_capacity; }  // Will be selected if C has inline_capacity
+    template<class C> static constexpr std::size_t get(...) { return 0; }                                            // Will be selected otherwise
+public:
+    static constexpr std::size_t value = get<T>(nullptr);
+};
+template<class T> constexpr std::size_t inline_capacity_of<T>::value;
+
+/**
+ * @internal
+ * @brief Helper to get capacity of a container, if known.
+ * @headerfile lazy_sorted_container.h <coveo/lazy/detail/lazy_sorted_container.h>
+ *
+ * Helper type that returns the capacity of a container if it has a
+ * <tt>capacity() const</tt> method (see <tt>has_capacity_const_method</tt>),
+ * otherwise its size.
+ *
+ * @tparam HasCapacity Whether container has a <tt>capacity() const</tt> method.
+ */
+template<bool HasCapacity> struct container_capacity_or_size {
+    template<class C> std::size_t operator()(const C& c) const {
+        return static_cast<std::size_t>(c.size());
+    }
+};
+template<> struct container_capacity_or_size<true> {
+    template<class C> std::size_t operator()(const C& c) const {
+        return static_cast<std::size_t>(c.capacity());
+    }
+};
+
 /**
  * @internal
  * @brief Predicate that proxies a key-based predicate.
@@ -230,6 +316,10 @@ public:
     lazy_value_pred_proxy(OVToK&& vtok, OKPred&& kpr)
         : vtok_(std::forward<OVToK>(vtok)), kpr_(std::forward<OKPred>(kpr)) { }
 
+    VToK value_to_key() const {
+        return vtok_;
+    }
+
     KPred key_predicate() const {
         return kpr_;
     }
@@ -303,7 +393,8 @@ public:
     forward_iterator_proxy(forward_iterator_proxy<OIt, OV, OPubV, _OItCat, _ODiff>&& other)
         : it_(std::move(other.it_)) { }
     template<class T,
-             class = std::enable_if_t<!is_forward_iterator_proxy<std::decay_t<T>>::value, void>>
+             class = std::enable_if_t<!is_forward_iterator_proxy<std::decay_t<T>>::value &&
+                                      std::is_constructible<It, T&&>::value, void>>
     forward_iterator_proxy(T&& obj) : it_(std::forward<T>(obj)) { }
     template<class T1, class T2, class... Tx>
     forward_iterator_proxy(T1&& obj1, T2&& obj2, Tx&&... objx)
@@ -396,7 +487,8 @@ public:
     bidirectional_iterator_proxy(bidirectional_iterator_proxy<OIt, OV, OPubV, _OItCat, _ODiff>&& other)
         : forward_iterator_proxy<It, V, PubV, _ItCat, _Diff>(static_cast<forward_iterator_proxy<OIt, OV, OPubV, _OItCat, _ODiff>&&>(other)) { }
     template<class T,
-             class = std::enable_if_t<!is_bidirectional_iterator_proxy<std::decay_t<T>>::value, void>>
+             class = std::enable_if_t<!is_bidirectional_iterator_proxy<std::decay_t<T>>::value &&
+                                      std::is_constructible<It, T&&>::value, void>>
     bidirectional_iterator_proxy(T&& obj)
         : forward_iterator_proxy<It, V, PubV, _ItCat, _Diff>(std::forward<T>(obj)) { }
     template<class T1, class T2, class... Tx>
@@ -485,7 +577,8 @@ public:
     random_access_iterator_proxy(random_access_iterator_proxy<OIt, OV, OPubV, _OItCat, _ODiff>&& other)
         : bidirectional_iterator_proxy<It, V, PubV, _ItCat, _Diff>(static_cast<bidirectional_iterator_proxy<OIt, OV, OPubV, _OItCat, _ODiff>&&>(other)) { }
     template<class T,
-             class = std::enable_if_t<!is_random_access_iterator_proxy<std::decay_t<T>>::value, void>>
+             class = std::enable_if_t<!is_random_access_iterator_proxy<std::decay_t<T>>::value &&
+                                      std::is_constructible<It, T&&>::value, void>>
     random_access_iterator_proxy(T&& obj)
         : bidirectional_iterator_proxy<It, V, PubV, _ItCat, _Diff>(std::forward<T>(obj)) { }
     template<class T1, class T2, class... Tx>
@@ -646,8 +739,8 @@ using conditional_iterator_proxy = std::conditional_t<std::is_same<PubV, V>::val
  * @brief Helper for @c sort_if_needed.
  * @headerfile lazy_sorted_container.h <coveo/lazy/detail/lazy_sorted_container.h>
  *
- * Helper type that calls <tt>sort_if_needed()</tt> on a lazy sorted container
- * only if it does not support duplicates.
+ * Helper type that calls <tt>sort_if_needed_for_lookup()</tt> on a lazy sorted
+ * container only if it does not support duplicates.
  *
  * @tparam Multi Whether lazy sorted container accepts duplicates.
  */
@@ -656,7 +749,146 @@ template<> struct sort_lazy_container_if_needed_and_not_multi<true> {
     template<class LazyC> void operator()(LazyC&) const { }
 };
 template<> struct sort_lazy_container_if_needed_and_not_multi<false> {
-    template<class LazyC> void operator()(LazyC& c) const { c.sort_if_needed(); }
+    template<class LazyC> void operator()(LazyC& c) const { c.sort_if_needed_for_lookup(false); }
+};
+
+/**
+ * @internal
+ * @brief Helper to remove duplicates from pending elements.
+ * @headerfile lazy_sorted_container.h <coveo/lazy/detail/lazy_sorted_container.h>
+ *
+ * Helper type that removes newly-inserted elements from the unsorted tail of
+ * a lazy sorted container if they are duplicates, but only if the container
+ * does not support duplicates and if lookups can scan its unsorted tail (see
+ * <tt>set_pending_limit()</tt>). This ensures that sorting will not remove any
+ * element, so that iterators returned by lookups remain comparable to <tt>end()</tt>.
+ * Duplicates are first resolved with the existing elements using the container's
+ * duplicate policy (see <tt>coveo/lazy/duplicate_policy.h</tt>).
+ *
+ * @tparam Multi Whether lazy sorted container accepts duplicates.
+ */
+template<bool Multi> struct remove_lazy_container_pending_duplicates;
+template<> struct remove_lazy_container_pending_duplicates<true> {
+    template<class LazyC> void operator()(LazyC&, typename LazyC::size_type) const { }
+};
+template<> struct remove_lazy_container_pending_duplicates<false> {
+    template<class LazyC> void operator()(LazyC& c, typename LazyC::size_type first_new) const {
+        if (c.sorted_ || c.elements_.size() - c.sorted_until_ > c.pending_limit_) {
+            return;
+        }
+        if (!c.pending_erases_.empty()) {
+            // Pending elements could be re-inserting keys erased by lazy_erase(); lookups sort in this case.
+            return;
+        }
+        auto elem_begin = c.elements_.begin();
+        auto elem_end = c.elements_.end();
+        auto prefix_end = std::next(elem_begin, c.sorted_until_);
+        auto out = std::next(elem_begin, std::max(first_new, c.sorted_until_));
+        for (auto it = out; it != elem_end; ++it) {
+            auto& elem = *it;
+            auto kept = std::lower_bound(elem_begin, prefix_end, elem, c.vcmp_);
+            if (kept == prefix_end || c.vcmp_(elem, *kept)) {
+                kept = std::find_if(prefix_end, out, [&](const typename LazyC::value_type& pending) {
+                    return c.veq_(pending, elem);
+                });
+            }
+            if (kept != out) {
+                c.resolve_duplicate(*kept, elem);
+            } else {
+                if (out != it) {
+                    *out = std::move(*it);
+                }
+                ++out;
+            }
+        }
+        c.elements_.erase(out, elem_end);
+        if (c.elements_.size() == c.sorted_until_) {
+            c.sorted_ = true;
+        }
+    }
+};
+
+/**
+ * @internal
+ * @brief Helper that checks the order of two elements.
+ * @headerfile lazy_sorted_container.h <coveo/lazy/detail/lazy_sorted_container.h>
+ *
+ * Helper type that checks if two elements of a lazy sorted container are in
+ * the proper order. For containers that do not accept duplicates, this means
+ * that the first element must be strictly less than the second one.
+ *
+ * @tparam Multi Whether lazy sorted container accepts duplicates.
+ */
+template<bool Multi> struct lazy_container_elements_in_order;
+template<> struct lazy_container_elements_in_order<true> {
+    template<class LazyC, class E> bool operator()(const LazyC& c, const E& left, const E& right) const {
+        return !c.vcmp_(right, left);
+    }
+};
+template<> struct lazy_container_elements_in_order<false> {
+    template<class LazyC, class E> bool operator()(const LazyC& c, const E& left, const E& right) const {
+        return c.vcmp_(left, right);
+    }
+};
+
+/**
+ * @internal
+ * @brief Helper that sorts the unsorted tail of a lazy sorted container.
+ * @headerfile lazy_sorted_container.h <coveo/lazy/detail/lazy_sorted_container.h>
+ *
+ * Helper type that sorts the elements in <tt>[first, last[</tt>, the unsorted tail
+ * of a lazy sorted container, using its sort policy. If the container's append policy
+ * tracks the tail (see <tt>coveo/lazy/append_policy.h</tt>) and few elements were
+ * appended out of order, the tail is made of a few sorted runs; those are merged
+ * (stably) instead, which costs <tt>O(n log runs)</tt>.
+ *
+ * @tparam Multi Whether lazy sorted container accepts duplicates.
+ * @tparam TracksTail Whether the container's append policy tracks the tail.
+ */
+template<bool Multi, bool TracksTail> struct sort_lazy_container_tail {
+    template<class LazyC, class RandIt> void operator()(const LazyC& c, RandIt first, RandIt last, bool stable) const {
+        typename LazyC::sort_policy sorter;
+        if (stable) {
+            policy_stable_sort(sorter, first, last, c.vcmp_, c.elements_.get_allocator(), 0);
+        } else {
+            policy_sort(sorter, first, last, c.vcmp_, c.elements_.get_allocator(), 0);
+        }
+    }
+};
+template<bool Multi> struct sort_lazy_container_tail<Multi, true> {
+    template<class LazyC, class RandIt> void operator()(const LazyC& c, RandIt first, RandIt last, bool stable) const {
+        const std::size_t max_runs = LazyC::append_policy::max_tail_runs;
+        if (c.tail_breaks_ < max_runs) {
+            // Find the runs; the count of breaks is a hint, so stop if there are too many.
+            std::array<RandIt, max_runs + 1> bounds;
+            bounds[0] = first;
+            std::size_t runs = 1;
+            for (auto it = first; it != last && std::next(it) != last && runs <= max_runs; ++it) {
+                if (!lazy_container_elements_in_order<Multi>()(c, *it, *std::next(it))) {
+                    if (runs < max_runs) {
+                        bounds[runs] = std::next(it);
+                    }
+                    ++runs;
+                }
+            }
+            if (runs <= max_runs) {
+                bounds[runs] = last;
+                while (runs > 1) {
+                    std::size_t merged = 0;
+                    for (std::size_t i = 0; i < runs; i += 2) {
+                        if (i + 1 < runs) {
+                            allocator_inplace_merge(bounds[i], bounds[i + 1], bounds[i + 2], c.vcmp_, c.elements_.get_allocator());
+                        }
+                        bounds[merged++] = bounds[i];
+                    }
+                    bounds[merged] = bounds[runs];
+                    runs = merged;
+                }
+                return;
+            }
+        }
+        sort_lazy_container_tail<Multi, false>()(c, first, last, stable);
+    }
 };
 
 /**
@@ -664,24 +896,252 @@ template<> struct sort_lazy_container_if_needed_and_not_multi<false> {
  * @brief Sort helper for lazy sorted containers.
  * @headerfile lazy_sorted_container.h <coveo/lazy/detail/lazy_sorted_container.h>
  *
- * Helper type that sorts the elements of a lazy sorted container.
- * Implementation differs depending on whether containers accepts duplicates or not.
+ * Helper type that sorts the elements of a lazy sorted container using its
+ * sort policy (see <tt>coveo/lazy/sort_policy.h</tt>). Implementation differs
+ * depending on whether containers accepts duplicates or not.
+ *
+ * Only the unsorted tail of the container (e.g. the elements after
+ * its @c sorted_until_ position) is actually sorted; it is then merged
+ * into the sorted prefix. This means that sorting a container after
+ * appending @c k elements to @c n sorted ones costs <tt>O(k log k + n)</tt>
+ * instead of <tt>O(n log n)</tt>. If the tail is known to be sorted already
+ * (see the container's @c tail_sorted_ member), it is merged directly.
  *
  * @tparam Multi Whether lazy sorted container accepts duplicates.
  */
 template<bool Multi> struct sort_lazy_container_elements;
 template<> struct sort_lazy_container_elements<true> {
     template<class LazyC> void operator()(LazyC& c) const {
-        // For multi-value containers, we need to use std::stable_sort() because order
-        // of equivalent elements must be preserved (since C++11).
-        std::stable_sort(c.elements_.begin(), c.elements_.end(), c.vcmp_);
+        // For multi-value containers, we need to use a stable sort because order
+        // of equivalent elements must be preserved (since C++11). Merging
+        // is also stable and puts elements of the sorted prefix first, which is what we
+        // want since they were inserted before those in the tail.
+        auto elem_begin = c.elements_.begin();
+        auto elem_mid = std::next(elem_begin, c.sorted_until_);
+        auto elem_end = c.elements_.end();
+        if (!c.tail_sorted_) {
+            sort_lazy_container_tail<true, LazyC::append_policy::tracks_tail>()(c, elem_mid, elem_end, true);
+        }
+        allocator_inplace_merge(elem_begin, elem_mid, elem_end, c.vcmp_, c.elements_.get_allocator());
     }
 };
 template<> struct sort_lazy_container_elements<false> {
     template<class LazyC> void operator()(LazyC& c) const {
-        std::sort(c.elements_.begin(), c.elements_.end(), c.vcmp_);
-        c.elements_.erase(std::unique(c.elements_.begin(), c.elements_.end(), c.veq_), c.elements_.end());
+        // Sorted prefix is already free of duplicates, so we only need to remove them
+        // from the tail before merging. Merging can then put equivalent elements next
+        // to each other, so we need one more (linear) pass to remove those. If the
+        // duplicate policy depends on insertion order, we need a stable sort; since
+        // merging is stable and puts elements of the prefix first, duplicates are
+        // then always resolved in the order they were inserted.
+        typename LazyC::sort_policy sorter;
+        auto elem_begin = c.elements_.begin();
+        auto elem_mid = std::next(elem_begin, c.sorted_until_);
+        auto elem_end = c.elements_.end();
+        if (!c.tail_sorted_) {
+            sort_lazy_container_tail<false, LazyC::append_policy::tracks_tail>()(c, elem_mid, elem_end,
+                                                                                  LazyC::duplicate_policy::ordered);
+            elem_end = c.unique_resolve(elem_mid, elem_end, sorter);
+        }
+        allocator_inplace_merge(elem_begin, elem_mid, elem_end, c.vcmp_, c.elements_.get_allocator());
+        c.elements_.erase(c.unique_resolve(elem_begin, elem_end, sorter), c.elements_.end());
+    }
+};
+
+/**
+ * @internal
+ * @brief Sort helper that records statistics.
+ * @headerfile lazy_sorted_container.h <coveo/lazy/detail/lazy_sorted_container.h>
+ *
+ * Helper type that sorts the elements of a lazy sorted container using
+ * @c sort_lazy_container_elements. If the container's stats policy is enabled,
+ * also measures the sort and records it in the container's stats policy.
+ *
+ * @tparam Multi Whether lazy sorted container accepts duplicates.
+ * @tparam StatsEnabled Whether the container's stats policy is enabled.
+ */
+template<bool Multi, bool StatsEnabled> struct sort_lazy_container_elements_and_record_stats;
+template<bool Multi> struct sort_lazy_container_elements_and_record_stats<Multi, false> {
+    template<class LazyC> void operator()(const LazyC& c) const {
+        sort_lazy_container_elements<Multi>()(c);
+    }
+};
+template<bool Multi> struct sort_lazy_container_elements_and_record_stats<Multi, true> {
+    template<class LazyC> void operator()(const LazyC& c) const {
+        sort_stats_event event;
+        event.size_before = c.elements_.size();
+        event.sorted_prefix = c.sorted_until_;
+        event.elements_sorted = c.tail_sorted_ ? 0 : event.size_before - event.sorted_prefix;
+        const auto start = std::chrono::steady_clock::now();
+        sort_lazy_container_elements<Multi>()(c);
+        event.duration = std::chrono::steady_clock::now() - start;
+        event.duplicates_removed = event.size_before - c.elements_.size();
+        c.stats().record(event);
+    }
+};
+
+/**
+ * @internal
+ * @brief Storage for one element of a <tt>compressed_pair</tt>.
+ * @headerfile lazy_sorted_container.h <coveo/lazy/detail/lazy_sorted_container.h>
+ *
+ * Stores an object of type @c T. If @c T is an empty class that is not @c final,
+ * the object is stored as a base class instead of a member, so that it takes no room
+ * (the empty base optimization). The object is always accessible through a @c const
+ * storage, like a @c mutable member: empty objects have no state to modify.
+ *
+ * @tparam T Type of object to store.
+ * @tparam Index Index of element in the pair; ensures both bases have different types.
+ */
+template<class T, std::size_t Index, bool = std::is_empty<T>::value && !std::is_final<T>::value>
+class compressed_pair_element
+{
+    mutable T obj_;     // Stored object.
+
+public:
+    compressed_pair_element() = default;
+    explicit compressed_pair_element(const T& obj) : obj_(obj) { }
+
+    T& get() const noexcept {
+        return obj_;
+    }
+};
+template<class T, std::size_t Index>
+class compressed_pair_element<T, Index, true> : private T
+{
+public:
+    compressed_pair_element() = default;
+    explicit compressed_pair_element(const T& obj) : T(obj) { }
+
+    T& get() const noexcept {
+        return const_cast<T&>(static_cast<const T&>(*this));
+    }
+};
+
+/**
+ * @internal
+ * @brief Pair of objects that takes no room for empty objects.
+ * @headerfile lazy_sorted_container.h <coveo/lazy/detail/lazy_sorted_container.h>
+ *
+ * Stores two objects using <tt>compressed_pair_element</tt>, so that objects of
+ * empty classes take no room. Used as a base class of lazy-sorted containers to
+ * store their sort stats policy and search index, which are usually empty.
+ *
+ * @tparam First Type of first object.
+ * @tparam Second Type of second object.
+ */
+template<class First, class Second>
+class compressed_pair : private compressed_pair_element<First, 0>,
+                        private compressed_pair_element<Second, 1>
+{
+    using first_base = compressed_pair_element<First, 0>;
+    using second_base = compressed_pair_element<Second, 1>;
+
+public:
+    compressed_pair() = default;
+
+    First& first() const noexcept {
+        return first_base::get();
     }
+    Second& second() const noexcept {
+        return second_base::get();
+    }
+};
+
+/**
+ * @internal
+ * @brief State of an asynchronous sort.
+ * @headerfile lazy_sorted_container.h <coveo/lazy/detail/lazy_sorted_container.h>
+ *
+ * Helper type that holds the future of a sort started by
+ * <tt>lazy_sorted_container::sort_async()</tt>. Copying an instance waits for
+ * the sort of the source to complete but does not copy its future; since lazy
+ * sorted containers hold it in their first base class (see @c async_sort_base),
+ * this makes sure a container's elements, sort stats and search index are not
+ * copied or moved while they are being sorted.
+ */
+class async_sort_state
+{
+    mutable std::shared_future<void> done_; // Future of the sort in progress, if any.
+
+public:
+    async_sort_state() = default;
+    async_sort_state(const async_sort_state& obj)
+        : done_() {
+        obj.wait();
+    }
+    async_sort_state& operator=(const async_sort_state& obj) {
+        wait();
+        obj.wait();
+        return *this;
+    }
+    ~async_sort_state() {
+        join();
+    }
+
+    // Returns whether a sort has been started and not waited for.
+    bool pending() const {
+        return done_.valid();
+    }
+
+    // Returns whether a sort has been started and is not complete yet.
+    bool running() const {
+        return done_.valid() && done_.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+    }
+
+    // Starts tracking the sort that will complete done.
+    void start(std::shared_future<void> done) {
+        done_ = std::move(done);
+    }
+
+    // Waits for the sort in progress, if any. Rethrows any exception thrown by the sort.
+    void wait() const {
+        if (done_.valid()) {
+            auto done = std::move(done_);
+            done_ = std::shared_future<void>();
+            done.get();
+        }
+    }
+
+    // Waits for the sort in progress, if any, ignoring its result.
+    void join() const noexcept {
+        if (done_.valid()) {
+            done_.wait();
+            done_ = std::shared_future<void>();
+        }
+    }
+};
+
+/**
+ * @internal
+ * @brief Base class holding the state of an asynchronous sort.
+ * @headerfile lazy_sorted_container.h <coveo/lazy/detail/lazy_sorted_container.h>
+ *
+ * Lazy sorted containers inherit from this class before any other base class,
+ * so that its @c async_sort_state is copied or assigned (and thus waits for any
+ * sort in progress) before the other bases and members, which the sort modifies.
+ */
+struct async_sort_base
+{
+    async_sort_state async_sort_;   // Sort started by sort_async(), if any.
+};
+
+/**
+ * @internal
+ * @brief Helper to get the part of an element resolved by duplicate policies.
+ * @headerfile lazy_sorted_container.h <coveo/lazy/detail/lazy_sorted_container.h>
+ *
+ * Helper type that returns a reference to the part of an element of a lazy sorted
+ * container that is passed to its duplicate policy: the mapped value for maps,
+ * or the element itself for sets (see <tt>coveo/lazy/duplicate_policy.h</tt>).
+ *
+ * @tparam IsMap Whether lazy sorted container is a map.
+ */
+template<bool IsMap> struct lazy_container_duplicate_payload;
+template<> struct lazy_container_duplicate_payload<true> {
+    template<class E> auto& operator()(E& elem) const { return elem.second; }
+};
+template<> struct lazy_container_duplicate_payload<false> {
+    template<class E> E& operator()(E& elem) const { return elem; }
 };
 
 /**
@@ -692,19 +1152,19 @@ template<> struct sort_lazy_container_elements<false> {
  * Helper type that updates a lazy sorted container's @c sorted_ flag after an
  * insertion at the back of the container, depending on whether the insertion
  * maintained the sorting or not. Use only on sorted containers with more
- * than one element.
+ * than one element. If sorting is broken, also records the end of the sorted
+ * prefix in the container's @c sorted_until_ member; the unsorted tail then
+ * contains a single element, so it is sorted.
  *
  * @tparam Multi Whether lazy sorted container accepts duplicates.
  */
-template<bool Multi> struct updated_lazy_container_sorted_flag_after_insert;
-template<> struct updated_lazy_container_sorted_flag_after_insert<true> {
-    template<class LazyC> void operator()(LazyC& c) const {
-        c.sorted_ = !c.vcmp_(c.elements_.back(), *(c.elements_.crbegin() + 1));
-    }
-};
-template<> struct updated_lazy_container_sorted_flag_after_insert<false> {
+template<bool Multi> struct updated_lazy_container_sorted_flag_after_insert {
     template<class LazyC> void operator()(LazyC& c) const {
-        c.sorted_ = c.vcmp_(*(c.elements_.crbegin() + 1), c.elements_.back());
+        c.sorted_ = lazy_container_elements_in_order<Multi>()(c, *(c.elements_.crbegin() + 1), c.elements_.back());
+        if (!c.sorted_) {
+            c.sorted_until_ = c.elements_.size() - 1;
+            c.tail_sorted_ = true;
+        }
     }
 };
 
@@ -747,6 +1207,10 @@ template<> struct mapped_type_base<void> { };
  * - Protect it with a shared mutex like <tt>std::shared_mutex</tt> and make sure
  *   that it is always sorted before writer threads release their write locks.
  *
+ * Alternatively, <tt>coveo::lazy::concurrent_container</tt> (see <tt>coveo/lazy/concurrent.h</tt>)
+ * wraps a container so that threads can insert elements without a global lock and
+ * look for them in immutable, sorted snapshots.
+ *
  * If this container is a map (e.g., type @c T is not @c void), this class will
  * additionally have a @c mapped_type typedef (defined as @c T). Furthermore, if
  * the map does not accept duplicates (e.g., @c Multi is @c false), the following
@@ -757,8 +1221,13 @@ template<> struct mapped_type_base<void> { };
  * - <tt>insert_or_assign()</tt>
  * - <tt>try_emplace()</tt>
  *
- * Note, however, that those methods all require the container to be sorted to
- * work, so they could be less efficient that blind inserts.
+ * Note, however, that those methods need to look for existing elements, so they
+ * could be less efficient that blind inserts. To avoid moving all following
+ * elements each time, elements added by <tt>operator[]()</tt> are kept in a small
+ * sorted buffer at the end of the container that <tt>at()</tt> and <tt>count()</tt>
+ * can search; it is merged with the other elements when it grows larger than about
+ * the square root of the container's size, or when a method returning iterators
+ * is called. See <tt>set_tail_lookups()</tt> to let other methods use that buffer.
  *
  * @tparam K Type of keys used to sort elements in the container.
  * @tparam T Type of values bound to each key. If this is set to @c void, the
@@ -780,6 +1249,22 @@ template<> struct mapped_type_base<void> { };
  *              template parameters as <tt>std::vector/deque/etc.</tt>
  * @tparam Multi Whether container is allowed to have duplicates. Set this to
  *               @c true for <tt>std::multiset/multimap</tt>-like containers.
+ * @tparam Sort Sort policy used to sort elements when needed. Defaults to
+ *              @c default_sort_policy. See <tt>coveo/lazy/sort_policy.h</tt>
+ *              for details.
+ * @tparam Stats Policy used to collect statistics about sorting. Defaults to
+ *               @c no_sort_stats, which collects nothing. See
+ *               <tt>coveo/lazy/sort_stats.h</tt> for details.
+ * @tparam Search Policy used to look for elements in the sorted container.
+ *                Defaults to @c binary_search_policy. See
+ *                <tt>coveo/lazy/search_policy.h</tt> for details.
+ * @tparam Dup Policy used to resolve duplicates when the container does not
+ *             accept them. Defaults to @c default_duplicate_policy. Ignored
+ *             if @c Multi is @c true. See <tt>coveo/lazy/duplicate_policy.h</tt>
+ *             for details.
+ * @tparam Append Policy used to track the order of elements inserted at the end
+ *                of the container. Defaults to @c default_append_policy. See
+ *                <tt>coveo/lazy/append_policy.h</tt> for details.
  */
 template<class K,
          class T,
@@ -791,8 +1276,15 @@ template<class K,
          class Alloc,
          template<class _ImplT, class _ImplAlloc> class Impl,
          bool Multi,
+         class Sort = default_sort_policy,
+         class Stats = no_sort_stats,
+         class Search = binary_search_policy,
+         class Dup = default_duplicate_policy,
+         class Append = default_append_policy,
          bool _IsNonMultiMap = !std::is_void<T>::value && !Multi>
-class lazy_sorted_container : public mapped_type_base<T>
+class lazy_sorted_container : private async_sort_base,
+                              public mapped_type_base<T>,
+                              private compressed_pair<Stats, typename Search::template index<K, KCmp, Alloc>>
 {
 public:
     /**
@@ -913,6 +1405,61 @@ public:
      */
     using value_equal_to = lazy_value_pred_proxy<value_type, value_to_key, key_equal_to>;
 
+    /**
+     * @brief Sort policy.
+     *
+     * Policy used to sort elements in the container when needed. Defaults to
+     * <tt>coveo::lazy::default_sort_policy</tt>, which uses <tt>std::sort</tt>.
+     * See <tt>coveo/lazy/sort_policy.h</tt> for details.
+     */
+    using sort_policy = Sort;
+
+    /**
+     * @brief Sort statistics policy.
+     *
+     * Policy used to collect statistics about sorts performed by the container.
+     * Defaults to <tt>coveo::lazy::no_sort_stats</tt>, which collects nothing.
+     * See <tt>coveo/lazy/sort_stats.h</tt> for details.
+     */
+    using sort_stats_policy = Stats;
+
+    /**
+     * @brief Search policy.
+     *
+     * Policy used to look for elements in the container once it is sorted.
+     * Defaults to <tt>coveo::lazy::binary_search_policy</tt>, which uses
+     * <tt>std::lower_bound</tt>. See <tt>coveo/lazy/search_policy.h</tt> for details.
+     */
+    using search_policy = Search;
+
+    /**
+     * @brief Duplicate policy.
+     *
+     * Policy used to choose which element to keep (or how to combine them) when
+     * the same key is inserted more than once in a container that does not accept
+     * duplicates. Defaults to <tt>coveo::lazy::default_duplicate_policy</tt>, which
+     * keeps any one of them. See <tt>coveo/lazy/duplicate_policy.h</tt> for details.
+     */
+    using duplicate_policy = Dup;
+
+    /**
+     * @brief Append policy.
+     *
+     * Policy used to track whether elements inserted at the end of the container
+     * keep it sorted. Defaults to <tt>coveo::lazy::default_append_policy</tt>, which
+     * stops checking once the container is no longer sorted. See
+     * <tt>coveo/lazy/append_policy.h</tt> for details.
+     */
+    using append_policy = Append;
+
+    /**
+     * @brief Type of read-only view of the container's elements.
+     *
+     * Type of <tt>coveo::lazy::detail::sorted_view</tt> that can be opened over
+     * elements written by <tt>lazy_sorted_container::serialize()</tt>.
+     */
+    using view_type = sorted_view<K, T, V, PubV, value_compare, Multi>;
+
     /**
      * @brief Type of allocator used.
      *
@@ -994,19 +1541,60 @@ public:
     using const_reverse_iterator = conditional_iterator_proxy<const_reverse_iterator_impl, const V, const PubV>;
 
 private:
+    // Type of container storing keys erased by lazy_erase(); uses our allocator.
+    using pending_erase = std::pair<key_type, size_type>;
+    using pending_erases_impl = std::vector<pending_erase, typename std::allocator_traits<allocator_type>::template rebind_alloc<pending_erase>>;
+
     mutable container_impl elements_;   // Container storing actual elements.
     mutable bool sorted_;               // Whether elements_ is currently sorted.
+    mutable size_type sorted_until_;    // If !sorted_, number of elements at the beginning of elements_ that are sorted.
+    mutable bool tail_sorted_;          // If !sorted_, whether elements after sorted_until_ are sorted as well.
+    mutable size_type tail_breaks_;     // If !sorted_, number of elements appended out of order in the tail, if append_policy tracks it.
+    mutable size_type searchable_tail_end_; // If equal to size, tail is sorted and free of keys found in prefix; see find_insert_position().
+    size_type pending_limit_;           // Max number of unsorted elements that lookups can scan without sorting.
+    bool tail_lookups_;                 // Whether lookups can return iterators to the tail added by operator[] without sorting.
     value_to_key vtok_;                 // Predicate to get key for a given value.
     value_compare vcmp_;                // Value comparator.
     value_equal_to veq_;                // Value equality predictate.
+    mutable pending_erases_impl pending_erases_;    // Keys erased by lazy_erase() with number of elements at the time; if any, !sorted_.
+
+    // Statistics about sorting (stats()) and search index, if any (search_index(); only valid when sorted_),
+    // are stored in a compressed_pair base so that they take no room when empty, which is the default.
+    using search_index_type = typename search_policy::template index<key_type, key_compare, allocator_type>;
+    using policies_base = compressed_pair<sort_stats_policy, search_index_type>;
+
+    static_assert(!std::is_empty<sort_stats_policy>::value || std::is_final<sort_stats_policy>::value ||
+                  !std::is_empty<search_index_type>::value || std::is_final<search_index_type>::value ||
+                  std::is_empty<policies_base>::value,
+                  "empty sort stats policy and search index must not take room in lazy-sorted containers");
+
+    // Returns statistics about sorting.
+    sort_stats_policy& stats() const {
+        return policies_base::first();
+    }
+
+    // Returns search index.
+    search_index_type& search_index() const {
+        return policies_base::second();
+    }
 
     /// @cond NEVERSHOWN
 
 private:
     // Friend some helper types.
     template<bool _HelperMulti> friend struct sort_lazy_container_if_needed_and_not_multi;
+    template<bool _HelperMulti> friend struct remove_lazy_container_pending_duplicates;
+    template<bool _HelperMulti> friend struct lazy_container_elements_in_order;
+    template<bool _HelperMulti, bool _HelperStatsEnabled> friend struct sort_lazy_container_elements_and_record_stats;
     template<bool _HelperMulti> friend struct sort_lazy_container_elements;
     template<bool _HelperMulti> friend struct updated_lazy_container_sorted_flag_after_insert;
+    template<bool _HelperMulti, bool _HelperTracksTail> friend struct sort_lazy_container_tail;
+
+    // Used to disable overloads accepting any type of key when OK is a key_type or an
+    // iterator, so that those use the overloads accepting key_type or iterators instead.
+    template<class OK> using enable_if_other_key_t = std::enable_if_t<!std::is_same<std::decay_t<OK>, key_type>::value &&
+                                                                      !std::is_convertible<OK, const_iterator>::value &&
+                                                                      !std::is_convertible<OK, iterator>::value>;
     
     /// @endcond
 
@@ -1033,8 +1621,8 @@ public:
     explicit lazy_sorted_container(const key_compare& kcmp,
                                    const allocator_type& alloc = allocator_type(),
                                    const key_equal_to& keq = key_equal_to())
-        : elements_(alloc), sorted_(true),
-          vtok_(), vcmp_(vtok_, kcmp),  veq_(vtok_, keq) { }
+        : async_sort_base(), elements_(alloc), sorted_(true), sorted_until_(0), tail_sorted_(false), tail_breaks_(0), searchable_tail_end_(0), pending_limit_(inline_capacity_of<container_impl>::value), tail_lookups_(false),
+          vtok_(), vcmp_(vtok_, kcmp),  veq_(vtok_, keq), pending_erases_(alloc) { }
 
     /**
      * @brief Constructor with allocator.
@@ -1066,8 +1654,8 @@ public:
                                              const key_compare& kcmp = key_compare(),
                                              const allocator_type& alloc = allocator_type(),
                                              const key_equal_to& keq = key_equal_to())
-        : elements_(first, last, alloc), sorted_(elements_.size() <= 1),
-          vtok_(), vcmp_(vtok_, kcmp), veq_(vtok_, keq) { }
+        : async_sort_base(), elements_(first, last, alloc), sorted_(elements_.size() <= 1), sorted_until_(0), tail_sorted_(false), tail_breaks_(0), searchable_tail_end_(0), pending_limit_(inline_capacity_of<container_impl>::value), tail_lookups_(false),
+          vtok_(), vcmp_(vtok_, kcmp), veq_(vtok_, keq), pending_erases_(alloc) { }
 
     /**
      * @brief Range constructor with allocator.
@@ -1084,6 +1672,82 @@ public:
                                              const allocator_type& alloc)
         : lazy_sorted_container(first, last, key_compare(), alloc) { }
 
+    /**
+     * @brief Sorted range constructor.
+     *
+     * Constructor that initializes the container with the elements in the
+     * range <tt>[first, last[</tt>. The elements must be sorted according to
+     * @c kcmp and must not contain duplicates; this is not validated (except
+     * in debug builds). The container will thus be sorted right away.
+     *
+     * @param first Beginning of the range of sorted elements to insert in the container (inclusive).
+     * @param last End of the range of sorted elements to insert in the container (exclusive).
+     * @param kcmp @c key_compare instance to use for this container. Defaults to
+     *             a default-constructed <tt>lazy_sorted_container::key_compare</tt>.
+     * @param alloc @c allocator_type instance to use for this container. Defaults to
+     *              a default-constructed <tt>lazy_sorted_container::allocator_type</tt>.
+     * @param keq @c key_equal_to instance to use for this container. Defaults to
+     *            a default-constructed <tt>lazy_sorted_container::key_equal_to</tt>.
+     */
+    template<class It> lazy_sorted_container(sorted_unique_t,
+                                             It first,
+                                             It last,
+                                             const key_compare& kcmp = key_compare(),
+                                             const allocator_type& alloc = allocator_type(),
+                                             const key_equal_to& keq = key_equal_to())
+        : lazy_sorted_container(kcmp, alloc, keq) {
+        insert_sorted(first, last);
+    }
+
+    /**
+     * @brief Sorted range constructor with allocator.
+     *
+     * Constructor that initializes the container with the sorted elements in the
+     * range <tt>[first, last[</tt>. Also initializes the allocator. See
+     * <tt>lazy_sorted_container(sorted_unique_t, It, It, const key_compare&, const allocator_type&, const key_equal_to&)</tt>
+     * for details.
+     *
+     * @param first Beginning of the range of sorted elements to insert in the container (inclusive).
+     * @param last End of the range of sorted elements to insert in the container (exclusive).
+     * @param alloc @c allocator_type instance to use for this container.
+     */
+    template<class It> lazy_sorted_container(sorted_unique_t,
+                                             It first,
+                                             It last,
+                                             const allocator_type& alloc)
+        : lazy_sorted_container(sorted_unique, first, last, key_compare(), alloc) { }
+
+    /**
+     * @brief Sorted range constructor, possibly with duplicates.
+     *
+     * Constructor that initializes the container with the elements in the
+     * range <tt>[first, last[</tt>. The elements must be sorted according to
+     * @c kcmp, but can contain equivalent elements; this is not validated
+     * (except in debug builds). The container will thus be sorted right away.
+     *
+     * @param first Beginning of the range of sorted elements to insert in the container (inclusive).
+     * @param last End of the range of sorted elements to insert in the container (exclusive).
+     * @param kcmp @c key_compare instance to use for this container. Defaults to
+     *             a default-constructed <tt>lazy_sorted_container::key_compare</tt>.
+     * @param alloc @c allocator_type instance to use for this container. Defaults to
+     *              a default-constructed <tt>lazy_sorted_container::allocator_type</tt>.
+     * @param keq @c key_equal_to instance to use for this container. Defaults to
+     *            a default-constructed <tt>lazy_sorted_container::key_equal_to</tt>.
+     * @remarks This constructor is only available for containers that accept duplicates.
+     */
+    template<class It,
+             bool _Enabled = Multi,
+             class = std::enable_if_t<_Enabled, void>>
+    lazy_sorted_container(sorted_equivalent_t,
+                          It first,
+                          It last,
+                          const key_compare& kcmp = key_compare(),
+                          const allocator_type& alloc = allocator_type(),
+                          const key_equal_to& keq = key_equal_to())
+        : lazy_sorted_container(kcmp, alloc, keq) {
+        insert_sorted(first, last);
+    }
+
     /**
      * @brief Copy constructor.
      *
@@ -1103,8 +1767,11 @@ public:
      * @param alloc @c allocator_type instance  to use for this container.
      */
     lazy_sorted_container(const lazy_sorted_container& obj, const allocator_type& alloc)
-        : elements_(obj.elements_, alloc), sorted_(obj.sorted_),
-          vtok_(obj.vtok_), vcmp_(obj.vcmp_), veq_(obj.veq_) { }
+        : async_sort_base(obj), policies_base(obj), elements_(obj.elements_, alloc), sorted_(obj.sorted_), sorted_until_(obj.sorted_until_), tail_sorted_(obj.tail_sorted_), tail_breaks_(obj.tail_breaks_), searchable_tail_end_(obj.searchable_tail_end_), pending_limit_(obj.pending_limit_), tail_lookups_(obj.tail_lookups_),
+          vtok_(obj.vtok_), vcmp_(obj.vcmp_), veq_(obj.veq_), pending_erases_(obj.pending_erases_, alloc) {
+        // Search index was copied with the allocator of obj; rebuild it with ours.
+        build_search_index();
+    }
 
     /**
      * @brief Move constructor.
@@ -1114,8 +1781,9 @@ public:
      * @param obj Container to move in this one.
      */
     lazy_sorted_container(lazy_sorted_container&& obj)
-        : elements_(std::move(obj.elements_)), sorted_(obj.sorted_),
-          vtok_(std::move(obj.vtok_)), vcmp_(std::move(obj.vcmp_)), veq_(std::move(obj.veq_)) {
+        : async_sort_base(obj), policies_base(std::move(obj)), elements_(std::move(obj.elements_)), sorted_(obj.sorted_), sorted_until_(obj.sorted_until_), tail_sorted_(obj.tail_sorted_), tail_breaks_(obj.tail_breaks_), searchable_tail_end_(obj.searchable_tail_end_), pending_limit_(obj.pending_limit_), tail_lookups_(obj.tail_lookups_),
+          vtok_(std::move(obj.vtok_)), vcmp_(std::move(obj.vcmp_)), veq_(std::move(obj.veq_)), pending_erases_(std::move(obj.pending_erases_)) {
+        obj.pending_erases_.clear();
         obj.sorted_ = true;
     }
 
@@ -1123,17 +1791,33 @@ public:
      * @brief Move constructor with allocator.
      *
      * Constructor that moves the elements of another container in this one
-     * but uses a different allocator instance.
+     * but uses a different allocator instance. If @c alloc is not equal to the
+     * allocator of @c obj, elements are moved one by one. @c obj is left empty.
      *
      * @param obj Container to move in this one. Its allocator is not moved.
      * @param alloc @c allocator_type instance to use for this container.
      */
     lazy_sorted_container(lazy_sorted_container&& obj, const allocator_type& alloc)
-        : elements_(std::move(obj.elements_), alloc), sorted_(obj.sorted_),
-          vtok_(std::move(obj.vtok_)), vcmp_(std::move(obj.vcmp_)), veq_(std::move(obj.veq_)) {
+        : async_sort_base(obj), policies_base(std::move(obj)), elements_(std::move(obj.elements_), alloc), sorted_(obj.sorted_), sorted_until_(obj.sorted_until_), tail_sorted_(obj.tail_sorted_), tail_breaks_(obj.tail_breaks_), searchable_tail_end_(obj.searchable_tail_end_), pending_limit_(obj.pending_limit_), tail_lookups_(obj.tail_lookups_),
+          vtok_(std::move(obj.vtok_)), vcmp_(std::move(obj.vcmp_)), veq_(std::move(obj.veq_)), pending_erases_(std::move(obj.pending_erases_), alloc) {
+        // If allocators differ, elements are moved one by one and remain in obj;
+        // the search index then needs to be rebuilt with our allocator.
+        build_search_index();
+        obj.elements_.clear();
+        obj.pending_erases_.clear();
         obj.sorted_ = true;
     }
 
+    /**
+     * @brief Destructor.
+     *
+     * Destroys the container and its elements. If a sort started by
+     * <tt>sort_async()</tt> is still in progress, waits for it to complete first.
+     */
+    ~lazy_sorted_container() {
+        async_sort_.join();
+    }
+
     /**
      * @brief Initializer list constructor.
      *
@@ -1167,6 +1851,30 @@ public:
                           const allocator_type& alloc)
         : lazy_sorted_container(std::begin(init), std::end(init), alloc) { }
 
+    /**
+     * @brief Sorted initializer list constructor.
+     *
+     * Constructor that initializes the container with the elements in the
+     * given @c initializer_list. The elements must be sorted and must not
+     * contain duplicates; see
+     * <tt>lazy_sorted_container(sorted_unique_t, It, It, const key_compare&, const allocator_type&, const key_equal_to&)</tt>
+     * for details.
+     *
+     * @param init @c initializer_list containing container's initial sorted elements.
+     * @param kcmp @c key_compare instance to use for this container. Defaults to
+     *             a default-constructed <tt>lazy_sorted_container::key_compare</tt>.
+     * @param alloc @c allocator_type instance to use for this container. Defaults to
+     *              a default-constructed <tt>lazy_sorted_container::allocator_type</tt>.
+     * @param keq @c key_equal_to instance to use for this container. Defaults to
+     *            a default-constructed <tt>lazy_sorted_container::key_equal_to</tt>.
+     */
+    lazy_sorted_container(sorted_unique_t,
+                          std::initializer_list<value_type> init,
+                          const key_compare& kcmp = key_compare(),
+                          const allocator_type& alloc = allocator_type(),
+                          const key_equal_to& keq = key_equal_to())
+        : lazy_sorted_container(sorted_unique, std::begin(init), std::end(init), kcmp, alloc, keq) { }
+
     /**
      * @brief Assignment operator.
      *
@@ -1181,17 +1889,38 @@ public:
      * @brief Move assignment operator.
      *
      * Move assignment operator. Moves the elements of the given container into
-     * this one; no copy is performed.
+     * this one; no copy is performed. If the allocator does not propagate on
+     * move assignment (like <tt>std::pmr::polymorphic_allocator</tt>) and is not
+     * equal to the allocator of @c obj, elements are moved one by one.
+     * @c obj is left empty.
      *
      * @param obj Container to move in this one.
      * @return Reference to @c this container.
      */
     lazy_sorted_container& operator=(lazy_sorted_container&& obj) {
+        if (this == &obj) {
+            return *this;
+        }
+        // Wait for sorts in progress in both containers.
+        async_sort_ = obj.async_sort_;
+        // If the allocator does not propagate and differs, elements are moved one by one and remain in obj.
         elements_ = std::move(obj.elements_);
+        obj.elements_.clear();
         sorted_ = obj.sorted_;
+        sorted_until_ = obj.sorted_until_;
+        tail_sorted_ = obj.tail_sorted_;
+        tail_breaks_ = obj.tail_breaks_;
+        searchable_tail_end_ = obj.searchable_tail_end_;
+        pending_limit_ = obj.pending_limit_;
+        tail_lookups_ = obj.tail_lookups_;
         vtok_ = std::move(obj.vtok_);
         vcmp_ = std::move(obj.vcmp_);
         veq_ = std::move(obj.veq_);
+        stats() = std::move(obj.stats());
+        search_index() = std::move(obj.search_index());
+        build_search_index();
+        pending_erases_ = std::move(obj.pending_erases_);
+        obj.pending_erases_.clear();
         obj.sorted_ = true;
         return *this;
     }
@@ -1206,9 +1935,15 @@ public:
      * @return Reference to @c this container.
      */
     lazy_sorted_container& operator=(std::initializer_list<value_type> init) {
+        async_sort_.wait();
         elements_.clear();
         elements_.insert(elements_.cend(), std::begin(init), std::end(init));
+        invalidate_lookups();
+        pending_erases_.clear();
         sorted_ = elements_.size() <= 1;
+        sorted_until_ = 0;
+        tail_sorted_ = false;
+        remove_pending_duplicates(0);
         return *this;
     }
 
@@ -1321,13 +2056,11 @@ public:
     template<class _T = T,
              class _TRef = std::enable_if_t<_IsNonMultiMap, _T&>>
     _TRef at(const key_type& key) {
-        sort_if_needed();
-        auto elem_end = elements_.end();
-        auto it = std::lower_bound(elements_.begin(), elem_end, key, vcmp_);
-        if (it == elem_end || vcmp_(key, *it)) {
+        auto cit = find_impl(key, false);
+        if (cit == elements_.cend()) {
             throw_out_of_range();
         }
-        return it->second;
+        return std::next(elements_.begin(), std::distance(elements_.cbegin(), cit))->second;
     }
 
     /**
@@ -1344,10 +2077,66 @@ public:
     template<class _T = T,
              class _CTRef = std::enable_if_t<_IsNonMultiMap, const _T&>>
     _CTRef at(const key_type& key) const {
-        sort_if_needed();
-        auto elem_cend = elements_.cend();
-        auto cit = std::lower_bound(elements_.cbegin(), elem_cend, key, vcmp_);
-        if (cit == elem_cend || vcmp_(key, *cit)) {
+        auto cit = find_impl(key, false);
+        if (cit == elements_.cend()) {
+            throw_out_of_range();
+        }
+        return cit->second;
+    }
+
+    /**
+     * @brief Accesses an existing element using any type of key.
+     *
+     * Returns a reference to the existing element with the given key, which
+     * can be any type accepted by <tt>lazy_sorted_container::key_compare</tt>.
+     * If the container does not have such an element, an exception is thrown.
+     *
+     * @param key Key of element to look for.
+     * @return Reference to the existing element associated with @c key.
+     * @throw coveo::lazy::out_of_range No element with that key exists.
+     * @remarks This method is only available for non-multi maps.
+     * @remark This method is only available if <tt>lazy_sorted_container::key_compare</tt>
+     *         is a transparent function (e.g. defines @c is_transparent), like
+     *         <tt>std::less<></tt>. For more info, see
+     *         http://en.cppreference.com/w/cpp/utility/functional/less_void
+     */
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent,
+             class _T = T,
+             class _TRef = std::enable_if_t<_IsNonMultiMap, _T&>>
+    _TRef at(const OK& key) {
+        auto cit = find_impl(key, false);
+        if (cit == elements_.cend()) {
+            throw_out_of_range();
+        }
+        return std::next(elements_.begin(), std::distance(elements_.cbegin(), cit))->second;
+    }
+
+    /**
+     * @brief Accesses an existing element using any type of key (const version).
+     *
+     * Returns a const reference to the existing element with the given key, which
+     * can be any type accepted by <tt>lazy_sorted_container::key_compare</tt>.
+     * If the container does not have such an element, an exception is thrown.
+     *
+     * @param key Key of element to look for.
+     * @return Const reference to the existing element associated with @c key.
+     * @throw coveo::lazy::out_of_range No element with that key exists.
+     * @remarks This method is only available for non-multi maps.
+     * @remark This method is only available if <tt>lazy_sorted_container::key_compare</tt>
+     *         is a transparent function (e.g. defines @c is_transparent), like
+     *         <tt>std::less<></tt>. For more info, see
+     *         http://en.cppreference.com/w/cpp/utility/functional/less_void
+     */
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent,
+             class _T = T,
+             class _CTRef = std::enable_if_t<_IsNonMultiMap, const _T&>>
+    _CTRef at(const OK& key) const {
+        auto cit = find_impl(key, false);
+        if (cit == elements_.cend()) {
             throw_out_of_range();
         }
         return cit->second;
@@ -1396,6 +2185,37 @@ public:
         return operator_brackets_impl(std::move(key));
     }
 
+    /**
+     * @brief Accesses an element using any type of key, possibly creating it.
+     *
+     * Returns a reference to the element with the given key, which can be any
+     * type accepted by <tt>lazy_sorted_container::key_compare</tt>. If the
+     * container does not have such an element, a default-constructed one is
+     * added and associated with a key constructed by forwarding @c key; no
+     * <tt>lazy_sorted_container::key_type</tt> is constructed otherwise.
+     *
+     * @note Invalidates all iterators and references except
+     *       for the return value.
+     *
+     * @param key Key of element to look for.
+     * @return Reference to the element associated with @c key.
+     * @remarks This method is only available for non-multi maps, and only
+     *          if <tt>lazy_sorted_container::key_type</tt> can be constructed from @c key.
+     * @remark This method is only available if <tt>lazy_sorted_container::key_compare</tt>
+     *         is a transparent function (e.g. defines @c is_transparent), like
+     *         <tt>std::less<></tt>. For more info, see
+     *         http://en.cppreference.com/w/cpp/utility/functional/less_void
+     */
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent,
+             class = enable_if_other_key_t<OK>,
+             class _T = T,
+             class _TRef = std::enable_if_t<_IsNonMultiMap && std::is_constructible<key_type, OK&&>::value, _T&>>
+    _TRef operator[](OK&& key) {
+        return operator_brackets_impl(std::forward<OK>(key));
+    }
+
     /**
      * @brief Iterator to beginning of container.
      *
@@ -1464,7 +2284,7 @@ public:
      * @see lazy_sorted_container::begin
      */
     iterator end() {
-        sort_if_needed();
+        sort_if_needed_for_lookup();
         return elements_.end();
     }
 
@@ -1499,7 +2319,7 @@ public:
      * @see lazy_sorted_container::cbegin
      */
     const_iterator cend() const {
-        sort_if_needed();
+        sort_if_needed_for_lookup();
         return elements_.cend();
     }
 
@@ -1620,6 +2440,8 @@ public:
      * @return @c true if the container has no element.
      */
     bool empty() const {
+        async_sort_.wait();
+        remove_pending_erases();
         return elements_.empty();
     }
 
@@ -1631,7 +2453,9 @@ public:
      * @return Number of elements in the container.
      */
     size_type size() const {
+        async_sort_.wait();
         // If we're not sorted and this container does not accept duplicates, we have no choice but to sort.
+        remove_pending_erases();
         sort_lazy_container_if_needed_and_not_multi<Multi>()(*this);
         return elements_.size();
     }
@@ -1646,6 +2470,7 @@ public:
      * @return Maximum number of elements that can be stored in the container.
      */
     size_type max_size() const {
+        async_sort_.wait();
         return elements_.max_size();
     }
 
@@ -1665,6 +2490,7 @@ public:
      */
     template<class = std::enable_if_t<has_reserve_method<container_impl, size_type>::value, void>>
     void reserve(size_type new_cap) {
+        async_sort_.wait();
         elements_.reserve(new_cap);
     }
 
@@ -1681,6 +2507,7 @@ public:
      */
     template<class = std::enable_if_t<has_capacity_const_method<container_impl>::value, void>>
     auto capacity() const {
+        async_sort_.wait();
         return elements_.capacity();
     }
 
@@ -1696,9 +2523,61 @@ public:
      */
     template<class = std::enable_if_t<has_shrink_to_fit_method<container_impl>::value, void>>
     void shrink_to_fit() {
+        async_sort_.wait();
         elements_.shrink_to_fit();
     }
 
+    /**
+     * @brief Returns number of elements waiting to be sorted.
+     *
+     * Returns the number of elements stored in the container that will have
+     * to be sorted the next time a method needs sorted elements. Unlike
+     * <tt>size()</tt>, never sorts the elements, so for containers that do not
+     * accept duplicates, some of these elements might turn out to be duplicates.
+     *
+     * If a sort started by <tt>sort_async()</tt> is in progress, waits for it.
+     *
+     * @return Number of unsorted elements; 0 if container is sorted.
+     * @see lazy_sorted_container::memory_stats
+     */
+    size_type pending_size() const {
+        async_sort_.wait();
+        return sorted_ ? 0 : elements_.size() - sorted_until_;
+    }
+
+    /**
+     * @brief Returns information about container's memory.
+     *
+     * Returns the number of elements stored in the container, how many
+     * are waiting to be sorted and an estimate of the memory they use.
+     * Never sorts the elements. See <tt>coveo::lazy::container_memory_stats</tt>
+     * for details.
+     *
+     * If a sort started by <tt>sort_async()</tt> is in progress, waits for it.
+     *
+     * @return Memory stats for the container.
+     * @see lazy_sorted_container::pending_size
+     */
+    container_memory_stats memory_stats() const {
+        async_sort_.wait();
+        container_memory_stats stats;
+        stats.stored_elements = elements_.size();
+        stats.pending_elements = pending_size();
+        stats.sorted_elements = stats.stored_elements - stats.pending_elements;
+        if (!Multi && stats.pending_elements != 0) {
+            // Each pending element could be a duplicate, except the first one if nothing is sorted.
+            stats.possible_duplicates = stats.pending_elements - (stats.sorted_elements == 0 ? 1 : 0);
+        }
+        stats.pending_erasures = pending_erases_.size();
+        stats.capacity = container_capacity_or_size<has_capacity_const_method<container_impl>::value>()(elements_);
+        stats.element_size = sizeof(V);
+        stats.bytes_used = stats.stored_elements * sizeof(V) +
+                           pending_erases_.size() * sizeof(pending_erase);
+        stats.bytes_allocated = stats.capacity * sizeof(V) +
+                                pending_erases_.capacity() * sizeof(pending_erase);
+        return stats;
+    }
+
     /**
      * @brief Insert an element in the container.
      *
@@ -1711,11 +2590,10 @@ public:
      *         @c void instead of a <tt>pair<iterator, bool></tt>.
      */
     void insert(const value_type& value) {
+        async_sort_.wait();
         // What we do is push new value in the internal container, then check if container is still sorted.
         elements_.push_back(value);
-        if (sorted_) {
-            update_sorted_after_push_back();
-        }
+        update_sorted_after_push_back();
     }
 
     /**
@@ -1731,10 +2609,9 @@ public:
      *         @c void instead of a <tt>pair<iterator, bool></tt>.
      */
     void insert(value_type&& value) {
+        async_sort_.wait();
         elements_.push_back(std::move(value));
-        if (sorted_) {
-            update_sorted_after_push_back();
-        }
+        update_sorted_after_push_back();
     }
 
     /**
@@ -1789,9 +2666,68 @@ public:
      * @param last End of range of elements to insert.
      */
     template<class It> void insert(It first, It last) {
-        // Checking if container is sorted would be onerous for batch inserts.
+        async_sort_.wait();
+        // Checking if container is sorted would be onerous for batch inserts
+        // (callers can opt in by using check_sorted). However, we can remember where the sorted part ends to merge the new elements later.
+        const size_type old_size = elements_.size();
         elements_.insert(elements_.cend(), first, last);
-        sorted_ = elements_.size() <= 1;
+        if (elements_.size() != old_size) {
+            invalidate_lookups();
+            if (sorted_) {
+                sorted_until_ = old_size;
+            }
+            sorted_ = elements_.size() <= 1;
+            tail_sorted_ = false;
+            remove_pending_duplicates(old_size);
+        }
+    }
+
+    /**
+     * @brief Inserts a range of sorted elements in the container.
+     *
+     * Inserts all elements in the range <tt>[first, last[</tt>
+     * in the container. The elements must be sorted according
+     * to <tt>lazy_sorted_container::key_compare</tt> and must not
+     * contain duplicates; this is not validated (except in debug builds).
+     *
+     * If the new elements all go after existing elements of a sorted
+     * container, the container remains sorted. Otherwise, the new
+     * elements will simply be merged with existing ones when needed,
+     * without being sorted again.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param first Beginning of range of sorted elements to insert.
+     * @param last End of range of sorted elements to insert.
+     */
+    template<class It> void insert(sorted_unique_t, It first, It last) {
+        insert_sorted(first, last);
+    }
+
+    /**
+     * @brief Inserts a range of sorted elements, possibly with duplicates.
+     *
+     * Inserts all elements in the range <tt>[first, last[</tt> in
+     * the container. The elements must be sorted according to
+     * <tt>lazy_sorted_container::key_compare</tt>, but can contain
+     * equivalent elements; this is not validated (except in debug builds).
+     *
+     * If the new elements all go after existing elements of a sorted
+     * container, the container remains sorted. Otherwise, the new
+     * elements will simply be merged with existing ones when needed,
+     * without being sorted again.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param first Beginning of range of sorted elements to insert.
+     * @param last End of range of sorted elements to insert.
+     * @remarks This method is only available for containers that accept duplicates.
+     */
+    template<class It,
+             bool _Enabled = Multi,
+             class = std::enable_if_t<_Enabled, void>>
+    void insert(sorted_equivalent_t, It first, It last) {
+        insert_sorted(first, last);
     }
 
     /**
@@ -1805,8 +2741,57 @@ public:
      * @param init @c initializer_list containing the elements to insert.
      */
     void insert(std::initializer_list<value_type> init) {
-        elements_.insert(elements_.cend(), std::begin(init), std::end(init));
-        sorted_ = elements_.size() <= 1;
+        insert(std::begin(init), std::end(init));
+    }
+
+    /**
+     * @brief Inserts sorted elements from an initializer list in the container.
+     *
+     * Inserts all elements in the given @c initializer_list in the container.
+     * The elements must be sorted and must not contain duplicates.
+     * See <tt>insert(sorted_unique_t, It, It)</tt> for details.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param init @c initializer_list containing the sorted elements to insert.
+     */
+    void insert(sorted_unique_t, std::initializer_list<value_type> init) {
+        insert_sorted(std::begin(init), std::end(init));
+    }
+
+    /**
+     * @brief Inserts a range of elements that are likely sorted in the container.
+     *
+     * Inserts all elements in the range <tt>[first, last[</tt> in the container.
+     * Unlike <tt>insert(It, It)</tt>, this method then checks if the new elements
+     * are sorted through a single linear pass. If they are and they all go after
+     * existing elements of a sorted container, the container remains sorted.
+     * Otherwise, the sorted part of the new elements will not need to be sorted
+     * again, only merged with existing ones. Use this for data that is usually
+     * nearly sorted.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param first Beginning of range of elements to insert.
+     * @param last End of range of elements to insert.
+     */
+    template<class It> void insert(check_sorted_t, It first, It last) {
+        insert_checked(first, last);
+    }
+
+    /**
+     * @brief Inserts elements that are likely sorted from an initializer list in the container.
+     *
+     * Inserts all elements in the given @c initializer_list in the container,
+     * checking if they are sorted. See <tt>insert(check_sorted_t, It, It)</tt>
+     * for details.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param init @c initializer_list containing the elements to insert.
+     */
+    void insert(check_sorted_t, std::initializer_list<value_type> init) {
+        insert_checked(std::begin(init), std::end(init));
     }
 
     /**
@@ -1826,10 +2811,9 @@ public:
      *         @c void instead of a <tt>pair<iterator, bool></tt>.
      */
     template<class... Args> void emplace(Args&&... args) {
+        async_sort_.wait();
         elements_.emplace_back(std::forward<Args>(args)...);
-        if (sorted_) {
-            update_sorted_after_push_back();
-        }
+        update_sorted_after_push_back();
     }
     
     /**
@@ -1869,7 +2853,12 @@ public:
      *         if the removed element was the last one, at the end of the container.
      */
     iterator erase(const_iterator pos) {
-        // If user has a valid iterator, it's because container is sorted.
+        async_sort_.wait();
+        // If user has a valid iterator, it's because container is sorted
+        // or because lookups can return iterators while elements are pending
+        // (see set_pending_limit), in which case the sorted prefix shrinks.
+        const const_iterator_impl& impl_pos = pos;
+        before_erase(impl_pos, std::next(impl_pos));
         return elements_.erase(pos);
     }
 
@@ -1887,6 +2876,8 @@ public:
      *         if that was the last element, at the end of the container.
      */
     iterator erase(const_iterator first, const_iterator last) {
+        async_sort_.wait();
+        before_erase(first, last);
         return elements_.erase(first, last);
     }
     
@@ -1908,14 +2899,183 @@ public:
         return dist;
     }
 
+    /**
+     * @brief Removes elements using any type of key.
+     *
+     * Removes all elements associated with the given key from the container.
+     * The key can be any type accepted by <tt>lazy_sorted_container::key_compare</tt>.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param key Key of element(s) to remove.
+     * @return Number of elements removed. For containers that do not accept
+     *         duplicates, this can never be greater than 1.
+     * @remark This method is only available if <tt>lazy_sorted_container::key_compare</tt>
+     *         is a transparent function (e.g. defines @c is_transparent), like
+     *         <tt>std::less<></tt>. For more info, see
+     *         http://en.cppreference.com/w/cpp/utility/functional/less_void
+     */
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent,
+             class = enable_if_other_key_t<OK>>
+    size_type erase(const OK& key) {
+        auto range = equal_range(key);
+        size_type dist = std::distance(range.first, range.second);
+        erase(range.first, range.second);
+        return dist;
+    }
+
+    /**
+     * @brief Removes elements by key, lazily.
+     *
+     * Records that all elements currently associated with the given key must be
+     * removed from the container, without looking for them. Recorded keys are
+     * removed in a single pass the next time the container is sorted or its
+     * elements are accessed, or when there are as many recorded keys as elements.
+     * Removing many keys this way is much faster than calling <tt>erase()</tt>
+     * for each key, since the latter sorts the container and moves all
+     * following elements each time.
+     *
+     * Elements inserted after this method is called are not removed, even if
+     * they are associated with the same key.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param key Key of element(s) to remove.
+     */
+    void lazy_erase(const key_type& key) {
+        async_sort_.wait();
+        if (elements_.empty()) {
+            return;
+        }
+        if (sorted_) {
+            sorted_ = false;
+            sorted_until_ = elements_.size();
+            tail_sorted_ = true;
+        }
+        invalidate_lookups();
+        pending_erases_.emplace_back(key, elements_.size());
+        if (pending_erases_.size() >= elements_.size()) {
+            remove_pending_erases();
+        }
+    }
+
+    /**
+     * @brief Removes elements matching a predicate.
+     *
+     * Removes all elements for which @c pred returns @c true, in a single pass.
+     * Does not sort the container: elements that are not removed keep their
+     * relative order. Also removes elements erased through <tt>lazy_erase()</tt>.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param pred Predicate called with <tt>const value_type&</tt> for each element.
+     * @return Number of elements removed because @c pred returned @c true.
+     */
+    template<class Pred> size_type erase_if(Pred pred) {
+        async_sort_.wait();
+        return remove_elements_if([&pred](const V& elem) -> bool {
+            return pred(static_cast<const PubV&>(elem));
+        });
+    }
+
+    /**
+     * @brief Removes elements matching a predicate.
+     *
+     * Free function version of <tt>erase_if(Pred)</tt>, like <tt>std::erase_if()</tt>.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param c Container to remove elements from.
+     * @param pred Predicate called with <tt>const value_type&</tt> for each element.
+     * @return Number of elements removed.
+     */
+    template<class Pred> friend size_type erase_if(lazy_sorted_container& c, Pred pred) {
+        return c.erase_if(std::move(pred));
+    }
+
+    /**
+     * @brief Removes elements in many key ranges.
+     *
+     * Removes all elements whose key is in any of the ranges in <tt>[first, last[</tt>.
+     * Each range is a pair-like object whose @c first and @c second members are the
+     * bounds of the range; like <tt>erase(lower_bound(lo), lower_bound(hi))</tt>,
+     * @c first is included in the range and @c second is not. Ranges must be
+     * sorted by their @c first member, but may overlap.
+     *
+     * Sorts the container, then removes all elements in a single pass over the
+     * container and the ranges, which is much faster than calling
+     * <tt>erase(const_iterator, const_iterator)</tt> for each range, since the
+     * latter moves all following elements each time.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param first Beginning of sorted sequence of key ranges.
+     * @param last End of sorted sequence of key ranges.
+     * @return Number of elements removed.
+     */
+    template<class FwdIt> size_type erase_ranges(FwdIt first, FwdIt last) {
+        sort_if_needed();
+        const auto& kcmp = vcmp_.key_predicate();
+        return remove_elements_if([this, &kcmp, &first, &last](const V& elem) -> bool {
+            const auto& key = vtok_(elem);
+            while (first != last && !kcmp(key, first->second)) {
+                ++first;
+            }
+            return first != last && !kcmp(key, first->first);
+        });
+    }
+
+    /**
+     * @brief Removes elements whose key is not in a sorted sequence.
+     *
+     * Keeps only elements whose key is in <tt>[first, last[</tt>, which must
+     * be sorted using <tt>lazy_sorted_container::key_compare</tt> (for example,
+     * the keys of another lazy-sorted container). Sorts the container, then
+     * removes elements in a single pass over the container and the keys.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param first Beginning of sorted sequence of keys to keep.
+     * @param last End of sorted sequence of keys to keep.
+     * @return Number of elements removed.
+     */
+    template<class FwdIt> size_type retain_keys(FwdIt first, FwdIt last) {
+        return remove_elements_matching_keys(first, last, false);
+    }
+
+    /**
+     * @brief Removes elements whose key is in a sorted sequence.
+     *
+     * Removes all elements whose key is in <tt>[first, last[</tt>, which must
+     * be sorted using <tt>lazy_sorted_container::key_compare</tt>. Sorts the
+     * container, then removes elements in a single pass over the container
+     * and the keys. Unlike <tt>lazy_erase()</tt>, elements are removed before
+     * this method returns.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param first Beginning of sorted sequence of keys to remove.
+     * @param last End of sorted sequence of keys to remove.
+     * @return Number of elements removed.
+     */
+    template<class FwdIt> size_type erase_keys(FwdIt first, FwdIt last) {
+        return remove_elements_matching_keys(first, last, true);
+    }
+
     /**
      * @brief Clears all elements.
      *
      * Removes all elements from the container.
      */
     void clear() {
+        async_sort_.wait();
         elements_.clear();
+        pending_erases_.clear();
         sorted_ = true;
+        tail_breaks_ = 0;
+        invalidate_lookups();
     }
 
     /**
@@ -1928,15 +3088,33 @@ public:
      * Depending on internal container implementation, this is usually done
      * without moving of copying elements; only pointers are swapped.
      *
+     * @note Like for standard containers, if the allocator does not propagate
+     *       on swap (like <tt>std::pmr::polymorphic_allocator</tt>), both
+     *       containers must have equal allocators.
+     *
      * @param obj Container to swap with.
      */
     void swap(lazy_sorted_container& obj) {
+        // Like for standard containers, allocators must be equal if they do not propagate on swap.
+        assert(std::allocator_traits<allocator_type>::propagate_on_container_swap::value ||
+               elements_.get_allocator() == obj.elements_.get_allocator());
+        async_sort_.wait();
+        obj.async_sort_.wait();
         using std::swap;
         swap(elements_, obj.elements_);
         swap(sorted_, obj.sorted_);
+        swap(sorted_until_, obj.sorted_until_);
+        swap(tail_sorted_, obj.tail_sorted_);
+        swap(tail_breaks_, obj.tail_breaks_);
+        swap(searchable_tail_end_, obj.searchable_tail_end_);
+        swap(pending_limit_, obj.pending_limit_);
+        swap(tail_lookups_, obj.tail_lookups_);
         swap(vtok_, obj.vtok_);
         swap(vcmp_, obj.vcmp_);
         swap(veq_, obj.veq_);
+        swap(stats(), obj.stats());
+        swap(search_index(), obj.search_index());
+        swap(pending_erases_, obj.pending_erases_);
     }
 
     /**
@@ -1962,6 +3140,207 @@ public:
         obj1.swap(obj2);
     }
 
+    /**
+     * @brief Merges elements of another container into this one.
+     *
+     * Moves the elements of @c other into this container, like <tt>std::set::merge()</tt>.
+     * For containers that do not accept duplicates, elements of @c other whose
+     * keys are already in this container are left in @c other. For multi containers,
+     * all elements are moved; elements of @c other come after equivalent elements
+     * of this container.
+     *
+     * Both containers are sorted if needed, then merged in linear time; the
+     * result is sorted. If all elements of @c other come after those of this
+     * container, they are simply appended.
+     *
+     * @note Invalidates all iterators and references of both containers.
+     *
+     * @param other Container whose elements to merge. Must use an equivalent key comparator.
+     */
+    void merge(lazy_sorted_container& other) {
+        merge_impl(other, true);
+    }
+
+    /**
+     * @brief Merges elements of another container into this one (rvalue version).
+     *
+     * See <tt>merge(lazy_sorted_container&)</tt> for details.
+     *
+     * @note Invalidates all iterators and references of both containers.
+     *
+     * @param other Container whose elements to merge. Must use an equivalent key comparator.
+     */
+    void merge(lazy_sorted_container&& other) {
+        merge_impl(other, true);
+    }
+
+    /**
+     * @brief Moves all elements of another container into this one.
+     *
+     * Like <tt>merge()</tt>, but @c other is always left empty: for containers
+     * that do not accept duplicates, elements of @c other whose keys are already
+     * in this container are resolved using <tt>lazy_sorted_container::duplicate_policy</tt>,
+     * as if they had been inserted in this container, then destroyed.
+     *
+     * @note Invalidates all iterators and references of both containers.
+     *
+     * @param other Container whose elements to move. Must use an equivalent key comparator.
+     */
+    void splice(lazy_sorted_container& other) {
+        merge_impl(other, false);
+        other.clear();
+    }
+
+    /**
+     * @brief Moves all elements of another container into this one (rvalue version).
+     *
+     * See <tt>splice(lazy_sorted_container&)</tt> for details.
+     *
+     * @note Invalidates all iterators and references of both containers.
+     *
+     * @param other Container whose elements to move. Must use an equivalent key comparator.
+     */
+    void splice(lazy_sorted_container&& other) {
+        splice(other);
+    }
+
+    /**
+     * @brief Extracts a range of elements.
+     *
+     * Moves the elements in the range <tt>[first, last[</tt> to a new container
+     * and removes them from this container. The new container uses the same
+     * predicates and allocator as this one and is sorted, unless the range
+     * includes elements that were pending (see <tt>set_pending_limit()</tt>).
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param first Beginning of range of elements to extract.
+     * @param last End of range of elements to extract.
+     * @return Container holding the extracted elements.
+     */
+    lazy_sorted_container extract(const_iterator first, const_iterator last) {
+        async_sort_.wait();
+        auto result = make_empty_like(*this);
+        auto mfirst = elements_.erase(first, first);
+        auto mlast = std::next(mfirst, std::distance(first, last));
+        std::move(mfirst, mlast, std::back_inserter(result.elements_));
+        if (!sorted_) {
+            // Elements past the sorted prefix were pending and are not sorted.
+            const size_type first_pos = std::distance(elements_.begin(), mfirst);
+            const size_type last_pos = std::distance(elements_.begin(), mlast);
+            if (last_pos > sorted_until_ && result.elements_.size() > 1) {
+                result.sorted_ = false;
+                result.sorted_until_ = first_pos < sorted_until_ ? sorted_until_ - first_pos : 0;
+            }
+        }
+        erase(first, last);
+        return result;
+    }
+
+    /**
+     * @brief Extracts elements by key.
+     *
+     * Moves all elements associated with the given key to a new container
+     * and removes them from this container. See <tt>extract(const_iterator, const_iterator)</tt>.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param key Key of element(s) to extract.
+     * @return Container holding the extracted elements. For containers that
+     *         do not accept duplicates, it holds at most one element.
+     */
+    lazy_sorted_container extract(const key_type& key) {
+        auto range = equal_range(key);
+        return extract(range.first, range.second);
+    }
+
+    /**
+     * @brief Union of two containers.
+     *
+     * Returns a new container holding the elements found in @c left, @c right
+     * or both, like <tt>std::set_union()</tt>: for elements found in both, those
+     * of @c left are used. For multi containers, an element found @c m times in
+     * @c left and @c n times in @c right is found <tt>max(m, n)</tt> times in the result.
+     *
+     * Both containers are sorted if needed and the result is computed in linear time.
+     * The result is sorted and uses the predicates and allocator of @c left.
+     *
+     * @param left First container. Sorted if needed.
+     * @param right Second container. Sorted if needed. Must use an equivalent key comparator.
+     * @return Container holding the union of @c left and @c right.
+     */
+    friend lazy_sorted_container set_union(const lazy_sorted_container& left, const lazy_sorted_container& right) {
+        return left.copy_set_operation(right, [](auto... args) { return std::set_union(args...); });
+    }
+
+    /**
+     * @brief Union of two containers (rvalue version).
+     *
+     * Like <tt>set_union(const lazy_sorted_container&, const lazy_sorted_container&)</tt>,
+     * but elements are moved from both containers instead of being copied.
+     */
+    friend lazy_sorted_container set_union(lazy_sorted_container&& left, lazy_sorted_container&& right) {
+        return left.move_set_operation(right, [](auto... args) { return std::set_union(args...); });
+    }
+
+    /**
+     * @brief Intersection of two containers.
+     *
+     * Returns a new container holding the elements of @c left that are also found
+     * in @c right, like <tt>std::set_intersection()</tt>. For multi containers,
+     * an element found @c m times in @c left and @c n times in @c right is found
+     * <tt>min(m, n)</tt> times in the result.
+     *
+     * Both containers are sorted if needed and the result is computed in linear time.
+     * The result is sorted and uses the predicates and allocator of @c left.
+     *
+     * @param left First container. Sorted if needed.
+     * @param right Second container. Sorted if needed. Must use an equivalent key comparator.
+     * @return Container holding the intersection of @c left and @c right.
+     */
+    friend lazy_sorted_container set_intersection(const lazy_sorted_container& left, const lazy_sorted_container& right) {
+        return left.copy_set_operation(right, [](auto... args) { return std::set_intersection(args...); });
+    }
+
+    /**
+     * @brief Intersection of two containers (rvalue version).
+     *
+     * Like <tt>set_intersection(const lazy_sorted_container&, const lazy_sorted_container&)</tt>,
+     * but elements are moved from @c left instead of being copied.
+     */
+    friend lazy_sorted_container set_intersection(lazy_sorted_container&& left, lazy_sorted_container&& right) {
+        return left.move_set_operation(right, [](auto... args) { return std::set_intersection(args...); });
+    }
+
+    /**
+     * @brief Difference of two containers.
+     *
+     * Returns a new container holding the elements of @c left that are not
+     * found in @c right, like <tt>std::set_difference()</tt>. For multi containers,
+     * an element found @c m times in @c left and @c n times in @c right is found
+     * <tt>max(m - n, 0)</tt> times in the result.
+     *
+     * Both containers are sorted if needed and the result is computed in linear time.
+     * The result is sorted and uses the predicates and allocator of @c left.
+     *
+     * @param left First container. Sorted if needed.
+     * @param right Second container. Sorted if needed. Must use an equivalent key comparator.
+     * @return Container holding the elements of @c left not in @c right.
+     */
+    friend lazy_sorted_container set_difference(const lazy_sorted_container& left, const lazy_sorted_container& right) {
+        return left.copy_set_operation(right, [](auto... args) { return std::set_difference(args...); });
+    }
+
+    /**
+     * @brief Difference of two containers (rvalue version).
+     *
+     * Like <tt>set_difference(const lazy_sorted_container&, const lazy_sorted_container&)</tt>,
+     * but elements are moved from @c left instead of being copied.
+     */
+    friend lazy_sorted_container set_difference(lazy_sorted_container&& left, lazy_sorted_container&& right) {
+        return left.move_set_operation(right, [](auto... args) { return std::set_difference(args...); });
+    }
+
     /**
      * @brief Inserts or assigns a value.
      *
@@ -2010,6 +3389,41 @@ public:
         return insert_or_assign_impl(std::move(key), std::forward<OT>(val));
     }
 
+    /**
+     * @brief Inserts or assigns a value using any type of key.
+     *
+     * If the container contains an element associated with @c key, assigns
+     * @c val (by forwarding it) to its associated value. Otherwise, inserts
+     * a new element constructed by forwarding @c key and @c val. The key can
+     * be any type accepted by <tt>lazy_sorted_container::key_compare</tt>;
+     * a <tt>lazy_sorted_container::key_type</tt> is only constructed if the
+     * element is inserted.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param key Key of element to insert or assign to.
+     * @param val Value to insert or assign to @c key.
+     * @return @c pair whose @c first element is an @c iterator pointing at
+     *         the element in the container and whose @c second element will
+     *         be @c true if element was inserted or @c false if it was
+     *         assigned to.
+     * @remark This method is only available for non-multi maps, and only
+     *         if <tt>lazy_sorted_container::key_type</tt> can be constructed from @c key.
+     * @remark This method is only available if <tt>lazy_sorted_container::key_compare</tt>
+     *         is a transparent function (e.g. defines @c is_transparent), like
+     *         <tt>std::less<></tt>. For more info, see
+     *         http://en.cppreference.com/w/cpp/utility/functional/less_void
+     */
+    template<class OK,
+             class OT,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent,
+             class = enable_if_other_key_t<OK>,
+             class = std::enable_if_t<_IsNonMultiMap && std::is_constructible<key_type, OK&&>::value, void>>
+    std::pair<iterator, bool> insert_or_assign(OK&& key, OT&& val) {
+        return insert_or_assign_impl(std::forward<OK>(key), std::forward<OT>(val));
+    }
+
     /**
      * @brief Tries to construct an element in the container.
      *
@@ -2070,6 +3484,40 @@ public:
         return try_emplace_impl(std::move(key), std::forward<Args>(args)...);
     }
 
+    /**
+     * @brief Tries to construct an element in the container using any type of key.
+     *
+     * If the container already contains an element associated with @c key,
+     * does nothing; otherwise, constructs a new element in the container
+     * by forwarding @c key to the key's constructor and @c args to the value's
+     * constructor. The key can be any type accepted by <tt>lazy_sorted_container::key_compare</tt>;
+     * a <tt>lazy_sorted_container::key_type</tt> is only constructed if the
+     * element is added.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param key Key of element to try adding.
+     * @param args Arguments to forward to the value's constructor.
+     * @return @c pair whose @c first element is an @c iterator pointing at
+     *         the element in the container and whose @c second element will
+     *         be @c true if element was added or @c false if it already existed.
+     * @remark This method is only available for non-multi maps, and only
+     *         if <tt>lazy_sorted_container::key_type</tt> can be constructed from @c key.
+     * @remark This method is only available if <tt>lazy_sorted_container::key_compare</tt>
+     *         is a transparent function (e.g. defines @c is_transparent), like
+     *         <tt>std::less<></tt>. For more info, see
+     *         http://en.cppreference.com/w/cpp/utility/functional/less_void
+     */
+    template<class OK,
+             class... Args,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent,
+             class = enable_if_other_key_t<OK>,
+             class = std::enable_if_t<_IsNonMultiMap && std::is_constructible<key_type, OK&&>::value, void>>
+    std::pair<iterator, bool> try_emplace(OK&& key, Args&&... args) {
+        return try_emplace_impl(std::forward<OK>(key), std::forward<Args>(args)...);
+    }
+
     /**
      * @brief Returns number of elements associated to a key.
      *
@@ -2081,8 +3529,7 @@ public:
      * @return Number of elements associated with @c key.
      */
     size_type count(const key_type& key) const {
-        auto range = equal_range(key);
-        return std::distance(range.first, range.second);
+        return count_impl(key);
     }
 
     /**
@@ -2097,10 +3544,8 @@ public:
      *         pointing at the @c end of the container.
      */
     iterator find(const key_type& key) {
-        sort_if_needed();
-        auto elem_end = elements_.end();
-        auto it = std::lower_bound(elements_.begin(), elem_end, key, vcmp_);
-        return (it != elem_end && !vcmp_(key, *it)) ? it : elem_end;
+        auto cit = find_impl(key);
+        return std::next(elements_.begin(), std::distance(elements_.cbegin(), cit));
     }
 
     /**
@@ -2115,10 +3560,7 @@ public:
      *         pointing at the @c end of the container.
      */
     const_iterator find(const key_type& key) const {
-        sort_if_needed();
-        auto elem_cend = elements_.cend();
-        auto cit = std::lower_bound(elements_.cbegin(), elem_cend, key, vcmp_);
-        return (cit != elem_cend && !vcmp_(key, *cit)) ? cit : elem_cend;
+        return find_impl(key);
     }
 
     /**
@@ -2137,7 +3579,7 @@ public:
      */
     iterator lower_bound(const key_type& key) {
         sort_if_needed();
-        return std::lower_bound(elements_.begin(), elements_.end(), key, vcmp_);
+        return std::next(elements_.begin(), lower_bound_pos(key));
     }
 
     /**
@@ -2157,7 +3599,7 @@ public:
      */
     const_iterator lower_bound(const key_type& key) const {
         sort_if_needed();
-        return std::lower_bound(elements_.cbegin(), elements_.cend(), key, vcmp_);
+        return std::next(elements_.cbegin(), lower_bound_pos(key));
     }
 
     /**
@@ -2174,7 +3616,7 @@ public:
      */
     iterator upper_bound(const key_type& key) {
         sort_if_needed();
-        return std::upper_bound(elements_.begin(), elements_.end(), key, vcmp_);
+        return std::next(elements_.begin(), upper_bound_pos(key));
     }
 
     /**
@@ -2191,7 +3633,7 @@ public:
      */
     const_iterator upper_bound(const key_type& key) const {
         sort_if_needed();
-        return std::upper_bound(elements_.cbegin(), elements_.cend(), key, vcmp_);
+        return std::next(elements_.cbegin(), upper_bound_pos(key));
     }
 
     /**
@@ -2210,7 +3652,9 @@ public:
      */
     std::pair<iterator, iterator> equal_range(const key_type& key) {
         sort_if_needed();
-        return std::equal_range(elements_.begin(), elements_.end(), key, vcmp_);
+        auto range = equal_range_pos(key);
+        auto elem_begin = elements_.begin();
+        return std::make_pair(std::next(elem_begin, range.first), std::next(elem_begin, range.second));
     }
 
     /**
@@ -2230,7 +3674,9 @@ public:
      */
     std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const {
         sort_if_needed();
-        return std::equal_range(elements_.cbegin(), elements_.cend(), key, vcmp_);
+        auto range = equal_range_pos(key);
+        auto elem_cbegin = elements_.cbegin();
+        return std::make_pair(std::next(elem_cbegin, range.first), std::next(elem_cbegin, range.second));
     }
 
     /**
@@ -2252,8 +3698,7 @@ public:
              class _OKCmp = key_compare,
              class = typename _OKCmp::is_transparent>
     size_type count(const OK& key) const {
-        auto range = equal_range(key);
-        return std::distance(range.first, range.second);
+        return count_impl(key);
     }
 
     /**
@@ -2276,10 +3721,8 @@ public:
              class _OKCmp = key_compare,
              class = typename _OKCmp::is_transparent>
     iterator find(const OK& key) {
-        sort_if_needed();
-        auto elem_end = elements_.end();
-        auto it = std::lower_bound(elements_.begin(), elem_end, key, vcmp_);
-        return (it != elem_end && !vcmp_(key, *it)) ? it : elem_end;
+        auto cit = find_impl(key);
+        return std::next(elements_.begin(), std::distance(elements_.cbegin(), cit));
     }
 
     /**
@@ -2302,10 +3745,7 @@ public:
              class _OKCmp = key_compare,
              class = typename _OKCmp::is_transparent>
     const_iterator find(const OK& key) const {
-        sort_if_needed();
-        auto elem_cend = elements_.cend();
-        auto cit = std::lower_bound(elements_.cbegin(), elem_cend, key, vcmp_);
-        return (cit != elem_cend && !vcmp_(key, *cit)) ? cit : elem_cend;
+        return find_impl(key);
     }
 
     /**
@@ -2333,7 +3773,7 @@ public:
              class = typename _OKCmp::is_transparent>
     iterator lower_bound(const OK& key) {
         sort_if_needed();
-        return std::lower_bound(elements_.begin(), elements_.end(), key, vcmp_);
+        return std::next(elements_.begin(), lower_bound_pos(key));
     }
 
     /**
@@ -2361,7 +3801,7 @@ public:
              class = typename _OKCmp::is_transparent>
     const_iterator lower_bound(const OK& key) const {
         sort_if_needed();
-        return std::lower_bound(elements_.cbegin(), elements_.cend(), key, vcmp_);
+        return std::next(elements_.cbegin(), lower_bound_pos(key));
     }
 
     /**
@@ -2386,7 +3826,7 @@ public:
              class = typename _OKCmp::is_transparent>
     iterator upper_bound(const OK& key) {
         sort_if_needed();
-        return std::upper_bound(elements_.begin(), elements_.end(), key, vcmp_);
+        return std::next(elements_.begin(), upper_bound_pos(key));
     }
 
     /**
@@ -2411,7 +3851,7 @@ public:
              class = typename _OKCmp::is_transparent>
     const_iterator upper_bound(const OK& key) const {
         sort_if_needed();
-        return std::upper_bound(elements_.cbegin(), elements_.cend(), key, vcmp_);
+        return std::next(elements_.cbegin(), upper_bound_pos(key));
     }
 
     /**
@@ -2438,7 +3878,9 @@ public:
              class = typename _OKCmp::is_transparent>
     std::pair<iterator, iterator> equal_range(const OK& key) {
         sort_if_needed();
-        return std::equal_range(elements_.begin(), elements_.end(), key, vcmp_);
+        auto range = equal_range_pos(key);
+        auto elem_begin = elements_.begin();
+        return std::make_pair(std::next(elem_begin, range.first), std::next(elem_begin, range.second));
     }
 
     /**
@@ -2465,7 +3907,113 @@ public:
              class = typename _OKCmp::is_transparent>
     std::pair<const_iterator, const_iterator> equal_range(const OK& key) const {
         sort_if_needed();
-        return std::equal_range(elements_.cbegin(), elements_.cend(), key, vcmp_);
+        auto range = equal_range_pos(key);
+        auto elem_cbegin = elements_.cbegin();
+        return std::make_pair(std::next(elem_cbegin, range.first), std::next(elem_cbegin, range.second));
+    }
+
+    /**
+     * @brief Looks for many elements in the container.
+     *
+     * Looks for the elements matching each key in <tt>[first, last[</tt> and
+     * writes an iterator to each (or <tt>end()</tt> if it is not found) to
+     * @c out, in the order of keys. For multi containers, the iterator points
+     * to the first matching element. This is equivalent to calling <tt>find()</tt>
+     * for each key, but faster for many keys:
+     *
+     * - If keys are sorted according to <tt>lazy_sorted_container::key_compare</tt>,
+     *   elements are searched in a single pass, each search starting from the
+     *   previous result (galloping search).
+     * - Otherwise, if keys are arithmetic and searched using the default
+     *   <tt>binary_search_policy</tt>, the searches of groups of keys are
+     *   interleaved so that their memory accesses overlap.
+     *
+     * Keys can be of any type accepted by <tt>lazy_sorted_container::key_compare</tt>.
+     *
+     * @param first Beginning of range of keys to look for. Must be at least a forward iterator.
+     * @param last End of range of keys to look for.
+     * @param out Output iterator where to write iterators to elements found.
+     * @return Output iterator pointing after the last iterator written.
+     */
+    template<class It, class OutIt> OutIt find_all(It first, It last, OutIt out) {
+        sort_if_needed();
+        auto elem_begin = elements_.begin();
+        const auto size = elements_.size();
+        for_each_lower_bound(first, last, [&](const auto& key, size_type pos) {
+            *out++ = std::next(elem_begin, pos != size && !vcmp_(key, *std::next(elem_begin, pos)) ? pos : size);
+            return true;
+        });
+        return out;
+    }
+
+    /**
+     * @brief Looks for many elements in the container (const version).
+     *
+     * Looks for the elements matching each key in <tt>[first, last[</tt> and
+     * writes a <tt>const_iterator</tt> to each (or <tt>cend()</tt> if it is not found)
+     * to @c out, in the order of keys. See the non-const version for details.
+     *
+     * @param first Beginning of range of keys to look for. Must be at least a forward iterator.
+     * @param last End of range of keys to look for.
+     * @param out Output iterator where to write iterators to elements found.
+     * @return Output iterator pointing after the last iterator written.
+     */
+    template<class It, class OutIt> OutIt find_all(It first, It last, OutIt out) const {
+        sort_if_needed();
+        auto elem_cbegin = elements_.cbegin();
+        const auto size = elements_.size();
+        for_each_lower_bound(first, last, [&](const auto& key, size_type pos) {
+            *out++ = std::next(elem_cbegin, pos != size && !vcmp_(key, *std::next(elem_cbegin, pos)) ? pos : size);
+            return true;
+        });
+        return out;
+    }
+
+    /**
+     * @brief Counts elements matching many keys.
+     *
+     * Returns the total number of elements matching each key in <tt>[first, last[</tt>.
+     * This is equivalent to adding the results of <tt>count()</tt> for each key;
+     * keys that appear more than once are counted each time. Searches are performed
+     * like in <tt>find_all()</tt>.
+     *
+     * @param first Beginning of range of keys to look for. Must be at least a forward iterator.
+     * @param last End of range of keys to look for.
+     * @return Number of elements found.
+     */
+    template<class It> size_type count_all(It first, It last) const {
+        sort_if_needed();
+        size_type num = 0;
+        const auto elem_cbegin = elements_.cbegin();
+        const auto elem_cend = elements_.cend();
+        for_each_lower_bound(first, last, [&](const auto& key, size_type pos) {
+            auto cit = std::next(elem_cbegin, pos);
+            if (cit != elem_cend && !vcmp_(key, *cit)) {
+                num += Multi ? static_cast<size_type>(std::distance(cit, std::upper_bound(cit, elem_cend, key, vcmp_))) : 1;
+            }
+            return true;
+        });
+        return num;
+    }
+
+    /**
+     * @brief Checks if the container contains elements matching many keys.
+     *
+     * Checks if at least one element matches each key in <tt>[first, last[</tt>.
+     * Searches are performed like in <tt>find_all()</tt> and stop as soon
+     * as a key is not found.
+     *
+     * @param first Beginning of range of keys to look for. Must be at least a forward iterator.
+     * @param last End of range of keys to look for.
+     * @return @c true if all keys are found (or if there are no keys).
+     */
+    template<class It> bool contains_all(It first, It last) const {
+        sort_if_needed();
+        const auto elem_cbegin = elements_.cbegin();
+        const auto size = elements_.size();
+        return for_each_lower_bound(first, last, [&](const auto& key, size_type pos) {
+            return pos != size && !vcmp_(key, *std::next(elem_cbegin, pos));
+        });
     }
 
     /**
@@ -2501,6 +4049,7 @@ public:
      * @return Allocator instance.
      */
     allocator_type get_allocator() const {
+        async_sort_.wait();
         return elements_.get_allocator();
     }
 
@@ -2538,23 +4087,281 @@ public:
      *
      * It's possible to trigger sorting by calling <tt>sort()</tt>.
      *
+     * If a sort started by <tt>sort_async()</tt> is still in progress,
+     * returns @c false without waiting for it.
+     *
      * @return @c true if elements are currently sorted.
      * @see lazy_sorted_container::sort
      */
     bool sorted() const {
+        if (async_sort_.running()) {
+            return false;
+        }
+        async_sort_.wait();
         return sorted_;
     }
 
     /**
      * @brief Forces container to sort elements.
      *
-     * Forces container to sort its elements immediately. Has no effect
-     * if elements are already sorted.
+     * Forces container to sort its elements immediately. If elements are
+     * already sorted, only builds the search index if it needs to be rebuilt
+     * (see <tt>coveo/lazy/search_policy.h</tt>).
      *
      * @see lazy_sorted_container::sorted
      */
     void sort() {
         sort_if_needed();
+        build_search_index();
+    }
+
+    /**
+     * @brief Sorts elements asynchronously.
+     *
+     * Creates a task that sorts the container's elements and passes it to @c executor,
+     * which can run it immediately or schedule it to run later, in any thread. This makes
+     * it possible to sort a container once it is populated, before its first lookup, without
+     * blocking the caller; the executor can be a thread pool, a stage of a processing
+     * pipeline, etc.
+     *
+     * Until the task completes, the container's elements belong to it: any use of the
+     * container (lookup, iteration, insertion, copy, etc.) first waits for the task to
+     * complete, so callers only block if the sort is not finished yet. <tt>sorted()</tt>
+     * can be used to check this without blocking. Sort statistics are recorded by
+     * the task, in the thread running it. Temporary buffers used for sorting are
+     * also allocated with the container's allocator from that thread, so a memory
+     * resource shared with other objects must be thread-safe.
+     *
+     * @code
+     *   coveo::lazy::set<int> s;
+     *   // ... fill s ...
+     *   s.sort_async([&pool](auto&& task) { pool.post(std::move(task)); });
+     *   // ... do something else ...
+     *   auto it = s.find(42);  // Waits for the sort if it is still running
+     * @endcode
+     *
+     * @param executor Callable that will be invoked once with the task to run,
+     *                 a callable object that accepts no argument. The task must
+     *                 eventually be either run or destroyed.
+     * @return Future that becomes ready when the sort completes. If the sort fails or
+     *         the task is destroyed without running, the future holds the exception,
+     *         which is rethrown by the next use of the container; elements are then
+     *         left in the container, unsorted.
+     * @note The container must not be used or destroyed from within the task's
+     *       thread before the task completes, otherwise it will wait forever.
+     *       Starting an asynchronous sort invalidates all iterators. When the container
+     *       is protected by a shared mutex, the sort must be complete before readers
+     *       can share it, since the first use of the container after the sort updates it.
+     * @see lazy_sorted_container::sort_async()
+     */
+    template<class Executor> std::shared_future<void> sort_async(Executor&& executor) {
+        async_sort_.wait();
+        if (sorted_) {
+            std::promise<void> done;
+            done.set_value();
+            return done.get_future().share();
+        }
+        auto task = std::make_shared<std::packaged_task<void()>>([this]() { internal_sort(); });
+        auto done = task->get_future().share();
+        std::forward<Executor>(executor)([task]() { (*task)(); });
+        async_sort_.start(done);
+        return done;
+    }
+
+    /**
+     * @brief Sorts elements in a new thread.
+     *
+     * Same as <tt>sort_async(Executor&&)</tt>, but the sort is performed
+     * in a new, detached thread.
+     *
+     * @return Future that becomes ready when the sort completes.
+     * @see lazy_sorted_container::sort_async(Executor&&)
+     */
+    std::shared_future<void> sort_async() {
+        return sort_async([](auto&& task) { std::thread(std::forward<decltype(task)>(task)).detach(); });
+    }
+
+    /**
+     * @brief Returns an immutable view of the container's elements.
+     *
+     * Sorts the container if needed, then returns a <tt>lazy_sorted_container::view_type</tt>
+     * that shares ownership of a copy of its elements. The view offers the same lookup
+     * and iteration methods as the container but never needs to sort and cannot be
+     * modified, so it can be read from multiple threads at once without locking.
+     * The container itself is not affected.
+     *
+     * @return View of the container's sorted elements.
+     * @remarks This method is only available if the internal container stores
+     *          its elements contiguously, like <tt>std::vector</tt>.
+     * @see lazy_sorted_container::freeze() &&
+     */
+    view_type freeze() const & {
+        sort_if_needed();
+        return make_view(std::make_shared<const container_impl>(elements_));
+    }
+
+    /**
+     * @brief Returns an immutable view of the container's elements (rvalue version).
+     *
+     * Like <tt>freeze() const &</tt>, but the view takes ownership of the container's
+     * elements instead of copying them. The container is left empty.
+     *
+     * @code
+     *   coveo::lazy::set<int> s;
+     *   // ... fill s ...
+     *   auto v = std::move(s).freeze();
+     * @endcode
+     *
+     * @return View of the container's sorted elements.
+     * @remarks This method is only available if the internal container stores
+     *          its elements contiguously, like <tt>std::vector</tt>.
+     */
+    view_type freeze() && {
+        sort_if_needed();
+        auto owner = std::make_shared<const container_impl>(std::move(elements_));
+        clear();
+        return make_view(std::move(owner));
+    }
+
+    /**
+     * @brief Writes sorted elements to a stream.
+     *
+     * Sorts the container if needed, then writes its elements to @c os in
+     * a binary format that can be used in place by a
+     * <tt>lazy_sorted_container::view_type</tt>, for example by mapping
+     * the written file in memory. This makes it possible to load large
+     * containers without inserting or sorting their elements again.
+     * See <tt>coveo/lazy/sorted_view.h</tt> for details on the format.
+     *
+     * Elements are written as they are stored in memory; the data can
+     * therefore only be read on platforms with the same byte order and
+     * type layouts.
+     *
+     * @param os Stream to write to. Should be opened in binary mode.
+     *           Errors are reported through the stream's state.
+     * @remarks This method is only available if elements are trivially
+     *          copyable (or, for maps, if both keys and values are).
+     */
+    void serialize(std::ostream& os) const {
+        sort_if_needed();
+        write_sorted_view<V, key_compare, Multi>(os, elements_.cbegin(), elements_.cend(), elements_.size());
+    }
+
+    /**
+     * @brief Returns maximum number of pending elements.
+     *
+     * Returns the maximum number of unsorted elements that <tt>find()</tt>
+     * and <tt>count()</tt> can scan linearly instead of sorting the container.
+     *
+     * @return Maximum number of pending elements. Defaults to the number of
+     *         elements the internal container can store inline (see
+     *         <tt>coveo::lazy::small_vector</tt>), or 0 for other containers.
+     * @see lazy_sorted_container::set_pending_limit
+     */
+    size_type pending_limit() const {
+        return pending_limit_;
+    }
+
+    /**
+     * @brief Sets maximum number of pending elements.
+     *
+     * When elements are inserted out of order, the container needs to sort
+     * them on the next lookup. In workloads that alternate inserts and lookups,
+     * this can mean sorting on almost each lookup. To avoid this, a pending limit
+     * can be set: as long as there are no more than @c limit unsorted elements
+     * (inserted after the container was last sorted), <tt>find()</tt> and
+     * <tt>count()</tt> look for elements in the sorted elements using a binary
+     * search, then scan the unsorted ones linearly. Unsorted elements are merged
+     * with the sorted ones when there are too many of them or when another method
+     * that requires sorting is called (like <tt>begin()</tt> or <tt>lower_bound()</tt>).
+     *
+     * A small limit (for example, 16 to 64 elements) is usually best, since
+     * scanning is linear.
+     * When the internal container stores its elements inline (like
+     * <tt>coveo::lazy::small_vector</tt>), the limit defaults to its inline
+     * capacity: such containers are small enough that scanning them is
+     * faster than sorting them.
+     *
+     * While lookups can scan unsorted elements, <tt>end()</tt> and <tt>size()</tt>
+     * do not sort either. So that sorting does not remove elements later,
+     * containers that do not accept duplicates check new elements when they
+     * are inserted out of order; elements that are already in the container
+     * are discarded right away.
+     *
+     * Sorts the container if needed.
+     *
+     * @param limit Maximum number of pending elements. 0 disables the feature.
+     * @see lazy_sorted_container::pending_limit
+     */
+    void set_pending_limit(size_type limit) {
+        sort_if_needed();
+        pending_limit_ = limit;
+    }
+
+    /**
+     * @brief Returns whether tail lookups are enabled.
+     *
+     * Returns whether methods returning iterators can use the sorted buffer
+     * of elements added by <tt>operator[]()</tt> without sorting the container.
+     *
+     * @return @c true if tail lookups are enabled. Defaults to @c false.
+     * @see lazy_sorted_container::set_tail_lookups
+     */
+    bool tail_lookups() const {
+        return tail_lookups_;
+    }
+
+    /**
+     * @brief Enables or disables tail lookups.
+     *
+     * In non-multi maps, <tt>operator[]()</tt> keeps the elements it adds in
+     * a small sorted buffer at the end of the container instead of moving
+     * all following elements. By default, methods that return iterators,
+     * like <tt>find()</tt> or <tt>end()</tt>, merge that buffer with the other
+     * elements first, so that iterators always enumerate elements in order.
+     *
+     * When tail lookups are enabled, <tt>find()</tt> and <tt>end()</tt> binary
+     * search the buffer instead, and <tt>insert_or_assign()</tt> and
+     * <tt>try_emplace()</tt> also add their elements to it. As with
+     * <tt>set_pending_limit()</tt>, iterators returned by those methods can
+     * then point to elements that are not in order; use <tt>begin()</tt> or
+     * <tt>lower_bound()</tt> to iterate over elements in order.
+     *
+     * Sorts the container if needed.
+     *
+     * @param enabled Whether to enable tail lookups.
+     * @see lazy_sorted_container::tail_lookups
+     */
+    void set_tail_lookups(bool enabled) {
+        sort_if_needed();
+        tail_lookups_ = enabled;
+    }
+
+    /**
+     * @brief Returns sort statistics.
+     *
+     * Returns the instance of <tt>lazy_sorted_container::sort_stats_policy</tt>
+     * used by the container to collect statistics about sorting.
+     *
+     * @return Sort statistics policy instance.
+     */
+    const sort_stats_policy& sort_stats() const {
+        async_sort_.wait();
+        return stats();
+    }
+
+    /**
+     * @brief Returns sort statistics (non-const version).
+     *
+     * Returns the instance of <tt>lazy_sorted_container::sort_stats_policy</tt>
+     * used by the container to collect statistics about sorting. Can be used to
+     * reset statistics or to configure the policy (for example, to set a callback).
+     *
+     * @return Sort statistics policy instance.
+     */
+    sort_stats_policy& sort_stats() {
+        async_sort_.wait();
+        return stats();
     }
     
 private:
@@ -2562,76 +4369,568 @@ private:
     void sort_if_needed() const {
         // This method is const because we need to be able to perform sorting even in const
         // lookup/iteration methods. elements_ and sorted_ are mutable to make this possible.
+        async_sort_.wait();
         if (!sorted_) {
             // Wrap actual sorting in another method to try and improve inlining.
             internal_sort();
         }
     }
     void internal_sort() const {
-        // Sort, then remove duplicates if container does not accept them.
-        sort_lazy_container_elements<Multi>()(*this);
-        sorted_ = true;
+        // Removing erased elements first keeps them out of the sort; it might be all that was needed.
+        remove_pending_erases();
+        if (!sorted_) {
+            // Sort unsorted tail, then merge it with the sorted prefix and
+            // remove duplicates if container does not accept them.
+            sort_lazy_container_elements_and_record_stats<Multi, sort_stats_policy::enabled>()(*this);
+            sorted_ = true;
+            tail_breaks_ = 0;
+            invalidate_lookups();
+        }
+        build_search_index();
+    }
+
+    // Internal method that builds the search index of a sorted container, if it needs to be.
+    // This is only done when sorting so that lookups never modify the index.
+    void build_search_index() const {
+        if (sorted_) {
+            search_index().build(elements_.cbegin(), elements_.cend(), vcmp_, elements_.get_allocator());
+        }
+    }
+
+    // Internal method that returns a view of the sorted elements of impl, sharing its ownership.
+    view_type make_view(std::shared_ptr<const container_impl>&& impl) const {
+        static_assert(has_data_const_method<container_impl>::value,
+                      "freeze() requires an internal container that stores its elements contiguously");
+        const_pointer first = impl->data();
+        const_pointer last = first + impl->size();
+        return view_type(first, last, std::move(impl), vcmp_.key_predicate());
+    }
+
+    // Internal method that returns an empty, sorted container with the same predicates and allocator as obj.
+    static lazy_sorted_container make_empty_like(const lazy_sorted_container& obj) {
+        return lazy_sorted_container(obj.vcmp_.key_predicate(), obj.elements_.get_allocator(), obj.veq_.key_predicate());
+    }
+
+    // Internal method to merge the elements of other into this container. If keep_rejects is true,
+    // elements that cannot be merged because their keys already exist are kept in other.
+    void merge_impl(lazy_sorted_container& other, bool keep_rejects) {
+        if (this == &other) {
+            return;
+        }
+        sort_if_needed();
+        other.sort_if_needed();
+        invalidate_lookups();
+        other.invalidate_lookups();
+        if (other.elements_.empty()) {
+            return;
+        }
+        if (elements_.empty() || vcmp_(elements_.back(), other.elements_.front()) ||
+            (Multi && !vcmp_(other.elements_.front(), elements_.back()))) {
+            // All elements of other come after ours, simply append them.
+            std::move(other.elements_.begin(), other.elements_.end(), std::back_inserter(elements_));
+            other.elements_.clear();
+            return;
+        }
+        container_impl merged(elements_.get_allocator());
+        container_impl rejects(other.elements_.get_allocator());
+        auto it = elements_.begin(), end = elements_.end();
+        auto oit = other.elements_.begin(), oend = other.elements_.end();
+        while (it != end && oit != oend) {
+            if (vcmp_(*oit, *it)) {
+                merged.push_back(std::move(*oit++));
+            } else {
+                if (!Multi && !vcmp_(*it, *oit)) {
+                    if (keep_rejects) {
+                        rejects.push_back(std::move(*oit));
+                    } else {
+                        resolve_duplicate(*it, *oit);
+                    }
+                    ++oit;
+                }
+                merged.push_back(std::move(*it++));
+            }
+        }
+        std::move(it, end, std::back_inserter(merged));
+        std::move(oit, oend, std::back_inserter(merged));
+        elements_.swap(merged);
+        other.elements_.swap(rejects);
+    }
+
+    // Internal method that performs a set operation like std::set_union on the elements
+    // of this container and those of right, copying them. Result uses our predicates and allocator.
+    template<class SetOp>
+    lazy_sorted_container copy_set_operation(const lazy_sorted_container& right, const SetOp& set_op) const {
+        sort_if_needed();
+        right.sort_if_needed();
+        auto result = make_empty_like(*this);
+        set_op(elements_.cbegin(), elements_.cend(), right.elements_.cbegin(), right.elements_.cend(),
+               std::back_inserter(result.elements_), vcmp_);
+        return result;
+    }
+
+    // Same as copy_set_operation, but elements are moved from both containers.
+    template<class SetOp>
+    lazy_sorted_container move_set_operation(lazy_sorted_container& right, const SetOp& set_op) {
+        sort_if_needed();
+        right.sort_if_needed();
+        auto result = make_empty_like(*this);
+        set_op(std::make_move_iterator(elements_.begin()), std::make_move_iterator(elements_.end()),
+               std::make_move_iterator(right.elements_.begin()), std::make_move_iterator(right.elements_.end()),
+               std::back_inserter(result.elements_), vcmp_);
+        return result;
+    }
+
+    // Internal method to sort if needed before a lookup. If the unsorted tail
+    // is small enough, lookups can scan it instead (see set_pending_limit).
+    // If it was added by operator[] and similar methods, lookups can binary search it,
+    // but only return iterators to the container if tail lookups are enabled (see set_tail_lookups).
+    void sort_if_needed_for_lookup(bool returns_iterator = true) const {
+        async_sort_.wait();
+        const bool tail_usable = tail_searchable() && (tail_lookups_ || !returns_iterator);
+        if (!sorted_ && ((elements_.size() - sorted_until_ > pending_limit_ && !tail_usable) || !pending_erases_.empty())) {
+            internal_sort();
+        }
+    }
+
+    // Internal method that checks if the unsorted tail can be binary searched (see find_insert_position).
+    bool tail_searchable() const {
+        return tail_sorted_ && searchable_tail_end_ == elements_.size();
+    }
+
+    // Internal method to call when elements are added, removed or reordered. Invalidates
+    // the search index and forgets that the unsorted tail could be binary searched.
+    void invalidate_lookups() const {
+        search_index().invalidate();
+        searchable_tail_end_ = 0;
+    }
+
+    // Internal method to call before removing elements in [first, last[. If elements are pending,
+    // shrinks the sorted prefix by the number of elements removed from it, so that pending
+    // elements following it are not considered sorted afterwards.
+    void before_erase(const const_iterator_impl& first, const const_iterator_impl& last) {
+        invalidate_lookups();
+        if (!sorted_) {
+            const size_type first_pos = std::distance(elements_.cbegin(), first);
+            const size_type last_pos = std::distance(elements_.cbegin(), last);
+            if (first_pos < sorted_until_) {
+                sorted_until_ -= std::min(last_pos, sorted_until_) - first_pos;
+            }
+        }
+    }
+
+    // Internal method to remove elements erased by lazy_erase(), if any.
+    void remove_pending_erases() const {
+        if (!pending_erases_.empty()) {
+            remove_elements_if([](const V&) { return false; });
+        }
+    }
+
+    // Internal method that sorts the container, then removes elements whose key is (or is not, if !matching)
+    // in the sorted sequence of keys [first, last[ in a single pass. Used by retain_keys() and erase_keys().
+    template<class FwdIt> size_type remove_elements_matching_keys(FwdIt first, FwdIt last, bool matching) {
+        sort_if_needed();
+        const auto& kcmp = vcmp_.key_predicate();
+        return remove_elements_if([this, &kcmp, &first, &last, matching](const V& elem) -> bool {
+            const auto& key = vtok_(elem);
+            while (first != last && kcmp(*first, key)) {
+                ++first;
+            }
+            return (first != last && !kcmp(key, *first)) == matching;
+        });
+    }
+
+    // Internal method to remove elements for which pred returns true as well as those erased by
+    // lazy_erase(), in a single pass. Preserves sorting flags. Returns number of elements removed because of pred.
+    template<class Pred> size_type remove_elements_if(const Pred& pred) const {
+        const auto& kcmp = vcmp_.key_predicate();
+        auto erase_less = [&kcmp](const pending_erase& left, const pending_erase& right) {
+            return kcmp(left.first, right.first);
+        };
+
+        // Keep only the last erasure of each key, which applies to the most elements.
+        detail::allocator_stable_sort(pending_erases_.begin(), pending_erases_.end(), erase_less, pending_erases_.get_allocator());
+        auto erases_end = pending_erases_.begin();
+        for (auto it = pending_erases_.begin(); it != pending_erases_.end(); ++it) {
+            auto next = std::next(it);
+            if (next == pending_erases_.end() || erase_less(*it, *next)) {
+                if (erases_end != it) {
+                    *erases_end = std::move(*it);
+                }
+                ++erases_end;
+            }
+        }
+        pending_erases_.erase(erases_end, pending_erases_.end());
+
+        const size_type prefix_size = sorted_ ? elements_.size() : sorted_until_;
+        const bool tail_was_searchable = !sorted_ && tail_searchable();
+        size_type pos = 0, prefix_removed = 0, pred_removed = 0;
+        auto out = elements_.begin();
+        for (auto it = elements_.begin(), end = elements_.end(); it != end; ++it, ++pos) {
+            bool remove = false;
+            if (!pending_erases_.empty()) {
+                const auto& key = vtok_(*it);
+                auto erase_it = std::lower_bound(pending_erases_.cbegin(), pending_erases_.cend(), key,
+                                                 [&kcmp](const pending_erase& pending, const key_type& k) {
+                                                     return kcmp(pending.first, k);
+                                                 });
+                remove = erase_it != pending_erases_.cend() && pos < erase_it->second && !kcmp(key, erase_it->first);
+            }
+            if (!remove && pred(*it)) {
+                remove = true;
+                ++pred_removed;
+            }
+            if (remove) {
+                if (pos < prefix_size) {
+                    ++prefix_removed;
+                }
+            } else {
+                if (out != it) {
+                    *out = std::move(*it);
+                }
+                ++out;
+            }
+        }
+        elements_.erase(out, elements_.end());
+        pending_erases_.clear();
+        invalidate_lookups();
+        if (!sorted_) {
+            sorted_until_ -= prefix_removed;
+            sorted_ = sorted_until_ == elements_.size() || elements_.size() <= 1;
+            if (tail_was_searchable) {
+                // Removing elements does not affect the order of the others.
+                searchable_tail_end_ = elements_.size();
+            }
+        }
+        return pred_removed;
+    }
+
+    // Internal method that calls found(key, pos) with the position of the lower bound of each key
+    // in [first, last[, in order, until it returns false. Container must be sorted.
+    // Returns false if found returned false.
+    template<class It, class Found> bool for_each_lower_bound(It first, It last, const Found& found) const {
+        using probe_key_type = std::decay_t<decltype(*first)>;
+        const auto kcmp = vcmp_.key_predicate();
+        if (std::is_sorted(first, last, [&](const auto& left, const auto& right) { return kcmp(left, right); })) {
+            return for_each_sorted_lower_bound(first, last, found);
+        }
+        return for_each_lower_bound(first, last, found,
+                                    std::integral_constant<bool, std::is_same<search_policy, binary_search_policy>::value &&
+                                                                 detail::is_branchless_searchable<const_iterator_impl, value_compare,
+                                                                                          probe_key_type>::value>());
+    }
+    template<class It, class Found> bool for_each_lower_bound(It first, It last, const Found& found, std::true_type) const {
+        return detail::branchless_lower_bound_each(elements_.cbegin(), elements_.cend(), first, last, vcmp_, found);
+    }
+    template<class It, class Found> bool for_each_lower_bound(It first, It last, const Found& found, std::false_type) const {
+        for (; first != last; ++first) {
+            if (!found(*first, lower_bound_pos(*first))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Internal method that calls found(key, pos) for the lower bound of each key in [first, last[,
+    // which must be sorted. Each search starts from the previous result and looks for a range
+    // containing the lower bound by doubling its size, then performs a binary search in that range.
+    template<class It, class Found> bool for_each_sorted_lower_bound(It first, It last, const Found& found) const {
+        const auto elem_cbegin = elements_.cbegin();
+        const size_type size = elements_.size();
+        size_type low = 0;
+        for (; first != last; ++first) {
+            const auto& key = *first;
+            size_type high = low;
+            size_type step = 1;
+            while (high < size && vcmp_(*std::next(elem_cbegin, high), key)) {
+                low = high + 1;
+                high = low + step;
+                step *= 2;
+            }
+            high = std::min(high, size);
+            low += detail::lower_bound_position(std::next(elem_cbegin, low), std::next(elem_cbegin, high), key, vcmp_);
+            if (!found(key, low)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Internal methods to look for a key in the sorted container using the search policy.
+    template<class OK> size_type lower_bound_pos(const OK& key) const {
+        return static_cast<size_type>(search_index().lower_bound(elements_.cbegin(), elements_.cend(), key, vcmp_));
+    }
+    template<class OK> size_type upper_bound_pos(const OK& key) const {
+        return static_cast<size_type>(search_index().upper_bound(elements_.cbegin(), elements_.cend(), key, vcmp_));
+    }
+    template<class OK> std::pair<size_type, size_type> equal_range_pos(const OK& key) const {
+        auto range = search_index().equal_range(elements_.cbegin(), elements_.cend(), key, vcmp_);
+        return std::make_pair(static_cast<size_type>(range.first), static_cast<size_type>(range.second));
+    }
+
+    // Internal method to look for an element, scanning the unsorted tail if needed.
+    // If returns_iterator is false, the result is only used to access the element.
+    template<class OK> const_iterator_impl find_impl(const OK& key, bool returns_iterator = true) const {
+        sort_if_needed_for_lookup(returns_iterator);
+        auto elem_cend = elements_.cend();
+        auto prefix_cend = sorted_ ? elem_cend : std::next(elements_.cbegin(), sorted_until_);
+        auto cit = sorted_ ? std::next(elements_.cbegin(), lower_bound_pos(key))
+                           : std::next(elements_.cbegin(), detail::lower_bound_position(elements_.cbegin(), prefix_cend, key, vcmp_));
+        if (cit != prefix_cend && !vcmp_(key, *cit)) {
+            return cit;
+        }
+        if (!sorted_ && tail_searchable()) {
+            cit = std::next(prefix_cend, detail::lower_bound_position(prefix_cend, elem_cend, key, vcmp_));
+            return cit != elem_cend && !vcmp_(key, *cit) ? cit : elem_cend;
+        }
+        return sorted_ ? elem_cend : std::find_if(prefix_cend, elem_cend, [&](const V& elem) {
+            return !vcmp_(elem, key) && !vcmp_(key, elem);
+        });
+    }
+
+    // Internal method to count elements, scanning the unsorted tail if needed.
+    template<class OK> size_type count_impl(const OK& key) const {
+        sort_if_needed_for_lookup(false);
+        auto elem_cend = elements_.cend();
+        auto prefix_cend = sorted_ ? elem_cend : std::next(elements_.cbegin(), sorted_until_);
+        size_type num = 0;
+        if (sorted_) {
+            auto range = equal_range_pos(key);
+            num = range.second - range.first;
+        } else {
+            auto range = detail::equal_range_positions(elements_.cbegin(), prefix_cend, key, vcmp_);
+            num = static_cast<size_type>(range.second - range.first);
+        }
+        if (!sorted_ && (Multi || num == 0) && tail_searchable()) {
+            auto range = detail::equal_range_positions(prefix_cend, elem_cend, key, vcmp_);
+            num += static_cast<size_type>(range.second - range.first);
+        } else if (!sorted_ && (Multi || num == 0)) {
+            num += static_cast<size_type>(std::count_if(prefix_cend, elem_cend, [&](const V& elem) {
+                return !vcmp_(elem, key) && !vcmp_(key, elem);
+            }));
+            if (!Multi && num > 1) {
+                // Duplicates will be removed when sorting.
+                num = 1;
+            }
+        }
+        return num;
     }
 
     // Internal method to keep sorted if possible
     void update_sorted_after_push_back() {
-        if (elements_.size() > 1) {
-            // Keep sorted if new element was inserted in the proper place.
-            updated_lazy_container_sorted_flag_after_insert<Multi>()(*this);
+        invalidate_lookups();
+        if (append_policy::trusted) {
+            // New element belongs at the end; sorting flags remain valid.
+            assert(elements_.size() <= 1 ||
+                   lazy_container_elements_in_order<Multi>()(*this, *(elements_.crbegin() + 1), elements_.back()));
+        } else if (sorted_) {
+            if (elements_.size() > 1) {
+                // Keep sorted if new element was inserted in the proper place.
+                updated_lazy_container_sorted_flag_after_insert<Multi>()(*this);
+                tail_breaks_ = 0;
+            }
+        } else if (append_policy::tracks_tail) {
+            // Count elements breaking the order of the unsorted tail, to merge its runs when sorting.
+            if (elements_.size() - 1 != sorted_until_ &&
+                !lazy_container_elements_in_order<Multi>()(*this, *(elements_.crbegin() + 1), elements_.back())) {
+                tail_sorted_ = false;
+                ++tail_breaks_;
+            }
+        } else {
+            // We don't check if the unsorted tail is still sorted.
+            tail_sorted_ = false;
+        }
+        remove_pending_duplicates(elements_.size() - 1);
+    }
+
+    // Internal method to remove duplicates from pending elements (see set_pending_limit).
+    void remove_pending_duplicates(size_type first_new) {
+        remove_lazy_container_pending_duplicates<Multi>()(*this, first_new);
+    }
+
+    // Internal method to resolve dup, inserted after kept, using our duplicate policy. dup is then destroyed.
+    void resolve_duplicate(V& kept, V& dup) const {
+        lazy_container_duplicate_payload<!std::is_void<T>::value> payload;
+        duplicate_policy().resolve(payload(kept), std::move(payload(dup)));
+    }
+
+    // Internal method to remove consecutive duplicates in [first, last[, resolving them using our duplicate policy.
+    template<class RandIt, class Sorter> RandIt unique_resolve(RandIt first, RandIt last, const Sorter& sorter) const {
+        return unique_resolve(first, last, sorter, std::is_same<duplicate_policy, default_duplicate_policy>());
+    }
+    template<class RandIt, class Sorter> RandIt unique_resolve(RandIt first, RandIt last, const Sorter& sorter, std::true_type) const {
+        return sorter.unique(first, last, veq_);
+    }
+    template<class RandIt, class Sorter> RandIt unique_resolve(RandIt first, RandIt last, const Sorter&, std::false_type) const {
+        return detail::unique_resolve(first, last, veq_, [this](V& kept, V&& dup) { resolve_duplicate(kept, dup); });
+    }
+
+    // Internal method to insert a range of elements that are known to be sorted.
+    template<class It> void insert_sorted(It first, It last) {
+        async_sort_.wait();
+        const size_type old_size = elements_.size();
+        elements_.insert(elements_.cend(), first, last);
+        assert(sorted_run_end(std::next(elements_.cbegin(), old_size), elements_.cend()) == elements_.cend());
+        update_sorted_after_sorted_append(old_size);
+        remove_pending_duplicates(old_size);
+    }
+
+    // Internal method to insert a range of elements and check if they are sorted.
+    template<class It> void insert_checked(It first, It last) {
+        async_sort_.wait();
+        const size_type old_size = elements_.size();
+        elements_.insert(elements_.cend(), first, last);
+        auto new_begin = std::next(elements_.cbegin(), old_size);
+        auto run_end = sorted_run_end(new_begin, elements_.cend());
+        if (run_end == elements_.cend()) {
+            update_sorted_after_sorted_append(old_size);
+        } else {
+            // Only the beginning of the new elements is sorted; if it continues
+            // the sorted container, we can at least extend the sorted prefix.
+            if (sorted_) {
+                sorted_until_ = old_size;
+                if (old_size == 0 || lazy_container_elements_in_order<Multi>()(*this, *std::prev(new_begin), *new_begin)) {
+                    sorted_until_ += static_cast<size_type>(std::distance(new_begin, run_end));
+                }
+                sorted_ = false;
+            }
+            tail_sorted_ = false;
+        }
+        remove_pending_duplicates(old_size);
+    }
+
+    // Internal method to update sorted flags after sorted elements have been appended.
+    void update_sorted_after_sorted_append(size_type old_size) {
+        invalidate_lookups();
+        auto new_begin = std::next(elements_.cbegin(), old_size);
+        if (old_size != 0 && new_begin != elements_.cend()) {
+            // Check if new elements can simply be added to the sorted prefix or tail.
+            const bool continued = lazy_container_elements_in_order<Multi>()(*this, *std::prev(new_begin), *new_begin);
+            if (sorted_) {
+                if (!continued) {
+                    sorted_ = false;
+                    sorted_until_ = old_size;
+                    tail_sorted_ = true;
+                }
+            } else if (sorted_until_ == old_size) {
+                tail_sorted_ = true;
+            } else {
+                tail_sorted_ = tail_sorted_ && continued;
+            }
         }
     }
 
+    // Internal method to find the end of the sorted run at the beginning of a range of elements.
+    const_iterator_impl sorted_run_end(const_iterator_impl first, const_iterator_impl last) const {
+        auto it = std::adjacent_find(first, last, [this](const V& left, const V& right) {
+            return !lazy_container_elements_in_order<Multi>()(*this, left, right);
+        });
+        return it != last ? std::next(it) : last;
+    }
+
+    // Internal method that finds the element associated with key in a non-multi container, or the position
+    // where it should be inserted, for operator[] and similar methods. Inserting in the middle of a sorted
+    // container would move all following elements, so new elements are inserted in the unsorted tail instead,
+    // keeping it sorted and free of keys found in the prefix; lookups can then binary search it. The tail
+    // is merged with the prefix when it gets larger than about sqrt(size). If use_tail is false, the container
+    // is sorted and new elements are inserted in place instead, for methods returning iterators (see
+    // set_tail_lookups). Returns position of element and whether it was found; if not found, call
+    // update_after_emplace() after inserting at that position.
+    template<class OK> std::pair<iterator_impl, bool> find_insert_position(const OK& key, bool use_tail) {
+        async_sort_.wait();
+        remove_pending_erases();
+        if (!sorted_) {
+            const size_type tail_size = elements_.size() - sorted_until_;
+            if (!use_tail || !tail_searchable() || tail_size >= std::max(pending_limit_, max_searchable_tail_size())) {
+                internal_sort();
+            }
+        }
+        auto elem_begin = elements_.begin();
+        auto elem_end = elements_.end();
+        if (sorted_) {
+            auto it = std::next(elem_begin, lower_bound_pos(key));
+            if (it != elem_end && !vcmp_(key, *it)) {
+                return std::make_pair(it, true);
+            }
+            if (it != elem_end && use_tail) {
+                // Start a new tail instead of moving elements.
+                sorted_ = false;
+                sorted_until_ = elements_.size();
+                tail_sorted_ = true;
+                it = elem_end;
+            }
+            return std::make_pair(it, false);
+        }
+        auto prefix_end = std::next(elem_begin, sorted_until_);
+        auto it = std::next(elem_begin, detail::lower_bound_position(elem_begin, prefix_end, key, vcmp_));
+        if (it != prefix_end && !vcmp_(key, *it)) {
+            return std::make_pair(it, true);
+        }
+        it = std::next(prefix_end, detail::lower_bound_position(prefix_end, elem_end, key, vcmp_));
+        return std::make_pair(it, it != elem_end && !vcmp_(key, *it));
+    }
+
+    // Internal method to call after inserting an element at the position returned by find_insert_position().
+    void update_after_emplace() {
+        invalidate_lookups();
+        if (!sorted_) {
+            searchable_tail_end_ = elements_.size();
+        }
+    }
+
+    // Internal method that returns the maximum size of the tail managed by find_insert_position().
+    size_type max_searchable_tail_size() const {
+        return std::max(size_type(64), static_cast<size_type>(std::sqrt(static_cast<double>(elements_.size()))));
+    }
+
     // Internal implementation of operator[]. Works with both lvalue and rvalue references.
     template<class OK,
              class _T = T,
-             class _TRef = std::enable_if_t<_IsNonMultiMap && std::is_same<std::decay_t<OK>, key_type>::value, _T&>>
+             class _TRef = std::enable_if_t<_IsNonMultiMap, _T&>>
     _TRef operator_brackets_impl(OK&& key) {
-        sort_if_needed();
-        auto elem_end = elements_.end();
-        auto it = std::lower_bound(elements_.begin(), elem_end, key, vcmp_);
-        if (it == elem_end || vcmp_(key, *it)) {
-            it = elements_.emplace(it, std::piecewise_construct,
-                                       std::forward_as_tuple(std::forward<OK>(key)),
-                                       std::make_tuple());
+        // Only a reference is returned, so the new element can always go in the tail.
+        auto pos = find_insert_position(key, true);
+        if (!pos.second) {
+            pos.first = elements_.emplace(pos.first, std::piecewise_construct,
+                                                     std::forward_as_tuple(std::forward<OK>(key)),
+                                                     std::make_tuple());
+            update_after_emplace();
         }
-        return it->second;
+        return pos.first->second;
     }
 
     // Internal implementation of insert_or_assign(). Works with both lvalue and rvalue key references.
     template<class OK,
              class OT,
-             class = std::enable_if_t<_IsNonMultiMap && std::is_same<std::decay_t<OK>, key_type>::value, void>>
+             bool _Enabled = _IsNonMultiMap,
+             class = std::enable_if_t<_Enabled, void>>
     std::pair<iterator, bool> insert_or_assign_impl(OK&& key, OT&& val) {
-        sort_if_needed();
-        auto elem_end = elements_.end();
-        auto it = std::lower_bound(elements_.begin(), elem_end, key, vcmp_);
-        bool inserted = (it == elem_end || vcmp_(key, *it));
-        if (inserted) {
+        auto pos = find_insert_position(key, tail_lookups_);
+        if (!pos.second) {
             // Element does not exist, we must insert.
-            it = elements_.emplace(it, std::forward<OK>(key), std::forward<OT>(val));
+            pos.first = elements_.emplace(pos.first, std::forward<OK>(key), std::forward<OT>(val));
+            update_after_emplace();
         } else {
             // Element already exists, assign to existing mapped value.
-            it->second = std::forward<OT>(val);
+            pos.first->second = std::forward<OT>(val);
         }
-        return std::pair<iterator, bool>(std::move(it), inserted);
+        return std::pair<iterator, bool>(std::move(pos.first), !pos.second);
     }
 
     // Internal implementation of try_emplace(). Works with both lvalue and rvalue key references.
     template<class OK,
              class... Args,
-             class = std::enable_if_t<_IsNonMultiMap && std::is_same<std::decay_t<OK>, key_type>::value, void>>
+             bool _Enabled = _IsNonMultiMap,
+             class = std::enable_if_t<_Enabled, void>>
     std::pair<iterator, bool> try_emplace_impl(OK&& key, Args&&... args) {
-        sort_if_needed();
-        auto elem_end = elements_.end();
-        auto it = std::lower_bound(elements_.begin(), elem_end, key, vcmp_);
-        bool emplaced = (it == elem_end || vcmp_(key, *it));
-        if (emplaced) {
+        auto pos = find_insert_position(key, tail_lookups_);
+        if (!pos.second) {
             // Element doesn't exist, we can emplace.
-            it = elements_.emplace(it, std::piecewise_construct,
-                                       std::forward_as_tuple(std::forward<OK>(key)),
-                                       std::forward_as_tuple(std::forward<Args>(args)...));
+            pos.first = elements_.emplace(pos.first, std::piecewise_construct,
+                                                     std::forward_as_tuple(std::forward<OK>(key)),
+                                                     std::forward_as_tuple(std::forward<Args>(args)...));
+            update_after_emplace();
         }
-        return std::pair<iterator, bool>(std::move(it), emplaced);
+        return std::pair<iterator, bool>(std::move(pos.first), !pos.second);
     }
 
     // Helpers to throw consistent exceptions
@@ -2727,11 +5026,16 @@ struct identity {
  * Unary predicate that projects the reference to a <tt>pair</tt>'s @c first element.
  * Used as "value to key" for map-like containers.
  *
+ * Accepts any pair-like object, not only @c P: containers also pass their public
+ * value type (e.g. <tt>std::pair</tt>, a base of <tt>map_pair</tt>), which would
+ * otherwise be converted to a temporary copy of the whole pair on each call.
+ *
  * @tparam P Type of pair to project the first element of.
  */
 template<class P>
 struct pair_first {
-    decltype(auto) operator()(const P& obj) const {
+    template<class OP>
+    decltype(auto) operator()(const OP& obj) const {
         return std::get<0>(obj);
     }
 };
@@ -2792,9 +5096,11 @@ public:
     map_pair(U1&& fir, U2&& sec)
         : base_std_pair(std::forward<U1>(fir), std::forward<U2>(sec)) { }
 
-    // Copy and move constructors.
+    // Copy and move constructors. Moves are noexcept when those of the members are,
+    // so that internal containers move elements instead of copying them when they grow.
     map_pair(const map_pair&) = default;
-    map_pair(map_pair&& obj)
+    map_pair(map_pair&& obj) noexcept(std::is_nothrow_move_constructible<RT1>::value &&
+                                      std::is_nothrow_move_constructible<T2>::value)
         : base_std_pair(std::move(const_cast<RT1&>(obj.first)), std::move(obj.second)) { }
 
     // Constructors from compatible map_pair's.
@@ -2835,7 +5141,8 @@ public:
     }
 
     // Move assignment operators.
-    map_pair& operator=(map_pair&& obj) {
+    map_pair& operator=(map_pair&& obj) noexcept(std::is_nothrow_move_assignable<RT1>::value &&
+                                                 std::is_nothrow_move_assignable<T2>::value) {
         const_cast<RT1&>(this->first) = std::move(const_cast<RT1&>(obj.first));
         this->second = std::move(obj.second);
         return *this;
@@ -2901,6 +5208,19 @@ template<class K,
          template<class _AllocT> class _Alloc = std::allocator>
 using map_allocator = _Alloc<map_pair<K, T>>;
 
+/**
+ * @internal
+ * @brief Specialization of @c is_trivially_serializable for @c map_pair.
+ * @headerfile lazy_sorted_container.h <coveo/lazy/detail/lazy_sorted_container.h>
+ *
+ * @c map_pair is not trivially copyable because of its assignment operators,
+ * but its bytes can be copied if those of its first and second elements can.
+ */
+template<class RT1, class T2, class _BaseStdPair>
+struct is_trivially_serializable<map_pair<RT1, T2, _BaseStdPair>>
+    : std::integral_constant<bool, std::is_trivially_copyable<RT1>::value &&
+                                   std::is_trivially_copyable<T2>::value> { };
+
 /// @endcond
 
 } // detail
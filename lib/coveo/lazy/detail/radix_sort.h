@@ -0,0 +1,390 @@
+/**
+ * @file
+ * @brief Radix sort used by lazy-sorted containers.
+ *
+ * This header file contains an implementation of LSD radix sort that
+ * is used by <tt>coveo::lazy::default_sort_policy</tt> to sort elements
+ * with arithmetic keys in linear time. It should not be necessary to
+ * use types defined in this header directly.
+ *
+ * @copyright 2015-2016, Coveo Solutions Inc.
+ *            Distributed under the Apache License, Version 2.0 (see <a href="https://github.com/coveo/lazy/blob/master/LICENSE">LICENSE</a>).
+ */
+
+#ifndef COVEO_LAZY_DETAIL_RADIX_SORT_H
+#define COVEO_LAZY_DETAIL_RADIX_SORT_H
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace coveo {
+namespace lazy {
+namespace detail {
+
+/**
+ * @internal
+ * @brief Helper to detect valid expressions in partial specializations.
+ * @headerfile radix_sort.h <coveo/lazy/detail/radix_sort.h>
+ *
+ * Equivalent of C++17's <tt>std::void_t</tt>.
+ */
+template<class...> struct make_void { using type = void; };
+
+/**
+ * @internal
+ * @brief Vector used as a temporary buffer while sorting.
+ * @headerfile radix_sort.h <coveo/lazy/detail/radix_sort.h>
+ *
+ * <tt>std::vector</tt> that uses the allocator of the container being sorted,
+ * rebound to type @c T, so that sorting does not allocate memory elsewhere.
+ *
+ * @tparam T Type of items in the vector.
+ * @tparam Alloc Allocator of the container being sorted.
+ */
+template<class T, class Alloc>
+using scratch_vector = std::vector<T, typename std::allocator_traits<Alloc>::template rebind_alloc<T>>;
+
+/**
+ * @internal
+ * @brief Unsigned integer type with the same size as another type.
+ * @headerfile radix_sort.h <coveo/lazy/detail/radix_sort.h>
+ *
+ * @tparam Size Size of type, in bytes.
+ */
+template<std::size_t Size> struct unsigned_of_size;
+template<> struct unsigned_of_size<1> { using type = std::uint8_t; };
+template<> struct unsigned_of_size<2> { using type = std::uint16_t; };
+template<> struct unsigned_of_size<4> { using type = std::uint32_t; };
+template<> struct unsigned_of_size<8> { using type = std::uint64_t; };
+
+/**
+ * @internal
+ * @brief Converts keys to radix-sortable unsigned integers.
+ * @headerfile radix_sort.h <coveo/lazy/detail/radix_sort.h>
+ *
+ * Helper that converts arithmetic keys to unsigned integers whose natural
+ * order is the same as the order of the keys compared with <tt>operator<</tt>.
+ * Has a @c value member set to @c true if conversion is supported for type @c K.
+ *
+ * @tparam K Type of keys to convert.
+ */
+template<class K, class = void>
+struct radix_key_converter {
+    static const bool value = false;
+};
+template<class K>
+struct radix_key_converter<K, std::enable_if_t<std::is_integral<K>::value>> {
+    static const bool value = true;
+    using type = typename unsigned_of_size<sizeof(K)>::type;
+
+    type operator()(K key) const {
+        // Flip sign bit of signed integers so that negative numbers come first.
+        type ukey = static_cast<type>(key);
+        if (std::is_signed<K>::value) {
+            ukey ^= static_cast<type>(type(1) << (sizeof(type) * CHAR_BIT - 1));
+        }
+        return ukey;
+    }
+};
+template<class K>
+struct radix_key_converter<K, std::enable_if_t<std::is_floating_point<K>::value &&
+                                               (sizeof(K) == 4 || sizeof(K) == 8)>> {
+    static const bool value = true;
+    using type = typename unsigned_of_size<sizeof(K)>::type;
+
+    type operator()(K key) const {
+        // Negative numbers have their bits flipped (since their order is reversed),
+        // positive numbers have their sign bit flipped (to come after negative ones).
+        // -0.0 is converted to +0.0 first since they compare equal, so that stable
+        // sorts keep them in their original order.
+        if (key == K(0)) {
+            key = K(0);
+        }
+        type ukey;
+        std::memcpy(&ukey, &key, sizeof(ukey));
+        const type sign_bit = static_cast<type>(type(1) << (sizeof(type) * CHAR_BIT - 1));
+        return (ukey & sign_bit) != 0 ? static_cast<type>(~ukey) : static_cast<type>(ukey | sign_bit);
+    }
+};
+
+/**
+ * @internal
+ * @brief Determines the direction of a radix sort from a key predicate.
+ * @headerfile radix_sort.h <coveo/lazy/detail/radix_sort.h>
+ *
+ * Has a @c value member set to @c true if keys of type @c K compared with
+ * @c KCmp can be radix-sorted. If so, a @c descending member tells whether
+ * keys are sorted in descending order.
+ *
+ * @tparam KCmp Predicate used to compare keys.
+ * @tparam K Type of keys.
+ */
+template<class KCmp, class K> struct radix_key_order { static const bool value = false; };
+template<class K> struct radix_key_order<std::less<K>, K>    { static const bool value = true; static const bool descending = false; };
+template<class K> struct radix_key_order<std::less<>, K>     { static const bool value = true; static const bool descending = false; };
+template<class K> struct radix_key_order<std::greater<K>, K> { static const bool value = true; static const bool descending = true; };
+template<class K> struct radix_key_order<std::greater<>, K>  { static const bool value = true; static const bool descending = true; };
+
+/**
+ * @internal
+ * @brief Trait to detect if elements can be radix-sorted.
+ * @headerfile radix_sort.h <coveo/lazy/detail/radix_sort.h>
+ *
+ * Has a @c value member set to @c true if elements referred to by @c RandIt
+ * and compared by @c Cmp can be sorted using @c radix_sort. This is the case if
+ * @c Cmp is a value predicate (like <tt>lazy_value_pred_proxy</tt>) that gives
+ * access to its "value to key" predicate and its key predicate, if keys are
+ * arithmetic and if the key predicate is <tt>std::less</tt> or <tt>std::greater</tt>.
+ *
+ * @tparam RandIt Type of iterator to elements to sort.
+ * @tparam Cmp Predicate used to compare elements.
+ */
+template<class RandIt, class Cmp, class = void>
+struct is_radix_sortable {
+    static const bool value = false;
+};
+template<class RandIt, class Cmp>
+struct is_radix_sortable<RandIt, Cmp,
+                         typename make_void<decltype(std::declval<const Cmp&>().value_to_key()),
+                                            decltype(std::declval<const Cmp&>().key_predicate())>::type>
+{
+    using element_type = typename std::iterator_traits<RandIt>::value_type;
+    using value_to_key = std::decay_t<decltype(std::declval<const Cmp&>().value_to_key())>;
+    using key_predicate = std::decay_t<decltype(std::declval<const Cmp&>().key_predicate())>;
+    using key_type = std::decay_t<decltype(std::declval<const value_to_key&>()(std::declval<const element_type&>()))>;
+
+    static const bool value = std::is_base_of<std::random_access_iterator_tag,
+                                              typename std::iterator_traits<RandIt>::iterator_category>::value &&
+                              radix_key_converter<key_type>::value &&
+                              radix_key_order<key_predicate, key_type>::value;
+};
+
+/**
+ * @internal
+ * @brief LSD radix sort of a vector.
+ * @headerfile radix_sort.h <coveo/lazy/detail/radix_sort.h>
+ *
+ * Sorts the items in a vector using a least-significant-digit radix sort
+ * with 8-bit digits. Sorting is stable. Passes for digits that are the same
+ * for all items are skipped.
+ *
+ * @param items Items to sort. Must be default-constructible and movable.
+ * @param item_key Function returning the unsigned integer key of an item.
+ */
+template<class Item, class ItemAlloc, class ItemKey>
+void lsd_radix_sort(std::vector<Item, ItemAlloc>& items, const ItemKey& item_key)
+{
+    using ukey_type = std::decay_t<decltype(item_key(items.front()))>;
+    const std::size_t num_digits = sizeof(ukey_type);
+    const std::size_t num_buckets = std::size_t(1) << CHAR_BIT;
+
+    // Compute histograms for all digits in a single pass.
+    scratch_vector<std::array<std::size_t, num_buckets>, ItemAlloc> counts(num_digits, items.get_allocator());
+    for (auto&& count : counts) {
+        count.fill(0);
+    }
+    for (const auto& item : items) {
+        ukey_type ukey = item_key(item);
+        for (std::size_t d = 0; d < num_digits; ++d) {
+            ++counts[d][(ukey >> (d * CHAR_BIT)) & (num_buckets - 1)];
+        }
+    }
+
+    std::vector<Item, ItemAlloc> buffer(items.size(), items.get_allocator());
+    for (std::size_t d = 0; d < num_digits; ++d) {
+        auto& count = counts[d];
+        const std::size_t first_bucket = (item_key(items.front()) >> (d * CHAR_BIT)) & (num_buckets - 1);
+        if (count[first_bucket] == items.size()) {
+            // All items have the same digit, this pass would not change anything.
+            continue;
+        }
+        std::size_t offset = 0;
+        for (auto&& bucket_count : count) {
+            std::size_t bucket_size = bucket_count;
+            bucket_count = offset;
+            offset += bucket_size;
+        }
+        for (auto&& item : items) {
+            const std::size_t bucket = (item_key(item) >> (d * CHAR_BIT)) & (num_buckets - 1);
+            buffer[count[bucket]++] = std::move(item);
+        }
+        items.swap(buffer);
+    }
+}
+
+/**
+ * @internal
+ * @brief Minimum number of elements to use radix sort.
+ * @headerfile radix_sort.h <coveo/lazy/detail/radix_sort.h>
+ *
+ * Below this size, overhead of radix sort makes it slower than
+ * comparison-based sorting.
+ */
+const std::size_t radix_sort_min_size = 256;
+
+/**
+ * @internal
+ * @brief Radix sort of arithmetic elements.
+ * @headerfile radix_sort.h <coveo/lazy/detail/radix_sort.h>
+ *
+ * Implementation of @c radix_sort for elements that are themselves
+ * arithmetic; elements are sorted directly.
+ */
+template<class RandIt, class UKeyOf, class Alloc>
+void radix_sort_elements(RandIt first, RandIt last, const UKeyOf& ukey_of, const Alloc& alloc, std::true_type)
+{
+    using element_type = typename std::iterator_traits<RandIt>::value_type;
+
+    scratch_vector<element_type, Alloc> items(first, last, alloc);
+    lsd_radix_sort(items, ukey_of);
+    std::copy(items.cbegin(), items.cend(), first);
+}
+
+/**
+ * @internal
+ * @brief Radix sort of elements with arithmetic keys.
+ * @headerfile radix_sort.h <coveo/lazy/detail/radix_sort.h>
+ *
+ * Implementation of @c radix_sort for elements that are not arithmetic
+ * (like map pairs). Pairs of keys and indexes are sorted, then elements are
+ * moved to their final position; this way, each element is moved only twice
+ * regardless of the number of radix sort passes.
+ */
+template<class RandIt, class UKeyOf, class Alloc>
+void radix_sort_elements(RandIt first, RandIt last, const UKeyOf& ukey_of, const Alloc& alloc, std::false_type)
+{
+    using element_type = typename std::iterator_traits<RandIt>::value_type;
+    using ukey_type = std::decay_t<decltype(ukey_of(*first))>;
+    using indexed_key = std::pair<ukey_type, std::size_t>;
+
+    scratch_vector<indexed_key, Alloc> items(alloc);
+    items.reserve(static_cast<std::size_t>(std::distance(first, last)));
+    std::size_t i = 0;
+    for (auto it = first; it != last; ++it) {
+        items.emplace_back(ukey_of(*it), i++);
+    }
+    lsd_radix_sort(items, [](const indexed_key& item) { return item.first; });
+
+    scratch_vector<element_type, Alloc> sorted_elems(alloc);
+    sorted_elems.reserve(items.size());
+    for (const auto& item : items) {
+        sorted_elems.push_back(std::move(first[item.second]));
+    }
+    std::move(sorted_elems.begin(), sorted_elems.end(), first);
+}
+
+/**
+ * @internal
+ * @brief Computes radix-sortable keys of elements.
+ * @headerfile radix_sort.h <coveo/lazy/detail/radix_sort.h>
+ *
+ * Function object that returns the unsigned integer key of an element
+ * used to radix-sort it. Can only be used if
+ * <tt>is_radix_sortable<RandIt, Cmp>::value</tt> is @c true.
+ *
+ * @tparam RandIt Type of iterator to elements to sort.
+ * @tparam Cmp Predicate used to compare elements.
+ */
+template<class RandIt, class Cmp>
+class radix_element_key
+{
+    using traits = is_radix_sortable<RandIt, Cmp>;
+    using element_type = typename traits::element_type;
+    using key_type = typename traits::key_type;
+    using converter = radix_key_converter<key_type>;
+
+    static_assert(traits::value, "radix_element_key can only be used on radix-sortable elements");
+
+    typename traits::value_to_key vtok_;
+public:
+    using type = typename converter::type;
+
+    explicit radix_element_key(const Cmp& cmp) : vtok_(cmp.value_to_key()) { }
+
+    type operator()(const element_type& elem) const {
+        const bool descending = radix_key_order<typename traits::key_predicate, key_type>::descending;
+        type ukey = converter()(vtok_(elem));
+        return descending ? static_cast<type>(~ukey) : ukey;
+    }
+};
+
+/**
+ * @internal
+ * @brief Radix sort of elements with arithmetic keys.
+ * @headerfile radix_sort.h <coveo/lazy/detail/radix_sort.h>
+ *
+ * Sorts the elements in <tt>[first, last[</tt> using a stable LSD radix sort.
+ * Can only be used if <tt>is_radix_sortable<RandIt, Cmp>::value</tt> is @c true.
+ *
+ * @param first Beginning of range to sort.
+ * @param last End of range to sort.
+ * @param cmp Value predicate used to extract keys and determine sort order.
+ * @param alloc Allocator used for temporary buffers (rebound as needed).
+ */
+template<class RandIt, class Cmp, class Alloc>
+void radix_sort(RandIt first, RandIt last, const Cmp& cmp, const Alloc& alloc)
+{
+    using element_type = typename is_radix_sortable<RandIt, Cmp>::element_type;
+
+    if (first == last) {
+        return;
+    }
+    radix_sort_elements(first, last, radix_element_key<RandIt, Cmp>(cmp), alloc, std::is_arithmetic<element_type>());
+}
+
+/**
+ * @internal
+ * @brief Radix sort of the positions of elements with arithmetic keys.
+ * @headerfile radix_sort.h <coveo/lazy/detail/radix_sort.h>
+ *
+ * Computes the sorted order of the elements in <tt>[first, last[</tt> using a
+ * stable LSD radix sort, without moving elements. Can only be used if
+ * <tt>is_radix_sortable<RandIt, Cmp>::value</tt> is @c true.
+ *
+ * @param first Beginning of range to sort.
+ * @param last End of range to sort.
+ * @param cmp Value predicate used to extract keys and determine sort order.
+ * @param alloc Allocator used for temporary buffers and the result (rebound as needed).
+ * @return For each position in the sorted range, position of the element
+ *         that belongs there, relative to @c first.
+ */
+template<class RandIt, class Cmp, class Alloc>
+scratch_vector<std::size_t, Alloc> radix_sorted_positions(RandIt first, RandIt last, const Cmp& cmp, const Alloc& alloc)
+{
+    using ukey_of_type = radix_element_key<RandIt, Cmp>;
+    using indexed_key = std::pair<typename ukey_of_type::type, std::size_t>;
+
+    const ukey_of_type ukey_of(cmp);
+    scratch_vector<indexed_key, Alloc> items(alloc);
+    items.reserve(static_cast<std::size_t>(std::distance(first, last)));
+    std::size_t i = 0;
+    for (auto it = first; it != last; ++it) {
+        items.emplace_back(ukey_of(*it), i++);
+    }
+    if (!items.empty()) {
+        lsd_radix_sort(items, [](const indexed_key& item) { return item.first; });
+    }
+
+    scratch_vector<std::size_t, Alloc> positions(alloc);
+    positions.reserve(items.size());
+    for (const auto& item : items) {
+        positions.push_back(item.second);
+    }
+    return positions;
+}
+
+} // detail
+} // lazy
+} // coveo
+
+#endif // COVEO_LAZY_DETAIL_RADIX_SORT_H
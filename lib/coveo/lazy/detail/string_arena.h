@@ -0,0 +1,689 @@
+/**
+ * @file
+ * @brief String storage used by string-specialized lazy-sorted containers.
+ *
+ * This header file contains the string arena used by <tt>coveo::lazy::basic_string_set</tt>
+ * and <tt>coveo::lazy::basic_string_map</tt> to store strings contiguously, along
+ * with its iterators and the multikey quicksort used to sort it. It should not
+ * be necessary to use types defined in this header directly.
+ *
+ * @copyright 2015-2016, Coveo Solutions Inc.
+ *            Distributed under the Apache License, Version 2.0 (see <a href="https://github.com/coveo/lazy/blob/master/LICENSE">LICENSE</a>).
+ */
+
+#ifndef COVEO_LAZY_DETAIL_STRING_ARENA_H
+#define COVEO_LAZY_DETAIL_STRING_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace coveo {
+namespace lazy {
+namespace detail {
+
+/**
+ * @internal
+ * @brief Computes the cached prefix of a string.
+ * @headerfile string_arena.h <coveo/lazy/detail/string_arena.h>
+ *
+ * Returns the first 8 bytes of a string as a big-endian unsigned integer, padded
+ * with zeros. Comparing the prefixes of two strings gives the same result as
+ * comparing their first 8 bytes with @c memcmp, except that a string shorter than
+ * 8 bytes has the same prefix as itself followed by null characters.
+ *
+ * @param str Pointer to characters of string.
+ * @param size Number of characters in string.
+ * @return Prefix of string.
+ */
+inline std::uint64_t string_prefix(const char* str, std::size_t size)
+{
+    std::uint64_t prefix = 0;
+    const std::size_t n = std::min<std::size_t>(size, 8);
+    for (std::size_t i = 0; i < n; ++i) {
+        prefix |= static_cast<std::uint64_t>(static_cast<unsigned char>(str[i])) << (56 - 8 * i);
+    }
+    return prefix;
+}
+
+/**
+ * @internal
+ * @brief Reference to a string stored in a string arena.
+ * @headerfile string_arena.h <coveo/lazy/detail/string_arena.h>
+ *
+ * Non-owning, read-only view of a sequence of characters, returned when
+ * dereferencing iterators of string-specialized containers since they do
+ * not store <tt>std::string</tt> objects. Can also be constructed implicitly from
+ * a <tt>std::string</tt> or a null-terminated string to pass keys to containers
+ * without copying them. Converts implicitly to <tt>std::string</tt>.
+ *
+ * Strings are compared like <tt>std::string</tt> does, e.g. byte-wise.
+ *
+ * @note Only valid until the container it refers to is modified or sorted.
+ */
+class string_arena_ref
+{
+    const char* data_ = nullptr;    // Pointer to characters.
+    std::size_t size_ = 0;          // Number of characters.
+
+public:
+    using value_type        = char;
+    using size_type         = std::size_t;
+    using const_iterator    = const char*;
+    using iterator          = const_iterator;
+
+    string_arena_ref() = default;
+    string_arena_ref(const char* data, std::size_t size)
+        : data_(data), size_(size) { }
+    string_arena_ref(const char* str)
+        : data_(str), size_(std::strlen(str)) { }
+    template<class Traits, class Alloc>
+    string_arena_ref(const std::basic_string<char, Traits, Alloc>& str)
+        : data_(str.data()), size_(str.size()) { }
+
+    const char* data() const {
+        return data_;
+    }
+    size_type size() const {
+        return size_;
+    }
+    size_type length() const {
+        return size_;
+    }
+    bool empty() const {
+        return size_ == 0;
+    }
+    const_iterator begin() const {
+        return data_;
+    }
+    const_iterator end() const {
+        return data_ + size_;
+    }
+    char operator[](size_type pos) const {
+        return data_[pos];
+    }
+
+    std::string str() const {
+        return std::string(data_, size_);
+    }
+    operator std::string() const {
+        return str();
+    }
+
+    int compare(string_arena_ref right) const {
+        const std::size_t n = std::min(size_, right.size_);
+        const int cmp = n != 0 ? std::memcmp(data_, right.data_, n) : 0;
+        if (cmp != 0) {
+            return cmp;
+        }
+        return size_ < right.size_ ? -1 : (size_ > right.size_ ? 1 : 0);
+    }
+
+    friend bool operator==(string_arena_ref left, string_arena_ref right) {
+        return left.size_ == right.size_ && left.compare(right) == 0;
+    }
+    friend bool operator!=(string_arena_ref left, string_arena_ref right) {
+        return !(left == right);
+    }
+    friend bool operator<(string_arena_ref left, string_arena_ref right) {
+        return left.compare(right) < 0;
+    }
+    friend bool operator<=(string_arena_ref left, string_arena_ref right) {
+        return left.compare(right) <= 0;
+    }
+    friend bool operator>(string_arena_ref left, string_arena_ref right) {
+        return left.compare(right) > 0;
+    }
+    friend bool operator>=(string_arena_ref left, string_arena_ref right) {
+        return left.compare(right) >= 0;
+    }
+    friend std::ostream& operator<<(std::ostream& os, string_arena_ref str) {
+        return os.write(str.data_, static_cast<std::streamsize>(str.size_));
+    }
+};
+
+/**
+ * @internal
+ * @brief Entry of a string arena.
+ * @headerfile string_arena.h <coveo/lazy/detail/string_arena.h>
+ *
+ * Describes a string stored in a string arena: its position and size in the
+ * arena's characters, along with its cached prefix (see @c string_prefix).
+ * Entries are what is actually sorted; most comparisons only look at prefixes.
+ * This entry type is used by <tt>coveo::lazy::basic_string_set</tt>.
+ */
+struct string_arena_entry
+{
+    template<bool> using reference = string_arena_ref;
+    using value_type = std::string;
+
+    std::uint64_t prefix;   // First 8 bytes of string, as a big-endian integer.
+    std::size_t offset;     // Position of string in arena.
+    std::size_t size;       // Number of characters in string.
+
+    string_arena_entry(std::uint64_t pfx, std::size_t off, std::size_t sz)
+        : prefix(pfx), offset(off), size(sz) { }
+
+    static string_arena_ref make_reference(const char* chars, const string_arena_entry& entry) {
+        return string_arena_ref(chars + entry.offset, entry.size);
+    }
+};
+
+/**
+ * @internal
+ * @brief Entry of a string arena with a mapped value.
+ * @headerfile string_arena.h <coveo/lazy/detail/string_arena.h>
+ *
+ * Arena entry that also stores the value mapped to its string. Used by
+ * <tt>coveo::lazy::basic_string_map</tt>; keeping mapped values next to
+ * the descriptions of their keys avoids a second array to permute when sorting.
+ *
+ * @tparam T Type of mapped value.
+ */
+template<class T>
+struct string_arena_map_entry : string_arena_entry
+{
+    template<bool Const> using reference = std::pair<string_arena_ref, std::conditional_t<Const, const T&, T&>>;
+    using value_type = std::pair<const std::string, T>;
+
+    T value;    // Value mapped to string.
+
+    template<class... Args>
+    string_arena_map_entry(std::uint64_t pfx, std::size_t off, std::size_t sz, Args&&... args)
+        : string_arena_entry(pfx, off, sz), value(std::forward<Args>(args)...) { }
+
+    static reference<true> make_reference(const char* chars, const string_arena_map_entry& entry) {
+        return reference<true>(string_arena_ref(chars + entry.offset, entry.size), entry.value);
+    }
+    static reference<false> make_reference(const char* chars, string_arena_map_entry& entry) {
+        return reference<false>(string_arena_ref(chars + entry.offset, entry.size), entry.value);
+    }
+};
+
+/**
+ * @internal
+ * @brief Helper to return a proxy from an iterator's <tt>operator-></tt>.
+ * @headerfile string_arena.h <coveo/lazy/detail/string_arena.h>
+ *
+ * Stores the reference returned by dereferencing a <tt>string_arena_iterator</tt>
+ * so that its address can be returned.
+ *
+ * @tparam Ref Type of reference to store.
+ */
+template<class Ref>
+class string_arena_arrow_proxy
+{
+    Ref ref_;
+public:
+    explicit string_arena_arrow_proxy(Ref ref) : ref_(ref) { }
+
+    const Ref* operator->() const {
+        return std::addressof(ref_);
+    }
+};
+
+/**
+ * @internal
+ * @brief Iterator for string-specialized containers.
+ * @headerfile string_arena.h <coveo/lazy/detail/string_arena.h>
+ *
+ * Random-access iterator that refers to an entry of a string arena by its
+ * position. Dereferencing it returns a <tt>string_arena_ref</tt> or, for maps,
+ * a pair of a <tt>string_arena_ref</tt> and a reference to the mapped value.
+ *
+ * @tparam Entry Type of arena entries.
+ * @tparam Const Whether iterator provides const access to mapped values.
+ */
+template<class Entry, bool Const>
+class string_arena_iterator
+{
+    template<class, bool> friend class string_arena_iterator;
+
+    using entry_ptr = std::conditional_t<Const, const Entry*, Entry*>;
+
+    const char* chars_ = nullptr;   // Beginning of arena characters.
+    entry_ptr entries_ = nullptr;   // Beginning of arena entries.
+    std::ptrdiff_t pos_ = 0;        // Position of entry.
+
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type        = typename Entry::value_type;
+    using difference_type   = std::ptrdiff_t;
+    using reference         = typename Entry::template reference<Const>;
+    using pointer           = string_arena_arrow_proxy<reference>;
+
+    string_arena_iterator() = default;
+    string_arena_iterator(const char* chars, entry_ptr entries, std::ptrdiff_t pos)
+        : chars_(chars), entries_(entries), pos_(pos) { }
+
+    // Conversion from non-const iterator.
+    template<bool OConst, class = std::enable_if_t<Const && !OConst, void>>
+    string_arena_iterator(const string_arena_iterator<Entry, OConst>& obj)
+        : chars_(obj.chars_), entries_(obj.entries_), pos_(obj.pos_) { }
+
+    // Position of entry referred to by this iterator.
+    std::size_t position() const {
+        return static_cast<std::size_t>(pos_);
+    }
+
+    reference operator*() const {
+        return Entry::make_reference(chars_, entries_[pos_]);
+    }
+    pointer operator->() const {
+        return pointer(**this);
+    }
+    reference operator[](difference_type n) const {
+        return *(*this + n);
+    }
+
+    string_arena_iterator& operator++() { ++pos_; return *this; }
+    string_arena_iterator operator++(int) { auto it = *this; ++pos_; return it; }
+    string_arena_iterator& operator--() { --pos_; return *this; }
+    string_arena_iterator operator--(int) { auto it = *this; --pos_; return it; }
+    string_arena_iterator& operator+=(difference_type n) { pos_ += n; return *this; }
+    string_arena_iterator& operator-=(difference_type n) { pos_ -= n; return *this; }
+
+    friend string_arena_iterator operator+(string_arena_iterator it, difference_type n) { return it += n; }
+    friend string_arena_iterator operator+(difference_type n, string_arena_iterator it) { return it += n; }
+    friend string_arena_iterator operator-(string_arena_iterator it, difference_type n) { return it -= n; }
+    friend difference_type operator-(const string_arena_iterator& left, const string_arena_iterator& right) {
+        return left.pos_ - right.pos_;
+    }
+
+    friend bool operator==(const string_arena_iterator& left, const string_arena_iterator& right) {
+        return left.pos_ == right.pos_;
+    }
+    friend bool operator!=(const string_arena_iterator& left, const string_arena_iterator& right) {
+        return left.pos_ != right.pos_;
+    }
+    friend bool operator<(const string_arena_iterator& left, const string_arena_iterator& right) {
+        return left.pos_ < right.pos_;
+    }
+    friend bool operator<=(const string_arena_iterator& left, const string_arena_iterator& right) {
+        return left.pos_ <= right.pos_;
+    }
+    friend bool operator>(const string_arena_iterator& left, const string_arena_iterator& right) {
+        return left.pos_ > right.pos_;
+    }
+    friend bool operator>=(const string_arena_iterator& left, const string_arena_iterator& right) {
+        return left.pos_ >= right.pos_;
+    }
+};
+
+/**
+ * @internal
+ * @brief Contiguous storage for strings.
+ * @headerfile string_arena.h <coveo/lazy/detail/string_arena.h>
+ *
+ * Stores the characters of all strings in a single array, and describes each
+ * string with a small entry (see @c string_arena_entry). Entries can be sorted
+ * lazily: new ones are appended at the end, then sorted with a multikey quicksort
+ * and merged with the already-sorted ones when <tt>sort()</tt> is called. Sorting
+ * also removes duplicates, keeping the first string inserted.
+ *
+ * Removing entries leaves their characters in the arena; those are reclaimed when
+ * they account for more than half of the arena, by copying the characters of the
+ * remaining strings in sorted order.
+ *
+ * @tparam Entry Type of arena entries; @c string_arena_entry or a derived type.
+ * @tparam Alloc Allocator used for the array of characters. Rebound for entries.
+ */
+template<class Entry, class Alloc>
+class string_arena
+{
+public:
+    using char_container    = std::vector<char, Alloc>;
+    using entry_container   = std::vector<Entry, typename std::allocator_traits<Alloc>::template rebind_alloc<Entry>>;
+    using size_type         = std::size_t;
+    using difference_type   = std::ptrdiff_t;
+
+private:
+    // Below this size, ranges are sorted using insertion sort.
+    static const std::size_t insertion_sort_max_size = 16;
+
+    char_container chars_;          // Characters of all strings, including removed ones.
+    entry_container entries_;       // Entries, sorted until sorted_until_.
+    size_type sorted_until_ = 0;    // Number of sorted entries, without duplicates.
+    size_type garbage_ = 0;         // Number of characters in chars_ belonging to removed strings.
+
+public:
+    explicit string_arena(const Alloc& alloc = Alloc())
+        : chars_(alloc), entries_(alloc) { }
+
+    const entry_container& entries() const {
+        return entries_;
+    }
+    entry_container& entries() {
+        return entries_;
+    }
+    const char* chars() const {
+        return chars_.data();
+    }
+    size_type char_count() const {
+        return chars_.size() - garbage_;
+    }
+    Alloc get_allocator() const {
+        return chars_.get_allocator();
+    }
+
+    bool sorted() const {
+        return sorted_until_ == entries_.size();
+    }
+
+    string_arena_ref ref(const Entry& entry) const {
+        return string_arena_ref(chars_.data() + entry.offset, entry.size);
+    }
+
+    void reserve(size_type entries, size_type chars) {
+        entries_.reserve(entries);
+        chars_.reserve(chars);
+    }
+    void shrink_to_fit() {
+        compact();
+        entries_.shrink_to_fit();
+        chars_.shrink_to_fit();
+    }
+    void clear() {
+        entries_.clear();
+        chars_.clear();
+        sorted_until_ = 0;
+        garbage_ = 0;
+    }
+    void swap(string_arena& right) {
+        using std::swap;
+        swap(chars_, right.chars_);
+        swap(entries_, right.entries_);
+        swap(sorted_until_, right.sorted_until_);
+        swap(garbage_, right.garbage_);
+    }
+
+    // Appends a string to the arena. If it sorts after the last entry and the arena
+    // was sorted, it still is; otherwise, it will be sorted by sort().
+    template<class... Args>
+    void append(string_arena_ref str, Args&&... args) {
+        emplace_entry(entries_.size(), str, std::forward<Args>(args)...);
+        const size_type size = entries_.size();
+        if (sorted_until_ == size - 1 && (size == 1 || less(entries_[size - 2], entries_[size - 1]))) {
+            sorted_until_ = size;
+        }
+    }
+
+    // Inserts a string at a given position in a sorted arena. The string must not exist already.
+    template<class... Args>
+    void insert_sorted(size_type pos, string_arena_ref str, Args&&... args) {
+        emplace_entry(pos, str, std::forward<Args>(args)...);
+        ++sorted_until_;
+    }
+
+    // Removes entries in [first, last[ from a sorted arena.
+    void erase(size_type first, size_type last) {
+        const auto efirst = std::next(entries_.begin(), static_cast<difference_type>(first));
+        const auto elast = std::next(entries_.begin(), static_cast<difference_type>(last));
+        for (auto it = efirst; it != elast; ++it) {
+            garbage_ += it->size;
+        }
+        entries_.erase(efirst, elast);
+        sorted_until_ -= last - first;
+        if (garbage_ > chars_.size() / 2) {
+            compact();
+        }
+    }
+
+    // Sorts entries that are not already sorted and merges them with the others, removing duplicates.
+    void sort() {
+        if (sorted()) {
+            return;
+        }
+        const auto first = entries_.begin();
+        const auto middle = std::next(first, static_cast<difference_type>(sorted_until_));
+        const auto last = entries_.end();
+        multikey_quicksort(entries_.data() + sorted_until_, entries_.data() + entries_.size());
+        if (sorted_until_ != 0 && !less(*std::prev(middle), *middle)) {
+            // Merging is stable: already-sorted entries come first among duplicates and are kept.
+            std::inplace_merge(first, middle, last, [this](const Entry& left, const Entry& right) {
+                return less(left, right);
+            });
+        }
+        remove_duplicates();
+        sorted_until_ = entries_.size();
+        if (garbage_ > chars_.size() / 2) {
+            compact();
+        }
+    }
+
+    // Positions of bounds of a string in a sorted arena.
+    size_type lower_bound_pos(string_arena_ref str) const {
+        const std::uint64_t prefix = string_prefix(str.data(), str.size());
+        size_type first = 0, count = entries_.size();
+        while (count > 0) {
+            const size_type step = count / 2;
+            if (compare(entries_[first + step], prefix, str) < 0) {
+                first += step + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
+        }
+        return first;
+    }
+    size_type upper_bound_pos(string_arena_ref str) const {
+        const size_type pos = lower_bound_pos(str);
+        return pos != entries_.size() && ref(entries_[pos]) == str ? pos + 1 : pos;
+    }
+
+    // Position of a string in a sorted arena, or number of entries if not found.
+    size_type find_pos(string_arena_ref str) const {
+        const size_type pos = lower_bound_pos(str);
+        return pos != entries_.size() && ref(entries_[pos]) == str ? pos : entries_.size();
+    }
+
+private:
+    // Adds a string's characters to the arena and creates its entry at the given position.
+    template<class... Args>
+    void emplace_entry(size_type pos, string_arena_ref str, Args&&... args) {
+        // String might come from this arena, in which case adding characters can reallocate.
+        const char* data = str.data();
+        const bool own = !chars_.empty() && data >= chars_.data() && data < chars_.data() + chars_.size();
+        const size_type offset = chars_.size();
+        if (own) {
+            const size_type src = static_cast<size_type>(data - chars_.data());
+            chars_.resize(offset + str.size());
+            std::memmove(chars_.data() + offset, chars_.data() + src, str.size());
+        } else {
+            chars_.insert(chars_.end(), str.begin(), str.end());
+        }
+        try {
+            entries_.emplace(std::next(entries_.cbegin(), static_cast<difference_type>(pos)),
+                             string_prefix(chars_.data() + offset, str.size()), offset, str.size(),
+                             std::forward<Args>(args)...);
+        } catch (...) {
+            chars_.resize(offset);
+            throw;
+        }
+    }
+
+    // Compares an entry with a string whose prefix is known, like memcmp.
+    int compare(const Entry& entry, std::uint64_t prefix, string_arena_ref str) const {
+        if (entry.prefix != prefix) {
+            return entry.prefix < prefix ? -1 : 1;
+        }
+        return compare_suffixes(entry, str.data(), str.size());
+    }
+
+    // Compares two strings with the same prefix, skipping the bytes it covers.
+    int compare_suffixes(const Entry& entry, const char* data, size_type size) const {
+        const size_type n = std::min(entry.size, size);
+        if (n > 8) {
+            const int cmp = std::memcmp(chars_.data() + entry.offset + 8, data + 8, n - 8);
+            if (cmp != 0) {
+                return cmp;
+            }
+        }
+        return entry.size < size ? -1 : (entry.size > size ? 1 : 0);
+    }
+
+    // Checks if an entry's string is less than another's.
+    bool less(const Entry& left, const Entry& right) const {
+        if (left.prefix != right.prefix) {
+            return left.prefix < right.prefix;
+        }
+        return compare_suffixes(left, chars_.data() + right.offset, right.size) < 0;
+    }
+
+    // Digit of an entry's string at a given depth, used by multikey quicksort: the 8 characters
+    // starting at depth * 8 (see string_prefix) and the number of characters left from there,
+    // capped at 9. Digits compare like strings since the number of characters breaks ties
+    // caused by padding. Reads characters from the arena, except for the first digit.
+    using digit = std::pair<std::uint64_t, size_type>;
+    digit digit_at(const Entry& entry, size_type depth) const {
+        const size_type pos = depth * 8;
+        if (pos >= entry.size) {
+            return digit(0, 0);
+        }
+        const size_type left = entry.size - pos;
+        const std::uint64_t chunk = depth == 0 ? entry.prefix : string_prefix(chars_.data() + entry.offset + pos, left);
+        return digit(chunk, std::min<size_type>(left, 9));
+    }
+
+    // Digit of an entry's string at a given depth, when its prefix member holds that digit (see multikey_quicksort).
+    static digit cached_digit(const Entry& entry, size_type depth) {
+        const size_type pos = depth * 8;
+        return digit(entry.prefix, pos < entry.size ? std::min<size_type>(entry.size - pos, 9) : 0);
+    }
+
+    // Checks if an entry sorts before another whose string shares its first depth * 8 characters,
+    // using insertion order (e.g. offset) for duplicates. Prefix members must hold digits at depth.
+    bool cached_less_or_older(const Entry& left, const Entry& right, size_type depth) const {
+        const digit ldigit = cached_digit(left, depth);
+        const digit rdigit = cached_digit(right, depth);
+        if (ldigit != rdigit) {
+            return ldigit < rdigit;
+        }
+        if (ldigit.second == 9) {
+            const size_type pos = (depth + 1) * 8;
+            const size_type n = std::min(left.size, right.size);
+            if (n > pos) {
+                const int cmp = std::memcmp(chars_.data() + left.offset + pos, chars_.data() + right.offset + pos, n - pos);
+                if (cmp != 0) {
+                    return cmp < 0;
+                }
+            }
+            if (left.size != right.size) {
+                return left.size < right.size;
+            }
+        }
+        return left.offset < right.offset;
+    }
+
+    // Sorts entries in [first, last[ using Bentley and Sedgewick's multikey quicksort on 8-character
+    // digits, so that strings with long common prefixes need few passes. Duplicates keep their insertion order.
+    void multikey_quicksort(Entry* first, Entry* last) {
+        if (multikey_quicksort(first, last, 0)) {
+            // Deeper digits were cached in prefix members; restore them.
+            for (Entry* it = first; it != last; ++it) {
+                it->prefix = string_prefix(chars_.data() + it->offset, it->size);
+            }
+        }
+    }
+
+    // Sorts entries in [first, last[, whose strings share their first depth * 8 characters and whose
+    // prefix members hold their digit at depth. To avoid reading characters from the arena each time
+    // a range is partitioned, digits are loaded in prefix members once when moving to the next depth.
+    // Returns true if this happened, in which case prefix members must be restored.
+    bool multikey_quicksort(Entry* first, Entry* last, size_type depth) {
+        using std::swap;
+        bool cached = false;
+        while (static_cast<size_type>(last - first) > insertion_sort_max_size) {
+            // Median of three digits as pivot.
+            digit a = cached_digit(*first, depth);
+            digit b = cached_digit(first[(last - first) / 2], depth);
+            digit c = cached_digit(*(last - 1), depth);
+            if (a > b) swap(a, b);
+            if (b > c) swap(b, c);
+            if (a > b) swap(a, b);
+            const digit pivot = b;
+
+            // Three-way partition: [first, lt[ < pivot, [lt, gt[ == pivot, [gt, last[ > pivot.
+            Entry* lt = first;
+            Entry* gt = last;
+            for (Entry* it = first; it < gt; ) {
+                const digit d = cached_digit(*it, depth);
+                if (d < pivot) {
+                    swap(*lt++, *it++);
+                } else if (pivot < d) {
+                    swap(*it, *--gt);
+                } else {
+                    ++it;
+                }
+            }
+            cached = multikey_quicksort(first, lt, depth) || cached;
+            cached = multikey_quicksort(gt, last, depth) || cached;
+            if (pivot.second < 9) {
+                // All strings in the middle part end with this digit, so they are equal.
+                std::sort(lt, gt, [](const Entry& left, const Entry& right) { return left.offset < right.offset; });
+                return cached;
+            }
+            first = lt;
+            last = gt;
+            ++depth;
+            for (Entry* it = first; it != last; ++it) {
+                it->prefix = digit_at(*it, depth).first;
+            }
+            cached = true;
+        }
+        for (Entry* it = first; it != last; ++it) {
+            for (Entry* cur = it; cur != first && cached_less_or_older(*cur, *(cur - 1), depth); --cur) {
+                swap(*cur, *(cur - 1));
+            }
+        }
+        return cached;
+    }
+
+    // Removes consecutive duplicates from sorted entries, keeping the first of each.
+    void remove_duplicates() {
+        if (entries_.empty()) {
+            return;
+        }
+        auto out = entries_.begin();
+        for (auto it = std::next(out); it != entries_.end(); ++it) {
+            if (less(*out, *it)) {
+                if (++out != it) {
+                    *out = std::move(*it);
+                }
+            } else {
+                garbage_ += it->size;
+            }
+        }
+        entries_.erase(std::next(out), entries_.end());
+    }
+
+    // Copies characters of remaining strings to a new arena, in order, to reclaim removed ones.
+    void compact() {
+        if (garbage_ == 0) {
+            return;
+        }
+        char_container chars(chars_.get_allocator());
+        chars.reserve(chars_.size() - garbage_);
+        for (auto&& entry : entries_) {
+            const size_type offset = chars.size();
+            chars.insert(chars.end(), chars_.data() + entry.offset, chars_.data() + entry.offset + entry.size);
+            entry.offset = offset;
+        }
+        chars_.swap(chars);
+        garbage_ = 0;
+    }
+};
+
+} // detail
+} // lazy
+} // coveo
+
+#endif // COVEO_LAZY_DETAIL_STRING_ARENA_H
@@ -0,0 +1,171 @@
+/**
+ * @file
+ * @brief Duplicate policies used by lazy-sorted associative containers.
+ *
+ * This file contains the duplicate policies that can be used to customize
+ * which element is kept when the same key is inserted more than once in a
+ * container that does not accept duplicates, like <tt>coveo::lazy::set</tt>
+ * or <tt>coveo::lazy::map</tt>. A duplicate policy is specified through the
+ * @c _Dup template parameter of those containers:
+ *
+ * @code
+ *   // Sum values inserted for the same key, like a combiner in MapReduce
+ *   coveo::lazy::map<std::string, int, std::less<std::string>, std::vector,
+ *                    coveo::lazy::detail::equal_to_using_less_if_needed<std::string, std::less<std::string>>,
+ *                    coveo::lazy::map_allocator<std::string, int>,
+ *                    coveo::lazy::default_sort_policy,
+ *                    coveo::lazy::no_sort_stats,
+ *                    coveo::lazy::binary_search_policy,
+ *                    coveo::lazy::combine_duplicate_policy<std::plus<>>> m;
+ *   m.insert(std::make_pair("foo", 1));
+ *   m.insert(std::make_pair("foo", 2));
+ *   assert(m.at("foo") == 3);
+ * @endcode
+ *
+ * Duplicates are resolved while sorting, in the same pass that removes them.
+ * A duplicate policy must be a default-constructible type with the following members:
+ *
+ * - <tt>static const bool ordered</tt>: whether <tt>resolve()</tt> depends on the
+ *   order in which duplicates were inserted. If @c true, containers sort new
+ *   elements with the @c stable_sort method of their sort policy instead of @c sort.
+ * - <tt>void resolve(E& kept, E&& dup) const</tt>: called for each duplicate, in
+ *   insertion order if @c ordered is @c true. @c kept is part of the element
+ *   that remains in the container and @c dup is part of an element inserted
+ *   after it, which will be destroyed. For maps, @c E is the type of mapped
+ *   values; for sets, it is the type of elements. Must not change the key of
+ *   @c kept.
+ *
+ * Policies only apply to elements inserted without a lookup, e.g. using
+ * <tt>insert()</tt> or <tt>emplace()</tt>, and to <tt>splice()</tt>. Methods like
+ * <tt>operator[]()</tt>, <tt>try_emplace()</tt> and <tt>merge()</tt> look for
+ * existing elements first and keep their usual semantics.
+ *
+ * @copyright 2015-2016, Coveo Solutions Inc.
+ *            Distributed under the Apache License, Version 2.0 (see <a href="https://github.com/coveo/lazy/blob/master/LICENSE">LICENSE</a>).
+ */
+
+#ifndef COVEO_LAZY_DUPLICATE_POLICY_H
+#define COVEO_LAZY_DUPLICATE_POLICY_H
+
+#include <functional>
+#include <iterator>
+#include <utility>
+
+namespace coveo {
+namespace lazy {
+namespace detail {
+
+/**
+ * @internal
+ * @brief Version of <tt>std::unique</tt> that resolves duplicates.
+ * @headerfile duplicate_policy.h <coveo/lazy/duplicate_policy.h>
+ *
+ * Like <tt>std::unique</tt>, removes consecutive duplicates in <tt>[first, last[</tt>,
+ * but calls <tt>resolve(kept, dup)</tt> for each duplicate before removing it,
+ * where @c kept is the first element of its run of duplicates.
+ *
+ * @param first Beginning of range to process.
+ * @param last End of range to process.
+ * @param eq Predicate used to identify duplicates.
+ * @param resolve Function called with each duplicate and the element that is kept.
+ * @return New end of range.
+ */
+template<class FwdIt, class Eq, class Resolve>
+FwdIt unique_resolve(FwdIt first, FwdIt last, const Eq& eq, const Resolve& resolve)
+{
+    if (first == last) {
+        return last;
+    }
+    auto out = first;
+    for (auto it = std::next(first); it != last; ++it) {
+        if (eq(*out, *it)) {
+            resolve(*out, std::move(*it));
+        } else if (++out != it) {
+            *out = std::move(*it);
+        }
+    }
+    return ++out;
+}
+
+} // detail
+
+/**
+ * @brief Default duplicate policy.
+ * @headerfile duplicate_policy.h <coveo/lazy/duplicate_policy.h>
+ *
+ * Duplicate policy that keeps any one of the duplicates, like
+ * <tt>std::set::insert()</tt> keeps the existing element. Elements already sorted
+ * are kept over new ones, but when the same key is inserted more than once
+ * between two sorts, which one of the new elements is kept is unspecified.
+ * This lets containers use their sort policy's fastest (unstable) sort.
+ * This is the default duplicate policy of lazy-sorted containers.
+ */
+struct default_duplicate_policy
+{
+    static const bool ordered = false;
+
+    template<class E>
+    void resolve(E&, E&&) const { }
+};
+
+/**
+ * @brief First-wins duplicate policy.
+ * @headerfile duplicate_policy.h <coveo/lazy/duplicate_policy.h>
+ *
+ * Duplicate policy that always keeps the first element inserted for each key.
+ */
+struct first_wins_duplicate_policy
+{
+    static const bool ordered = true;
+
+    template<class E>
+    void resolve(E&, E&&) const { }
+};
+
+/**
+ * @brief Last-wins duplicate policy.
+ * @headerfile duplicate_policy.h <coveo/lazy/duplicate_policy.h>
+ *
+ * Duplicate policy that always keeps the last element inserted for each key.
+ * For maps, this means the last value replaces the existing one, like
+ * <tt>insert_or_assign()</tt>: the key of the first element is kept.
+ */
+struct last_wins_duplicate_policy
+{
+    static const bool ordered = true;
+
+    template<class E>
+    void resolve(E& kept, E&& dup) const {
+        kept = std::move(dup);
+    }
+};
+
+/**
+ * @brief Combining duplicate policy.
+ * @headerfile duplicate_policy.h <coveo/lazy/duplicate_policy.h>
+ *
+ * Duplicate policy that combines the elements inserted for each key using
+ * a binary function, in insertion order, like <tt>std::accumulate</tt>. For
+ * maps, mapped values are combined; for example, <tt>std::plus<></tt> sums
+ * the values inserted for each key. This makes it possible to use a map as
+ * an aggregation buffer, without looking up each key when inserting.
+ *
+ * @tparam Combine Default-constructible function that receives the result so far
+ *                 and a new element (both as rvalues) and returns their combination.
+ *                 Defaults to <tt>std::plus<></tt>.
+ */
+template<class Combine = std::plus<>>
+struct combine_duplicate_policy
+{
+    static const bool ordered = true;
+
+    template<class E>
+    void resolve(E& kept, E&& dup) const {
+        kept = Combine()(std::move(kept), std::move(dup));
+    }
+};
+
+} // lazy
+} // coveo
+
+#endif // COVEO_LAZY_DUPLICATE_POLICY_H
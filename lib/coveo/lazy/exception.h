@@ -29,6 +29,21 @@ public:
     using std::out_of_range::out_of_range;
 };
 
+/**
+ * @brief Invalid format exception.
+ * @headerfile exception.h <coveo/lazy/exception.h>
+ *
+ * Subclass of <tt>std::runtime_error</tt> used by lazy sorted containers.
+ * Thrown when opening a <tt>coveo::lazy::detail::sorted_view</tt> over data
+ * that was not written by <tt>serialize()</tt> for the same type of container.
+ */
+class format_error : public std::runtime_error
+{
+public:
+    format_error() = delete;
+    using std::runtime_error::runtime_error;
+};
+
 } // lazy
 } // coveo
 
@@ -89,13 +89,33 @@ using map_allocator = detail::map_allocator<K, T, _Alloc>;
  *             otherwise to an implementation that uses @c _Cmp (see above).
  * @tparam _Alloc Allocator used for the map elements.
  *                Defaults to @c map_allocator.
+ * @tparam _Sort Policy used to sort the elements when needed.
+ *               Defaults to <tt>coveo::lazy::default_sort_policy</tt>.
+ *               See <tt>coveo/lazy/sort_policy.h</tt> for details.
+ * @tparam _Stats Policy used to collect statistics about sorting.
+ *                Defaults to <tt>coveo::lazy::no_sort_stats</tt>.
+ *                See <tt>coveo/lazy/sort_stats.h</tt> for details.
+ * @tparam _Search Policy used to look for elements once sorted.
+ *                 Defaults to <tt>coveo::lazy::binary_search_policy</tt>.
+ *                 See <tt>coveo/lazy/search_policy.h</tt> for details.
+ * @tparam _Dup Policy used to resolve duplicates inserted in the map.
+ *              Defaults to <tt>coveo::lazy::default_duplicate_policy</tt>.
+ *              See <tt>coveo/lazy/duplicate_policy.h</tt> for details.
+ * @tparam _Append Policy used to track the order of elements inserted at the end of the map.
+ *                 Defaults to <tt>coveo::lazy::default_append_policy</tt>.
+ *                 See <tt>coveo/lazy/append_policy.h</tt> for details.
  */
 template<class K,
          class T,
          class _Cmp = std::less<K>,
          template<class _ImplT, class _ImplAlloc> class _Impl = std::vector,
          class _Eq = detail::equal_to_using_less_if_needed<K, _Cmp>,
-         class _Alloc = map_allocator<K, T>>
+         class _Alloc = map_allocator<K, T>,
+         class _Sort = default_sort_policy,
+         class _Stats = no_sort_stats,
+         class _Search = binary_search_policy,
+         class _Dup = default_duplicate_policy,
+         class _Append = default_append_policy>
  using map = detail::lazy_sorted_container<K,
                                            T,
                                            detail::map_pair<K, T>,
@@ -105,7 +125,12 @@ template<class K,
                                            _Eq,
                                            _Alloc,
                                            _Impl,
-                                           false>;
+                                           false,
+                                           _Sort,
+                                           _Stats,
+                                           _Search,
+                                           _Dup,
+                                           _Append>;
 
 /**
  * @class coveo::lazy::multimap
@@ -149,13 +174,29 @@ template<class K,
  *             otherwise to an implementation that uses @c _Cmp (see above).
  * @tparam _Alloc Allocator used for the map elements.
  *                Defaults to @c map_allocator.
+ * @tparam _Sort Policy used to sort the elements when needed.
+ *               Defaults to <tt>coveo::lazy::default_sort_policy</tt>.
+ *               See <tt>coveo/lazy/sort_policy.h</tt> for details.
+ * @tparam _Stats Policy used to collect statistics about sorting.
+ *                Defaults to <tt>coveo::lazy::no_sort_stats</tt>.
+ *                See <tt>coveo/lazy/sort_stats.h</tt> for details.
+ * @tparam _Search Policy used to look for elements once sorted.
+ *                 Defaults to <tt>coveo::lazy::binary_search_policy</tt>.
+ *                 See <tt>coveo/lazy/search_policy.h</tt> for details.
+ * @tparam _Append Policy used to track the order of elements inserted at the end of the multimap.
+ *                 Defaults to <tt>coveo::lazy::default_append_policy</tt>.
+ *                 See <tt>coveo/lazy/append_policy.h</tt> for details.
  */
 template<class K,
          class T,
          class _Cmp = std::less<K>,
          template<class _ImplT, class _ImplAlloc> class _Impl = std::vector,
          class _Eq = detail::equal_to_using_less_if_needed<K, _Cmp>,
-         class _Alloc = map_allocator<K, T>>
+         class _Alloc = map_allocator<K, T>,
+         class _Sort = default_sort_policy,
+         class _Stats = no_sort_stats,
+         class _Search = binary_search_policy,
+         class _Append = default_append_policy>
  using multimap = detail::lazy_sorted_container<K,
                                                 T,
                                                 detail::map_pair<K, T>,
@@ -165,7 +206,128 @@ template<class K,
                                                 _Eq,
                                                 _Alloc,
                                                 _Impl,
-                                                true>;
+                                                true,
+                                                _Sort,
+                                                _Stats,
+                                                _Search,
+                                                default_duplicate_policy,
+                                                _Append>;
+
+/**
+ * @brief Read-only view of a map's sorted elements.
+ * @headerfile map.h <coveo/lazy/map.h>
+ *
+ * Read-only container that looks for elements of a <tt>coveo::lazy::map</tt>
+ * without copying or sorting them, for example over a file written by
+ * <tt>coveo::lazy::map::serialize()</tt> and mapped in memory.
+ * Same as <tt>coveo::lazy::map::view_type</tt>.
+ * See <tt>coveo::lazy::detail::sorted_view</tt> for details.
+ *
+ * @tparam K Type of keys.
+ * @tparam T Type of values.
+ * @tparam _Cmp Predicate used to sort the keys.
+ *              Defaults to <tt>std::less<K></tt>.
+ */
+template<class K,
+         class T,
+         class _Cmp = std::less<K>>
+using map_view = detail::sorted_view<K,
+                                     T,
+                                     detail::map_pair<K, T>,
+                                     typename detail::map_pair<K, T>::base_std_pair,
+                                     detail::lazy_value_pred_proxy<typename detail::map_pair<K, T>::base_std_pair,
+                                                                   detail::pair_first<detail::map_pair<K, T>>,
+                                                                   _Cmp>,
+                                     false>;
+
+/**
+ * @brief Read-only view of a multimap's sorted elements.
+ * @headerfile map.h <coveo/lazy/map.h>
+ *
+ * Like <tt>coveo::lazy::map_view</tt>, but for elements of a
+ * <tt>coveo::lazy::multimap</tt>. Can also be opened over the
+ * elements of a <tt>coveo::lazy::map</tt>.
+ *
+ * @tparam K Type of keys.
+ * @tparam T Type of values.
+ * @tparam _Cmp Predicate used to sort the keys.
+ *              Defaults to <tt>std::less<K></tt>.
+ */
+template<class K,
+         class T,
+         class _Cmp = std::less<K>>
+using multimap_view = detail::sorted_view<K,
+                                          T,
+                                          detail::map_pair<K, T>,
+                                          typename detail::map_pair<K, T>::base_std_pair,
+                                          detail::lazy_value_pred_proxy<typename detail::map_pair<K, T>::base_std_pair,
+                                                                        detail::pair_first<detail::map_pair<K, T>>,
+                                                                        _Cmp>,
+                                          true>;
+
+#ifdef COVEO_LAZY_HAS_MEMORY_RESOURCE
+
+namespace pmr {
+
+/**
+ * @brief Lazy map using a polymorphic allocator.
+ * @headerfile map.h <coveo/lazy/map.h>
+ *
+ * Like <tt>std::pmr::map</tt>, a <tt>coveo::lazy::map</tt> that uses
+ * <tt>std::pmr::polymorphic_allocator</tt> to allocate its elements.
+ * Combined with a <tt>std::pmr::monotonic_buffer_resource</tt>, this can be
+ * used to build short-lived containers without freeing memory:
+ *
+ * @code
+ *   std::pmr::monotonic_buffer_resource arena;
+ *   coveo::lazy::pmr::map<int, double> m(&arena);
+ * @endcode
+ *
+ * Only available when compiling for C++17 or later.
+ *
+ * @tparam K Type of keys stored in the map.
+ * @tparam T Type of values stored in the map.
+ * @tparam _Cmp Predicate used to sort the keys.
+ *              Defaults to <tt>std::less<K></tt>.
+ * @tparam _Impl Type of sequence container used by the map.
+ *               Defaults to <tt>std::vector</tt>.
+ * @tparam _Eq Predicate used to determine if keys are equal.
+ *             See <tt>coveo::lazy::map</tt> for details.
+ */
+template<class K,
+         class T,
+         class _Cmp = std::less<K>,
+         template<class _ImplT, class _ImplAlloc> class _Impl = std::vector,
+         class _Eq = detail::equal_to_using_less_if_needed<K, _Cmp>>
+using map = coveo::lazy::map<K, T, _Cmp, _Impl, _Eq, map_allocator<K, T, std::pmr::polymorphic_allocator>>;
+
+/**
+ * @brief Lazy multimap using a polymorphic allocator.
+ * @headerfile map.h <coveo/lazy/map.h>
+ *
+ * Like <tt>std::pmr::multimap</tt>, a <tt>coveo::lazy::multimap</tt> that uses
+ * <tt>std::pmr::polymorphic_allocator</tt> to allocate its elements.
+ * See <tt>coveo::lazy::pmr::map</tt> for details.
+ *
+ * @tparam K Type of keys stored in the map.
+ * @tparam T Type of values stored in the map.
+ * @tparam _Cmp Predicate used to sort the keys.
+ *              Defaults to <tt>std::less<K></tt>.
+ * @tparam _Impl Type of sequence container used by the map.
+ *               Defaults to <tt>std::vector</tt>.
+ * @tparam _Eq Predicate used to determine if keys are equal.
+ *             See <tt>coveo::lazy::multimap</tt> for details.
+ */
+template<class K,
+         class T,
+         class _Cmp = std::less<K>,
+         template<class _ImplT, class _ImplAlloc> class _Impl = std::vector,
+         class _Eq = detail::equal_to_using_less_if_needed<K, _Cmp>>
+using multimap = coveo::lazy::multimap<K, T, _Cmp, _Impl, _Eq, map_allocator<K, T, std::pmr::polymorphic_allocator>>;
+
+} // pmr
+
+#endif // COVEO_LAZY_HAS_MEMORY_RESOURCE
 
 } // lazy
 } // coveo
@@ -0,0 +1,55 @@
+/**
+ * @file
+ * @brief Memory footprint information reported by lazy-sorted associative containers.
+ *
+ * This file contains the structure returned by the <tt>memory_stats()</tt> method
+ * of lazy-sorted containers like <tt>coveo::lazy::set</tt> or <tt>coveo::lazy::map</tt>.
+ * Since most methods of these containers sort their elements first (including
+ * <tt>size()</tt> for containers that do not accept duplicates), these stats can be
+ * used to decide when to sort, shrink or evict without paying that cost:
+ *
+ * @code
+ *   const auto stats = s.memory_stats();
+ *   if (stats.bytes_allocated > 2 * stats.bytes_used) {
+ *       s.shrink_to_fit();
+ *   }
+ * @endcode
+ *
+ * @copyright 2015-2016, Coveo Solutions Inc.
+ *            Distributed under the Apache License, Version 2.0 (see <a href="https://github.com/coveo/lazy/blob/master/LICENSE">LICENSE</a>).
+ */
+
+#ifndef COVEO_LAZY_MEMORY_STATS_H
+#define COVEO_LAZY_MEMORY_STATS_H
+
+#include <cstddef>
+
+namespace coveo {
+namespace lazy {
+
+/**
+ * @brief Information about the memory used by a container.
+ * @headerfile memory_stats.h <coveo/lazy/memory_stats.h>
+ *
+ * Structure returned by <tt>memory_stats()</tt>. Describes the container's
+ * internal storage as it is, without sorting it. Byte counts are shallow:
+ * they do not include memory owned by the elements themselves (e.g. the
+ * characters of a <tt>std::string</tt>) nor by the search policy's index.
+ */
+struct container_memory_stats
+{
+    std::size_t stored_elements = 0;        ///< Number of elements stored, including unsorted ones not yet known to be duplicates.
+    std::size_t sorted_elements = 0;        ///< Number of stored elements that are already sorted.
+    std::size_t pending_elements = 0;       ///< Number of stored elements that still need to be sorted.
+    std::size_t possible_duplicates = 0;    ///< Maximum number of pending elements that could be removed as duplicates when sorting (always 0 for multi containers).
+    std::size_t pending_erasures = 0;       ///< Number of keys erased by <tt>lazy_erase()</tt> whose elements have not been removed yet.
+    std::size_t capacity = 0;               ///< Number of elements that can be stored without reallocating (same as @c stored_elements if unknown).
+    std::size_t element_size = 0;           ///< Size of one element, in bytes.
+    std::size_t bytes_used = 0;             ///< Bytes used by stored elements and pending erasures.
+    std::size_t bytes_allocated = 0;        ///< Bytes allocated for elements and pending erasures, including unused capacity.
+};
+
+} // lazy
+} // coveo
+
+#endif // COVEO_LAZY_MEMORY_STATS_H
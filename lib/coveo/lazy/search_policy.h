@@ -0,0 +1,327 @@
+/**
+ * @file
+ * @brief Search policies used by lazy-sorted associative containers.
+ *
+ * This file contains the search policies that can be used to customize
+ * how lazy-sorted containers look for elements. A search policy is
+ * specified through the @c _Search template parameter of containers like
+ * <tt>coveo::lazy::set</tt> or <tt>coveo::lazy::map</tt>:
+ *
+ * @code
+ *   // Use a cache-friendly index for lookups in a large, read-mostly map
+ *   coveo::lazy::map<std::uint64_t, std::string, std::less<std::uint64_t>, std::vector,
+ *                    coveo::lazy::detail::equal_to_using_less_if_needed<std::uint64_t, std::less<std::uint64_t>>,
+ *                    coveo::lazy::map_allocator<std::uint64_t, std::string>,
+ *                    coveo::lazy::default_sort_policy,
+ *                    coveo::lazy::no_sort_stats,
+ *                    coveo::lazy::eytzinger_search_policy<>> m;
+ * @endcode
+ *
+ * A search policy must be a type with a nested class template
+ * <tt>index<K, KCmp, Alloc></tt>, where @c K is the type of keys, @c KCmp the
+ * type of predicate used to compare them and @c Alloc the container's allocator
+ * type. Each container stores an instance of this index type, which must be
+ * default-constructible, copyable and have the following methods:
+ *
+ * - <tt>void build(RandIt first, RandIt last, const VCmp& vcmp, const Alloc& alloc)</tt>:
+ *   called each time the container is sorted, with all its elements; an index
+ *   that needs storage must allocate it with @c alloc (rebound as needed)
+ * - <tt>std::size_t lower_bound(RandIt first, RandIt last, const OK& key, const VCmp& vcmp) const</tt>:
+ *   returns the position of the first element in <tt>[first, last[</tt> that is
+ *   not less than @c key, like <tt>std::lower_bound</tt>
+ * - <tt>std::size_t upper_bound(RandIt first, RandIt last, const OK& key, const VCmp& vcmp) const</tt>:
+ *   returns the position of the first element in <tt>[first, last[</tt> that is
+ *   greater than @c key, like <tt>std::upper_bound</tt>
+ * - <tt>std::pair<std::size_t, std::size_t> equal_range(RandIt first, RandIt last, const OK& key, const VCmp& vcmp) const</tt>:
+ *   returns the positions of the lower and upper bounds of @c key, like <tt>std::equal_range</tt>
+ * - <tt>void invalidate()</tt>: called when elements of the container change
+ *
+ * Search methods are only called with all the elements of a sorted container,
+ * but not necessarily after @c build(): elements can be modified without
+ * breaking their order (when erasing, for instance). Search methods must not
+ * modify the index, so that concurrent lookups in a sorted container are safe.
+ * @c vcmp is a value predicate that gives access to the container's
+ * "value to key" predicate and key predicate through its <tt>value_to_key()</tt>
+ * and <tt>key_predicate()</tt> methods.
+ *
+ * @copyright 2015-2016, Coveo Solutions Inc.
+ *            Distributed under the Apache License, Version 2.0 (see <a href="https://github.com/coveo/lazy/blob/master/LICENSE">LICENSE</a>).
+ */
+
+#ifndef COVEO_LAZY_SEARCH_POLICY_H
+#define COVEO_LAZY_SEARCH_POLICY_H
+
+#include <coveo/lazy/detail/branchless_search.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace coveo {
+namespace lazy {
+
+/**
+ * @brief Default search policy.
+ * @headerfile search_policy.h <coveo/lazy/search_policy.h>
+ *
+ * Search policy that performs a binary search of the sorted elements
+ * using <tt>std::lower_bound</tt> and <tt>std::upper_bound</tt>. This
+ * policy does not store anything. This is the default search policy
+ * of lazy-sorted containers.
+ *
+ * When keys are arithmetic (integers or floating-point numbers) and are
+ * compared using <tt>std::less</tt> or <tt>std::greater</tt>, this policy
+ * uses a branchless binary search instead, which finishes with a linear
+ * scan of the last few elements. This avoids the branch mispredictions
+ * of <tt>std::lower_bound</tt>, which dominate lookup latency in such cases.
+ */
+struct binary_search_policy
+{
+    template<class K, class KCmp, class Alloc = std::allocator<K>>
+    struct index
+    {
+        template<class RandIt, class VCmp>
+        void build(RandIt, RandIt, const VCmp&, const Alloc&) { }
+
+        template<class RandIt, class OK, class VCmp>
+        std::size_t lower_bound(RandIt first, RandIt last, const OK& key, const VCmp& vcmp) const {
+            return detail::lower_bound_position(first, last, key, vcmp);
+        }
+
+        template<class RandIt, class OK, class VCmp>
+        std::size_t upper_bound(RandIt first, RandIt last, const OK& key, const VCmp& vcmp) const {
+            return detail::upper_bound_position(first, last, key, vcmp);
+        }
+
+        template<class RandIt, class OK, class VCmp>
+        std::pair<std::size_t, std::size_t> equal_range(RandIt first, RandIt last, const OK& key, const VCmp& vcmp) const {
+            return detail::equal_range_positions(first, last, key, vcmp);
+        }
+
+        void invalidate() { }
+    };
+};
+
+/**
+ * @brief Search policy using an Eytzinger layout.
+ * @headerfile search_policy.h <coveo/lazy/search_policy.h>
+ *
+ * Search policy that builds a copy of the keys of the elements in Eytzinger
+ * (breadth-first) order each time a container is sorted. In this layout, the
+ * first levels of the implicit search tree are stored together, so they stay
+ * in cache, and the nodes visited next can be prefetched; this greatly reduces
+ * cache misses compared to a binary search of large containers.
+ *
+ * The index is discarded each time the container is modified, and rebuilt
+ * when it is sorted again. Lookups never build the index: if a container is
+ * modified without losing its order (when erasing elements, for instance),
+ * lookups perform a binary search until the container is sorted again or
+ * <tt>sort()</tt> is called. Thus, like with the default policy, concurrent
+ * lookups in a sorted container are safe. This policy is best suited for
+ * large containers that are mostly read. Iteration still uses the elements
+ * directly.
+ *
+ * The index stores a copy of each key, plus the position of its element.
+ * Keys must therefore be copyable. This storage is allocated with the
+ * container's allocator.
+ *
+ * @tparam MinIndexSize Minimum number of elements for which to build the index.
+ *                      For smaller containers, a binary search is performed.
+ *                      Defaults to 1024.
+ */
+template<std::size_t MinIndexSize = 1024>
+struct eytzinger_search_policy
+{
+    template<class K, class KCmp, class Alloc = std::allocator<K>>
+    class index
+    {
+        using key_allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<K>;
+        using position_allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<std::size_t>;
+
+        // Storage of the index, allocated with the container's allocator.
+        struct storage
+        {
+            std::vector<K, key_allocator_type> keys;                    // Keys in Eytzinger order; node k (1-based) is at keys[k - 1].
+            std::vector<std::size_t, position_allocator_type> positions; // Position of the element of each node, in the same order.
+
+            explicit storage(const key_allocator_type& alloc)
+                : keys(alloc), positions(position_allocator_type(alloc)) { }
+            storage(const storage& obj, const key_allocator_type& alloc)
+                : keys(obj.keys, alloc), positions(obj.positions, position_allocator_type(alloc)) { }
+        };
+        using storage_allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<storage>;
+        using storage_traits = std::allocator_traits<storage_allocator_type>;
+
+        // Frees storage with the allocator it was allocated with.
+        struct storage_deleter
+        {
+            void operator()(storage* ptr) const {
+                storage_allocator_type alloc(ptr->keys.get_allocator());
+                storage_traits::destroy(alloc, ptr);
+                storage_traits::deallocate(alloc, std::pointer_traits<typename storage_traits::pointer>::pointer_to(*ptr), 1);
+            }
+        };
+        using storage_ptr = std::unique_ptr<storage, storage_deleter>;
+
+    public:
+        index() = default;
+
+        index(const index& obj)
+            : storage_(), valid_(false) {
+            if (obj.valid_) {
+                storage_ = make_storage(std::allocator_traits<key_allocator_type>::select_on_container_copy_construction(
+                                            obj.storage_->keys.get_allocator()), *obj.storage_);
+                valid_ = true;
+            }
+        }
+
+        index& operator=(const index& obj) {
+            if (this != &obj) {
+                valid_ = false;
+                if (obj.valid_) {
+                    // Copy in our storage unless its allocator must be replaced; without storage,
+                    // we do not know our container's allocator, so let the next sort build the index.
+                    if (std::allocator_traits<key_allocator_type>::propagate_on_container_copy_assignment::value) {
+                        storage_ = make_storage(obj.storage_->keys.get_allocator(), *obj.storage_);
+                        valid_ = true;
+                    } else if (storage_) {
+                        storage_->keys = obj.storage_->keys;
+                        storage_->positions = obj.storage_->positions;
+                        valid_ = true;
+                    }
+                }
+            }
+            return *this;
+        }
+
+        index(index&& obj)
+            : storage_(std::move(obj.storage_)), valid_(obj.valid_) {
+            obj.invalidate();
+        }
+
+        index& operator=(index&& obj) {
+            storage_ = std::move(obj.storage_);
+            valid_ = obj.valid_;
+            obj.invalidate();
+            return *this;
+        }
+
+        template<class RandIt, class VCmp>
+        void build(RandIt first, RandIt last, const VCmp& vcmp, const Alloc& alloc) {
+            const auto size = static_cast<std::size_t>(std::distance(first, last));
+            const key_allocator_type key_alloc(alloc);
+            if (size < MinIndexSize || (valid_ && storage_->keys.get_allocator() == key_alloc)) {
+                return;
+            }
+            valid_ = false;
+            if (!storage_ || storage_->keys.get_allocator() != key_alloc) {
+                storage_ = make_storage(key_alloc);
+            }
+            auto& keys = storage_->keys;
+            auto& positions = storage_->positions;
+            keys.clear();
+            positions.clear();
+            keys.reserve(size);
+            positions.resize(size);
+            // Nodes are visited in sorted order, but keys must be stored in node
+            // order; fill positions first, then copy keys in the proper order.
+            std::size_t pos = 0;
+            fill_positions(1, size, pos);
+            const auto& vtok = vcmp.value_to_key();
+            for (std::size_t node_pos : positions) {
+                keys.push_back(vtok(first[node_pos]));
+            }
+            valid_ = true;
+        }
+
+        template<class RandIt, class OK, class VCmp>
+        std::size_t lower_bound(RandIt first, RandIt last, const OK& key, const VCmp& vcmp) const {
+            if (!valid_) {
+                return detail::lower_bound_position(first, last, key, vcmp);
+            }
+            const auto& kcmp = vcmp.key_predicate();
+            return search([&](const K& node_key) {
+                return kcmp(node_key, key);
+            });
+        }
+
+        template<class RandIt, class OK, class VCmp>
+        std::size_t upper_bound(RandIt first, RandIt last, const OK& key, const VCmp& vcmp) const {
+            if (!valid_) {
+                return detail::upper_bound_position(first, last, key, vcmp);
+            }
+            const auto& kcmp = vcmp.key_predicate();
+            return search([&](const K& node_key) {
+                return !kcmp(key, node_key);
+            });
+        }
+
+        template<class RandIt, class OK, class VCmp>
+        std::pair<std::size_t, std::size_t> equal_range(RandIt first, RandIt last, const OK& key, const VCmp& vcmp) const {
+            return std::make_pair(lower_bound(first, last, key, vcmp), upper_bound(first, last, key, vcmp));
+        }
+
+        void invalidate() {
+            valid_ = false;
+        }
+
+    private:
+        storage_ptr storage_;   // Storage of the index, if it was ever built; kept to be reused.
+        bool valid_ = false;    // Whether storage_ corresponds to the container's elements.
+
+        // Allocates storage with the given allocator, passing it extra constructor arguments if any.
+        template<class... Args>
+        static storage_ptr make_storage(const key_allocator_type& key_alloc, const Args&... args) {
+            storage_allocator_type alloc(key_alloc);
+            auto ptr = storage_traits::allocate(alloc, 1);
+            try {
+                storage_traits::construct(alloc, std::addressof(*ptr), args..., key_alloc);
+            } catch (...) {
+                storage_traits::deallocate(alloc, ptr, 1);
+                throw;
+            }
+            return storage_ptr(std::addressof(*ptr));
+        }
+
+        // Assigns positions to nodes through an in-order traversal of the implicit tree.
+        void fill_positions(std::size_t node, std::size_t size, std::size_t& pos) {
+            if (node <= size) {
+                fill_positions(2 * node, size, pos);
+                storage_->positions[node - 1] = pos++;
+                fill_positions(2 * node + 1, size, pos);
+            }
+        }
+
+        // Descends the implicit tree; goes right while go_right(node_key) is true.
+        // Returns position of the element of the last node where we went left, or size.
+        template<class GoRight>
+        std::size_t search(const GoRight& go_right) const {
+            const K* keys = storage_->keys.data();
+            const std::size_t size = storage_->keys.size();
+            std::size_t node = 1;
+            while (node <= size) {
+#if defined(__GNUC__) || defined(__clang__)
+                // Prefetch nodes four levels down; they are stored contiguously.
+                if (16 * node <= size) {
+                    __builtin_prefetch(keys + 16 * node - 1);
+                }
+#endif
+                node = 2 * node + (go_right(keys[node - 1]) ? 1 : 0);
+            }
+            // Remove all the right turns taken after the last left turn, then that left turn.
+            while ((node & 1) != 0) {
+                node >>= 1;
+            }
+            node >>= 1;
+            return node != 0 ? storage_->positions[node - 1] : size;
+        }
+    };
+};
+
+} // lazy
+} // coveo
+
+#endif // COVEO_LAZY_SEARCH_POLICY_H
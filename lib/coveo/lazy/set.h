@@ -62,12 +62,32 @@ namespace lazy {
  *             otherwise to an implementation that uses @c _Cmp (see above).
  * @tparam _Alloc Allocator used for the set elements.
  *                Defaults to <tt>std::allocator</tt>.
+ * @tparam _Sort Policy used to sort the elements when needed.
+ *               Defaults to <tt>coveo::lazy::default_sort_policy</tt>.
+ *               See <tt>coveo/lazy/sort_policy.h</tt> for details.
+ * @tparam _Stats Policy used to collect statistics about sorting.
+ *                Defaults to <tt>coveo::lazy::no_sort_stats</tt>.
+ *                See <tt>coveo/lazy/sort_stats.h</tt> for details.
+ * @tparam _Search Policy used to look for elements once sorted.
+ *                 Defaults to <tt>coveo::lazy::binary_search_policy</tt>.
+ *                 See <tt>coveo/lazy/search_policy.h</tt> for details.
+ * @tparam _Dup Policy used to resolve duplicates inserted in the set.
+ *              Defaults to <tt>coveo::lazy::default_duplicate_policy</tt>.
+ *              See <tt>coveo/lazy/duplicate_policy.h</tt> for details.
+ * @tparam _Append Policy used to track the order of elements inserted at the end of the set.
+ *                 Defaults to <tt>coveo::lazy::default_append_policy</tt>.
+ *                 See <tt>coveo/lazy/append_policy.h</tt> for details.
  */
 template<class K,
          class _Cmp = std::less<K>,
          template<class _ImplT, class _ImplAlloc> class _Impl = std::vector,
          class _Eq = detail::equal_to_using_less_if_needed<K, _Cmp>,
-         class _Alloc = std::allocator<K>>
+         class _Alloc = std::allocator<K>,
+         class _Sort = default_sort_policy,
+         class _Stats = no_sort_stats,
+         class _Search = binary_search_policy,
+         class _Dup = default_duplicate_policy,
+         class _Append = default_append_policy>
  using set = detail::lazy_sorted_container<K,
                                            void,
                                            K,
@@ -77,7 +97,12 @@ template<class K,
                                            _Eq,
                                            _Alloc,
                                            _Impl,
-                                           false>;
+                                           false,
+                                           _Sort,
+                                           _Stats,
+                                           _Search,
+                                           _Dup,
+                                           _Append>;
 
 /**
  * @class coveo::lazy::multiset
@@ -120,12 +145,28 @@ template<class K,
  *             otherwise to an implementation that uses @c _Cmp (see above).
  * @tparam _Alloc Allocator used for the set elements.
  *                Defaults to <tt>std::allocator</tt>.
+ * @tparam _Sort Policy used to sort the elements when needed.
+ *               Defaults to <tt>coveo::lazy::default_sort_policy</tt>.
+ *               See <tt>coveo/lazy/sort_policy.h</tt> for details.
+ * @tparam _Stats Policy used to collect statistics about sorting.
+ *                Defaults to <tt>coveo::lazy::no_sort_stats</tt>.
+ *                See <tt>coveo/lazy/sort_stats.h</tt> for details.
+ * @tparam _Search Policy used to look for elements once sorted.
+ *                 Defaults to <tt>coveo::lazy::binary_search_policy</tt>.
+ *                 See <tt>coveo/lazy/search_policy.h</tt> for details.
+ * @tparam _Append Policy used to track the order of elements inserted at the end of the multiset.
+ *                 Defaults to <tt>coveo::lazy::default_append_policy</tt>.
+ *                 See <tt>coveo/lazy/append_policy.h</tt> for details.
  */
 template<class K,
          class _Cmp = std::less<K>,
          template<class _ImplT, class _ImplAlloc> class _Impl = std::vector,
          class _Eq = detail::equal_to_using_less_if_needed<K, _Cmp>,
-         class _Alloc = std::allocator<K>>
+         class _Alloc = std::allocator<K>,
+         class _Sort = default_sort_policy,
+         class _Stats = no_sort_stats,
+         class _Search = binary_search_policy,
+         class _Append = default_append_policy>
  using multiset = detail::lazy_sorted_container<K,
                                                 void,
                                                 K,
@@ -135,7 +176,116 @@ template<class K,
                                                 _Eq,
                                                 _Alloc,
                                                 _Impl,
-                                                true>;
+                                                true,
+                                                _Sort,
+                                                _Stats,
+                                                _Search,
+                                                default_duplicate_policy,
+                                                _Append>;
+
+/**
+ * @brief Read-only view of a set's sorted elements.
+ * @headerfile set.h <coveo/lazy/set.h>
+ *
+ * Read-only container that looks for elements of a <tt>coveo::lazy::set</tt>
+ * without copying or sorting them, for example over a file written by
+ * <tt>coveo::lazy::set::serialize()</tt> and mapped in memory.
+ * Same as <tt>coveo::lazy::set::view_type</tt>.
+ * See <tt>coveo::lazy::detail::sorted_view</tt> for details.
+ *
+ * @tparam K Type of elements.
+ * @tparam _Cmp Predicate used to sort the elements.
+ *              Defaults to <tt>std::less<K></tt>.
+ */
+template<class K,
+         class _Cmp = std::less<K>>
+using set_view = detail::sorted_view<K,
+                                     void,
+                                     K,
+                                     K,
+                                     detail::lazy_value_pred_proxy<K, detail::identity<K>, _Cmp>,
+                                     false>;
+
+/**
+ * @brief Read-only view of a multiset's sorted elements.
+ * @headerfile set.h <coveo/lazy/set.h>
+ *
+ * Like <tt>coveo::lazy::set_view</tt>, but for elements of a
+ * <tt>coveo::lazy::multiset</tt>. Can also be opened over the
+ * elements of a <tt>coveo::lazy::set</tt>.
+ *
+ * @tparam K Type of elements.
+ * @tparam _Cmp Predicate used to sort the elements.
+ *              Defaults to <tt>std::less<K></tt>.
+ */
+template<class K,
+         class _Cmp = std::less<K>>
+using multiset_view = detail::sorted_view<K,
+                                          void,
+                                          K,
+                                          K,
+                                          detail::lazy_value_pred_proxy<K, detail::identity<K>, _Cmp>,
+                                          true>;
+
+#ifdef COVEO_LAZY_HAS_MEMORY_RESOURCE
+
+namespace pmr {
+
+/**
+ * @brief Lazy set using a polymorphic allocator.
+ * @headerfile set.h <coveo/lazy/set.h>
+ *
+ * Like <tt>std::pmr::set</tt>, a <tt>coveo::lazy::set</tt> that uses
+ * <tt>std::pmr::polymorphic_allocator</tt> to allocate its elements.
+ * Combined with a <tt>std::pmr::monotonic_buffer_resource</tt>, this can be
+ * used to build short-lived containers without freeing memory:
+ *
+ * @code
+ *   std::pmr::monotonic_buffer_resource arena;
+ *   coveo::lazy::pmr::set<int> s(&arena);
+ * @endcode
+ *
+ * Only available when compiling for C++17 or later.
+ *
+ * @tparam K Type of elements stored in the set.
+ * @tparam _Cmp Predicate used to sort the elements.
+ *              Defaults to <tt>std::less<K></tt>.
+ * @tparam _Impl Type of sequence container used by the set.
+ *               Defaults to <tt>std::vector</tt>.
+ * @tparam _Eq Predicate used to determine if elements are equal.
+ *             See <tt>coveo::lazy::set</tt> for details.
+ */
+template<class K,
+         class _Cmp = std::less<K>,
+         template<class _ImplT, class _ImplAlloc> class _Impl = std::vector,
+         class _Eq = detail::equal_to_using_less_if_needed<K, _Cmp>>
+using set = coveo::lazy::set<K, _Cmp, _Impl, _Eq, std::pmr::polymorphic_allocator<K>>;
+
+/**
+ * @brief Lazy multiset using a polymorphic allocator.
+ * @headerfile set.h <coveo/lazy/set.h>
+ *
+ * Like <tt>std::pmr::multiset</tt>, a <tt>coveo::lazy::multiset</tt> that uses
+ * <tt>std::pmr::polymorphic_allocator</tt> to allocate its elements.
+ * See <tt>coveo::lazy::pmr::set</tt> for details.
+ *
+ * @tparam K Type of elements stored in the set.
+ * @tparam _Cmp Predicate used to sort the elements.
+ *              Defaults to <tt>std::less<K></tt>.
+ * @tparam _Impl Type of sequence container used by the set.
+ *               Defaults to <tt>std::vector</tt>.
+ * @tparam _Eq Predicate used to determine if elements are equal.
+ *             See <tt>coveo::lazy::multiset</tt> for details.
+ */
+template<class K,
+         class _Cmp = std::less<K>,
+         template<class _ImplT, class _ImplAlloc> class _Impl = std::vector,
+         class _Eq = detail::equal_to_using_less_if_needed<K, _Cmp>>
+using multiset = coveo::lazy::multiset<K, _Cmp, _Impl, _Eq, std::pmr::polymorphic_allocator<K>>;
+
+} // pmr
+
+#endif // COVEO_LAZY_HAS_MEMORY_RESOURCE
 
 } // lazy
 } // coveo
@@ -0,0 +1,729 @@
+/**
+ * @file
+ * @brief Definition of a vector-like container with inline storage.
+ *
+ * This file contains the definition of <tt>coveo::lazy::small_vector</tt>, a
+ * sequence container similar to <tt>std::vector</tt> that stores up to a given
+ * number of elements inline, without allocating memory. It can be used as the
+ * internal container of lazy-sorted containers that usually hold few elements:
+ *
+ * @code
+ *   // Set that only allocates memory if it holds more than 16 elements
+ *   coveo::lazy::set<int, std::less<int>, coveo::lazy::small_vector_impl<16>::type> s;
+ * @endcode
+ *
+ * When used this way, lazy-sorted containers also look for elements by
+ * scanning them instead of sorting them, as long as they do not hold more
+ * elements than can be stored inline (see
+ * <tt>coveo::lazy::detail::lazy_sorted_container::set_pending_limit()</tt>).
+ *
+ * @copyright 2015-2016, Coveo Solutions Inc.
+ *            Distributed under the Apache License, Version 2.0 (see <a href="https://github.com/coveo/lazy/blob/master/LICENSE">LICENSE</a>).
+ */
+
+#ifndef COVEO_LAZY_SMALL_VECTOR_H
+#define COVEO_LAZY_SMALL_VECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace coveo {
+namespace lazy {
+namespace detail {
+
+/**
+ * @internal
+ * @brief Iterator for @c small_vector.
+ * @headerfile small_vector.h <coveo/lazy/small_vector.h>
+ *
+ * Random-access iterator wrapping a pointer to an element of a @c small_vector.
+ * A class is used instead of a plain pointer so that iterators of containers
+ * storing derived classes can be converted back to this type (see
+ * <tt>coveo::lazy::detail::iterator_proxy</tt>).
+ *
+ * @tparam T Type of elements in the container.
+ * @tparam Const Whether iterator returns const references.
+ */
+template<class T, bool Const>
+class small_vector_iterator
+{
+    template<class, bool> friend class small_vector_iterator;
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const T*, T*>;
+    using reference = std::conditional_t<Const, const T&, T&>;
+
+    small_vector_iterator() = default;
+    explicit small_vector_iterator(pointer ptr) : ptr_(ptr) { }
+    template<bool _OConst, class = std::enable_if_t<Const && !_OConst, void>>
+    small_vector_iterator(const small_vector_iterator<T, _OConst>& obj) : ptr_(obj.ptr_) { }
+
+    reference operator*() const { return *ptr_; }
+    pointer operator->() const { return ptr_; }
+    reference operator[](difference_type n) const { return ptr_[n]; }
+
+    small_vector_iterator& operator++() { ++ptr_; return *this; }
+    small_vector_iterator operator++(int) { auto it = *this; ++ptr_; return it; }
+    small_vector_iterator& operator--() { --ptr_; return *this; }
+    small_vector_iterator operator--(int) { auto it = *this; --ptr_; return it; }
+    small_vector_iterator& operator+=(difference_type n) { ptr_ += n; return *this; }
+    small_vector_iterator& operator-=(difference_type n) { ptr_ -= n; return *this; }
+
+    friend small_vector_iterator operator+(small_vector_iterator it, difference_type n) { return it += n; }
+    friend small_vector_iterator operator+(difference_type n, small_vector_iterator it) { return it += n; }
+    friend small_vector_iterator operator-(small_vector_iterator it, difference_type n) { return it -= n; }
+    friend difference_type operator-(const small_vector_iterator& left, const small_vector_iterator& right) { return left.ptr_ - right.ptr_; }
+
+    friend bool operator==(const small_vector_iterator& left, const small_vector_iterator& right) { return left.ptr_ == right.ptr_; }
+    friend bool operator!=(const small_vector_iterator& left, const small_vector_iterator& right) { return left.ptr_ != right.ptr_; }
+    friend bool operator<(const small_vector_iterator& left, const small_vector_iterator& right) { return left.ptr_ < right.ptr_; }
+    friend bool operator<=(const small_vector_iterator& left, const small_vector_iterator& right) { return left.ptr_ <= right.ptr_; }
+    friend bool operator>(const small_vector_iterator& left, const small_vector_iterator& right) { return left.ptr_ > right.ptr_; }
+    friend bool operator>=(const small_vector_iterator& left, const small_vector_iterator& right) { return left.ptr_ >= right.ptr_; }
+
+private:
+    pointer ptr_ = nullptr;     // Element pointed at.
+};
+
+} // detail
+
+/**
+ * @brief Vector with inline storage.
+ * @headerfile small_vector.h <coveo/lazy/small_vector.h>
+ *
+ * <tt>std::vector</tt>-like sequence container that stores up to @c N elements
+ * inside the container object itself. Memory is only allocated (through
+ * @c Alloc) when more elements are added; from then on, it behaves like
+ * a <tt>std::vector</tt>. <tt>shrink_to_fit()</tt> moves elements back
+ * inline when possible.
+ *
+ * Unlike <tt>std::vector</tt>, moving or swapping containers whose elements
+ * are stored inline moves the elements themselves, so it invalidates iterators.
+ *
+ * To use this class as the internal container of a lazy-sorted container,
+ * use <tt>small_vector_impl<N>::type</tt>, since those expect a template
+ * accepting two arguments like <tt>std::vector</tt>.
+ *
+ * @tparam T Type of elements stored in the container.
+ * @tparam N Number of elements that can be stored inline. Must be greater than 0.
+ * @tparam Alloc Allocator used when elements cannot be stored inline.
+ *               Defaults to <tt>std::allocator<T></tt>.
+ */
+template<class T, std::size_t N, class Alloc = std::allocator<T>>
+class small_vector
+{
+    static_assert(N > 0, "small_vector must be able to store at least one element inline");
+
+    using alloc_traits = std::allocator_traits<Alloc>;
+public:
+    /// Number of elements that can be stored without allocating memory.
+    static constexpr std::size_t inline_capacity = N;
+
+    using value_type = T;
+    using allocator_type = Alloc;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = detail::small_vector_iterator<T, false>;
+    using const_iterator = detail::small_vector_iterator<T, true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+private:
+    allocator_type alloc_;      // Allocator used when elements are not inline.
+    T* data_;                   // Pointer to elements; either inline_ or allocated.
+    size_type size_;            // Number of elements.
+    size_type capacity_;        // Number of elements that data_ can hold.
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type inline_[N];  // Inline storage.
+
+public:
+    /**
+     * @brief Default constructor.
+     *
+     * Creates an empty container.
+     */
+    small_vector() : small_vector(allocator_type()) { }
+
+    /**
+     * @brief Constructor with allocator.
+     *
+     * Creates an empty container that will use the given allocator
+     * if elements cannot be stored inline.
+     *
+     * @param alloc Allocator instance to use.
+     */
+    explicit small_vector(const allocator_type& alloc)
+        : alloc_(alloc), data_(inline_data()), size_(0), capacity_(N) { }
+
+    /**
+     * @brief Range constructor.
+     *
+     * Creates a container with copies of the elements in <tt>[first, last[</tt>.
+     *
+     * @param first Beginning of range of elements to copy.
+     * @param last End of range of elements to copy.
+     * @param alloc Allocator instance to use.
+     */
+    template<class It,
+             class = typename std::iterator_traits<It>::iterator_category>
+    small_vector(It first, It last, const allocator_type& alloc = allocator_type())
+        : small_vector(alloc) {
+        insert(cend(), first, last);
+    }
+
+    /**
+     * @brief Initializer list constructor.
+     *
+     * Creates a container with copies of the elements in @c init.
+     *
+     * @param init List of elements to copy.
+     * @param alloc Allocator instance to use.
+     */
+    small_vector(std::initializer_list<T> init, const allocator_type& alloc = allocator_type())
+        : small_vector(init.begin(), init.end(), alloc) { }
+
+    /**
+     * @brief Copy constructor.
+     *
+     * @param obj Container to copy.
+     */
+    small_vector(const small_vector& obj)
+        : small_vector(obj, alloc_traits::select_on_container_copy_construction(obj.alloc_)) { }
+
+    /**
+     * @brief Copy constructor with allocator.
+     *
+     * @param obj Container to copy.
+     * @param alloc Allocator instance to use.
+     */
+    small_vector(const small_vector& obj, const allocator_type& alloc)
+        : small_vector(alloc) {
+        insert(cend(), obj.cbegin(), obj.cend());
+    }
+
+    /**
+     * @brief Move constructor.
+     *
+     * Steals the memory of @c obj if its elements are not stored inline;
+     * otherwise, moves its elements one by one. @c obj is left empty.
+     *
+     * @param obj Container to move.
+     */
+    small_vector(small_vector&& obj)
+        : small_vector(std::move(obj.alloc_)) {
+        steal_or_move_elements(obj, std::true_type());
+    }
+
+    /**
+     * @brief Move constructor with allocator.
+     *
+     * Steals the memory of @c obj if its elements are not stored inline and
+     * if @c alloc is equal to its allocator; otherwise, moves its elements
+     * one by one. @c obj is left empty.
+     *
+     * @param obj Container to move.
+     * @param alloc Allocator instance to use.
+     */
+    small_vector(small_vector&& obj, const allocator_type& alloc)
+        : small_vector(alloc) {
+        steal_or_move_elements(obj, std::false_type());
+    }
+
+    /**
+     * @brief Destructor.
+     */
+    ~small_vector() {
+        clear();
+        release();
+    }
+
+    /**
+     * @brief Assignment operator.
+     *
+     * @param obj Container to copy.
+     * @return Reference to @c this container.
+     */
+    small_vector& operator=(const small_vector& obj) {
+        if (this != &obj) {
+            if (alloc_traits::propagate_on_container_copy_assignment::value && alloc_ != obj.alloc_) {
+                clear();
+                release();
+                alloc_ = obj.alloc_;
+            }
+            clear();
+            insert(cend(), obj.cbegin(), obj.cend());
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Move assignment operator.
+     *
+     * Steals the memory of @c obj if possible (see move constructor); otherwise,
+     * moves its elements one by one. @c obj is left empty.
+     *
+     * @param obj Container to move.
+     * @return Reference to @c this container.
+     */
+    small_vector& operator=(small_vector&& obj) {
+        if (this != &obj) {
+            clear();
+            if (alloc_traits::propagate_on_container_move_assignment::value) {
+                release();
+                alloc_ = std::move(obj.alloc_);
+                steal_or_move_elements(obj, std::true_type());
+            } else {
+                steal_or_move_elements(obj, std::false_type());
+            }
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Assignment operator from initializer list.
+     *
+     * @param init List of elements to copy.
+     * @return Reference to @c this container.
+     */
+    small_vector& operator=(std::initializer_list<T> init) {
+        clear();
+        insert(cend(), init.begin(), init.end());
+        return *this;
+    }
+
+    /// @brief Returns allocator used by the container.
+    allocator_type get_allocator() const { return alloc_; }
+
+    /// @brief Returns iterator to beginning of container.
+    iterator begin() { return iterator(data_); }
+    /// @brief Returns const iterator to beginning of container.
+    const_iterator begin() const { return cbegin(); }
+    /// @brief Returns const iterator to beginning of container.
+    const_iterator cbegin() const { return const_iterator(data_); }
+    /// @brief Returns iterator to end of container.
+    iterator end() { return iterator(data_ + size_); }
+    /// @brief Returns const iterator to end of container.
+    const_iterator end() const { return cend(); }
+    /// @brief Returns const iterator to end of container.
+    const_iterator cend() const { return const_iterator(data_ + size_); }
+    /// @brief Returns reverse iterator to beginning of reversed container.
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+    /// @brief Returns const reverse iterator to beginning of reversed container.
+    const_reverse_iterator rbegin() const { return crbegin(); }
+    /// @brief Returns const reverse iterator to beginning of reversed container.
+    const_reverse_iterator crbegin() const { return const_reverse_iterator(cend()); }
+    /// @brief Returns reverse iterator to end of reversed container.
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+    /// @brief Returns const reverse iterator to end of reversed container.
+    const_reverse_iterator rend() const { return crend(); }
+    /// @brief Returns const reverse iterator to end of reversed container.
+    const_reverse_iterator crend() const { return const_reverse_iterator(cbegin()); }
+
+    /// @brief Checks if container is empty.
+    bool empty() const { return size_ == 0; }
+    /// @brief Returns number of elements in container.
+    size_type size() const { return size_; }
+    /// @brief Returns maximum number of elements container can hold.
+    size_type max_size() const { return alloc_traits::max_size(alloc_); }
+    /// @brief Returns number of elements container can hold without allocating memory.
+    size_type capacity() const { return capacity_; }
+    /// @brief Checks if elements are stored inline.
+    bool is_inline() const { return data_ == inline_data(); }
+
+    /**
+     * @brief Reserves memory.
+     *
+     * Makes sure the container can hold at least @c new_cap elements
+     * without allocating memory.
+     *
+     * @param new_cap Number of elements to reserve memory for.
+     */
+    void reserve(size_type new_cap) {
+        if (new_cap > capacity_) {
+            reallocate(new_cap);
+        }
+    }
+
+    /**
+     * @brief Releases unused memory.
+     *
+     * Moves elements back inline if possible; otherwise, reallocates
+     * memory to hold exactly <tt>size()</tt> elements.
+     */
+    void shrink_to_fit() {
+        if (!is_inline() && size_ < capacity_) {
+            reallocate(size_);
+        }
+    }
+
+    /// @brief Returns pointer to elements.
+    T* data() { return data_; }
+    /// @brief Returns const pointer to elements.
+    const T* data() const { return data_; }
+    /// @brief Accesses an element without bounds checking.
+    T& operator[](size_type pos) { return data_[pos]; }
+    /// @brief Accesses an element without bounds checking (const version).
+    const T& operator[](size_type pos) const { return data_[pos]; }
+    /// @brief Returns reference to first element.
+    T& front() { return data_[0]; }
+    /// @brief Returns const reference to first element.
+    const T& front() const { return data_[0]; }
+    /// @brief Returns reference to last element.
+    T& back() { return data_[size_ - 1]; }
+    /// @brief Returns const reference to last element.
+    const T& back() const { return data_[size_ - 1]; }
+
+    /**
+     * @brief Accesses an element with bounds checking.
+     *
+     * @param pos Position of element.
+     * @return Reference to element.
+     * @throw std::out_of_range @c pos is not smaller than <tt>size()</tt>.
+     */
+    T& at(size_type pos) {
+        check_pos(pos);
+        return data_[pos];
+    }
+
+    /**
+     * @brief Accesses an element with bounds checking (const version).
+     *
+     * @param pos Position of element.
+     * @return Const reference to element.
+     * @throw std::out_of_range @c pos is not smaller than <tt>size()</tt>.
+     */
+    const T& at(size_type pos) const {
+        check_pos(pos);
+        return data_[pos];
+    }
+
+    /**
+     * @brief Removes all elements.
+     *
+     * Memory is not released; see <tt>shrink_to_fit()</tt>.
+     */
+    void clear() {
+        destroy_from(0);
+    }
+
+    /**
+     * @brief Constructs an element at the end of the container.
+     *
+     * @param args Arguments to pass to the element's constructor.
+     * @return Reference to new element.
+     */
+    template<class... Args> T& emplace_back(Args&&... args) {
+        if (size_ == capacity_) {
+            // Construct new element first, since args could refer to an existing element.
+            const size_type new_cap = grown_capacity(size_ + 1);
+            T* new_data = alloc_traits::allocate(alloc_, new_cap);
+            try {
+                alloc_traits::construct(alloc_, new_data + size_, std::forward<Args>(args)...);
+            } catch (...) {
+                alloc_traits::deallocate(alloc_, new_data, new_cap);
+                throw;
+            }
+            adopt(new_data, new_cap, 1);
+        } else {
+            alloc_traits::construct(alloc_, data_ + size_, std::forward<Args>(args)...);
+        }
+        return data_[size_++];
+    }
+
+    /// @brief Copies an element at the end of the container.
+    void push_back(const T& value) { emplace_back(value); }
+    /// @brief Moves an element at the end of the container.
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    /// @brief Removes last element.
+    void pop_back() { destroy_from(size_ - 1); }
+
+    /**
+     * @brief Constructs an element in the container.
+     *
+     * @param pos Iterator pointing where to construct element.
+     * @param args Arguments to pass to the element's constructor.
+     * @return Iterator pointing at new element.
+     */
+    template<class... Args> iterator emplace(const_iterator pos, Args&&... args) {
+        const size_type offset = position(pos);
+        emplace_back(std::forward<Args>(args)...);
+        std::rotate(data_ + offset, data_ + size_ - 1, data_ + size_);
+        return iterator(data_ + offset);
+    }
+
+    /// @brief Inserts a copy of an element in the container.
+    iterator insert(const_iterator pos, const T& value) { return emplace(pos, value); }
+    /// @brief Moves an element in the container.
+    iterator insert(const_iterator pos, T&& value) { return emplace(pos, std::move(value)); }
+
+    /**
+     * @brief Inserts a range of elements in the container.
+     *
+     * @param pos Iterator pointing where to insert elements.
+     * @param first Beginning of range of elements to insert.
+     * @param last End of range of elements to insert.
+     * @return Iterator pointing at first element inserted, or @c pos if none.
+     */
+    template<class It,
+             class = typename std::iterator_traits<It>::iterator_category>
+    iterator insert(const_iterator pos, It first, It last) {
+        const size_type offset = position(pos);
+        const size_type old_size = size_;
+        reserve_for_range(first, last, typename std::iterator_traits<It>::iterator_category());
+        for (; first != last; ++first) {
+            emplace_back(*first);
+        }
+        std::rotate(data_ + offset, data_ + old_size, data_ + size_);
+        return iterator(data_ + offset);
+    }
+
+    /// @brief Inserts elements of an initializer list in the container.
+    iterator insert(const_iterator pos, std::initializer_list<T> init) {
+        return insert(pos, init.begin(), init.end());
+    }
+
+    /**
+     * @brief Removes an element.
+     *
+     * @param pos Iterator pointing at element to remove.
+     * @return Iterator pointing at element following the removed one.
+     */
+    iterator erase(const_iterator pos) {
+        return erase(pos, std::next(pos));
+    }
+
+    /**
+     * @brief Removes a range of elements.
+     *
+     * @param first Beginning of range of elements to remove.
+     * @param last End of range of elements to remove.
+     * @return Iterator pointing at element following the last one removed.
+     */
+    iterator erase(const_iterator first, const_iterator last) {
+        const size_type offset = position(first);
+        if (first != last) {
+            std::move(data_ + position(last), data_ + size_, data_ + offset);
+            destroy_from(size_ - (last - first));
+        }
+        return iterator(data_ + offset);
+    }
+
+    /**
+     * @brief Resizes the container.
+     *
+     * Removes elements or adds value-initialized elements at the end.
+     *
+     * @param count New number of elements.
+     */
+    void resize(size_type count) {
+        if (count < size_) {
+            destroy_from(count);
+        } else {
+            reserve(count);
+            while (size_ < count) {
+                emplace_back();
+            }
+        }
+    }
+
+    /**
+     * @brief Swaps the contents of two containers.
+     *
+     * If elements of both containers are stored in allocated memory, only
+     * pointers are swapped; otherwise, elements are moved. Like for standard
+     * containers, allocators must be equal if they do not propagate on swap.
+     *
+     * @param obj Container to swap with.
+     */
+    void swap(small_vector& obj) {
+        if (this == &obj) {
+            return;
+        }
+        if (alloc_traits::propagate_on_container_swap::value) {
+            using std::swap;
+            swap(alloc_, obj.alloc_);
+        }
+        if (!is_inline() && !obj.is_inline()) {
+            std::swap(data_, obj.data_);
+            std::swap(size_, obj.size_);
+            std::swap(capacity_, obj.capacity_);
+        } else {
+            small_vector tmp(std::move(obj), obj.alloc_);
+            obj.clear();
+            obj.steal_or_move_elements(*this, std::false_type());
+            clear();
+            steal_or_move_elements(tmp, std::false_type());
+        }
+    }
+
+    /// @brief Swaps the contents of two containers; see <tt>small_vector::swap()</tt>.
+    friend void swap(small_vector& obj1, small_vector& obj2) {
+        obj1.swap(obj2);
+    }
+
+    /// @brief Checks if two containers hold equal elements.
+    friend bool operator==(const small_vector& left, const small_vector& right) {
+        return std::equal(left.cbegin(), left.cend(), right.cbegin(), right.cend());
+    }
+    /// @brief Checks if two containers do not hold equal elements.
+    friend bool operator!=(const small_vector& left, const small_vector& right) {
+        return !(left == right);
+    }
+    /// @brief Compares the elements of two containers lexicographically.
+    friend bool operator<(const small_vector& left, const small_vector& right) {
+        return std::lexicographical_compare(left.cbegin(), left.cend(), right.cbegin(), right.cend());
+    }
+
+private:
+    T* inline_data() {
+        return reinterpret_cast<T*>(&inline_[0]);
+    }
+    const T* inline_data() const {
+        return reinterpret_cast<const T*>(&inline_[0]);
+    }
+
+    size_type position(const_iterator it) const {
+        return static_cast<size_type>(it - cbegin());
+    }
+
+    void check_pos(size_type pos) const {
+        if (pos >= size_) {
+            throw std::out_of_range("small_vector::at");
+        }
+    }
+
+    size_type grown_capacity(size_type min_cap) const {
+        return std::max(min_cap, 2 * capacity_);
+    }
+
+    // Destroys elements from position pos to the end.
+    void destroy_from(size_type pos) {
+        while (size_ > pos) {
+            alloc_traits::destroy(alloc_, data_ + --size_);
+        }
+    }
+
+    // Releases allocated memory, if any; container must be empty.
+    void release() {
+        if (!is_inline()) {
+            alloc_traits::deallocate(alloc_, data_, capacity_);
+            data_ = inline_data();
+            capacity_ = N;
+        }
+    }
+
+    // Moves elements to new_data (which already holds num_new elements after them) and uses it from now on.
+    void adopt(T* new_data, size_type new_cap, size_type num_new) {
+        size_type moved = 0;
+        try {
+            for (; moved < size_; ++moved) {
+                alloc_traits::construct(alloc_, new_data + moved, std::move_if_noexcept(data_[moved]));
+            }
+        } catch (...) {
+            for (size_type i = 0; i < moved; ++i) {
+                alloc_traits::destroy(alloc_, new_data + i);
+            }
+            for (size_type i = 0; i < num_new; ++i) {
+                alloc_traits::destroy(alloc_, new_data + size_ + i);
+            }
+            if (new_data != inline_data()) {
+                alloc_traits::deallocate(alloc_, new_data, new_cap);
+            }
+            throw;
+        }
+        const size_type old_size = size_;
+        destroy_from(0);
+        release();
+        data_ = new_data;
+        capacity_ = new_cap;
+        size_ = old_size;
+    }
+
+    // Moves elements to a buffer of the given capacity, or inline if they fit.
+    void reallocate(size_type new_cap) {
+        if (new_cap <= N) {
+            if (!is_inline()) {
+                adopt(inline_data(), N, 0);
+            }
+        } else {
+            adopt(alloc_traits::allocate(alloc_, new_cap), new_cap, 0);
+        }
+    }
+
+    template<class It> void reserve_for_range(It first, It last, std::forward_iterator_tag) {
+        reserve(size_ + static_cast<size_type>(std::distance(first, last)));
+    }
+    template<class It> void reserve_for_range(It, It, std::input_iterator_tag) { }
+
+    // Takes the elements of obj, which is left empty. This container must be empty.
+    // If allocators are known to be equal, memory can always be stolen; otherwise they must be compared.
+    void steal_or_move_elements(small_vector& obj, std::true_type) {
+        if (!obj.is_inline()) {
+            release();
+            data_ = obj.data_;
+            size_ = obj.size_;
+            capacity_ = obj.capacity_;
+            obj.data_ = obj.inline_data();
+            obj.size_ = 0;
+            obj.capacity_ = N;
+        } else {
+            reserve(obj.size_);
+            for (auto& elem : obj) {
+                emplace_back(std::move(elem));
+            }
+            obj.clear();
+        }
+    }
+    void steal_or_move_elements(small_vector& obj, std::false_type) {
+        if (alloc_ == obj.alloc_) {
+            steal_or_move_elements(obj, std::true_type());
+        } else {
+            reserve(obj.size_);
+            for (auto& elem : obj) {
+                emplace_back(std::move(elem));
+            }
+            obj.clear();
+        }
+    }
+};
+
+template<class T, std::size_t N, class Alloc>
+constexpr std::size_t small_vector<T, N, Alloc>::inline_capacity;
+
+/**
+ * @brief Helper to use @c small_vector in lazy-sorted containers.
+ * @headerfile small_vector.h <coveo/lazy/small_vector.h>
+ *
+ * Lazy-sorted containers expect the type of their internal container to be
+ * a template accepting two arguments, like <tt>std::vector</tt>. This helper
+ * provides such a template for a @c small_vector storing @c N elements inline:
+ *
+ * @code
+ *   coveo::lazy::set<int, std::less<int>, coveo::lazy::small_vector_impl<16>::type> s;
+ * @endcode
+ *
+ * @tparam N Number of elements that can be stored inline.
+ */
+template<std::size_t N>
+struct small_vector_impl
+{
+    template<class T, class Alloc>
+    using type = small_vector<T, N, Alloc>;
+};
+
+} // lazy
+} // coveo
+
+#endif // COVEO_LAZY_SMALL_VECTOR_H
@@ -0,0 +1,868 @@
+/**
+ * @file
+ * @brief Definition of a lazy-sorted map storing keys and values separately.
+ *
+ * This file contains the definition of <tt>coveo::lazy::soa_map</tt>, a
+ * lazy-sorted map-like container that stores its keys and mapped values in
+ * two parallel arrays ("structure of arrays") instead of a single array
+ * of pairs. Lookups and sorting only touch keys, which makes this container
+ * more cache-friendly than <tt>coveo::lazy::map</tt> when mapped values
+ * are large.
+ *
+ * @copyright 2015-2016, Coveo Solutions Inc.
+ *            Distributed under the Apache License, Version 2.0 (see <a href="https://github.com/coveo/lazy/blob/master/LICENSE">LICENSE</a>).
+ */
+
+#ifndef COVEO_LAZY_SOA_MAP_H
+#define COVEO_LAZY_SOA_MAP_H
+
+#include <coveo/lazy/detail/branchless_search.h>
+#include <coveo/lazy/detail/radix_sort.h>
+#include <coveo/lazy/exception.h>
+#include <coveo/lazy/sort_policy.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace coveo {
+namespace lazy {
+namespace detail {
+
+/**
+ * @internal
+ * @brief Predicate that projects a key unmodified.
+ * @headerfile soa_map.h <coveo/lazy/soa_map.h>
+ *
+ * Used as "value to key" predicate when searching the key array
+ * of a <tt>coveo::lazy::soa_map</tt>.
+ */
+struct soa_key_identity {
+    template<class K>
+    const K& operator()(const K& key) const {
+        return key;
+    }
+};
+
+/**
+ * @internal
+ * @brief Value predicate used to search the key array of a <tt>coveo::lazy::soa_map</tt>.
+ * @headerfile soa_map.h <coveo/lazy/soa_map.h>
+ *
+ * Wraps a key predicate and gives access to it like <tt>lazy_value_pred_proxy</tt>
+ * does, so that search helpers can detect keys suitable for branchless search.
+ *
+ * @tparam KCmp Predicate used to compare keys.
+ */
+template<class KCmp>
+class soa_key_pred
+{
+    KCmp kcmp_;
+public:
+    explicit soa_key_pred(const KCmp& kcmp) : kcmp_(kcmp) { }
+
+    soa_key_identity value_to_key() const {
+        return soa_key_identity();
+    }
+
+    KCmp key_predicate() const {
+        return kcmp_;
+    }
+
+    template<class L, class R>
+    bool operator()(const L& left, const R& right) const {
+        return kcmp_(left, right);
+    }
+};
+
+/**
+ * @internal
+ * @brief Helper to return a proxy from an iterator's <tt>operator-></tt>.
+ * @headerfile soa_map.h <coveo/lazy/soa_map.h>
+ *
+ * Stores the pair of references returned by dereferencing a
+ * <tt>soa_map_iterator</tt> so that its address can be returned.
+ *
+ * @tparam Ref Type of reference to store.
+ */
+template<class Ref>
+class soa_arrow_proxy
+{
+    Ref ref_;
+public:
+    explicit soa_arrow_proxy(Ref ref) : ref_(ref) { }
+
+    const Ref* operator->() const {
+        return std::addressof(ref_);
+    }
+};
+
+/**
+ * @internal
+ * @brief Iterator for <tt>coveo::lazy::soa_map</tt>.
+ * @headerfile soa_map.h <coveo/lazy/soa_map.h>
+ *
+ * Random-access iterator that refers to an element in a <tt>coveo::lazy::soa_map</tt>
+ * by its position. Dereferencing it returns a pair of references to the key and
+ * mapped value (<tt>std::pair<const K&, T&></tt>) instead of a reference to a pair.
+ *
+ * @tparam K Type of keys.
+ * @tparam T Type of mapped values.
+ * @tparam Const Whether iterator provides const access to mapped values.
+ */
+template<class K, class T, bool Const>
+class soa_map_iterator
+{
+    template<class, class, bool> friend class soa_map_iterator;
+
+    using mapped_ptr = std::conditional_t<Const, const T*, T*>;
+
+    const K* keys_ = nullptr;       // Beginning of key array.
+    mapped_ptr values_ = nullptr; // Beginning of mapped value array.
+    std::ptrdiff_t pos_ = 0;        // Position of element in arrays.
+
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type        = std::pair<const K, T>;
+    using difference_type   = std::ptrdiff_t;
+    using reference         = std::pair<const K&, std::conditional_t<Const, const T&, T&>>;
+    using pointer           = soa_arrow_proxy<reference>;
+
+    soa_map_iterator() = default;
+    soa_map_iterator(const K* keys, mapped_ptr values, std::ptrdiff_t pos)
+        : keys_(keys), values_(values), pos_(pos) { }
+
+    // Non-const iterators can be converted to const ones.
+    template<bool OConst, class = std::enable_if_t<Const && !OConst, void>>
+    soa_map_iterator(const soa_map_iterator<K, T, OConst>& obj)
+        : keys_(obj.keys_), values_(obj.values_), pos_(obj.pos_) { }
+
+    // Position of referred-to element in the container.
+    std::size_t position() const {
+        return static_cast<std::size_t>(pos_);
+    }
+
+    reference operator*() const {
+        return reference(keys_[pos_], values_[pos_]);
+    }
+    pointer operator->() const {
+        return pointer(**this);
+    }
+    reference operator[](difference_type n) const {
+        return *(*this + n);
+    }
+
+    soa_map_iterator& operator++() { ++pos_; return *this; }
+    soa_map_iterator operator++(int) { auto it = *this; ++pos_; return it; }
+    soa_map_iterator& operator--() { --pos_; return *this; }
+    soa_map_iterator operator--(int) { auto it = *this; --pos_; return it; }
+    soa_map_iterator& operator+=(difference_type n) { pos_ += n; return *this; }
+    soa_map_iterator& operator-=(difference_type n) { pos_ -= n; return *this; }
+
+    friend soa_map_iterator operator+(soa_map_iterator it, difference_type n) { return it += n; }
+    friend soa_map_iterator operator+(difference_type n, soa_map_iterator it) { return it += n; }
+    friend soa_map_iterator operator-(soa_map_iterator it, difference_type n) { return it -= n; }
+    friend difference_type operator-(const soa_map_iterator& left, const soa_map_iterator& right) {
+        return left.pos_ - right.pos_;
+    }
+
+    friend bool operator==(const soa_map_iterator& left, const soa_map_iterator& right) {
+        return left.keys_ == right.keys_ && left.pos_ == right.pos_;
+    }
+    friend bool operator!=(const soa_map_iterator& left, const soa_map_iterator& right) {
+        return !(left == right);
+    }
+    friend bool operator<(const soa_map_iterator& left, const soa_map_iterator& right) {
+        return left.pos_ < right.pos_;
+    }
+    friend bool operator<=(const soa_map_iterator& left, const soa_map_iterator& right) {
+        return left.pos_ <= right.pos_;
+    }
+    friend bool operator>(const soa_map_iterator& left, const soa_map_iterator& right) {
+        return left.pos_ > right.pos_;
+    }
+    friend bool operator>=(const soa_map_iterator& left, const soa_map_iterator& right) {
+        return left.pos_ >= right.pos_;
+    }
+};
+
+/**
+ * @internal
+ * @brief Sorts keys and returns their original positions.
+ * @headerfile soa_map.h <coveo/lazy/soa_map.h>
+ *
+ * Sorts the keys in place and returns, for each sorted key, its position
+ * before sorting. Equivalent keys keep their relative order. Keys are moved
+ * next to their positions while sorting so that comparisons do not need
+ * to follow an indirection. Arithmetic keys compared with <tt>std::less</tt>
+ * or <tt>std::greater</tt> are radix-sorted, like <tt>coveo::lazy::default_sort_policy</tt> does.
+ * Temporary buffers, as well as the returned positions, are allocated with
+ * the keys' allocator (rebound as needed).
+ */
+template<class K, class KAlloc, class KCmp>
+scratch_vector<std::size_t, KAlloc> soa_sort_keys(std::vector<K, KAlloc>& keys, const KCmp& kcmp, std::false_type)
+{
+    using indexed_key = std::pair<K, std::size_t>;
+
+    const KAlloc alloc = keys.get_allocator();
+    scratch_vector<indexed_key, KAlloc> items(alloc);
+    items.reserve(keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        items.emplace_back(std::move(keys[i]), i);
+    }
+    allocator_stable_sort(items.begin(), items.end(), [&kcmp](const indexed_key& left, const indexed_key& right) {
+        return kcmp(left.first, right.first);
+    }, alloc);
+
+    scratch_vector<std::size_t, KAlloc> order(alloc);
+    order.reserve(items.size());
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        keys[i] = std::move(items[i].first);
+        order.push_back(items[i].second);
+    }
+    return order;
+}
+template<class K, class KAlloc, class KCmp>
+scratch_vector<std::size_t, KAlloc> soa_sort_keys(std::vector<K, KAlloc>& keys, const KCmp& kcmp, std::true_type)
+{
+    if (keys.size() < radix_sort_min_size) {
+        return soa_sort_keys(keys, kcmp, std::false_type());
+    }
+    using converter = radix_key_converter<K>;
+    using ukey_type = typename converter::type;
+    using indexed_key = std::pair<ukey_type, std::size_t>;
+
+    const bool descending = radix_key_order<KCmp, K>::descending;
+    const KAlloc alloc = keys.get_allocator();
+    scratch_vector<indexed_key, KAlloc> items(alloc);
+    items.reserve(keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        ukey_type ukey = converter()(keys[i]);
+        items.emplace_back(descending ? static_cast<ukey_type>(~ukey) : ukey, i);
+    }
+    lsd_radix_sort(items, [](const indexed_key& item) { return item.first; });
+
+    std::vector<K, KAlloc> sorted_keys(alloc);
+    scratch_vector<std::size_t, KAlloc> order(alloc);
+    sorted_keys.reserve(items.size());
+    order.reserve(items.size());
+    for (const auto& item : items) {
+        sorted_keys.push_back(keys[item.second]);
+        order.push_back(item.second);
+    }
+    keys.swap(sorted_keys);
+    return order;
+}
+
+} // detail
+
+/**
+ * @brief Map container that performs lazy sorting and stores keys and values separately.
+ * @headerfile soa_map.h <coveo/lazy/soa_map.h>
+ *
+ * <tt>std::map</tt>-like container class that stores its keys and mapped values in
+ * two parallel <tt>std::vector</tt>s and sorts them only when needed. Sorting can
+ * also be triggered on-demand.
+ *
+ * Compared to <tt>coveo::lazy::map</tt>, which stores pairs, lookups only touch
+ * the key array, so large mapped values do not pollute the cache. Sorting only
+ * moves keys and their original positions (using a radix sort for arithmetic
+ * keys), then moves each mapped value exactly once.
+ *
+ * This class has the following differences compared to <tt>coveo::lazy::map</tt>:
+ *
+ * - Since no pair is actually stored, iterators return a pair of references
+ *   (<tt>std::pair<const K&, T&></tt>) by value instead of a reference to a
+ *   <tt>value_type</tt>. <tt>operator-></tt> is supported through a proxy.
+ * - Only the internal storage of @c std::vector is supported.
+ * - Inserting an existing key does not check for it until the container is
+ *   sorted; as with <tt>coveo::lazy::map</tt>, the first key inserted wins.
+ *
+ * Like other lazy-sorted containers, this class is not thread-safe, even for
+ * read access. See <tt>coveo::lazy::detail::lazy_sorted_container</tt> for details.
+ *
+ * @tparam K Type of keys used to sort elements in the map.
+ * @tparam T Type of values bound to each key.
+ * @tparam _Cmp Predicate used to compare keys. Defaults to <tt>std::less<K></tt>.
+ * @tparam _KAlloc Allocator used for the key array. Defaults to <tt>std::allocator<K></tt>.
+ * @tparam _TAlloc Allocator used for the mapped value array. Defaults to <tt>std::allocator<T></tt>.
+ */
+template<class K,
+         class T,
+         class _Cmp = std::less<K>,
+         class _KAlloc = std::allocator<K>,
+         class _TAlloc = std::allocator<T>>
+class soa_map
+{
+public:
+    using key_type                  = K;
+    using mapped_type               = T;
+    using value_type                = std::pair<const K, T>;
+    using size_type                 = std::size_t;
+    using difference_type           = std::ptrdiff_t;
+    using key_compare               = _Cmp;
+    using key_container_type        = std::vector<K, _KAlloc>;
+    using mapped_container_type     = std::vector<T, _TAlloc>;
+    using iterator                  = detail::soa_map_iterator<K, T, false>;
+    using const_iterator            = detail::soa_map_iterator<K, T, true>;
+    using reference                 = typename iterator::reference;
+    using const_reference           = typename const_iterator::reference;
+    using reverse_iterator          = std::reverse_iterator<iterator>;
+    using const_reverse_iterator    = std::reverse_iterator<const_iterator>;
+
+private:
+    mutable key_container_type keys_;       // Keys, sorted or not.
+    mutable mapped_container_type values_;  // Mapped values, at the same positions as their keys.
+    mutable bool sorted_ = true;            // Whether keys are sorted and without duplicates.
+    key_compare kcmp_;                      // Predicate used to compare keys.
+
+public:
+    /**
+     * @brief Default constructor.
+     *
+     * Creates an empty map.
+     */
+    soa_map() = default;
+
+    /**
+     * @brief Constructor with predicate.
+     *
+     * Creates an empty map using the given predicate to compare keys.
+     *
+     * @param kcmp Predicate used to compare keys.
+     */
+    explicit soa_map(const key_compare& kcmp)
+        : kcmp_(kcmp) { }
+
+    /**
+     * @brief Constructor with range.
+     *
+     * Creates a map with a copy of the elements in the given range.
+     *
+     * @param first Beginning of range of elements to copy.
+     * @param last End of range of elements to copy.
+     * @param kcmp Predicate used to compare keys.
+     */
+    template<class It>
+    soa_map(It first, It last, const key_compare& kcmp = key_compare())
+        : kcmp_(kcmp)
+    {
+        insert(first, last);
+    }
+
+    /**
+     * @brief Constructor with initializer list.
+     *
+     * Creates a map with a copy of the elements in the given initializer list.
+     *
+     * @param init Initializer list of elements to copy.
+     * @param kcmp Predicate used to compare keys.
+     */
+    soa_map(std::initializer_list<value_type> init, const key_compare& kcmp = key_compare())
+        : soa_map(std::begin(init), std::end(init), kcmp) { }
+
+    /**
+     * @brief Replaces content with initializer list.
+     *
+     * @param init Initializer list of elements to copy.
+     * @return Reference to @c this map.
+     */
+    soa_map& operator=(std::initializer_list<value_type> init) {
+        clear();
+        insert(init);
+        return *this;
+    }
+
+    /**
+     * @brief Iterator to beginning of map. Sorts the map if needed.
+     */
+    iterator begin() {
+        sort_if_needed();
+        return iterator(keys_.data(), values_.data(), 0);
+    }
+    /// @copydoc begin()
+    const_iterator begin() const {
+        return cbegin();
+    }
+    /// @copydoc begin()
+    const_iterator cbegin() const {
+        sort_if_needed();
+        return const_iterator(keys_.data(), values_.data(), 0);
+    }
+
+    /**
+     * @brief Iterator to end of map. Sorts the map if needed.
+     */
+    iterator end() {
+        sort_if_needed();
+        return iterator(keys_.data(), values_.data(), static_cast<difference_type>(keys_.size()));
+    }
+    /// @copydoc end()
+    const_iterator end() const {
+        return cend();
+    }
+    /// @copydoc end()
+    const_iterator cend() const {
+        sort_if_needed();
+        return const_iterator(keys_.data(), values_.data(), static_cast<difference_type>(keys_.size()));
+    }
+
+    /**
+     * @brief Reverse iterator to end of map. Sorts the map if needed.
+     */
+    reverse_iterator rbegin() {
+        return reverse_iterator(end());
+    }
+    /// @copydoc rbegin()
+    const_reverse_iterator rbegin() const {
+        return crbegin();
+    }
+    /// @copydoc rbegin()
+    const_reverse_iterator crbegin() const {
+        return const_reverse_iterator(cend());
+    }
+
+    /**
+     * @brief Reverse iterator to beginning of map. Sorts the map if needed.
+     */
+    reverse_iterator rend() {
+        return reverse_iterator(begin());
+    }
+    /// @copydoc rend()
+    const_reverse_iterator rend() const {
+        return crend();
+    }
+    /// @copydoc rend()
+    const_reverse_iterator crend() const {
+        return const_reverse_iterator(cbegin());
+    }
+
+    /**
+     * @brief Checks if map is empty.
+     *
+     * @remark Does not sort the map.
+     */
+    bool empty() const {
+        return keys_.empty();
+    }
+
+    /**
+     * @brief Number of elements in map. Sorts the map if needed
+     *        to remove duplicate keys.
+     */
+    size_type size() const {
+        sort_if_needed();
+        return keys_.size();
+    }
+
+    /**
+     * @brief Reserves space for elements.
+     *
+     * @param new_cap Number of elements to reserve space for.
+     */
+    void reserve(size_type new_cap) {
+        keys_.reserve(new_cap);
+        values_.reserve(new_cap);
+    }
+
+    /**
+     * @brief Capacity of map.
+     */
+    size_type capacity() const {
+        return std::min(keys_.capacity(), values_.capacity());
+    }
+
+    /**
+     * @brief Shrinks internal arrays to fit elements. Sorts the map if needed.
+     */
+    void shrink_to_fit() {
+        sort_if_needed();
+        keys_.shrink_to_fit();
+        values_.shrink_to_fit();
+    }
+
+    /**
+     * @brief Inserts an element in the map.
+     *
+     * If the key already exists, insertion will be ignored when the map is sorted.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param value Element to insert.
+     * @remark In order to support lazy sorting, this method returns @c void.
+     */
+    void insert(const value_type& value) {
+        emplace(value.first, value.second);
+    }
+    /// @copydoc insert(const value_type&)
+    template<class P, class = std::enable_if_t<std::is_constructible<value_type, P&&>::value, void>>
+    void insert(P&& value) {
+        value_type val(std::forward<P>(value));
+        emplace(std::move(const_cast<K&>(val.first)), std::move(val.second));
+    }
+
+    /**
+     * @brief Inserts elements in the map.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param first Beginning of range of elements to insert.
+     * @param last End of range of elements to insert.
+     */
+    template<class It>
+    void insert(It first, It last) {
+        for (; first != last; ++first) {
+            insert(*first);
+        }
+    }
+    /// @copydoc insert(It, It)
+    void insert(std::initializer_list<value_type> init) {
+        insert(std::begin(init), std::end(init));
+    }
+
+    /**
+     * @brief Inserts an element in the map by constructing it in-place.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param key Key of element to insert.
+     * @param args Arguments used to construct mapped value.
+     * @remark In order to support lazy sorting, this method returns @c void.
+     */
+    template<class OK, class... Args>
+    void emplace(OK&& key, Args&&... args) {
+        keys_.emplace_back(std::forward<OK>(key));
+        try {
+            values_.emplace_back(std::forward<Args>(args)...);
+        } catch (...) {
+            keys_.pop_back();
+            throw;
+        }
+        if (sorted_ && keys_.size() > 1) {
+            sorted_ = kcmp_(keys_[keys_.size() - 2], keys_.back());
+        }
+    }
+
+    /**
+     * @brief Removes an element from the map.
+     *
+     * @note Invalidates all iterators and references at or after @c pos.
+     *
+     * @param pos Iterator pointing to element to remove.
+     * @return Iterator pointing to element after the one removed.
+     */
+    iterator erase(const_iterator pos) {
+        const auto offset = static_cast<difference_type>(pos.position());
+        keys_.erase(std::next(keys_.cbegin(), offset));
+        values_.erase(std::next(values_.cbegin(), offset));
+        return iterator(keys_.data(), values_.data(), offset);
+    }
+
+    /**
+     * @brief Removes a range of elements from the map.
+     *
+     * @note Invalidates all iterators and references at or after @c first.
+     *
+     * @param first Beginning of range of elements to remove.
+     * @param last End of range of elements to remove.
+     * @return Iterator pointing to element after the last one removed.
+     */
+    iterator erase(const_iterator first, const_iterator last) {
+        const auto offset_first = static_cast<difference_type>(first.position());
+        const auto offset_last = static_cast<difference_type>(last.position());
+        keys_.erase(std::next(keys_.cbegin(), offset_first), std::next(keys_.cbegin(), offset_last));
+        values_.erase(std::next(values_.cbegin(), offset_first), std::next(values_.cbegin(), offset_last));
+        return iterator(keys_.data(), values_.data(), offset_first);
+    }
+
+    /**
+     * @brief Removes an element from the map by key. Sorts the map if needed.
+     *
+     * @param key Key of element to remove.
+     * @return Number of elements removed (0 or 1).
+     */
+    size_type erase(const key_type& key) {
+        auto it = find(key);
+        if (it == end()) {
+            return 0;
+        }
+        erase(it);
+        return 1;
+    }
+
+    /**
+     * @brief Removes all elements from the map.
+     */
+    void clear() {
+        keys_.clear();
+        values_.clear();
+        sorted_ = true;
+    }
+
+    /**
+     * @brief Swaps the content of two maps.
+     *
+     * @param right Other map to swap with.
+     */
+    void swap(soa_map& right) {
+        using std::swap;
+        swap(keys_, right.keys_);
+        swap(values_, right.values_);
+        swap(sorted_, right.sorted_);
+        swap(kcmp_, right.kcmp_);
+    }
+    /// @copydoc swap()
+    friend void swap(soa_map& left, soa_map& right) {
+        left.swap(right);
+    }
+
+    /**
+     * @brief Returns a reference to the value mapped to a key, inserting a
+     *        default-constructed value if it does not exist. Sorts the map if needed.
+     *
+     * If the key does not exist, it is inserted at its sorted position.
+     *
+     * @note Invalidates all iterators and references if the key is inserted.
+     *
+     * @param key Key to look for.
+     * @return Reference to mapped value.
+     */
+    mapped_type& operator[](const key_type& key) {
+        return operator_brackets_impl(key);
+    }
+    /// @copydoc operator[](const key_type&)
+    mapped_type& operator[](key_type&& key) {
+        return operator_brackets_impl(std::move(key));
+    }
+
+    /**
+     * @brief Returns a reference to the value mapped to a key. Sorts the map if needed.
+     *
+     * @param key Key to look for.
+     * @return Reference to mapped value.
+     * @throw coveo::lazy::out_of_range No element exists with the given key.
+     */
+    mapped_type& at(const key_type& key) {
+        return const_cast<mapped_type&>(static_cast<const soa_map&>(*this).at(key));
+    }
+    /// @copydoc at()
+    const mapped_type& at(const key_type& key) const {
+        const size_type pos = find_pos(key);
+        if (pos == keys_.size()) {
+            throw coveo::lazy::out_of_range("out_of_range");
+        }
+        return values_[pos];
+    }
+
+    /**
+     * @brief Returns the number of elements with a given key. Sorts the map if needed.
+     *
+     * @param key Key to look for.
+     * @return Number of elements with key @c key (0 or 1).
+     */
+    size_type count(const key_type& key) const {
+        return find_pos(key) != keys_.size() ? 1 : 0;
+    }
+
+    /**
+     * @brief Looks for an element by key. Sorts the map if needed.
+     *
+     * Only the key array is searched.
+     *
+     * @param key Key to look for.
+     * @return Iterator pointing to element, or <tt>end()</tt> if not found.
+     */
+    iterator find(const key_type& key) {
+        const size_type pos = find_pos(key);
+        return iterator(keys_.data(), values_.data(), static_cast<difference_type>(pos));
+    }
+    /// @copydoc find()
+    const_iterator find(const key_type& key) const {
+        const size_type pos = find_pos(key);
+        return const_iterator(keys_.data(), values_.data(), static_cast<difference_type>(pos));
+    }
+
+    /**
+     * @brief Returns an iterator to the first element whose key is not less than a key.
+     *        Sorts the map if needed.
+     *
+     * @param key Key to look for.
+     * @return Iterator to lower bound of @c key.
+     */
+    iterator lower_bound(const key_type& key) {
+        return std::next(begin(), static_cast<difference_type>(lower_bound_pos(key)));
+    }
+    /// @copydoc lower_bound()
+    const_iterator lower_bound(const key_type& key) const {
+        return std::next(cbegin(), static_cast<difference_type>(lower_bound_pos(key)));
+    }
+
+    /**
+     * @brief Returns an iterator to the first element whose key is greater than a key.
+     *        Sorts the map if needed.
+     *
+     * @param key Key to look for.
+     * @return Iterator to upper bound of @c key.
+     */
+    iterator upper_bound(const key_type& key) {
+        return std::next(begin(), static_cast<difference_type>(upper_bound_pos(key)));
+    }
+    /// @copydoc upper_bound()
+    const_iterator upper_bound(const key_type& key) const {
+        return std::next(cbegin(), static_cast<difference_type>(upper_bound_pos(key)));
+    }
+
+    /**
+     * @brief Returns the range of elements with a given key. Sorts the map if needed.
+     *
+     * @param key Key to look for.
+     * @return Pair of iterators to lower and upper bound of @c key.
+     */
+    std::pair<iterator, iterator> equal_range(const key_type& key) {
+        return std::make_pair(lower_bound(key), upper_bound(key));
+    }
+    /// @copydoc equal_range()
+    std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const {
+        return std::make_pair(lower_bound(key), upper_bound(key));
+    }
+
+    /**
+     * @brief Sorted array of keys. Sorts the map if needed.
+     *
+     * Keys are at the same positions as their mapped values in <tt>values()</tt>.
+     */
+    const key_container_type& keys() const {
+        sort_if_needed();
+        return keys_;
+    }
+
+    /**
+     * @brief Array of mapped values, in key order. Sorts the map if needed.
+     *
+     * Values are at the same positions as their keys in <tt>keys()</tt>.
+     */
+    const mapped_container_type& values() const {
+        sort_if_needed();
+        return values_;
+    }
+
+    /**
+     * @brief Predicate used to compare keys.
+     */
+    key_compare key_comp() const {
+        return kcmp_;
+    }
+
+    /**
+     * @brief Sorts the map if needed.
+     *
+     * Sorts the map and removes duplicate keys, keeping the first one inserted.
+     * Normally, this is performed automatically when needed, but it can
+     * be called explicitly.
+     */
+    void sort() const {
+        sort_if_needed();
+    }
+
+    /**
+     * @brief Checks if the map is sorted.
+     */
+    bool sorted() const {
+        return sorted_;
+    }
+
+    /**
+     * @brief Equality operator.
+     *
+     * Compares two maps element-wise. Both maps are sorted if needed.
+     */
+    friend bool operator==(const soa_map& left, const soa_map& right) {
+        return left.keys() == right.keys() && left.values() == right.values();
+    }
+    /// @copydoc operator==()
+    friend bool operator!=(const soa_map& left, const soa_map& right) {
+        return !(left == right);
+    }
+
+private:
+    // Whether keys can be sorted with a radix sort.
+    using use_radix_sort = std::integral_constant<bool, detail::radix_key_converter<K>::value &&
+                                                        detail::radix_key_order<key_compare, K>::value>;
+
+    // Sorts the map if it is not already sorted.
+    void sort_if_needed() const {
+        if (!sorted_) {
+            internal_sort();
+        }
+    }
+
+    // Sorts keys, removes duplicates, then moves mapped values to the positions of their keys.
+    void internal_sort() const {
+        auto order = detail::soa_sort_keys(keys_, kcmp_, use_radix_sort());
+        // Equivalent keys are in insertion order; keep only the first one.
+        size_type num_unique = 0;
+        for (size_type i = 0; i < keys_.size(); ++i) {
+            if (num_unique == 0 || kcmp_(keys_[num_unique - 1], keys_[i])) {
+                if (num_unique != i) {
+                    keys_[num_unique] = std::move(keys_[i]);
+                    order[num_unique] = order[i];
+                }
+                ++num_unique;
+            }
+        }
+        keys_.erase(std::next(keys_.begin(), static_cast<difference_type>(num_unique)), keys_.end());
+        order.resize(num_unique);
+        mapped_container_type values(values_.get_allocator());
+        values.reserve(order.size());
+        for (size_type pos : order) {
+            values.push_back(std::move(values_[pos]));
+        }
+        values_.swap(values);
+        sorted_ = true;
+    }
+
+    // Positions of bounds of a key in the (sorted) key array.
+    size_type lower_bound_pos(const key_type& key) const {
+        sort_if_needed();
+        return detail::lower_bound_position(keys_.cbegin(), keys_.cend(), key, detail::soa_key_pred<key_compare>(kcmp_));
+    }
+    size_type upper_bound_pos(const key_type& key) const {
+        sort_if_needed();
+        return detail::upper_bound_position(keys_.cbegin(), keys_.cend(), key, detail::soa_key_pred<key_compare>(kcmp_));
+    }
+
+    // Position of a key in the (sorted) key array, or size if not found.
+    size_type find_pos(const key_type& key) const {
+        const size_type pos = lower_bound_pos(key);
+        return pos != keys_.size() && !kcmp_(key, keys_[pos]) ? pos : keys_.size();
+    }
+
+    // Implementation of operator[].
+    template<class OK>
+    mapped_type& operator_brackets_impl(OK&& key) {
+        const size_type pos = lower_bound_pos(key);
+        if (pos == keys_.size() || kcmp_(key, keys_[pos])) {
+            const auto offset = static_cast<difference_type>(pos);
+            keys_.insert(std::next(keys_.cbegin(), offset), std::forward<OK>(key));
+            try {
+                values_.emplace(std::next(values_.cbegin(), offset));
+            } catch (...) {
+                keys_.erase(std::next(keys_.cbegin(), offset));
+                throw;
+            }
+        }
+        return values_[pos];
+    }
+};
+
+} // lazy
+} // coveo
+
+#endif // COVEO_LAZY_SOA_MAP_H
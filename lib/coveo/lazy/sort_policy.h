@@ -0,0 +1,730 @@
+/**
+ * @file
+ * @brief Sort policies used by lazy-sorted associative containers.
+ *
+ * This file contains the sort policies that can be used to customize
+ * how lazy-sorted containers sort their elements. A sort policy is
+ * specified through the @c _Sort template parameter of containers like
+ * <tt>coveo::lazy::set</tt> or <tt>coveo::lazy::map</tt>:
+ *
+ * @code
+ *   // Sort using multiple threads if the map has enough elements
+ *   coveo::lazy::map<int, std::string, std::less<int>, std::vector,
+ *                    coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>>,
+ *                    coveo::lazy::map_allocator<int, std::string>,
+ *                    coveo::lazy::parallel_sort_policy<>> m;
+ * @endcode
+ *
+ * A sort policy must be a default-constructible type with the following methods:
+ *
+ * - <tt>void sort(RandIt first, RandIt last, Cmp cmp) const</tt>:
+ *   sorts <tt>[first, last[</tt>, like <tt>std::sort</tt>
+ * - <tt>void stable_sort(RandIt first, RandIt last, Cmp cmp) const</tt>:
+ *   sorts <tt>[first, last[</tt> while preserving order of equivalent elements,
+ *   like <tt>std::stable_sort</tt>
+ * - <tt>RandIt unique(RandIt first, RandIt last, Eq eq) const</tt>:
+ *   removes consecutive duplicates in <tt>[first, last[</tt>, like <tt>std::unique</tt>
+ *
+ * @c sort and @c stable_sort can also accept the container's allocator as a
+ * fourth argument; if they do, containers pass it so that temporary buffers
+ * can be allocated with it (rebound with <tt>std::allocator_traits</tt>). This
+ * way, a container using <tt>std::pmr::polymorphic_allocator</tt> does not
+ * allocate global memory when sorting. @c default_sort_policy and
+ * @c indirect_sort_policy support this.
+ *
+ * @copyright 2015-2016, Coveo Solutions Inc.
+ *            Distributed under the Apache License, Version 2.0 (see <a href="https://github.com/coveo/lazy/blob/master/LICENSE">LICENSE</a>).
+ */
+
+#ifndef COVEO_LAZY_SORT_POLICY_H
+#define COVEO_LAZY_SORT_POLICY_H
+
+#include <coveo/lazy/detail/radix_sort.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace coveo {
+namespace lazy {
+namespace detail {
+
+/**
+ * @internal
+ * @brief Runs tasks in parallel.
+ * @headerfile sort_policy.h <coveo/lazy/sort_policy.h>
+ *
+ * Calls @c task with each index in <tt>[0, count[</tt>, each call on its own thread.
+ * The last task is executed on the calling thread. Waits for all tasks to
+ * complete before returning. If a task throws an exception, it is rethrown
+ * once all threads have been joined.
+ *
+ * @param count Number of tasks to run.
+ * @param task Task to run; called with the index of the task.
+ */
+template<class F>
+void run_parallel_tasks(std::size_t count, const F& task)
+{
+    std::vector<std::exception_ptr> errors(count);
+    auto run_task = [&](std::size_t i) {
+        try {
+            task(i);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(count);
+    for (std::size_t i = 0; i + 1 < count; ++i) {
+        threads.emplace_back(run_task, i);
+    }
+    if (count != 0) {
+        run_task(count - 1);
+    }
+    for (auto&& thread : threads) {
+        thread.join();
+    }
+    for (auto&& error : errors) {
+        if (error != nullptr) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+/**
+ * @internal
+ * @brief Trait to detect the standard allocator.
+ * @headerfile sort_policy.h <coveo/lazy/sort_policy.h>
+ *
+ * Has a @c value member set to @c true if @c Alloc is an instance of
+ * <tt>std::allocator</tt>. Algorithms like <tt>std::stable_sort</tt> already
+ * allocate their temporary buffers from the same global memory, so they can
+ * be used directly for such allocators.
+ *
+ * @tparam Alloc Allocator type.
+ */
+template<class Alloc>
+struct is_std_allocator
+    : std::is_same<typename std::allocator_traits<Alloc>::template rebind_alloc<char>, std::allocator<char>> { };
+
+/**
+ * @internal
+ * @brief Merges two consecutive sorted ranges using a buffer.
+ * @headerfile sort_policy.h <coveo/lazy/sort_policy.h>
+ *
+ * Like <tt>std::inplace_merge</tt>, but the smaller of the two ranges is moved
+ * to @c buffer instead of a temporary buffer allocated with <tt>operator new</tt>.
+ * Elements that are already in place are skipped. Merging is stable.
+ *
+ * @param first Beginning of first sorted range.
+ * @param mid End of first sorted range and beginning of second one.
+ * @param last End of second sorted range.
+ * @param cmp Predicate used to compare elements.
+ * @param buffer Vector of elements used as a buffer. Its capacity is reused.
+ */
+template<class RandIt, class Cmp, class Buffer>
+void merge_with_buffer(RandIt first, RandIt mid, RandIt last, const Cmp& cmp, Buffer& buffer)
+{
+    if (first == mid || mid == last) {
+        return;
+    }
+    first = std::upper_bound(first, mid, *mid, cmp);
+    last = std::lower_bound(mid, last, *std::prev(mid), cmp);
+    if (first == mid || mid == last) {
+        return;
+    }
+
+    buffer.clear();
+    if (std::distance(first, mid) <= std::distance(mid, last)) {
+        // Move first range aside, then merge from the front.
+        buffer.reserve(static_cast<std::size_t>(std::distance(first, mid)));
+        std::move(first, mid, std::back_inserter(buffer));
+        auto bit = buffer.begin(), bend = buffer.end();
+        auto out = first, right = mid;
+        while (bit != bend && right != last) {
+            if (cmp(*right, *bit)) {
+                *out++ = std::move(*right++);
+            } else {
+                *out++ = std::move(*bit++);
+            }
+        }
+        std::move(bit, bend, out);
+    } else {
+        // Move second range aside, then merge from the back.
+        buffer.reserve(static_cast<std::size_t>(std::distance(mid, last)));
+        std::move(mid, last, std::back_inserter(buffer));
+        auto bbegin = buffer.begin(), bit = buffer.end();
+        auto out = last, left = mid;
+        while (bit != bbegin && left != first) {
+            if (cmp(*std::prev(bit), *std::prev(left))) {
+                *--out = std::move(*--left);
+            } else {
+                *--out = std::move(*--bit);
+            }
+        }
+        std::move_backward(bbegin, bit, out);
+    }
+    buffer.clear();
+}
+
+/**
+ * @internal
+ * @brief Version of <tt>std::inplace_merge</tt> using an allocator.
+ * @headerfile sort_policy.h <coveo/lazy/sort_policy.h>
+ *
+ * Merges two consecutive sorted ranges. The temporary buffer is allocated
+ * using @c alloc, unless it is a <tt>std::allocator</tt>, in which case
+ * <tt>std::inplace_merge</tt> is used. Merging is stable.
+ *
+ * @param first Beginning of first sorted range.
+ * @param mid End of first sorted range and beginning of second one.
+ * @param last End of second sorted range.
+ * @param cmp Predicate used to compare elements.
+ * @param alloc Allocator used for the temporary buffer (rebound as needed).
+ */
+template<class RandIt, class Cmp, class Alloc>
+void allocator_inplace_merge(RandIt first, RandIt mid, RandIt last, const Cmp& cmp, const Alloc& alloc)
+{
+    if (is_std_allocator<Alloc>::value) {
+        std::inplace_merge(first, mid, last, cmp);
+    } else {
+        scratch_vector<typename std::iterator_traits<RandIt>::value_type, Alloc> buffer(alloc);
+        merge_with_buffer(first, mid, last, cmp, buffer);
+    }
+}
+
+/**
+ * @internal
+ * @brief Version of <tt>std::stable_sort</tt> using an allocator.
+ * @headerfile sort_policy.h <coveo/lazy/sort_policy.h>
+ *
+ * Sorts a range while preserving the order of equivalent elements. If @c alloc
+ * is a <tt>std::allocator</tt>, <tt>std::stable_sort</tt> is used. Otherwise,
+ * small runs are sorted using insertion sort, then merged using a single
+ * temporary buffer allocated with @c alloc.
+ *
+ * @param first Beginning of range to sort.
+ * @param last End of range to sort.
+ * @param cmp Predicate used to compare elements.
+ * @param alloc Allocator used for the temporary buffer (rebound as needed).
+ */
+template<class RandIt, class Cmp, class Alloc>
+void allocator_stable_sort(RandIt first, RandIt last, const Cmp& cmp, const Alloc& alloc)
+{
+    using element_type = typename std::iterator_traits<RandIt>::value_type;
+
+    if (is_std_allocator<Alloc>::value) {
+        std::stable_sort(first, last, cmp);
+        return;
+    }
+
+    const std::size_t run_size = 32;
+    const auto size = static_cast<std::size_t>(std::distance(first, last));
+    for (std::size_t lo = 0; lo < size; lo += run_size) {
+        const auto run_first = std::next(first, lo);
+        const auto run_last = std::next(first, std::min(lo + run_size, size));
+        for (auto it = run_first; it != run_last; ++it) {
+            if (it != run_first && cmp(*it, *std::prev(it))) {
+                element_type tmp(std::move(*it));
+                auto hole = it;
+                do {
+                    *hole = std::move(*std::prev(hole));
+                    --hole;
+                } while (hole != run_first && cmp(tmp, *std::prev(hole)));
+                *hole = std::move(tmp);
+            }
+        }
+    }
+    scratch_vector<element_type, Alloc> buffer(alloc);
+    for (std::size_t width = run_size; width < size; width *= 2) {
+        for (std::size_t lo = 0; lo + width < size; lo += 2 * width) {
+            merge_with_buffer(std::next(first, lo), std::next(first, lo + width),
+                              std::next(first, std::min(lo + 2 * width, size)), cmp, buffer);
+        }
+    }
+}
+
+/**
+ * @internal
+ * @brief Sorts using a sort policy, passing it an allocator if it accepts one.
+ * @headerfile sort_policy.h <coveo/lazy/sort_policy.h>
+ *
+ * Calls <tt>sorter.sort(first, last, cmp, alloc)</tt> if the sort policy
+ * supports it, otherwise <tt>sorter.sort(first, last, cmp)</tt>. Call with
+ * a last argument of @c 0 to select the proper overload.
+ */
+template<class Sorter, class RandIt, class Cmp, class Alloc>
+auto policy_sort(const Sorter& sorter, RandIt first, RandIt last, const Cmp& cmp, const Alloc& alloc, int)
+    -> decltype(sorter.sort(first, last, cmp, alloc), void())
+{
+    sorter.sort(first, last, cmp, alloc);
+}
+template<class Sorter, class RandIt, class Cmp, class Alloc>
+void policy_sort(const Sorter& sorter, RandIt first, RandIt last, const Cmp& cmp, const Alloc&, long)
+{
+    sorter.sort(first, last, cmp);
+}
+
+/**
+ * @internal
+ * @brief Stable-sorts using a sort policy, passing it an allocator if it accepts one.
+ * @headerfile sort_policy.h <coveo/lazy/sort_policy.h>
+ *
+ * Same as @c policy_sort, but for the @c stable_sort method of the policy.
+ */
+template<class Sorter, class RandIt, class Cmp, class Alloc>
+auto policy_stable_sort(const Sorter& sorter, RandIt first, RandIt last, const Cmp& cmp, const Alloc& alloc, int)
+    -> decltype(sorter.stable_sort(first, last, cmp, alloc), void())
+{
+    sorter.stable_sort(first, last, cmp, alloc);
+}
+template<class Sorter, class RandIt, class Cmp, class Alloc>
+void policy_stable_sort(const Sorter& sorter, RandIt first, RandIt last, const Cmp& cmp, const Alloc&, long)
+{
+    sorter.stable_sort(first, last, cmp);
+}
+
+/**
+ * @internal
+ * @brief Computes number of threads to use for parallel sorting.
+ * @headerfile sort_policy.h <coveo/lazy/sort_policy.h>
+ *
+ * @param size Number of elements to process.
+ * @param min_parallel_size Minimum number of elements each thread should process.
+ * @param max_threads Maximum number of threads to use, or 0 to use
+ *                    <tt>std::thread::hardware_concurrency()</tt>.
+ * @return Number of threads to use. Always at least 1.
+ */
+inline std::size_t parallel_sort_thread_count(std::size_t size,
+                                              std::size_t min_parallel_size,
+                                              std::size_t max_threads)
+{
+    if (max_threads == 0) {
+        max_threads = std::thread::hardware_concurrency();
+    }
+    std::size_t threads = min_parallel_size != 0 ? size / min_parallel_size : size;
+    return std::max<std::size_t>(std::min(threads, max_threads), 1);
+}
+
+/**
+ * @internal
+ * @brief Parallel merge-sort.
+ * @headerfile sort_policy.h <coveo/lazy/sort_policy.h>
+ *
+ * Splits <tt>[first, last[</tt> in chunks, sorts each chunk on its own thread
+ * using @c chunk_sort, then merges the chunks pairwise (also in parallel)
+ * using <tt>std::inplace_merge</tt>. Since merging is stable, the whole sort
+ * is stable if @c chunk_sort is.
+ *
+ * @param first Beginning of range to sort.
+ * @param last End of range to sort.
+ * @param cmp Predicate used to compare elements.
+ * @param threads Number of threads to use.
+ * @param chunk_sort Function used to sort each chunk.
+ */
+template<class RandIt, class Cmp, class ChunkSort>
+void parallel_merge_sort(RandIt first, RandIt last, const Cmp& cmp,
+                         std::size_t threads, const ChunkSort& chunk_sort)
+{
+    if (threads <= 1) {
+        chunk_sort(first, last, cmp);
+        return;
+    }
+
+    const auto size = static_cast<std::size_t>(std::distance(first, last));
+    std::vector<RandIt> bounds;
+    bounds.reserve(threads + 1);
+    for (std::size_t i = 0; i <= threads; ++i) {
+        bounds.push_back(std::next(first, size * i / threads));
+    }
+
+    run_parallel_tasks(threads, [&](std::size_t i) {
+        chunk_sort(bounds[i], bounds[i + 1], cmp);
+    });
+    for (std::size_t width = 1; width < threads; width *= 2) {
+        const std::size_t merges = (threads + 2 * width - 1) / (2 * width);
+        run_parallel_tasks(merges, [&](std::size_t m) {
+            const std::size_t lo = m * 2 * width;
+            const std::size_t mid = std::min(lo + width, threads);
+            const std::size_t hi = std::min(lo + 2 * width, threads);
+            if (mid < hi) {
+                std::inplace_merge(bounds[lo], bounds[mid], bounds[hi], cmp);
+            }
+        });
+    }
+}
+
+/**
+ * @internal
+ * @brief Parallel version of <tt>std::unique</tt>.
+ * @headerfile sort_policy.h <coveo/lazy/sort_policy.h>
+ *
+ * Splits <tt>[first, last[</tt> in chunks that do not break runs of
+ * equivalent elements, removes duplicates from each chunk on its own
+ * thread, then compacts the chunks together.
+ *
+ * @param first Beginning of range to process.
+ * @param last End of range to process.
+ * @param eq Predicate used to identify duplicates.
+ * @param threads Number of threads to use.
+ * @return New end of range.
+ */
+template<class RandIt, class Eq>
+RandIt parallel_unique(RandIt first, RandIt last, const Eq& eq, std::size_t threads)
+{
+    if (threads <= 1) {
+        return std::unique(first, last, eq);
+    }
+
+    const auto size = static_cast<std::size_t>(std::distance(first, last));
+    std::vector<RandIt> bounds;
+    bounds.reserve(threads + 1);
+    bounds.push_back(first);
+    for (std::size_t i = 1; i < threads; ++i) {
+        // Make sure chunks do not start in the middle of a run of duplicates.
+        auto bound = std::max(std::next(first, size * i / threads), bounds.back());
+        while (bound != first && bound != last && eq(*std::prev(bound), *bound)) {
+            ++bound;
+        }
+        bounds.push_back(bound);
+    }
+    bounds.push_back(last);
+
+    std::vector<RandIt> ends(bounds.begin(), bounds.end() - 1);
+    run_parallel_tasks(threads, [&](std::size_t i) {
+        ends[i] = std::unique(bounds[i], bounds[i + 1], eq);
+    });
+    auto new_last = ends[0];
+    for (std::size_t i = 1; i < threads; ++i) {
+        // Chunks are already in place until the first one that removed duplicates;
+        // moving them onto themselves would leave moved-from elements behind.
+        if (new_last == bounds[i]) {
+            new_last = ends[i];
+        } else {
+            new_last = std::move(bounds[i], ends[i], new_last);
+        }
+    }
+    return new_last;
+}
+
+/**
+ * @internal
+ * @brief Trait to detect if elements have small keys that can be copied to sort them.
+ * @headerfile sort_policy.h <coveo/lazy/sort_policy.h>
+ *
+ * Has a @c value member set to @c true if @c Cmp is a value predicate (like
+ * <tt>lazy_value_pred_proxy</tt>) that gives access to its "value to key"
+ * predicate and key predicate, and if keys are trivially copyable and no
+ * larger than two pointers. Such keys can be copied next to the positions
+ * of their elements to sort them without following an indirection.
+ *
+ * @tparam RandIt Type of iterator to elements to sort.
+ * @tparam Cmp Predicate used to compare elements.
+ */
+template<class RandIt, class Cmp, class = void>
+struct has_small_sort_key {
+    static const bool value = false;
+};
+template<class RandIt, class Cmp>
+struct has_small_sort_key<RandIt, Cmp,
+                          typename make_void<decltype(std::declval<const Cmp&>().value_to_key()),
+                                             decltype(std::declval<const Cmp&>().key_predicate())>::type>
+{
+    using element_type = typename std::iterator_traits<RandIt>::value_type;
+    using value_to_key = std::decay_t<decltype(std::declval<const Cmp&>().value_to_key())>;
+    using key_type = std::decay_t<decltype(std::declval<const value_to_key&>()(std::declval<const element_type&>()))>;
+
+    static const bool value = std::is_trivially_copyable<key_type>::value &&
+                              sizeof(key_type) <= 2 * sizeof(void*);
+};
+
+/**
+ * @internal
+ * @brief Computes the sorted order of elements without moving them.
+ * @headerfile sort_policy.h <coveo/lazy/sort_policy.h>
+ *
+ * Returns, for each position in the sorted range, the position of the element
+ * that belongs there. Depending on the elements, this sorts:
+ *
+ * - pairs of radix keys and positions, if elements can be radix-sorted;
+ * - pairs of keys and positions, if keys are small (see @c has_small_sort_key);
+ * - positions only, compared through the elements otherwise.
+ *
+ * @param first Beginning of range to sort.
+ * @param last End of range to sort.
+ * @param cmp Predicate used to compare elements.
+ * @param stable Whether equivalent elements must keep their relative order.
+ * @param alloc Allocator used for temporary buffers and the result (rebound as needed).
+ */
+template<class RandIt, class Cmp, class Alloc>
+scratch_vector<std::size_t, Alloc> indirect_sorted_positions(RandIt first, RandIt last, const Cmp& cmp, bool stable,
+                                                             const Alloc& alloc, std::integral_constant<int, 0>)
+{
+    scratch_vector<std::size_t, Alloc> positions(static_cast<std::size_t>(std::distance(first, last)), alloc);
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+        positions[i] = i;
+    }
+    auto pos_cmp = [&](std::size_t left, std::size_t right) {
+        return cmp(first[left], first[right]);
+    };
+    if (stable) {
+        allocator_stable_sort(positions.begin(), positions.end(), pos_cmp, alloc);
+    } else {
+        std::sort(positions.begin(), positions.end(), pos_cmp);
+    }
+    return positions;
+}
+template<class RandIt, class Cmp, class Alloc>
+scratch_vector<std::size_t, Alloc> indirect_sorted_positions(RandIt first, RandIt last, const Cmp& cmp, bool stable,
+                                                             const Alloc& alloc, std::integral_constant<int, 1>)
+{
+    using key_type = typename has_small_sort_key<RandIt, Cmp>::key_type;
+    using indexed_key = std::pair<key_type, std::size_t>;
+
+    const auto vtok = cmp.value_to_key();
+    const auto kcmp = cmp.key_predicate();
+    scratch_vector<indexed_key, Alloc> items(alloc);
+    items.reserve(static_cast<std::size_t>(std::distance(first, last)));
+    std::size_t i = 0;
+    for (auto it = first; it != last; ++it) {
+        items.emplace_back(vtok(*it), i++);
+    }
+    auto item_cmp = [&](const indexed_key& left, const indexed_key& right) {
+        return kcmp(left.first, right.first);
+    };
+    if (stable) {
+        allocator_stable_sort(items.begin(), items.end(), item_cmp, alloc);
+    } else {
+        std::sort(items.begin(), items.end(), item_cmp);
+    }
+
+    scratch_vector<std::size_t, Alloc> positions(alloc);
+    positions.reserve(items.size());
+    for (const auto& item : items) {
+        positions.push_back(item.second);
+    }
+    return positions;
+}
+template<class RandIt, class Cmp, class Alloc>
+scratch_vector<std::size_t, Alloc> indirect_sorted_positions(RandIt first, RandIt last, const Cmp& cmp, bool stable,
+                                                             const Alloc& alloc, std::integral_constant<int, 2>)
+{
+    if (static_cast<std::size_t>(std::distance(first, last)) < radix_sort_min_size) {
+        return indirect_sorted_positions(first, last, cmp, stable, alloc, std::integral_constant<int, 1>());
+    }
+    return radix_sorted_positions(first, last, cmp, alloc);
+}
+template<class RandIt, class Cmp, class Alloc>
+scratch_vector<std::size_t, Alloc> indirect_sorted_positions(RandIt first, RandIt last, const Cmp& cmp, bool stable,
+                                                             const Alloc& alloc) {
+    const int mode = is_radix_sortable<RandIt, Cmp>::value ? 2 : (has_small_sort_key<RandIt, Cmp>::value ? 1 : 0);
+    return indirect_sorted_positions(first, last, cmp, stable, alloc, std::integral_constant<int, mode>());
+}
+
+/**
+ * @internal
+ * @brief Moves elements to their sorted positions.
+ * @headerfile sort_policy.h <coveo/lazy/sort_policy.h>
+ *
+ * Applies a permutation to <tt>[first, first + positions.size()[</tt> by following
+ * its cycles: each element is moved once, plus one temporary per cycle.
+ * Fixed points are not moved at all.
+ *
+ * @param first Beginning of range to permute.
+ * @param positions For each position, position of the element that belongs there.
+ *                  Modified by this function.
+ */
+template<class RandIt, class Positions>
+void apply_sorted_positions(RandIt first, Positions& positions)
+{
+    using element_type = typename std::iterator_traits<RandIt>::value_type;
+
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+        if (positions[i] == i) {
+            continue;
+        }
+        element_type tmp(std::move(first[i]));
+        std::size_t cur = i;
+        for (;;) {
+            const std::size_t next = positions[cur];
+            positions[cur] = cur;
+            if (next == i) {
+                first[cur] = std::move(tmp);
+                break;
+            }
+            first[cur] = std::move(first[next]);
+            cur = next;
+        }
+    }
+}
+
+} // detail
+
+/**
+ * @brief Default sort policy.
+ * @headerfile sort_policy.h <coveo/lazy/sort_policy.h>
+ *
+ * Sort policy that uses the standard library algorithms <tt>std::sort</tt>,
+ * <tt>std::stable_sort</tt> and <tt>std::unique</tt> on the calling thread.
+ * This is the default sort policy of lazy-sorted containers.
+ *
+ * When keys are arithmetic (integers or floating-point numbers) and are
+ * compared using <tt>std::less</tt> or <tt>std::greater</tt>, this policy
+ * uses a (stable) LSD radix sort instead, which runs in linear time.
+ */
+struct default_sort_policy
+{
+    template<class RandIt, class Cmp, class Alloc = std::allocator<char>>
+    void sort(RandIt first, RandIt last, const Cmp& cmp, const Alloc& alloc = Alloc()) const {
+        sort_impl(first, last, cmp, alloc, use_radix_sort<RandIt, Cmp>(), [](RandIt f, RandIt l, const Cmp& c) {
+            std::sort(f, l, c);
+        });
+    }
+
+    template<class RandIt, class Cmp, class Alloc = std::allocator<char>>
+    void stable_sort(RandIt first, RandIt last, const Cmp& cmp, const Alloc& alloc = Alloc()) const {
+        sort_impl(first, last, cmp, alloc, use_radix_sort<RandIt, Cmp>(), [&alloc](RandIt f, RandIt l, const Cmp& c) {
+            detail::allocator_stable_sort(f, l, c, alloc);
+        });
+    }
+
+    template<class RandIt, class Eq>
+    RandIt unique(RandIt first, RandIt last, const Eq& eq) const {
+        return std::unique(first, last, eq);
+    }
+
+private:
+    template<class RandIt, class Cmp>
+    using use_radix_sort = std::integral_constant<bool, detail::is_radix_sortable<RandIt, Cmp>::value>;
+
+    template<class RandIt, class Cmp, class Alloc, class CmpSort>
+    static void sort_impl(RandIt first, RandIt last, const Cmp& cmp, const Alloc& alloc, std::true_type, const CmpSort& cmp_sort) {
+        if (static_cast<std::size_t>(std::distance(first, last)) >= detail::radix_sort_min_size) {
+            detail::radix_sort(first, last, cmp, alloc);
+        } else {
+            cmp_sort(first, last, cmp);
+        }
+    }
+    template<class RandIt, class Cmp, class Alloc, class CmpSort>
+    static void sort_impl(RandIt first, RandIt last, const Cmp& cmp, const Alloc&, std::false_type, const CmpSort& cmp_sort) {
+        cmp_sort(first, last, cmp);
+    }
+};
+
+/**
+ * @brief Parallel sort policy.
+ * @headerfile sort_policy.h <coveo/lazy/sort_policy.h>
+ *
+ * Sort policy that uses a parallel merge-sort to sort elements using multiple
+ * threads. Use this for containers that can grow very large, to avoid stalling
+ * on a single core when sorting is triggered.
+ *
+ * Parallel sorting is only used when there are enough elements to sort; each
+ * thread will process at least @c MinParallelSize elements. Below this size,
+ * this policy behaves like @c default_sort_policy. Each thread also uses
+ * @c default_sort_policy to sort its part of the elements.
+ *
+ * Stable sorting (used by <tt>coveo::lazy::multiset</tt> and <tt>coveo::lazy::multimap</tt>)
+ * is also performed in parallel and preserves the order of equivalent elements.
+ *
+ * Unlike @c default_sort_policy, this policy does not use the container's allocator:
+ * allocators like those of <tt>std::pmr::monotonic_buffer_resource</tt> are not
+ * thread-safe. Temporary buffers (and threads) are allocated with global memory.
+ *
+ * @tparam MinParallelSize Minimum number of elements processed by each thread.
+ *                         Defaults to 65536.
+ * @tparam MaxThreads Maximum number of threads to use. Defaults to 0, which
+ *                    means to use <tt>std::thread::hardware_concurrency()</tt>.
+ */
+template<std::size_t MinParallelSize = 65536,
+         std::size_t MaxThreads = 0>
+struct parallel_sort_policy
+{
+    template<class RandIt, class Cmp>
+    void sort(RandIt first, RandIt last, const Cmp& cmp) const {
+        detail::parallel_merge_sort(first, last, cmp, thread_count(first, last),
+                                    [](RandIt f, RandIt l, const Cmp& c) { default_sort_policy().sort(f, l, c); });
+    }
+
+    template<class RandIt, class Cmp>
+    void stable_sort(RandIt first, RandIt last, const Cmp& cmp) const {
+        detail::parallel_merge_sort(first, last, cmp, thread_count(first, last),
+                                    [](RandIt f, RandIt l, const Cmp& c) { default_sort_policy().stable_sort(f, l, c); });
+    }
+
+    template<class RandIt, class Eq>
+    RandIt unique(RandIt first, RandIt last, const Eq& eq) const {
+        return detail::parallel_unique(first, last, eq, thread_count(first, last));
+    }
+
+private:
+    template<class RandIt>
+    static std::size_t thread_count(RandIt first, RandIt last) {
+        return detail::parallel_sort_thread_count(static_cast<std::size_t>(std::distance(first, last)),
+                                                  MinParallelSize, MaxThreads);
+    }
+};
+
+/**
+ * @brief Indirect sort policy.
+ * @headerfile sort_policy.h <coveo/lazy/sort_policy.h>
+ *
+ * Sort policy that sorts the positions of elements instead of the elements
+ * themselves, then moves each element to its final position in a single pass.
+ * Use this for containers whose elements are expensive to move, like maps with
+ * large mapped values: each element is moved at most once per sort, instead
+ * of many times by the swaps of <tt>std::sort</tt>.
+ *
+ * To avoid an indirection on each comparison, keys are copied along with the
+ * positions of their elements when they are small and trivially copyable;
+ * arithmetic keys compared with <tt>std::less</tt> or <tt>std::greater</tt>
+ * are radix-sorted this way. Other elements are compared through their positions,
+ * which causes more cache misses than sorting elements directly; for such elements,
+ * this policy only pays off when they are large (several hundred bytes).
+ *
+ * Sorting requires a temporary buffer of positions (or keys and positions).
+ * Below @c MinIndirectSize elements, this policy behaves like @c default_sort_policy.
+ *
+ * @tparam MinIndirectSize Minimum number of elements to sort indirectly.
+ *                         Defaults to 32.
+ */
+template<std::size_t MinIndirectSize = 32>
+struct indirect_sort_policy
+{
+    template<class RandIt, class Cmp, class Alloc = std::allocator<char>>
+    void sort(RandIt first, RandIt last, const Cmp& cmp, const Alloc& alloc = Alloc()) const {
+        if (static_cast<std::size_t>(std::distance(first, last)) < MinIndirectSize) {
+            default_sort_policy().sort(first, last, cmp, alloc);
+        } else {
+            auto positions = detail::indirect_sorted_positions(first, last, cmp, false, alloc);
+            detail::apply_sorted_positions(first, positions);
+        }
+    }
+
+    template<class RandIt, class Cmp, class Alloc = std::allocator<char>>
+    void stable_sort(RandIt first, RandIt last, const Cmp& cmp, const Alloc& alloc = Alloc()) const {
+        if (static_cast<std::size_t>(std::distance(first, last)) < MinIndirectSize) {
+            default_sort_policy().stable_sort(first, last, cmp, alloc);
+        } else {
+            auto positions = detail::indirect_sorted_positions(first, last, cmp, true, alloc);
+            detail::apply_sorted_positions(first, positions);
+        }
+    }
+
+    template<class RandIt, class Eq>
+    RandIt unique(RandIt first, RandIt last, const Eq& eq) const {
+        return std::unique(first, last, eq);
+    }
+};
+
+} // lazy
+} // coveo
+
+#endif // COVEO_LAZY_SORT_POLICY_H
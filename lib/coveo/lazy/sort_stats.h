@@ -0,0 +1,185 @@
+/**
+ * @file
+ * @brief Sort statistics policies used by lazy-sorted associative containers.
+ *
+ * This file contains the policies that can be used to collect statistics
+ * about the sorting performed by lazy-sorted containers. Since sorting is
+ * triggered implicitly by many methods (<tt>begin()</tt>, <tt>find()</tt>,
+ * etc.), these statistics help identify containers that often alternate
+ * between inserts and lookups. A stats policy is specified through the
+ * @c _Stats template parameter of containers like <tt>coveo::lazy::set</tt>
+ * or <tt>coveo::lazy::map</tt>:
+ *
+ * @code
+ *   using counted_set = coveo::lazy::set<int, std::less<int>, std::vector,
+ *                                        coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>>,
+ *                                        std::allocator<int>,
+ *                                        coveo::lazy::default_sort_policy,
+ *                                        coveo::lazy::counting_sort_stats>;
+ *   counted_set s;
+ *   // ...
+ *   report_metric("sorts", s.sort_stats().sort_count());
+ * @endcode
+ *
+ * A stats policy must be a copyable type with the following members:
+ *
+ * - <tt>static const bool enabled</tt>: whether to collect statistics. If
+ *   @c false, the container does not perform any additional work.
+ * - <tt>void record(const sort_stats_event& event)</tt>: called after each
+ *   sort with information about it (only needed if @c enabled is @c true).
+ *
+ * @copyright 2015-2016, Coveo Solutions Inc.
+ *            Distributed under the Apache License, Version 2.0 (see <a href="https://github.com/coveo/lazy/blob/master/LICENSE">LICENSE</a>).
+ */
+
+#ifndef COVEO_LAZY_SORT_STATS_H
+#define COVEO_LAZY_SORT_STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+namespace coveo {
+namespace lazy {
+
+/**
+ * @brief Information about a sort performed by a container.
+ * @headerfile sort_stats.h <coveo/lazy/sort_stats.h>
+ *
+ * Structure passed to stats policies each time a lazy-sorted
+ * container sorts its elements.
+ */
+struct sort_stats_event
+{
+    std::size_t size_before = 0;            ///< Number of elements in container before the sort.
+    std::size_t sorted_prefix = 0;          ///< Number of elements that were already sorted and only needed to be merged.
+    std::size_t elements_sorted = 0;        ///< Number of elements that had to be sorted.
+    std::size_t duplicates_removed = 0;     ///< Number of duplicates removed (always 0 for multi containers).
+    std::chrono::steady_clock::duration duration = std::chrono::steady_clock::duration::zero(); ///< Time spent sorting.
+};
+
+/**
+ * @brief Stats policy that does not collect anything.
+ * @headerfile sort_stats.h <coveo/lazy/sort_stats.h>
+ *
+ * Stats policy that disables collection of sort statistics.
+ * This is the default stats policy of lazy-sorted containers;
+ * it has no runtime cost.
+ */
+struct no_sort_stats
+{
+    static const bool enabled = false;
+};
+
+/**
+ * @brief Stats policy that counts sorts.
+ * @headerfile sort_stats.h <coveo/lazy/sort_stats.h>
+ *
+ * Stats policy that accumulates statistics about all sorts performed
+ * by a container: number of sorts, number of elements sorted, number of
+ * duplicates removed and time spent sorting. An optional callback can also
+ * be called after each sort, for example to export statistics to a
+ * metrics system.
+ *
+ * Statistics are stored in each container and are copied along with it.
+ */
+class counting_sort_stats
+{
+public:
+    static const bool enabled = true;
+
+    /**
+     * @brief Type of callback called after each sort.
+     */
+    using callback_type = std::function<void(const sort_stats_event&)>;
+
+    /**
+     * @brief Records a sort.
+     *
+     * Called by the container after each sort. Updates counters
+     * and calls the callback, if any.
+     *
+     * @param event Information about the sort.
+     */
+    void record(const sort_stats_event& event) {
+        ++sort_count_;
+        elements_sorted_ += event.elements_sorted;
+        elements_merged_ += event.sorted_prefix;
+        duplicates_removed_ += event.duplicates_removed;
+        sort_time_ += event.duration;
+        if (callback_) {
+            callback_(event);
+        }
+    }
+
+    /**
+     * @brief Number of times the container has been sorted.
+     */
+    std::size_t sort_count() const {
+        return sort_count_;
+    }
+
+    /**
+     * @brief Total number of elements that had to be sorted.
+     */
+    std::size_t elements_sorted() const {
+        return elements_sorted_;
+    }
+
+    /**
+     * @brief Total number of already-sorted elements that were merged with new ones.
+     */
+    std::size_t elements_merged() const {
+        return elements_merged_;
+    }
+
+    /**
+     * @brief Total number of duplicates removed.
+     */
+    std::size_t duplicates_removed() const {
+        return duplicates_removed_;
+    }
+
+    /**
+     * @brief Total time spent sorting.
+     */
+    std::chrono::steady_clock::duration sort_time() const {
+        return sort_time_;
+    }
+
+    /**
+     * @brief Sets the callback called after each sort.
+     *
+     * @param callback Callback to call, or an empty function to disable.
+     */
+    void set_callback(callback_type callback) {
+        callback_ = std::move(callback);
+    }
+
+    /**
+     * @brief Resets all counters to zero.
+     *
+     * Does not affect the callback.
+     */
+    void reset() {
+        sort_count_ = 0;
+        elements_sorted_ = 0;
+        elements_merged_ = 0;
+        duplicates_removed_ = 0;
+        sort_time_ = std::chrono::steady_clock::duration::zero();
+    }
+
+private:
+    std::size_t sort_count_ = 0;
+    std::size_t elements_sorted_ = 0;
+    std::size_t elements_merged_ = 0;
+    std::size_t duplicates_removed_ = 0;
+    std::chrono::steady_clock::duration sort_time_ = std::chrono::steady_clock::duration::zero();
+    callback_type callback_;
+};
+
+} // lazy
+} // coveo
+
+#endif // COVEO_LAZY_SORT_STATS_H
@@ -0,0 +1,574 @@
+/**
+ * @file
+ * @brief Read-only views of sorted elements used by lazy-sorted associative containers.
+ *
+ * This file contains the definition of <tt>coveo::lazy::detail::sorted_view</tt>,
+ * a read-only container that looks for elements in a range of sorted elements
+ * without copying or sorting them, as well as the binary format written by
+ * the <tt>serialize()</tt> method of lazy-sorted containers.
+ *
+ * For containers whose elements are trivially copyable, this can be used to build
+ * large containers offline and load them instantly, by mapping the file in memory:
+ *
+ * @code
+ *   // Offline
+ *   coveo::lazy::map<std::uint64_t, record> m;
+ *   // ... fill m ...
+ *   std::ofstream out("index.bin", std::ios::binary);
+ *   m.serialize(out);
+ *
+ *   // At startup; data points to the content of index.bin, mapped in memory
+ *   coveo::lazy::map_view<std::uint64_t, record> v(data, data_size);
+ *   auto it = v.find(42);
+ * @endcode
+ *
+ * The binary format is made of a header, followed by the container's sorted
+ * elements, stored contiguously and in the byte representation of the platform
+ * that wrote them. The header contains, in order:
+ *
+ * - a magic string (<tt>"COVEOLZY"</tt>)
+ * - the version of the format (currently 1), which also reveals differences in byte order
+ * - flags indicating whether elements are sorted and whether they can have duplicate keys
+ * - the size and alignment of elements
+ * - a tag identifying the type of comparator used to sort elements (see <tt>coveo::lazy::comparator_tag</tt>)
+ * - the number of elements
+ * - the offset of the first element from the start of the data, a multiple of the elements' alignment
+ *
+ * All header fields are unsigned integers of 32 bits (version and flags) or 64 bits (other fields).
+ *
+ * @copyright 2015-2016, Coveo Solutions Inc.
+ *            Distributed under the Apache License, Version 2.0 (see <a href="https://github.com/coveo/lazy/blob/master/LICENSE">LICENSE</a>).
+ */
+
+#ifndef COVEO_LAZY_SORTED_VIEW_H
+#define COVEO_LAZY_SORTED_VIEW_H
+
+#include <coveo/lazy/detail/branchless_search.h>
+#include <coveo/lazy/exception.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+namespace coveo {
+namespace lazy {
+
+/**
+ * @brief Tag identifying a type of comparator.
+ * @headerfile sorted_view.h <coveo/lazy/sorted_view.h>
+ *
+ * Identifies the type of comparator used to sort elements written by
+ * <tt>serialize()</tt>. When a <tt>coveo::lazy::detail::sorted_view</tt> is
+ * opened, this tag is compared to the one stored in the data to make sure
+ * elements were sorted the same way.
+ *
+ * By default, the tag is a hash of the comparator's type name, as reported
+ * by <tt>typeid</tt>. Since type names differ between compilers, this
+ * template can be specialized to provide a stable tag:
+ *
+ * @code
+ *   template<> struct coveo::lazy::comparator_tag<my_comparator> {
+ *       static std::uint64_t value() { return 0x6d795f636d70; }
+ *   };
+ * @endcode
+ *
+ * @tparam KCmp Type of key comparator.
+ */
+template<class KCmp>
+struct comparator_tag
+{
+    static std::uint64_t value() {
+        // FNV-1a hash of the type name.
+        std::uint64_t hash = 14695981039346656037ull;
+        for (const char* p = typeid(KCmp).name(); *p != '\0'; ++p) {
+            hash = (hash ^ static_cast<unsigned char>(*p)) * 1099511628211ull;
+        }
+        return hash;
+    }
+};
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief Trait to know if elements can be serialized.
+ * @headerfile sorted_view.h <coveo/lazy/sorted_view.h>
+ *
+ * Has a @c value member set to @c true if elements of type @c V can be
+ * written as bytes by <tt>serialize()</tt> and used in place from those
+ * bytes by <tt>sorted_view</tt>. This is the case for trivially-copyable
+ * types; it is specialized for the pairs stored in lazy maps.
+ *
+ * @tparam V Type of elements.
+ */
+template<class V>
+struct is_trivially_serializable : std::is_trivially_copyable<V> { };
+
+/**
+ * @internal
+ * @brief Header of serialized sorted elements.
+ * @headerfile sorted_view.h <coveo/lazy/sorted_view.h>
+ *
+ * Header written before elements by <tt>write_sorted_view()</tt>.
+ * See <tt>coveo/lazy/sorted_view.h</tt> for a description of the format.
+ */
+struct sorted_view_header
+{
+    static const std::uint32_t current_version = 1;
+    static const std::uint32_t sorted_flag = 0x1;
+    static const std::uint32_t multi_flag = 0x2;
+
+    char magic[8];                      // Always "COVEOLZY".
+    std::uint32_t version;              // Version of the format.
+    std::uint32_t flags;                // Combination of sorted_flag and multi_flag.
+    std::uint64_t value_size;           // sizeof of elements.
+    std::uint64_t value_alignment;      // alignof of elements.
+    std::uint64_t comparator_tag;       // comparator_tag of the key comparator.
+    std::uint64_t size;                 // Number of elements.
+    std::uint64_t elements_offset;      // Offset of first element from start of header.
+    std::uint64_t reserved;             // Unused; always 0.
+
+    static const char* expected_magic() {
+        return "COVEOLZY";
+    }
+
+    // Returns offset of elements of type V, right after the header.
+    template<class V>
+    static std::uint64_t elements_offset_for() {
+        return (sizeof(sorted_view_header) + alignof(V) - 1) / alignof(V) * alignof(V);
+    }
+};
+
+/**
+ * @internal
+ * @brief Writes sorted elements.
+ * @headerfile sorted_view.h <coveo/lazy/sorted_view.h>
+ *
+ * Writes a header followed by the bytes of the elements in <tt>[first, last[</tt>
+ * to a stream, in a format that can be read by <tt>sorted_view</tt>.
+ * Used to implement <tt>lazy_sorted_container::serialize()</tt>.
+ *
+ * @tparam V Type of elements to write. Must be trivially serializable.
+ * @tparam KCmp Type of comparator used to sort elements.
+ * @tparam Multi Whether elements can have duplicate keys.
+ * @param os Stream to write to. Should be opened in binary mode.
+ * @param first Beginning of range of sorted elements.
+ * @param last End of range of sorted elements.
+ * @param size Number of elements in <tt>[first, last[</tt>.
+ */
+template<class V, class KCmp, bool Multi, class It>
+void write_sorted_view(std::ostream& os, It first, It last, std::size_t size)
+{
+    static_assert(is_trivially_serializable<V>::value,
+                  "Only containers of trivially-copyable elements can be serialized");
+
+    sorted_view_header header;
+    std::memcpy(header.magic, sorted_view_header::expected_magic(), sizeof(header.magic));
+    header.version = sorted_view_header::current_version;
+    header.flags = sorted_view_header::sorted_flag | (Multi ? sorted_view_header::multi_flag : 0);
+    header.value_size = sizeof(V);
+    header.value_alignment = alignof(V);
+    header.comparator_tag = comparator_tag<KCmp>::value();
+    header.size = size;
+    header.elements_offset = sorted_view_header::elements_offset_for<V>();
+    header.reserved = 0;
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (std::uint64_t pad = sizeof(header); pad < header.elements_offset; ++pad) {
+        os.put('\0');
+    }
+    for (; first != last; ++first) {
+        os.write(reinterpret_cast<const char*>(std::addressof(*first)), sizeof(V));
+    }
+}
+
+/**
+ * @brief Read-only view of sorted elements.
+ * @headerfile sorted_view.h <coveo/lazy/sorted_view.h>
+ *
+ * Read-only associative container that looks for elements in a contiguous
+ * range of sorted elements that it does not own. It offers the same lookup
+ * and iteration methods as lazy-sorted containers, but since its elements
+ * are always sorted, it never needs to sort or copy them.
+ *
+ * Views can be opened directly over data written by <tt>serialize()</tt>,
+ * for example a file mapped in memory: the header is validated and elements
+ * are used in place. They can also be created over elements already sorted
+ * in memory.
+ *
+ * A view can optionally share ownership of the memory holding its elements,
+ * through a <tt>std::shared_ptr</tt> (for example, one that unmaps a file
+ * when released). Otherwise, that memory must outlive the view. Since views
+ * cannot be modified, they can be read from multiple threads at once.
+ *
+ * Do not use this class directly; instead, use one of the aliases like
+ * <tt>coveo::lazy::set_view</tt> or <tt>coveo::lazy::map_view</tt>.
+ *
+ * @tparam K Type of keys.
+ * @tparam T Type of mapped values for maps; @c void for sets.
+ * @tparam V Type of elements stored in memory.
+ * @tparam PubV Type of elements to publicly return references of.
+ *              Must be either @c V or a base class of @c V.
+ * @tparam VCmp Predicate used to compare elements of type @c PubV. Must have
+ *              <tt>value_to_key()</tt> and <tt>key_predicate()</tt> methods,
+ *              like <tt>lazy_value_pred_proxy</tt>.
+ * @tparam Multi Whether elements can have duplicate keys.
+ */
+template<class K,
+         class T,
+         class V,
+         class PubV,
+         class VCmp,
+         bool Multi>
+class sorted_view
+{
+public:
+    /// Type of keys of elements.
+    using key_type = K;
+    /// Type of elements.
+    using value_type = PubV;
+    /// Predicate used to get the key of an element.
+    using value_to_key = std::decay_t<decltype(std::declval<const VCmp&>().value_to_key())>;
+    /// Predicate used to compare keys.
+    using key_compare = std::decay_t<decltype(std::declval<const VCmp&>().key_predicate())>;
+    /// Predicate used to compare elements.
+    using value_compare = VCmp;
+    /// Type used for sizes.
+    using size_type = std::size_t;
+    /// Type used for differences between iterators.
+    using difference_type = std::ptrdiff_t;
+    /// Reference to an element.
+    using reference = const value_type&;
+    /// Const reference to an element.
+    using const_reference = const value_type&;
+    /// Pointer to an element.
+    using pointer = const value_type*;
+    /// Const pointer to an element.
+    using const_pointer = const value_type*;
+    /// Iterator; elements cannot be modified.
+    using iterator = const value_type*;
+    /// Const iterator.
+    using const_iterator = const value_type*;
+    /// Reverse iterator; elements cannot be modified.
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    /// Const reverse iterator.
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+private:
+    const_pointer first_;               // First element.
+    const_pointer last_;                // End of elements.
+    std::shared_ptr<const void> owner_; // Optional owner of the elements' memory.
+    value_compare vcmp_;                // Value comparator.
+
+public:
+    /**
+     * @brief Default constructor.
+     *
+     * Creates an empty view.
+     *
+     * @param kcmp @c key_compare instance to use for this view.
+     */
+    explicit sorted_view(const key_compare& kcmp = key_compare())
+        : first_(nullptr), last_(nullptr), owner_(), vcmp_(value_to_key(), kcmp) { }
+
+    /**
+     * @brief Constructor over sorted elements.
+     *
+     * Creates a view over the elements in <tt>[first, last[</tt>, which
+     * must be sorted using @c kcmp. Unless @c Multi is @c true, keys must
+     * also be unique. For example, this can be used to look for elements
+     * of a sorted <tt>std::vector</tt>.
+     *
+     * @param first Beginning of the range of sorted elements (inclusive).
+     * @param last End of the range of sorted elements (exclusive).
+     * @param owner Optional owner of the elements' memory.
+     * @param kcmp @c key_compare instance used to sort elements.
+     */
+    sorted_view(const_pointer first, const_pointer last,
+                std::shared_ptr<const void> owner = nullptr,
+                const key_compare& kcmp = key_compare())
+        : first_(first), last_(last), owner_(std::move(owner)), vcmp_(value_to_key(), kcmp) { }
+
+    /**
+     * @brief Constructor over serialized elements.
+     *
+     * Creates a view over elements written by <tt>serialize()</tt>. Elements
+     * are used in place and must therefore stay at the same address while the
+     * view is used; this is usually done by mapping the file that contains them
+     * in memory.
+     *
+     * @param data Pointer to the beginning of the serialized data. Must be suitably
+     *             aligned for elements (memory-mapped files always are).
+     * @param size Size of the serialized data, in bytes.
+     * @param owner Optional owner of the memory pointed to by @c data.
+     * @param kcmp @c key_compare instance used to sort elements.
+     * @throw coveo::lazy::format_error The data was not written by <tt>serialize()</tt>,
+     *                                  was written for another type of container or
+     *                                  is truncated or misaligned.
+     */
+    sorted_view(const void* data, std::size_t size,
+                std::shared_ptr<const void> owner = nullptr,
+                const key_compare& kcmp = key_compare())
+        : sorted_view(std::move(owner), kcmp)
+    {
+        static_assert(is_trivially_serializable<V>::value,
+                      "Only containers of trivially-copyable elements can be serialized");
+
+        sorted_view_header header;
+        if (data == nullptr || size < sizeof(header)) {
+            throw format_error("sorted_view: data is too small to contain a header");
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, sorted_view_header::expected_magic(), sizeof(header.magic)) != 0) {
+            throw format_error("sorted_view: data does not contain serialized elements");
+        }
+        if (header.version != sorted_view_header::current_version) {
+            throw format_error("sorted_view: unsupported version or byte order");
+        }
+        if (header.value_size != sizeof(V) || header.value_alignment != alignof(V)) {
+            throw format_error("sorted_view: elements have a different size or alignment");
+        }
+        if (header.comparator_tag != comparator_tag<key_compare>::value()) {
+            throw format_error("sorted_view: elements were sorted using a different comparator");
+        }
+        if ((header.flags & sorted_view_header::sorted_flag) == 0) {
+            throw format_error("sorted_view: elements are not sorted");
+        }
+        if (!Multi && (header.flags & sorted_view_header::multi_flag) != 0) {
+            throw format_error("sorted_view: elements can have duplicate keys");
+        }
+        if (header.elements_offset < sizeof(header) || header.elements_offset > size ||
+            header.size > (size - header.elements_offset) / sizeof(V)) {
+            throw format_error("sorted_view: data is truncated");
+        }
+        const char* elements = static_cast<const char*>(data) + header.elements_offset;
+        if (reinterpret_cast<std::uintptr_t>(elements) % alignof(V) != 0) {
+            throw format_error("sorted_view: elements are misaligned");
+        }
+        const V* first = reinterpret_cast<const V*>(elements);
+        first_ = first;
+        last_ = first + header.size;
+    }
+
+    /// @brief Returns iterator to beginning of view.
+    const_iterator begin() const { return first_; }
+    /// @brief Returns iterator to beginning of view.
+    const_iterator cbegin() const { return first_; }
+    /// @brief Returns iterator to end of view.
+    const_iterator end() const { return last_; }
+    /// @brief Returns iterator to end of view.
+    const_iterator cend() const { return last_; }
+    /// @brief Returns reverse iterator to beginning of reversed view.
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(last_); }
+    /// @brief Returns reverse iterator to beginning of reversed view.
+    const_reverse_iterator crbegin() const { return const_reverse_iterator(last_); }
+    /// @brief Returns reverse iterator to end of reversed view.
+    const_reverse_iterator rend() const { return const_reverse_iterator(first_); }
+    /// @brief Returns reverse iterator to end of reversed view.
+    const_reverse_iterator crend() const { return const_reverse_iterator(first_); }
+
+    /// @brief Checks if view is empty.
+    bool empty() const { return first_ == last_; }
+    /// @brief Returns number of elements in view.
+    size_type size() const { return static_cast<size_type>(last_ - first_); }
+
+    /// @brief Returns the key comparator.
+    key_compare key_comp() const { return vcmp_.key_predicate(); }
+    /// @brief Returns the value comparator.
+    value_compare value_comp() const { return vcmp_; }
+
+    /**
+     * @brief Accesses an existing element.
+     *
+     * Returns a const reference to the mapped value of the element with the given key.
+     *
+     * @param key Key of element to look for.
+     * @return Const reference to the value associated with @c key.
+     * @throw coveo::lazy::out_of_range No element with that key exists.
+     * @remarks This method is only available for views of non-multi maps.
+     */
+    template<class _T = T,
+             class _CTRef = std::enable_if_t<!std::is_void<_T>::value && !Multi, const _T&>>
+    _CTRef at(const key_type& key) const {
+        return at_impl(key);
+    }
+
+    /**
+     * @brief Accesses an existing element using any type of key.
+     *
+     * @param key Key of element to look for.
+     * @return Const reference to the value associated with @c key.
+     * @throw coveo::lazy::out_of_range No element with that key exists.
+     * @remarks This method is only available for views of non-multi maps,
+     *          if @c key_compare is transparent.
+     */
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent,
+             class _T = T,
+             class _CTRef = std::enable_if_t<!std::is_void<_T>::value && !Multi, const _T&>>
+    _CTRef at(const OK& key) const {
+        return at_impl(key);
+    }
+
+    /**
+     * @brief Returns number of elements associated to a key.
+     *
+     * @param key Key of element(s) to count.
+     * @return Number of elements associated with @c key.
+     */
+    size_type count(const key_type& key) const {
+        return count_impl(key);
+    }
+
+    /// @brief Returns number of elements associated to any type of key; requires a transparent @c key_compare.
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent>
+    size_type count(const OK& key) const {
+        return count_impl(key);
+    }
+
+    /**
+     * @brief Looks for an element in the view.
+     *
+     * @param key Key of element to look for.
+     * @return Iterator pointing at the first element associated with @c key
+     *         if found, otherwise <tt>end()</tt>.
+     */
+    const_iterator find(const key_type& key) const {
+        return find_impl(key);
+    }
+
+    /// @brief Looks for an element using any type of key; requires a transparent @c key_compare.
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent>
+    const_iterator find(const OK& key) const {
+        return find_impl(key);
+    }
+
+    /**
+     * @brief Looks for key's lower bound.
+     *
+     * @param key Key to look for.
+     * @return Iterator pointing at the first element whose key is not less than @c key.
+     */
+    const_iterator lower_bound(const key_type& key) const {
+        return lower_bound_impl(key);
+    }
+
+    /// @brief Looks for lower bound of any type of key; requires a transparent @c key_compare.
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent>
+    const_iterator lower_bound(const OK& key) const {
+        return lower_bound_impl(key);
+    }
+
+    /**
+     * @brief Looks for key's upper bound.
+     *
+     * @param key Key to look for.
+     * @return Iterator pointing at the first element whose key is greater than @c key.
+     */
+    const_iterator upper_bound(const key_type& key) const {
+        return first_ + upper_bound_position(first_, last_, key, vcmp_);
+    }
+
+    /// @brief Looks for upper bound of any type of key; requires a transparent @c key_compare.
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent>
+    const_iterator upper_bound(const OK& key) const {
+        return first_ + upper_bound_position(first_, last_, key, vcmp_);
+    }
+
+    /**
+     * @brief Looks for all elements associated with a key.
+     *
+     * @param key Key to look for.
+     * @return Pair of iterators pointing at the key's lower and upper bounds.
+     */
+    std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const {
+        return equal_range_impl(key);
+    }
+
+    /// @brief Looks for all elements associated with any type of key; requires a transparent @c key_compare.
+    template<class OK,
+             class _OKCmp = key_compare,
+             class = typename _OKCmp::is_transparent>
+    std::pair<const_iterator, const_iterator> equal_range(const OK& key) const {
+        return equal_range_impl(key);
+    }
+
+    /**
+     * @brief Swaps two views.
+     *
+     * @param obj View to swap with.
+     */
+    void swap(sorted_view& obj) {
+        using std::swap;
+        swap(first_, obj.first_);
+        swap(last_, obj.last_);
+        swap(owner_, obj.owner_);
+        swap(vcmp_, obj.vcmp_);
+    }
+
+    /// @brief Swaps two views; see <tt>sorted_view::swap()</tt>.
+    friend void swap(sorted_view& obj1, sorted_view& obj2) {
+        obj1.swap(obj2);
+    }
+
+private:
+    // Delegated to by the serialized-data constructor.
+    sorted_view(std::shared_ptr<const void>&& owner, const key_compare& kcmp)
+        : first_(nullptr), last_(nullptr), owner_(std::move(owner)), vcmp_(value_to_key(), kcmp) { }
+
+    template<class OK> const_iterator lower_bound_impl(const OK& key) const {
+        return first_ + lower_bound_position(first_, last_, key, vcmp_);
+    }
+
+    template<class OK> const_iterator find_impl(const OK& key) const {
+        auto it = lower_bound_impl(key);
+        if (it != last_ && vcmp_(key, *it)) {
+            it = last_;
+        }
+        return it;
+    }
+
+    template<class OK> std::pair<const_iterator, const_iterator> equal_range_impl(const OK& key) const {
+        auto range = equal_range_positions(first_, last_, key, vcmp_);
+        return std::make_pair(first_ + range.first, first_ + range.second);
+    }
+
+    template<class OK> size_type count_impl(const OK& key) const {
+        if (Multi) {
+            auto range = equal_range_impl(key);
+            return static_cast<size_type>(range.second - range.first);
+        } else {
+            return find_impl(key) != last_ ? 1 : 0;
+        }
+    }
+
+    template<class OK> decltype(auto) at_impl(const OK& key) const {
+        auto it = find_impl(key);
+        if (it == last_) {
+            throw coveo::lazy::out_of_range("out_of_range");
+        }
+        return (it->second);
+    }
+};
+
+} // detail
+} // lazy
+} // coveo
+
+#endif // COVEO_LAZY_SORTED_VIEW_H
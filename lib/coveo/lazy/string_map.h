@@ -0,0 +1,551 @@
+/**
+ * @file
+ * @brief Definition of a lazy-sorted map specialized for string keys.
+ *
+ * This file contains the definition of <tt>coveo::lazy::basic_string_map</tt>
+ * and its alias <tt>coveo::lazy::string_map</tt>, a lazy-sorted map-like
+ * container that stores the characters of all its keys in a single
+ * contiguous array, instead of one heap-allocated <tt>std::string</tt> per
+ * element like <tt>coveo::lazy::map<std::string, T></tt> does.
+ *
+ * @copyright 2015-2016, Coveo Solutions Inc.
+ *            Distributed under the Apache License, Version 2.0 (see <a href="https://github.com/coveo/lazy/blob/master/LICENSE">LICENSE</a>).
+ */
+
+#ifndef COVEO_LAZY_STRING_MAP_H
+#define COVEO_LAZY_STRING_MAP_H
+
+#include <coveo/lazy/detail/string_arena.h>
+#include <coveo/lazy/exception.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace coveo {
+namespace lazy {
+
+/**
+ * @brief Map container specialized for string keys that performs lazy sorting.
+ * @headerfile string_map.h <coveo/lazy/string_map.h>
+ *
+ * <tt>std::map<std::string, T></tt>-like container class that stores the characters
+ * of its keys in a single array (an "arena") and sorts them only when needed.
+ * Sorting can also be triggered on-demand.
+ *
+ * Each element is stored as an entry holding the position, size and first 8 bytes
+ * (its "prefix", stored as a big-endian integer) of its key, followed by its mapped
+ * value. Sorting moves entries, never characters, and most comparisons only look
+ * at prefixes. See <tt>coveo::lazy::basic_string_set</tt> for details. This works
+ * best with small mapped values, like identifiers; for large mapped values,
+ * consider <tt>coveo::lazy::soa_map</tt>.
+ *
+ * This class has the following differences compared to <tt>coveo::lazy::map<std::string, T></tt>:
+ *
+ * - Since no pair is actually stored, iterators return a pair of a lightweight reference
+ *   to the key's characters and a reference to the mapped value by value, instead of
+ *   a reference to a <tt>value_type</tt>. <tt>operator-></tt> is supported through a proxy.
+ *   Key references can be compared with strings and convert implicitly to <tt>std::string</tt>.
+ * - Keys are always compared byte-wise, like <tt>std::less<std::string></tt> does.
+ * - Inserting an existing key does not check for it until the map is sorted;
+ *   as with <tt>coveo::lazy::map</tt>, the first key inserted wins.
+ *
+ * Like other lazy-sorted containers, this class is not thread-safe, even for
+ * read access. See <tt>coveo::lazy::detail::lazy_sorted_container</tt> for details.
+ *
+ * @tparam T Type of values bound to each key.
+ * @tparam _Alloc Allocator used for the arena. Defaults to <tt>std::allocator<char></tt>.
+ *                Also used (after rebinding) to allocate entries.
+ */
+template<class T,
+         class _Alloc = std::allocator<char>>
+class basic_string_map
+{
+    using entry_type = detail::string_arena_map_entry<T>;
+    using arena_type = detail::string_arena<entry_type, _Alloc>;
+
+public:
+    using key_type                  = std::string;
+    using key_reference             = detail::string_arena_ref;
+    using mapped_type               = T;
+    using value_type                = std::pair<const std::string, T>;
+    using size_type                 = std::size_t;
+    using difference_type           = std::ptrdiff_t;
+    using allocator_type            = _Alloc;
+    using iterator                  = detail::string_arena_iterator<entry_type, false>;
+    using const_iterator            = detail::string_arena_iterator<entry_type, true>;
+    using reference                 = typename iterator::reference;
+    using const_reference           = typename const_iterator::reference;
+    using reverse_iterator          = std::reverse_iterator<iterator>;
+    using const_reverse_iterator    = std::reverse_iterator<const_iterator>;
+
+private:
+    mutable arena_type arena_;  // Keys and mapped values, sorted or not.
+
+public:
+    /**
+     * @brief Default constructor.
+     *
+     * Creates an empty map.
+     *
+     * @param alloc Allocator used for the arena.
+     */
+    explicit basic_string_map(const allocator_type& alloc = allocator_type())
+        : arena_(alloc) { }
+
+    /**
+     * @brief Constructor with range.
+     *
+     * Creates a map with a copy of the elements in the given range.
+     *
+     * @param first Beginning of range of elements to copy.
+     * @param last End of range of elements to copy.
+     * @param alloc Allocator used for the arena.
+     */
+    template<class It>
+    basic_string_map(It first, It last, const allocator_type& alloc = allocator_type())
+        : arena_(alloc)
+    {
+        insert(first, last);
+    }
+
+    /**
+     * @brief Constructor with initializer list.
+     *
+     * Creates a map with a copy of the elements in the given initializer list.
+     *
+     * @param init Initializer list of elements to copy.
+     * @param alloc Allocator used for the arena.
+     */
+    basic_string_map(std::initializer_list<value_type> init, const allocator_type& alloc = allocator_type())
+        : basic_string_map(std::begin(init), std::end(init), alloc) { }
+
+    /**
+     * @brief Replaces content with initializer list.
+     *
+     * @param init Initializer list of elements to copy.
+     * @return Reference to @c this map.
+     */
+    basic_string_map& operator=(std::initializer_list<value_type> init) {
+        clear();
+        insert(init);
+        return *this;
+    }
+
+    /**
+     * @brief Iterator to beginning of map. Sorts the map if needed.
+     */
+    iterator begin() {
+        sort_if_needed();
+        return iterator(arena_.chars(), arena_.entries().data(), 0);
+    }
+    /// @copydoc begin()
+    const_iterator begin() const {
+        sort_if_needed();
+        return const_iterator(arena_.chars(), arena_.entries().data(), 0);
+    }
+    /// @copydoc begin()
+    const_iterator cbegin() const {
+        return begin();
+    }
+
+    /**
+     * @brief Iterator to end of map. Sorts the map if needed.
+     */
+    iterator end() {
+        return std::next(begin(), static_cast<difference_type>(arena_.entries().size()));
+    }
+    /// @copydoc end()
+    const_iterator end() const {
+        return std::next(begin(), static_cast<difference_type>(arena_.entries().size()));
+    }
+    /// @copydoc end()
+    const_iterator cend() const {
+        return end();
+    }
+
+    /**
+     * @brief Reverse iterator to beginning of map. Sorts the map if needed.
+     */
+    reverse_iterator rbegin() {
+        return reverse_iterator(end());
+    }
+    /// @copydoc rbegin()
+    const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+    /// @copydoc rbegin()
+    const_reverse_iterator crbegin() const {
+        return rbegin();
+    }
+
+    /**
+     * @brief Reverse iterator to end of map. Sorts the map if needed.
+     */
+    reverse_iterator rend() {
+        return reverse_iterator(begin());
+    }
+    /// @copydoc rend()
+    const_reverse_iterator rend() const {
+        return const_reverse_iterator(begin());
+    }
+    /// @copydoc rend()
+    const_reverse_iterator crend() const {
+        return rend();
+    }
+
+    /**
+     * @brief Checks if map is empty.
+     *
+     * @remark Does not sort the map.
+     */
+    bool empty() const {
+        return arena_.entries().empty();
+    }
+
+    /**
+     * @brief Number of elements in map. Sorts the map if needed
+     *        to remove duplicate keys.
+     */
+    size_type size() const {
+        sort_if_needed();
+        return arena_.entries().size();
+    }
+
+    /**
+     * @brief Number of characters stored for keys in map. Sorts the map
+     *        if needed to remove duplicate keys.
+     *
+     * Does not include characters of keys that have been erased but not reclaimed.
+     */
+    size_type char_count() const {
+        sort_if_needed();
+        return arena_.char_count();
+    }
+
+    /**
+     * @brief Reserves space for elements.
+     *
+     * @param new_cap Number of elements to reserve space for.
+     * @param new_char_cap Number of characters of all keys to reserve space for.
+     */
+    void reserve(size_type new_cap, size_type new_char_cap = 0) {
+        arena_.reserve(new_cap, new_char_cap);
+    }
+
+    /**
+     * @brief Capacity of map, in number of elements.
+     */
+    size_type capacity() const {
+        return arena_.entries().capacity();
+    }
+
+    /**
+     * @brief Shrinks internal arrays to fit elements. Sorts the map if needed.
+     *
+     * Also reclaims characters of keys that have been erased.
+     */
+    void shrink_to_fit() {
+        sort_if_needed();
+        arena_.shrink_to_fit();
+    }
+
+    /**
+     * @brief Inserts an element in the map.
+     *
+     * If the key already exists, insertion will be ignored when the map is sorted.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param value Element to insert.
+     * @remark In order to support lazy sorting, this method returns @c void.
+     */
+    template<class P, class = std::enable_if_t<std::is_constructible<key_reference, const typename std::decay_t<P>::first_type&>::value, void>>
+    void insert(P&& value) {
+        emplace(value.first, std::forward<P>(value).second);
+    }
+    /// @copydoc insert(P&&)
+    void insert(const value_type& value) {
+        emplace(value.first, value.second);
+    }
+
+    /**
+     * @brief Inserts elements in the map.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param first Beginning of range of elements to insert.
+     * @param last End of range of elements to insert.
+     */
+    template<class It>
+    void insert(It first, It last) {
+        for (; first != last; ++first) {
+            insert(*first);
+        }
+    }
+    /// @copydoc insert(It, It)
+    void insert(std::initializer_list<value_type> init) {
+        insert(std::begin(init), std::end(init));
+    }
+
+    /**
+     * @brief Inserts an element in the map by constructing its mapped value in-place.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param key Key of element to insert; its characters are copied to the arena.
+     * @param args Arguments used to construct mapped value.
+     * @remark In order to support lazy sorting, this method returns @c void.
+     */
+    template<class... Args>
+    void emplace(key_reference key, Args&&... args) {
+        arena_.append(key, std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Removes an element from the map.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param pos Iterator pointing to element to remove.
+     * @return Iterator pointing to element after the one removed.
+     */
+    iterator erase(const_iterator pos) {
+        return erase(pos, std::next(pos));
+    }
+
+    /**
+     * @brief Removes a range of elements from the map.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param first Beginning of range of elements to remove.
+     * @param last End of range of elements to remove.
+     * @return Iterator pointing to element after the last one removed.
+     */
+    iterator erase(const_iterator first, const_iterator last) {
+        arena_.erase(first.position(), last.position());
+        return iterator(arena_.chars(), arena_.entries().data(), static_cast<difference_type>(first.position()));
+    }
+
+    /**
+     * @brief Removes an element from the map by key. Sorts the map if needed.
+     *
+     * @param key Key of element to remove.
+     * @return Number of elements removed (0 or 1).
+     */
+    size_type erase(key_reference key) {
+        const size_type pos = find_pos(key);
+        if (pos == arena_.entries().size()) {
+            return 0;
+        }
+        arena_.erase(pos, pos + 1);
+        return 1;
+    }
+
+    /**
+     * @brief Removes all elements from the map.
+     */
+    void clear() {
+        arena_.clear();
+    }
+
+    /**
+     * @brief Swaps the content of two maps.
+     *
+     * @param right Other map to swap with.
+     */
+    void swap(basic_string_map& right) {
+        arena_.swap(right.arena_);
+    }
+    /// @copydoc swap()
+    friend void swap(basic_string_map& left, basic_string_map& right) {
+        left.swap(right);
+    }
+
+    /**
+     * @brief Returns a reference to the value mapped to a key, inserting a
+     *        default-constructed value if it does not exist. Sorts the map if needed.
+     *
+     * If the key does not exist, it is inserted at its sorted position.
+     *
+     * @note Invalidates all iterators and references if the key is inserted.
+     *
+     * @param key Key to look for.
+     * @return Reference to mapped value.
+     */
+    mapped_type& operator[](key_reference key) {
+        sort_if_needed();
+        const size_type pos = arena_.lower_bound_pos(key);
+        auto& entries = arena_.entries();
+        if (pos == entries.size() || arena_.ref(entries[pos]) != key) {
+            arena_.insert_sorted(pos, key);
+        }
+        return entries[pos].value;
+    }
+
+    /**
+     * @brief Returns a reference to the value mapped to a key. Sorts the map if needed.
+     *
+     * @param key Key to look for.
+     * @return Reference to mapped value.
+     * @throw coveo::lazy::out_of_range No element exists with the given key.
+     */
+    mapped_type& at(key_reference key) {
+        return const_cast<mapped_type&>(static_cast<const basic_string_map&>(*this).at(key));
+    }
+    /// @copydoc at()
+    const mapped_type& at(key_reference key) const {
+        const size_type pos = find_pos(key);
+        if (pos == arena_.entries().size()) {
+            throw coveo::lazy::out_of_range("out_of_range");
+        }
+        return arena_.entries()[pos].value;
+    }
+
+    /**
+     * @brief Returns the number of elements with a given key. Sorts the map if needed.
+     *
+     * @param key Key to look for.
+     * @return Number of elements with key @c key (0 or 1).
+     */
+    size_type count(key_reference key) const {
+        return find_pos(key) != arena_.entries().size() ? 1 : 0;
+    }
+
+    /**
+     * @brief Looks for an element by key. Sorts the map if needed.
+     *
+     * @param key Key to look for.
+     * @return Iterator pointing to element, or <tt>end()</tt> if not found.
+     */
+    iterator find(key_reference key) {
+        const size_type pos = find_pos(key);
+        return iterator(arena_.chars(), arena_.entries().data(), static_cast<difference_type>(pos));
+    }
+    /// @copydoc find()
+    const_iterator find(key_reference key) const {
+        const size_type pos = find_pos(key);
+        return const_iterator(arena_.chars(), arena_.entries().data(), static_cast<difference_type>(pos));
+    }
+
+    /**
+     * @brief Returns an iterator to the first element whose key is not less than a key.
+     *        Sorts the map if needed.
+     *
+     * @param key Key to look for.
+     * @return Iterator to lower bound of @c key.
+     */
+    iterator lower_bound(key_reference key) {
+        sort_if_needed();
+        return std::next(begin(), static_cast<difference_type>(arena_.lower_bound_pos(key)));
+    }
+    /// @copydoc lower_bound()
+    const_iterator lower_bound(key_reference key) const {
+        sort_if_needed();
+        return std::next(begin(), static_cast<difference_type>(arena_.lower_bound_pos(key)));
+    }
+
+    /**
+     * @brief Returns an iterator to the first element whose key is greater than a key.
+     *        Sorts the map if needed.
+     *
+     * @param key Key to look for.
+     * @return Iterator to upper bound of @c key.
+     */
+    iterator upper_bound(key_reference key) {
+        sort_if_needed();
+        return std::next(begin(), static_cast<difference_type>(arena_.upper_bound_pos(key)));
+    }
+    /// @copydoc upper_bound()
+    const_iterator upper_bound(key_reference key) const {
+        sort_if_needed();
+        return std::next(begin(), static_cast<difference_type>(arena_.upper_bound_pos(key)));
+    }
+
+    /**
+     * @brief Returns the range of elements with a given key. Sorts the map if needed.
+     *
+     * @param key Key to look for.
+     * @return Pair of iterators to lower and upper bound of @c key.
+     */
+    std::pair<iterator, iterator> equal_range(key_reference key) {
+        return std::make_pair(lower_bound(key), upper_bound(key));
+    }
+    /// @copydoc equal_range()
+    std::pair<const_iterator, const_iterator> equal_range(key_reference key) const {
+        return std::make_pair(lower_bound(key), upper_bound(key));
+    }
+
+    /**
+     * @brief Returns a copy of the arena's allocator.
+     */
+    allocator_type get_allocator() const {
+        return arena_.get_allocator();
+    }
+
+    /**
+     * @brief Sorts the map if needed.
+     *
+     * Sorts the map and removes duplicate keys, keeping the first one inserted.
+     * Normally, this is performed automatically when needed, but it can
+     * be called explicitly.
+     */
+    void sort() const {
+        sort_if_needed();
+    }
+
+    /**
+     * @brief Checks if the map is sorted.
+     */
+    bool sorted() const {
+        return arena_.sorted();
+    }
+
+    /**
+     * @brief Equality operator.
+     *
+     * Compares two maps element-wise. Both maps are sorted if needed.
+     */
+    friend bool operator==(const basic_string_map& left, const basic_string_map& right) {
+        return left.size() == right.size() && std::equal(left.begin(), left.end(), right.begin());
+    }
+    /// @copydoc operator==()
+    friend bool operator!=(const basic_string_map& left, const basic_string_map& right) {
+        return !(left == right);
+    }
+
+private:
+    // Sorts the map if it is not already sorted.
+    void sort_if_needed() const {
+        arena_.sort();
+    }
+
+    // Position of a key in the (sorted) arena, or size if not found.
+    size_type find_pos(key_reference key) const {
+        sort_if_needed();
+        return arena_.find_pos(key);
+    }
+};
+
+/**
+ * @brief Lazy-sorted map with string keys using the default allocator.
+ * @headerfile string_map.h <coveo/lazy/string_map.h>
+ *
+ * Alternative to <tt>coveo::lazy::map<std::string, T></tt>. See
+ * <tt>coveo::lazy::basic_string_map</tt> for details.
+ *
+ * @tparam T Type of values bound to each key.
+ */
+template<class T>
+using string_map = basic_string_map<T>;
+
+} // lazy
+} // coveo
+
+#endif // COVEO_LAZY_STRING_MAP_H
@@ -0,0 +1,450 @@
+/**
+ * @file
+ * @brief Definition of a lazy-sorted set specialized for strings.
+ *
+ * This file contains the definition of <tt>coveo::lazy::basic_string_set</tt>
+ * and its alias <tt>coveo::lazy::string_set</tt>, a lazy-sorted set-like
+ * container that stores the characters of all its strings in a single
+ * contiguous array, instead of one heap-allocated <tt>std::string</tt> per
+ * element like <tt>coveo::lazy::set<std::string></tt> does.
+ *
+ * @copyright 2015-2016, Coveo Solutions Inc.
+ *            Distributed under the Apache License, Version 2.0 (see <a href="https://github.com/coveo/lazy/blob/master/LICENSE">LICENSE</a>).
+ */
+
+#ifndef COVEO_LAZY_STRING_SET_H
+#define COVEO_LAZY_STRING_SET_H
+
+#include <coveo/lazy/detail/string_arena.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace coveo {
+namespace lazy {
+
+/**
+ * @brief Set container specialized for strings that performs lazy sorting.
+ * @headerfile string_set.h <coveo/lazy/string_set.h>
+ *
+ * <tt>std::set<std::string></tt>-like container class that stores the characters
+ * of its strings in a single array (an "arena") and sorts them only when needed.
+ * Sorting can also be triggered on-demand.
+ *
+ * Compared to <tt>coveo::lazy::set<std::string></tt>, each string only costs
+ * its characters plus a 24-byte entry holding its position, size and first
+ * 8 bytes (its "prefix", stored as a big-endian integer). Sorting and lookups
+ * work on entries: most comparisons only look at prefixes, without following
+ * a pointer to the characters. New strings are sorted using a multikey quicksort,
+ * which looks at each character at most a few times, then merged with the
+ * strings that were already sorted.
+ *
+ * This class has the following differences compared to <tt>coveo::lazy::set<std::string></tt>:
+ *
+ * - Since no <tt>std::string</tt> is actually stored, iterators return a lightweight
+ *   reference to characters in the arena (@c reference) by value. It can be compared
+ *   with strings and converts implicitly to <tt>std::string</tt>. Like other
+ *   references, it is invalidated when the set is modified or sorted.
+ * - Strings are always compared byte-wise, like <tt>std::less<std::string></tt> does.
+ * - Erasing strings does not free their characters right away; those are reclaimed
+ *   when they account for more than half of the arena, or by <tt>shrink_to_fit()</tt>.
+ *
+ * Like other lazy-sorted containers, this class is not thread-safe, even for
+ * read access. See <tt>coveo::lazy::detail::lazy_sorted_container</tt> for details.
+ *
+ * @tparam _Alloc Allocator used for the arena. Defaults to <tt>std::allocator<char></tt>.
+ *                Also used (after rebinding) to allocate entries.
+ */
+template<class _Alloc = std::allocator<char>>
+class basic_string_set
+{
+    using arena_type = detail::string_arena<detail::string_arena_entry, _Alloc>;
+
+public:
+    using key_type                  = std::string;
+    using value_type                = std::string;
+    using size_type                 = std::size_t;
+    using difference_type           = std::ptrdiff_t;
+    using allocator_type            = _Alloc;
+    using iterator                  = detail::string_arena_iterator<detail::string_arena_entry, true>;
+    using const_iterator            = iterator;
+    using reference                 = detail::string_arena_ref;
+    using const_reference           = reference;
+    using reverse_iterator          = std::reverse_iterator<iterator>;
+    using const_reverse_iterator    = reverse_iterator;
+
+private:
+    mutable arena_type arena_;  // Strings, sorted or not.
+
+public:
+    /**
+     * @brief Default constructor.
+     *
+     * Creates an empty set.
+     *
+     * @param alloc Allocator used for the arena.
+     */
+    explicit basic_string_set(const allocator_type& alloc = allocator_type())
+        : arena_(alloc) { }
+
+    /**
+     * @brief Constructor with range.
+     *
+     * Creates a set with a copy of the strings in the given range.
+     *
+     * @param first Beginning of range of strings to copy.
+     * @param last End of range of strings to copy.
+     * @param alloc Allocator used for the arena.
+     */
+    template<class It>
+    basic_string_set(It first, It last, const allocator_type& alloc = allocator_type())
+        : arena_(alloc)
+    {
+        insert(first, last);
+    }
+
+    /**
+     * @brief Constructor with initializer list.
+     *
+     * Creates a set with a copy of the strings in the given initializer list.
+     *
+     * @param init Initializer list of strings to copy.
+     * @param alloc Allocator used for the arena.
+     */
+    basic_string_set(std::initializer_list<reference> init, const allocator_type& alloc = allocator_type())
+        : basic_string_set(std::begin(init), std::end(init), alloc) { }
+
+    /**
+     * @brief Replaces content with initializer list.
+     *
+     * @param init Initializer list of strings to copy.
+     * @return Reference to @c this set.
+     */
+    basic_string_set& operator=(std::initializer_list<reference> init) {
+        clear();
+        insert(init);
+        return *this;
+    }
+
+    /**
+     * @brief Iterator to beginning of set. Sorts the set if needed.
+     */
+    const_iterator begin() const {
+        sort_if_needed();
+        return const_iterator(arena_.chars(), arena_.entries().data(), 0);
+    }
+    /// @copydoc begin()
+    const_iterator cbegin() const {
+        return begin();
+    }
+
+    /**
+     * @brief Iterator to end of set. Sorts the set if needed.
+     */
+    const_iterator end() const {
+        sort_if_needed();
+        return const_iterator(arena_.chars(), arena_.entries().data(),
+                              static_cast<difference_type>(arena_.entries().size()));
+    }
+    /// @copydoc end()
+    const_iterator cend() const {
+        return end();
+    }
+
+    /**
+     * @brief Reverse iterator to beginning of set. Sorts the set if needed.
+     */
+    const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+    /// @copydoc rbegin()
+    const_reverse_iterator crbegin() const {
+        return rbegin();
+    }
+
+    /**
+     * @brief Reverse iterator to end of set. Sorts the set if needed.
+     */
+    const_reverse_iterator rend() const {
+        return const_reverse_iterator(begin());
+    }
+    /// @copydoc rend()
+    const_reverse_iterator crend() const {
+        return rend();
+    }
+
+    /**
+     * @brief Checks if set is empty.
+     *
+     * @remark Does not sort the set.
+     */
+    bool empty() const {
+        return arena_.entries().empty();
+    }
+
+    /**
+     * @brief Number of strings in set. Sorts the set if needed
+     *        to remove duplicates.
+     */
+    size_type size() const {
+        sort_if_needed();
+        return arena_.entries().size();
+    }
+
+    /**
+     * @brief Number of characters stored for strings in set. Sorts the set
+     *        if needed to remove duplicates.
+     *
+     * Does not include characters of strings that have been erased but not reclaimed.
+     */
+    size_type char_count() const {
+        sort_if_needed();
+        return arena_.char_count();
+    }
+
+    /**
+     * @brief Reserves space for strings.
+     *
+     * @param new_cap Number of strings to reserve space for.
+     * @param new_char_cap Number of characters of all strings to reserve space for.
+     */
+    void reserve(size_type new_cap, size_type new_char_cap = 0) {
+        arena_.reserve(new_cap, new_char_cap);
+    }
+
+    /**
+     * @brief Capacity of set, in number of strings.
+     */
+    size_type capacity() const {
+        return arena_.entries().capacity();
+    }
+
+    /**
+     * @brief Shrinks internal arrays to fit strings. Sorts the set if needed.
+     *
+     * Also reclaims characters of strings that have been erased.
+     */
+    void shrink_to_fit() {
+        sort_if_needed();
+        arena_.shrink_to_fit();
+    }
+
+    /**
+     * @brief Inserts a string in the set.
+     *
+     * Characters are copied to the arena. If the string already exists,
+     * it will be removed when the set is sorted.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param str String to insert; can be a <tt>std::string</tt>, a null-terminated
+     *            string or a reference to a string in another set.
+     * @remark In order to support lazy sorting, this method returns @c void.
+     */
+    void insert(reference str) {
+        arena_.append(str);
+    }
+
+    /**
+     * @brief Inserts strings in the set.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param first Beginning of range of strings to insert.
+     * @param last End of range of strings to insert.
+     */
+    template<class It>
+    void insert(It first, It last) {
+        for (; first != last; ++first) {
+            insert(*first);
+        }
+    }
+    /// @copydoc insert(It, It)
+    void insert(std::initializer_list<reference> init) {
+        insert(std::begin(init), std::end(init));
+    }
+
+    /**
+     * @brief Removes a string from the set.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param pos Iterator pointing to string to remove.
+     * @return Iterator pointing to string after the one removed.
+     */
+    iterator erase(const_iterator pos) {
+        return erase(pos, std::next(pos));
+    }
+
+    /**
+     * @brief Removes a range of strings from the set.
+     *
+     * @note Invalidates all iterators and references.
+     *
+     * @param first Beginning of range of strings to remove.
+     * @param last End of range of strings to remove.
+     * @return Iterator pointing to string after the last one removed.
+     */
+    iterator erase(const_iterator first, const_iterator last) {
+        arena_.erase(first.position(), last.position());
+        return iterator(arena_.chars(), arena_.entries().data(), static_cast<difference_type>(first.position()));
+    }
+
+    /**
+     * @brief Removes a string from the set by value. Sorts the set if needed.
+     *
+     * @param str String to remove.
+     * @return Number of strings removed (0 or 1).
+     */
+    size_type erase(reference str) {
+        const size_type pos = find_pos(str);
+        if (pos == arena_.entries().size()) {
+            return 0;
+        }
+        arena_.erase(pos, pos + 1);
+        return 1;
+    }
+
+    /**
+     * @brief Removes all strings from the set.
+     */
+    void clear() {
+        arena_.clear();
+    }
+
+    /**
+     * @brief Swaps the content of two sets.
+     *
+     * @param right Other set to swap with.
+     */
+    void swap(basic_string_set& right) {
+        arena_.swap(right.arena_);
+    }
+    /// @copydoc swap()
+    friend void swap(basic_string_set& left, basic_string_set& right) {
+        left.swap(right);
+    }
+
+    /**
+     * @brief Returns the number of strings equal to a string. Sorts the set if needed.
+     *
+     * @param str String to look for.
+     * @return 1 if @c str is in the set, 0 otherwise.
+     */
+    size_type count(reference str) const {
+        return find_pos(str) != arena_.entries().size() ? 1 : 0;
+    }
+
+    /**
+     * @brief Looks for a string. Sorts the set if needed.
+     *
+     * @param str String to look for.
+     * @return Iterator pointing to string, or <tt>end()</tt> if not found.
+     */
+    const_iterator find(reference str) const {
+        const size_type pos = find_pos(str);
+        return const_iterator(arena_.chars(), arena_.entries().data(), static_cast<difference_type>(pos));
+    }
+
+    /**
+     * @brief Returns an iterator to the first string not less than a string.
+     *        Sorts the set if needed.
+     *
+     * @param str String to look for.
+     * @return Iterator to lower bound of @c str.
+     */
+    const_iterator lower_bound(reference str) const {
+        sort_if_needed();
+        return std::next(begin(), static_cast<difference_type>(arena_.lower_bound_pos(str)));
+    }
+
+    /**
+     * @brief Returns an iterator to the first string greater than a string.
+     *        Sorts the set if needed.
+     *
+     * @param str String to look for.
+     * @return Iterator to upper bound of @c str.
+     */
+    const_iterator upper_bound(reference str) const {
+        sort_if_needed();
+        return std::next(begin(), static_cast<difference_type>(arena_.upper_bound_pos(str)));
+    }
+
+    /**
+     * @brief Returns the range of strings equal to a string. Sorts the set if needed.
+     *
+     * @param str String to look for.
+     * @return Pair of iterators to lower and upper bound of @c str.
+     */
+    std::pair<const_iterator, const_iterator> equal_range(reference str) const {
+        return std::make_pair(lower_bound(str), upper_bound(str));
+    }
+
+    /**
+     * @brief Returns a copy of the arena's allocator.
+     */
+    allocator_type get_allocator() const {
+        return arena_.get_allocator();
+    }
+
+    /**
+     * @brief Sorts the set if needed.
+     *
+     * Sorts the set and removes duplicates. Normally, this is performed
+     * automatically when needed, but it can be called explicitly.
+     */
+    void sort() const {
+        sort_if_needed();
+    }
+
+    /**
+     * @brief Checks if the set is sorted.
+     */
+    bool sorted() const {
+        return arena_.sorted();
+    }
+
+    /**
+     * @brief Equality operator.
+     *
+     * Compares two sets element-wise. Both sets are sorted if needed.
+     */
+    friend bool operator==(const basic_string_set& left, const basic_string_set& right) {
+        return left.size() == right.size() && std::equal(left.begin(), left.end(), right.begin());
+    }
+    /// @copydoc operator==()
+    friend bool operator!=(const basic_string_set& left, const basic_string_set& right) {
+        return !(left == right);
+    }
+
+private:
+    // Sorts the set if it is not already sorted.
+    void sort_if_needed() const {
+        arena_.sort();
+    }
+
+    // Position of a string in the (sorted) arena, or size if not found.
+    size_type find_pos(reference str) const {
+        sort_if_needed();
+        return arena_.find_pos(str);
+    }
+};
+
+/**
+ * @brief Lazy-sorted set of strings using the default allocator.
+ * @headerfile string_set.h <coveo/lazy/string_set.h>
+ *
+ * Drop-in alternative to <tt>coveo::lazy::set<std::string></tt>. See
+ * <tt>coveo::lazy::basic_string_set</tt> for details.
+ */
+using string_set = basic_string_set<>;
+
+} // lazy
+} // coveo
+
+#endif // COVEO_LAZY_STRING_SET_H
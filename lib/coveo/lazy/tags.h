@@ -0,0 +1,105 @@
+/**
+ * @file
+ * @brief Tag types used by lazy-sorted associative containers.
+ *
+ * @copyright 2015-2016, Coveo Solutions Inc.
+ *            Distributed under the Apache License, Version 2.0 (see <a href="https://github.com/coveo/lazy/blob/master/LICENSE">LICENSE</a>).
+ */
+
+#ifndef COVEO_LAZY_TAGS_H
+#define COVEO_LAZY_TAGS_H
+
+namespace coveo {
+namespace lazy {
+
+/**
+ * @brief Tag type for sorted input without duplicates.
+ * @headerfile tags.h <coveo/lazy/tags.h>
+ *
+ * Tag type used to tell a lazy-sorted container that a range of elements
+ * passed to a constructor or to <tt>insert()</tt> is already sorted according
+ * to the container's @c key_compare and does not contain duplicates. The
+ * container will trust this and will not sort those elements again.
+ *
+ * Mirrors <tt>sorted_unique_t</tt> from <tt>std::flat_map</tt>.
+ *
+ * @see coveo::lazy::sorted_unique
+ */
+struct sorted_unique_t {
+    explicit sorted_unique_t() = default;
+};
+
+/**
+ * @brief Tag for sorted input without duplicates.
+ * @headerfile tags.h <coveo/lazy/tags.h>
+ *
+ * Instance of @c sorted_unique_t that can be passed to constructors and
+ * to <tt>insert()</tt>:
+ *
+ * @code
+ *   // Snapshot was written in key order
+ *   coveo::lazy::set<int> s(coveo::lazy::sorted_unique, snapshot.begin(), snapshot.end());
+ * @endcode
+ */
+constexpr sorted_unique_t sorted_unique{};
+
+/**
+ * @brief Tag type for sorted input that may contain equivalent elements.
+ * @headerfile tags.h <coveo/lazy/tags.h>
+ *
+ * Tag type used to tell a lazy-sorted container that accepts duplicates
+ * (like <tt>coveo::lazy::multiset</tt>) that a range of elements passed to a
+ * constructor or to <tt>insert()</tt> is already sorted according to the
+ * container's @c key_compare. The container will trust this and will not
+ * sort those elements again.
+ *
+ * Mirrors <tt>sorted_equivalent_t</tt> from <tt>std::flat_multimap</tt>.
+ *
+ * @see coveo::lazy::sorted_equivalent
+ */
+struct sorted_equivalent_t {
+    explicit sorted_equivalent_t() = default;
+};
+
+/**
+ * @brief Tag for sorted input that may contain equivalent elements.
+ * @headerfile tags.h <coveo/lazy/tags.h>
+ *
+ * Instance of @c sorted_equivalent_t that can be passed to constructors
+ * and to <tt>insert()</tt> of containers that accept duplicates.
+ */
+constexpr sorted_equivalent_t sorted_equivalent{};
+
+/**
+ * @brief Tag type for input that is likely sorted.
+ * @headerfile tags.h <coveo/lazy/tags.h>
+ *
+ * Tag type used to tell a lazy-sorted container that a range of elements
+ * passed to <tt>insert()</tt> is likely to be sorted. Unlike with
+ * @c sorted_unique_t, this is not trusted: the container checks the order
+ * of the new elements with a linear scan, which is much cheaper than
+ * sorting them again later. Useful for feeds that are usually nearly sorted.
+ *
+ * @see coveo::lazy::check_sorted
+ */
+struct check_sorted_t {
+    explicit check_sorted_t() = default;
+};
+
+/**
+ * @brief Tag for input that is likely sorted.
+ * @headerfile tags.h <coveo/lazy/tags.h>
+ *
+ * Instance of @c check_sorted_t that can be passed to <tt>insert()</tt>:
+ *
+ * @code
+ *   // Events usually arrive in timestamp order
+ *   events.insert(coveo::lazy::check_sorted, batch.begin(), batch.end());
+ * @endcode
+ */
+constexpr check_sorted_t check_sorted{};
+
+} // lazy
+} // coveo
+
+#endif // COVEO_LAZY_TAGS_H
@@ -0,0 +1,85 @@
+// Copyright (c) 2015-2016, Coveo Solutions Inc.
+// Distributed under the Apache License, Version 2.0 (see LICENSE).
+
+// A relatively barebones benchmark framework.
+
+#ifndef COVEO_BENCHMARK_FRAMEWORK_H
+#define COVEO_BENCHMARK_FRAMEWORK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace coveo_tests {
+
+// Runs a benchmark once and prints the time it took.
+// The benchmark must return a value computed from its work
+// (so that it doesn't get optimized away); it is printed as well.
+template<typename F>
+void run_benchmark(const std::string& benchmark_name, const std::string& container_name, std::size_t size, F&& bench)
+{
+    auto start_marker = std::chrono::steady_clock::now();
+    std::size_t result = bench();
+    auto end_marker = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> elapsed_ms = end_marker - start_marker;
+    std::ostringstream oss;
+    oss << std::left << std::setw(24) << benchmark_name
+        << std::setw(40) << container_name
+        << std::right << std::setw(10) << size
+        << std::setw(14) << std::fixed << std::setprecision(3) << elapsed_ms.count() << "ms"
+        << "  (result: " << result << ")";
+    std::cout << oss.str() << std::endl;
+}
+
+// Converts random numbers to keys of a given type for benchmarks.
+template<typename K> struct benchmark_key;
+template<> struct benchmark_key<std::size_t> {
+    static const char* name() { return "size_t"; }
+    static std::size_t make(std::uint64_t value) { return static_cast<std::size_t>(value); }
+    static std::size_t checksum(std::size_t key) { return key; }
+};
+template<> struct benchmark_key<std::string> {
+    // Strings share a common prefix to make comparisons a bit more realistic.
+    static const char* name() { return "std::string"; }
+    static std::string make(std::uint64_t value) { return "benchmark/key/" + std::to_string(value); }
+    static std::size_t checksum(const std::string& key) { return key.size(); }
+};
+
+// Keys used by benchmarks: keys to insert and keys to look up.
+// About half the lookup keys are present in the keys to insert.
+template<typename K>
+struct benchmark_keys
+{
+    std::vector<K> keys;
+    std::vector<K> lookups;
+
+    explicit benchmark_keys(std::size_t size) {
+        std::mt19937_64 rand;
+        std::uniform_int_distribution<std::uint64_t> dist;
+        keys.reserve(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            keys.push_back(benchmark_key<K>::make(dist(rand)));
+        }
+        lookups.reserve(size);
+        std::uniform_int_distribution<std::size_t> dist_idx(0, size - 1);
+        for (std::size_t i = 0; i < size; ++i) {
+            if (i % 2 == 0) {
+                lookups.push_back(keys[dist_idx(rand)]);
+            } else {
+                lookups.push_back(benchmark_key<K>::make(dist(rand)));
+            }
+        }
+    }
+};
+
+} // namespace coveo_tests
+
+#endif // COVEO_BENCHMARK_FRAMEWORK_H
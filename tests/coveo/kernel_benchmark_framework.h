@@ -0,0 +1,341 @@
+// Copyright (c) 2015-2016, Coveo Solutions Inc.
+// Distributed under the Apache License, Version 2.0 (see LICENSE).
+
+// Framework for kernel-level benchmarks: instrumented types that count
+// comparisons, moves and copies, hardware cache-miss counters (on Linux,
+// when perf events are available) and JSON reports that can be compared
+// with a baseline to catch regressions.
+
+#ifndef COVEO_KERNEL_BENCHMARK_FRAMEWORK_H
+#define COVEO_KERNEL_BENCHMARK_FRAMEWORK_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#   include <linux/perf_event.h>
+#   include <sys/ioctl.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#   define COVEO_KERNEL_BENCHMARKS_PERF_EVENTS
+#endif
+
+namespace coveo_tests {
+
+// Counters incremented by the instrumented types below.
+struct kernel_counter_values
+{
+    std::uint64_t comparisons = 0;
+    std::uint64_t moves = 0;
+    std::uint64_t copies = 0;
+};
+inline kernel_counter_values& kernel_counters()
+{
+    static kernel_counter_values counters;
+    return counters;
+}
+
+// Key that counts the number of times it is moved or copied.
+struct counted_key
+{
+    std::uint64_t value = 0;
+
+    counted_key() = default;
+    explicit counted_key(std::uint64_t val) : value(val) { }
+    counted_key(const counted_key& obj) : value(obj.value) { ++kernel_counters().copies; }
+    counted_key(counted_key&& obj) noexcept : value(obj.value) { ++kernel_counters().moves; }
+    counted_key& operator=(const counted_key& obj) { value = obj.value; ++kernel_counters().copies; return *this; }
+    counted_key& operator=(counted_key&& obj) noexcept { value = obj.value; ++kernel_counters().moves; return *this; }
+};
+
+// Comparator for counted_key that counts the number of comparisons.
+struct counted_less
+{
+    bool operator()(const counted_key& left, const counted_key& right) const {
+        ++kernel_counters().comparisons;
+        return left.value < right.value;
+    }
+};
+
+// Counts cache misses of the calling thread using perf events, if available.
+class cache_miss_counter
+{
+public:
+    cache_miss_counter() {
+#ifdef COVEO_KERNEL_BENCHMARKS_PERF_EVENTS
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+    cache_miss_counter(const cache_miss_counter&) = delete;
+    cache_miss_counter& operator=(const cache_miss_counter&) = delete;
+    ~cache_miss_counter() {
+#ifdef COVEO_KERNEL_BENCHMARKS_PERF_EVENTS
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+#endif
+    }
+
+    bool available() const {
+        return fd_ >= 0;
+    }
+
+    void start() {
+#ifdef COVEO_KERNEL_BENCHMARKS_PERF_EVENTS
+        if (fd_ >= 0) {
+            ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    std::uint64_t stop() {
+        std::uint64_t count = 0;
+#ifdef COVEO_KERNEL_BENCHMARKS_PERF_EVENTS
+        if (fd_ >= 0) {
+            ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd_, &count, sizeof(count)) != static_cast<ssize_t>(sizeof(count))) {
+                count = 0;
+            }
+        }
+#endif
+        return count;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+// Per-operation costs measured by a kernel benchmark. An operation is one
+// element processed: sorted, looked up, inserted or moved, depending on the kernel.
+struct kernel_measurement
+{
+    double ns_per_op = 0;
+    double cache_misses_per_op = -1;    // Negative if cache misses could not be counted.
+    double comparisons_per_op = 0;
+    double moves_per_op = 0;
+    double copies_per_op = 0;
+};
+
+// Runs a kernel once, measuring its time, cache misses and instrumented counters.
+// Like benchmarks run by run_benchmark(), the kernel must return a value computed from its work.
+template<typename F>
+kernel_measurement measure_kernel(std::size_t ops, cache_miss_counter& misses, F&& kernel)
+{
+    static volatile std::size_t sink = 0;
+    kernel_counters() = kernel_counter_values();
+    misses.start();
+    auto start_marker = std::chrono::steady_clock::now();
+    sink = sink + kernel();
+    auto end_marker = std::chrono::steady_clock::now();
+    const std::uint64_t miss_count = misses.stop();
+    const std::chrono::duration<double, std::nano> elapsed_ns = end_marker - start_marker;
+
+    const double dops = static_cast<double>(ops != 0 ? ops : 1);
+    kernel_measurement m;
+    m.ns_per_op = elapsed_ns.count() / dops;
+    if (misses.available()) {
+        m.cache_misses_per_op = static_cast<double>(miss_count) / dops;
+    }
+    m.comparisons_per_op = static_cast<double>(kernel_counters().comparisons) / dops;
+    m.moves_per_op = static_cast<double>(kernel_counters().moves) / dops;
+    m.copies_per_op = static_cast<double>(kernel_counters().copies) / dops;
+    return m;
+}
+
+// Result of one kernel benchmark, as reported in JSON.
+struct kernel_result
+{
+    std::string kernel;
+    std::string container;
+    std::string distribution;
+    std::size_t size = 0;
+    std::size_t repetitions = 0;
+    kernel_measurement measurement;
+
+    std::string id() const {
+        return kernel + "|" + container + "|" + distribution + "|" + std::to_string(size);
+    }
+};
+
+// Prints one result as a line of the benchmark report.
+inline void print_kernel_result(const kernel_result& result)
+{
+    const kernel_measurement& m = result.measurement;
+    std::ostringstream oss;
+    oss << std::left << std::setw(20) << result.kernel
+        << std::setw(28) << result.container
+        << std::setw(16) << result.distribution
+        << std::right << std::setw(10) << result.size
+        << std::fixed << std::setprecision(2)
+        << std::setw(12) << m.ns_per_op << "ns"
+        << std::setw(10) << m.comparisons_per_op << "cmp"
+        << std::setw(10) << m.moves_per_op << "mov"
+        << std::setw(10) << m.copies_per_op << "cpy";
+    if (m.cache_misses_per_op >= 0) {
+        oss << std::setw(10) << m.cache_misses_per_op << "miss";
+    }
+    std::cout << oss.str() << std::endl;
+}
+
+// Writes results as JSON, with one result object per line
+// so that reports can be diffed and read back by read_kernel_baseline().
+inline void write_kernel_results_json(std::ostream& os, const std::vector<kernel_result>& results)
+{
+    auto quoted = [](const std::string& str) {
+        std::string res = "\"";
+        for (char c : str) {
+            if (c == '"' || c == '\\') {
+                res += '\\';
+            }
+            res += c;
+        }
+        return res + "\"";
+    };
+    os << "{" << std::endl
+       << "  \"benchmark\": \"coveo::lazy kernels\"," << std::endl
+       << "  \"results\": [" << std::endl;
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const kernel_result& r = results[i];
+        const kernel_measurement& m = r.measurement;
+        std::ostringstream line;
+        line << std::setprecision(6)
+             << "    {\"kernel\": " << quoted(r.kernel)
+             << ", \"container\": " << quoted(r.container)
+             << ", \"distribution\": " << quoted(r.distribution)
+             << ", \"size\": " << r.size
+             << ", \"repetitions\": " << r.repetitions
+             << ", \"ns_per_op\": " << m.ns_per_op
+             << ", \"comparisons_per_op\": " << m.comparisons_per_op
+             << ", \"moves_per_op\": " << m.moves_per_op
+             << ", \"copies_per_op\": " << m.copies_per_op
+             << ", \"cache_misses_per_op\": ";
+        if (m.cache_misses_per_op >= 0) {
+            line << m.cache_misses_per_op;
+        } else {
+            line << "null";
+        }
+        line << "}" << (i + 1 < results.size() ? "," : "");
+        os << line.str() << std::endl;
+    }
+    os << "  ]" << std::endl
+       << "}" << std::endl;
+}
+
+namespace detail {
+
+// Helpers to read fields of a result line written by write_kernel_results_json().
+inline bool read_json_string_field(const std::string& line, const std::string& name, std::string& value)
+{
+    const std::string marker = "\"" + name + "\": \"";
+    auto pos = line.find(marker);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    value.clear();
+    for (pos += marker.size(); pos < line.size() && line[pos] != '"'; ++pos) {
+        if (line[pos] == '\\' && pos + 1 < line.size()) {
+            ++pos;
+        }
+        value += line[pos];
+    }
+    return true;
+}
+inline bool read_json_number_field(const std::string& line, const std::string& name, double& value)
+{
+    const std::string marker = "\"" + name + "\": ";
+    auto pos = line.find(marker);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    const char* begin = line.c_str() + pos + marker.size();
+    char* end = nullptr;
+    value = std::strtod(begin, &end);
+    return end != begin;
+}
+
+} // namespace detail
+
+// Reads results from a JSON report written by write_kernel_results_json(), indexed by id.
+// Returns false if the file cannot be read.
+inline bool read_kernel_baseline(const std::string& path, std::map<std::string, kernel_result>& baseline)
+{
+    std::ifstream ifs(path);
+    if (!ifs) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(ifs, line)) {
+        kernel_result r;
+        double size = 0;
+        if (detail::read_json_string_field(line, "kernel", r.kernel) &&
+            detail::read_json_string_field(line, "container", r.container) &&
+            detail::read_json_string_field(line, "distribution", r.distribution) &&
+            detail::read_json_number_field(line, "size", size))
+        {
+            r.size = static_cast<std::size_t>(size);
+            kernel_measurement& m = r.measurement;
+            detail::read_json_number_field(line, "ns_per_op", m.ns_per_op);
+            detail::read_json_number_field(line, "comparisons_per_op", m.comparisons_per_op);
+            detail::read_json_number_field(line, "moves_per_op", m.moves_per_op);
+            detail::read_json_number_field(line, "copies_per_op", m.copies_per_op);
+            baseline[r.id()] = r;
+        }
+    }
+    return true;
+}
+
+// Compares results with a baseline and prints regressions. Comparisons, moves and copies
+// are deterministic, so they regress if they exceed the baseline by more than tolerance
+// (e.g. 0.05 for 5%). Times are only checked if time_tolerance is positive.
+// Returns the number of regressions found; results missing from baseline are ignored.
+inline std::size_t check_kernel_regressions(const std::vector<kernel_result>& results,
+                                            const std::map<std::string, kernel_result>& baseline,
+                                            double tolerance, double time_tolerance)
+{
+    std::size_t regressions = 0;
+    auto check = [&](const kernel_result& r, const char* what, double current, double base, double tol) {
+        // Small absolute slack so that counts that were 0 do not regress because of rounding.
+        if (current > base * (1.0 + tol) + 0.01) {
+            std::cerr << "Regression: " << r.id() << ": " << what << " "
+                      << base << " -> " << current << std::endl;
+            ++regressions;
+        }
+    };
+    for (const kernel_result& r : results) {
+        auto it = baseline.find(r.id());
+        if (it != baseline.end()) {
+            const kernel_measurement& cur = r.measurement;
+            const kernel_measurement& base = it->second.measurement;
+            check(r, "comparisons_per_op", cur.comparisons_per_op, base.comparisons_per_op, tolerance);
+            check(r, "moves_per_op", cur.moves_per_op, base.moves_per_op, tolerance);
+            check(r, "copies_per_op", cur.copies_per_op, base.copies_per_op, tolerance);
+            if (time_tolerance > 0) {
+                check(r, "ns_per_op", cur.ns_per_op, base.ns_per_op, time_tolerance);
+            }
+        }
+    }
+    return regressions;
+}
+
+} // namespace coveo_tests
+
+#endif // COVEO_KERNEL_BENCHMARK_FRAMEWORK_H
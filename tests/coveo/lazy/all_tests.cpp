@@ -15,15 +15,23 @@ void all_tests()
     // map/multimap
     map_tests();
     multimap_tests();
+    soa_map_tests();
+    string_map_tests();
 
     // set/multiset
     set_tests();
     multiset_tests();
+    small_vector_tests();
+    string_set_tests();
 }
 
 // Runs all benchmarks for coveo::lazy classes
 void all_benchmarks()
 {
+    // map/multimap
+    map_benchmarks();
+
+    // set/multiset
     set_benchmarks();
 }
 
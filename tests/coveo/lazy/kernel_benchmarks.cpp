@@ -0,0 +1,305 @@
+// Copyright (c) 2015-2016, Coveo Solutions Inc.
+// Distributed under the Apache License, Version 2.0 (see LICENSE).
+
+#include "coveo/lazy/kernel_benchmarks.h"
+
+#include <coveo/lazy/map.h>
+#include <coveo/lazy/search_policy.h>
+#include <coveo/lazy/set.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace coveo_tests {
+namespace lazy {
+namespace detail {
+
+// Distributions of keys inserted in containers by kernel benchmarks.
+enum class key_distribution { random, sorted, reverse, nearly_sorted, duplicates };
+
+const key_distribution all_distributions[] = {
+    key_distribution::random,
+    key_distribution::sorted,
+    key_distribution::reverse,
+    key_distribution::nearly_sorted,
+    key_distribution::duplicates,
+};
+
+const char* distribution_name(key_distribution dist)
+{
+    switch (dist) {
+        case key_distribution::random:          return "random";
+        case key_distribution::sorted:          return "sorted";
+        case key_distribution::reverse:         return "reverse";
+        case key_distribution::nearly_sorted:   return "nearly_sorted";
+        case key_distribution::duplicates:      return "duplicates";
+    }
+    return "unknown";
+}
+
+// Generates values following the given distribution. Always returns the same values for the same arguments.
+std::vector<std::uint64_t> make_values(key_distribution dist, std::size_t size)
+{
+    std::mt19937_64 rand;
+    std::vector<std::uint64_t> values(size);
+    switch (dist) {
+        case key_distribution::random: {
+            std::uniform_int_distribution<std::uint64_t> dist_val;
+            std::generate(values.begin(), values.end(), [&]() { return dist_val(rand); });
+            break;
+        }
+        case key_distribution::sorted:
+        case key_distribution::reverse:
+        case key_distribution::nearly_sorted: {
+            // Leave gaps between values so that some lookups miss.
+            for (std::size_t i = 0; i < size; ++i) {
+                values[i] = 2 * static_cast<std::uint64_t>(i);
+            }
+            if (dist == key_distribution::reverse) {
+                std::reverse(values.begin(), values.end());
+            } else if (dist == key_distribution::nearly_sorted && size > 1) {
+                // Swap about 1% of elements.
+                std::uniform_int_distribution<std::size_t> dist_idx(0, size - 1);
+                for (std::size_t i = 0; i < size / 100 + 1; ++i) {
+                    std::swap(values[dist_idx(rand)], values[dist_idx(rand)]);
+                }
+            }
+            break;
+        }
+        case key_distribution::duplicates: {
+            // About sqrt(size) distinct values, each repeated about sqrt(size) times.
+            const auto distinct = static_cast<std::uint64_t>(std::sqrt(static_cast<double>(size))) + 1;
+            std::uniform_int_distribution<std::uint64_t> dist_val(0, distinct - 1);
+            std::generate(values.begin(), values.end(), [&]() { return dist_val(rand); });
+            break;
+        }
+    }
+    return values;
+}
+
+// Generates values to look up: about half of them are present in values.
+std::vector<std::uint64_t> make_lookups(const std::vector<std::uint64_t>& values)
+{
+    std::mt19937_64 rand;
+    std::uniform_int_distribution<std::uint64_t> dist_val;
+    std::uniform_int_distribution<std::size_t> dist_idx(0, values.size() - 1);
+    std::vector<std::uint64_t> lookups;
+    lookups.reserve(values.size());
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        lookups.push_back(i % 2 == 0 ? values[dist_idx(rand)] : dist_val(rand));
+    }
+    return lookups;
+}
+
+// Key types used by kernels: plain keys are used to measure time, while
+// counted keys count comparisons, moves and copies. Note that counted keys
+// cannot be radix-sorted, so counts are those of comparison-based sorts.
+struct plain_keys
+{
+    using key = std::uint64_t;
+    using less = std::less<std::uint64_t>;
+    static key make(std::uint64_t val) { return val; }
+};
+struct counted_keys
+{
+    using key = counted_key;
+    using less = counted_less;
+    static key make(std::uint64_t val) { return counted_key(val); }
+};
+
+template<class Keys>
+std::vector<typename Keys::key> make_keys(const std::vector<std::uint64_t>& values)
+{
+    std::vector<typename Keys::key> keys;
+    keys.reserve(values.size());
+    for (std::uint64_t val : values) {
+        keys.push_back(Keys::make(val));
+    }
+    return keys;
+}
+
+// Kernel: sorting containers filled with unsorted elements (internal_sort()).
+template<class Container, class Keys>
+kernel_measurement sort_kernel(const std::vector<std::uint64_t>& values, std::size_t reps, cache_miss_counter& misses)
+{
+    const auto keys = make_keys<Keys>(values);
+    std::vector<Container> containers;
+    containers.reserve(reps);
+    for (std::size_t i = 0; i < reps; ++i) {
+        containers.emplace_back(keys.begin(), keys.end());
+    }
+    return measure_kernel(values.size() * reps, misses, [&]() {
+        std::size_t result = 0;
+        for (auto& c : containers) {
+            c.sort();
+            result += c.size();
+        }
+        return result;
+    });
+}
+
+// Kernel: lower_bound() on a sorted container.
+template<class Container, class Keys>
+kernel_measurement lower_bound_kernel(const std::vector<std::uint64_t>& values, std::size_t reps, cache_miss_counter& misses)
+{
+    const auto keys = make_keys<Keys>(values);
+    const auto lookups = make_keys<Keys>(make_lookups(values));
+    Container c(keys.begin(), keys.end());
+    c.sort();
+    c.lower_bound(lookups.front());     // Builds search index, if any.
+    return measure_kernel(lookups.size() * reps, misses, [&]() {
+        std::size_t result = 0;
+        for (std::size_t i = 0; i < reps; ++i) {
+            for (const auto& lookup : lookups) {
+                if (c.lower_bound(lookup) != c.end()) {
+                    ++result;
+                }
+            }
+        }
+        return result;
+    });
+}
+
+// Kernel: operator[] on initially-empty maps (operator_brackets_impl()).
+template<class Container, class Keys>
+kernel_measurement operator_brackets_kernel(const std::vector<std::uint64_t>& values, std::size_t reps, cache_miss_counter& misses)
+{
+    const auto keys = make_keys<Keys>(values);
+    std::vector<Container> containers(reps);
+    return measure_kernel(values.size() * reps, misses, [&]() {
+        std::size_t result = 0;
+        for (auto& c : containers) {
+            for (const auto& key : keys) {
+                result += ++c[key];
+            }
+        }
+        return result;
+    });
+}
+
+// Kernel: moving map_pair's in and out of a vector, like map containers do when sorting.
+template<class Keys>
+kernel_measurement map_pair_kernel(const std::vector<std::uint64_t>& values, std::size_t reps, cache_miss_counter& misses)
+{
+    using pair_type = coveo::lazy::detail::map_pair<typename Keys::key, std::string>;
+    std::vector<pair_type> elements;
+    elements.reserve(values.size());
+    for (std::uint64_t val : values) {
+        elements.emplace_back(Keys::make(val), std::to_string(val));
+    }
+    std::vector<pair_type> moved;
+    moved.reserve(values.size());
+    return measure_kernel(2 * values.size() * reps, misses, [&]() {
+        std::size_t result = 0;
+        for (std::size_t i = 0; i < reps; ++i) {
+            moved.clear();
+            for (auto& elem : elements) {
+                moved.emplace_back(std::move(elem));
+            }
+            std::move(moved.begin(), moved.end(), elements.begin());
+            result += elements.back().second.size();
+        }
+        return result;
+    });
+}
+
+// Kernel benchmark: runs a kernel with plain or counted keys.
+struct kernel_entry
+{
+    const char* kernel;
+    const char* container;
+    std::function<kernel_measurement(const std::vector<std::uint64_t>&, std::size_t, cache_miss_counter&)> run_plain;
+    std::function<kernel_measurement(const std::vector<std::uint64_t>&, std::size_t, cache_miss_counter&)> run_counted;
+};
+
+template<class Keys> using kernel_set = coveo::lazy::set<typename Keys::key, typename Keys::less>;
+template<class Keys> using kernel_multiset = coveo::lazy::multiset<typename Keys::key, typename Keys::less>;
+template<class Keys> using kernel_eytzinger_set =
+    coveo::lazy::set<typename Keys::key, typename Keys::less, std::vector,
+                     coveo::lazy::detail::equal_to_using_less_if_needed<typename Keys::key, typename Keys::less>,
+                     std::allocator<typename Keys::key>,
+                     coveo::lazy::default_sort_policy,
+                     coveo::lazy::no_sort_stats,
+                     coveo::lazy::eytzinger_search_policy<>>;
+template<class Keys> using kernel_map = coveo::lazy::map<typename Keys::key, std::size_t, typename Keys::less>;
+
+std::vector<kernel_entry> all_kernels()
+{
+    return {
+        { "sort", "coveo::lazy::set",
+          &sort_kernel<kernel_set<plain_keys>, plain_keys>,
+          &sort_kernel<kernel_set<counted_keys>, counted_keys> },
+        { "sort", "coveo::lazy::multiset",
+          &sort_kernel<kernel_multiset<plain_keys>, plain_keys>,
+          &sort_kernel<kernel_multiset<counted_keys>, counted_keys> },
+        { "lower_bound", "coveo::lazy::set",
+          &lower_bound_kernel<kernel_set<plain_keys>, plain_keys>,
+          &lower_bound_kernel<kernel_set<counted_keys>, counted_keys> },
+        { "lower_bound", "coveo::lazy::set<eytzinger>",
+          &lower_bound_kernel<kernel_eytzinger_set<plain_keys>, plain_keys>,
+          &lower_bound_kernel<kernel_eytzinger_set<counted_keys>, counted_keys> },
+        { "operator_brackets", "coveo::lazy::map",
+          &operator_brackets_kernel<kernel_map<plain_keys>, plain_keys>,
+          &operator_brackets_kernel<kernel_map<counted_keys>, counted_keys> },
+        { "map_pair_move", "detail::map_pair",
+          &map_pair_kernel<plain_keys>,
+          &map_pair_kernel<counted_keys> },
+    };
+}
+
+} // namespace detail
+
+// Runs kernel benchmarks for coveo::lazy classes. Each benchmark is run twice:
+// once with plain keys to measure time and cache misses, once with counted
+// keys to count comparisons, moves and copies.
+std::vector<kernel_result> kernel_benchmarks(const kernel_benchmark_options& options)
+{
+    cache_miss_counter misses;
+    if (!misses.available()) {
+        std::cout << "Cache misses cannot be counted (perf events unavailable)." << std::endl;
+    }
+
+    std::vector<kernel_result> results;
+    for (const auto& entry : detail::all_kernels()) {
+        if (!options.kernel.empty() && options.kernel != entry.kernel) {
+            continue;
+        }
+        for (auto dist : detail::all_distributions) {
+            if (!options.distribution.empty() && options.distribution != detail::distribution_name(dist)) {
+                continue;
+            }
+            for (std::size_t size = 1; size <= options.max_size; size *= 10) {
+                if (size < options.min_size) {
+                    continue;
+                }
+                const auto values = detail::make_values(dist, size);
+                kernel_result result;
+                result.kernel = entry.kernel;
+                result.container = entry.container;
+                result.distribution = detail::distribution_name(dist);
+                result.size = size;
+                result.repetitions = std::max<std::size_t>(1, options.min_ops / size);
+                result.measurement = entry.run_plain(values, result.repetitions, misses);
+
+                const auto counted = entry.run_counted(values, std::max<std::size_t>(1, options.min_counted_ops / size), misses);
+                result.measurement.comparisons_per_op = counted.comparisons_per_op;
+                result.measurement.moves_per_op = counted.moves_per_op;
+                result.measurement.copies_per_op = counted.copies_per_op;
+
+                print_kernel_result(result);
+                results.push_back(result);
+            }
+        }
+        std::cout << std::endl;
+    }
+    return results;
+}
+
+} // lazy
+} // coveo_tests
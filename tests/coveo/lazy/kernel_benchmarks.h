@@ -0,0 +1,33 @@
+// Copyright (c) 2015-2016, Coveo Solutions Inc.
+// Distributed under the Apache License, Version 2.0 (see LICENSE).
+
+#ifndef COVEO_LAZY_KERNEL_BENCHMARKS_H
+#define COVEO_LAZY_KERNEL_BENCHMARKS_H
+
+#include <coveo/kernel_benchmark_framework.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace coveo_tests {
+namespace lazy {
+
+// Options controlling which kernel benchmarks are run.
+struct kernel_benchmark_options
+{
+    std::size_t min_size = 10;                  // Smallest number of elements (sizes are powers of 10).
+    std::size_t max_size = 1000000;             // Largest number of elements.
+    std::size_t min_ops = 1000000;              // Minimum number of timed operations per benchmark.
+    std::size_t min_counted_ops = 10000;        // Minimum number of operations for the instrumented pass.
+    std::string kernel;                         // If not empty, only run this kernel.
+    std::string distribution;                   // If not empty, only use this distribution.
+};
+
+// Runs kernel benchmarks for coveo::lazy classes and returns their results.
+std::vector<kernel_result> kernel_benchmarks(const kernel_benchmark_options& options);
+
+} // lazy
+} // coveo_tests
+
+#endif // COVEO_LAZY_KERNEL_BENCHMARKS_H
@@ -3,14 +3,34 @@
 
 #include "coveo/lazy/map_tests.h"
 
+#include <coveo/lazy/adaptive.h>
+#include <coveo/lazy/concurrent.h>
 #include <coveo/lazy/map.h>
+#include <coveo/lazy/small_vector.h>
+#include <coveo/lazy/soa_map.h>
+#include <coveo/lazy/string_map.h>
+#include <coveo/benchmark_framework.h>
 #include <coveo/test_framework.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <initializer_list>
 #include <iterator>
 #include <list>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <utility>
 
@@ -51,6 +71,168 @@ public:
     }
 };
 
+// Performs a suite of benchmarks on a map-like container: bulk load,
+// insert then lookup, interleaved inserts and lookups, iteration and erase.
+template<class MapT, class K>
+void benchmark_map_suite(const std::string& container_name, const coveo_tests::benchmark_keys<K>& bk)
+{
+    typedef MapT map_type;
+    const std::size_t size = bk.keys.size();
+
+    std::vector<std::pair<K, std::size_t>> elems;
+    elems.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        elems.emplace_back(bk.keys[i], i);
+    }
+
+    coveo_tests::run_benchmark("bulk load", container_name, size, [&]() {
+        map_type m(elems.cbegin(), elems.cend());
+        return static_cast<std::size_t>(m.count(bk.keys.front()));
+    });
+    coveo_tests::run_benchmark("insert then lookup", container_name, size, [&]() {
+        map_type m;
+        for (auto&& elem : elems) {
+            m.emplace(elem.first, elem.second);
+        }
+        std::size_t num_found = 0;
+        for (auto&& key : bk.lookups) {
+            if (m.find(key) != m.end()) {
+                ++num_found;
+            }
+        }
+        return num_found;
+    });
+
+    // Interleaving inserts and lookups is the worst case for lazy containers,
+    // since they need to sort often; limit the number of inserts to keep it reasonable.
+    const std::size_t interleaved_size = std::min<std::size_t>(size, 10000);
+    const std::pair<std::size_t, std::size_t> ratios[] = { { 1, 1 }, { 1, 10 }, { 10, 1 }, { 100, 1 } };
+    for (auto&& ratio : ratios) {
+        const std::string benchmark_name = "interleaved " + std::to_string(ratio.first) +
+                                           ":" + std::to_string(ratio.second);
+        coveo_tests::run_benchmark(benchmark_name, container_name, interleaved_size, [&]() {
+            map_type m;
+            std::size_t num_found = 0;
+            std::size_t elem_idx = 0, lookup_idx = 0;
+            while (elem_idx < interleaved_size) {
+                for (std::size_t i = 0; i < ratio.first && elem_idx < interleaved_size; ++i, ++elem_idx) {
+                    m.emplace(elems[elem_idx].first, elems[elem_idx].second);
+                }
+                for (std::size_t i = 0; i < ratio.second; ++i) {
+                    if (m.find(bk.lookups[lookup_idx++ % interleaved_size]) != m.end()) {
+                        ++num_found;
+                    }
+                }
+            }
+            return num_found;
+        });
+    }
+
+    {
+        map_type m(elems.cbegin(), elems.cend());
+        m.find(bk.keys.front());
+        coveo_tests::run_benchmark("iteration", container_name, size, [&]() {
+            std::size_t checksum = 0;
+            for (auto&& elem : m) {
+                checksum += coveo_tests::benchmark_key<K>::checksum(elem.first) + elem.second;
+            }
+            return checksum;
+        });
+        coveo_tests::run_benchmark("erase(key)", container_name, size, [&]() {
+            std::size_t num_erased = 0;
+            for (auto&& key : bk.lookups) {
+                num_erased += m.erase(key);
+            }
+            return num_erased;
+        });
+    }
+}
+
+// Performs a benchmark of operator[] on a map-like container that does not accept duplicates.
+template<class MapT, class K>
+void benchmark_map_operator_brackets(const std::string& container_name, const coveo_tests::benchmark_keys<K>& bk)
+{
+    typedef MapT map_type;
+    const std::size_t size = bk.keys.size();
+
+    // operator[] merges new keys in lazy maps about every sqrt(n) inserts, so limit the number of keys.
+    const std::size_t brackets_size = std::min<std::size_t>(size, 100000);
+    coveo_tests::run_benchmark("operator[]", container_name, brackets_size, [&]() {
+        map_type m;
+        for (std::size_t i = 0; i < brackets_size; ++i) {
+            ++m[bk.keys[i]];
+        }
+        std::size_t checksum = 0;
+        for (std::size_t i = 0; i < brackets_size; ++i) {
+            checksum += m[bk.lookups[i]];
+        }
+        return checksum;
+    });
+}
+
+// Performs benchmark suites for coveo::lazy::string_map, which only supports string keys.
+template<class K>
+void benchmark_string_map_suite(const coveo_tests::benchmark_keys<K>&)
+{
+}
+inline void benchmark_string_map_suite(const coveo_tests::benchmark_keys<std::string>& bk)
+{
+    typedef coveo::lazy::string_map<std::size_t> string_map_type;
+    benchmark_map_suite<string_map_type>("coveo::lazy::string_map<std::size_t>", bk);
+    benchmark_map_operator_brackets<string_map_type>("coveo::lazy::string_map<std::size_t>", bk);
+}
+
+// Performs benchmark suites for map-like containers using keys of the given type.
+template<class K>
+void benchmark_map_suites_for_key()
+{
+    typedef std::map<K, std::size_t>                std_map_type;
+    typedef std::unordered_map<K, std::size_t>      std_unordered_map_type;
+    typedef coveo::lazy::map<K, std::size_t>        lazy_map_type;
+    typedef std::multimap<K, std::size_t>           std_multimap_type;
+    typedef coveo::lazy::multimap<K, std::size_t>   lazy_multimap_type;
+    typedef coveo::lazy::soa_map<K, std::size_t>    soa_map_type;
+
+    const std::string key_name = coveo_tests::benchmark_key<K>::name();
+    const std::size_t sizes[] = { 1000, 100000, 1000000 };
+    for (std::size_t size : sizes) {
+        coveo_tests::benchmark_keys<K> bk(size);
+        benchmark_map_suite<std_map_type>("std::map<" + key_name + ">", bk);
+        benchmark_map_operator_brackets<std_map_type>("std::map<" + key_name + ">", bk);
+        benchmark_map_suite<std_unordered_map_type>("std::unordered_map<" + key_name + ">", bk);
+        benchmark_map_operator_brackets<std_unordered_map_type>("std::unordered_map<" + key_name + ">", bk);
+        benchmark_map_suite<lazy_map_type>("coveo::lazy::map<" + key_name + ">", bk);
+        benchmark_map_operator_brackets<lazy_map_type>("coveo::lazy::map<" + key_name + ">", bk);
+        benchmark_map_suite<soa_map_type>("coveo::lazy::soa_map<" + key_name + ">", bk);
+        benchmark_map_operator_brackets<soa_map_type>("coveo::lazy::soa_map<" + key_name + ">", bk);
+        benchmark_string_map_suite(bk);
+        benchmark_map_suite<std_multimap_type>("std::multimap<" + key_name + ">", bk);
+        benchmark_map_suite<lazy_multimap_type>("coveo::lazy::multimap<" + key_name + ">", bk);
+        std::cout << std::endl;
+    }
+}
+
+// Mapped type that counts the number of times it is copied.
+struct copy_counter
+{
+    static std::size_t copies;
+
+    copy_counter() = default;
+    copy_counter(const copy_counter&) { ++copies; }
+    copy_counter(copy_counter&&) noexcept { }
+    copy_counter& operator=(const copy_counter&) { ++copies; return *this; }
+    copy_counter& operator=(copy_counter&&) noexcept { return *this; }
+};
+std::size_t copy_counter::copies = 0;
+
+// Key predicate that only compares the last digit of integers.
+struct last_digit_less
+{
+    bool operator()(int left, int right) const {
+        return left % 10 < right % 10;
+    }
+};
+
 } // namespace detail
 
 // Tests for coveo::lazy::map class
@@ -195,6 +377,154 @@ void map_tests()
         COVEO_ASSERT(local.capacity() >= 0);
     }
 
+    // Memory stats
+    {
+        int_string_map local({ { 42, "Life" }, { 23, "Hangar" } });
+        COVEO_ASSERT(local.pending_size() == 2);
+        auto stats = local.memory_stats();
+        COVEO_ASSERT(stats.possible_duplicates == 1);
+        COVEO_ASSERT(stats.element_size >= sizeof(int) + sizeof(std::string));
+        COVEO_ASSERT(stats.bytes_used == 2 * stats.element_size);
+        COVEO_ASSERT(local.at(23) == "Hangar");
+        COVEO_ASSERT(local.pending_size() == 0);
+
+        typedef coveo::lazy::map<int, std::string, std::less<int>, coveo::lazy::small_vector_impl<8>::type> small_int_string_map;
+        small_int_string_map small({ { 42, "Life" } });
+        stats = small.memory_stats();
+        COVEO_ASSERT(stats.stored_elements == 1);
+        COVEO_ASSERT(stats.capacity >= 8);
+    }
+
+    // Batched lookups
+    {
+        std::vector<int> keys({ 42, 24, 23 });
+        std::vector<int_string_map::iterator> found;
+        fromstdvector.find_all(keys.cbegin(), keys.cend(), std::back_inserter(found));
+        COVEO_ASSERT(found.size() == 3);
+        COVEO_ASSERT(found[0]->second == "Life");
+        COVEO_ASSERT(found[1] == fromstdvector.end());
+        COVEO_ASSERT(found[2]->second == "Hangar");
+        COVEO_ASSERT(fromstdvector.count_all(keys.cbegin(), keys.cend()) == 2);
+        COVEO_ASSERT(!fromstdvector.contains_all(keys.cbegin(), keys.cend()));
+        std::sort(keys.begin(), keys.end());
+        COVEO_ASSERT(fromstdvector.contains_all(keys.cend() - 1, keys.cend()));
+    }
+
+    // Lazy erasure
+    {
+        int_string_map local(fromstdvector);
+        local.lazy_erase(23);
+        local.lazy_erase(42);
+        local.insert(std::make_pair(42, "Answer"));
+        COVEO_ASSERT(local.find(23) == local.end());
+        COVEO_ASSERT(local.at(42) == "Answer");
+        const auto removed = local.erase_if([](const value_type& val) { return val.second.empty(); });
+        COVEO_ASSERT(removed == 0);
+        COVEO_ASSERT(local.size() == fromstdvector.size() - 1);
+    }
+
+    // Bulk erasure
+    {
+        int_string_map local;
+        for (int i = 0; i < 50; ++i) {
+            local.emplace(i, std::to_string(i));
+        }
+        std::vector<std::pair<int, int>> ranges({ { 10, 20 }, { 30, 40 } });
+        COVEO_ASSERT(local.erase_ranges(ranges.cbegin(), ranges.cend()) == 20);
+        int_string_map filter({ { 5, "" }, { 15, "" }, { 45, "" } });
+        std::vector<int> keys;
+        for (const auto& val : filter) {
+            keys.push_back(val.first);
+        }
+        COVEO_ASSERT(local.retain_keys(keys.cbegin(), keys.cend()) == 28);
+        COVEO_ASSERT(local.size() == 2 && local.at(5) == "5" && local.at(45) == "45");
+        COVEO_ASSERT(local.erase_keys(keys.cbegin(), keys.cend()) == 2);
+        COVEO_ASSERT(local.empty());
+    }
+
+#ifdef COVEO_LAZY_HAS_MEMORY_RESOURCE
+    // Polymorphic allocators
+    {
+        std::pmr::monotonic_buffer_resource arena;
+        coveo::lazy::pmr::map<int, std::string> local(&arena);
+        local.emplace(42, "Life");
+        local[23] = "Hangar";
+        COVEO_ASSERT(local.get_allocator().resource() == &arena);
+        coveo::lazy::pmr::map<int, std::string> moved(std::move(local), std::pmr::new_delete_resource());
+        COVEO_ASSERT(local.empty());
+        COVEO_ASSERT(moved.at(23) == "Hangar");
+        COVEO_ASSERT(moved.get_allocator().resource() == std::pmr::new_delete_resource());
+    }
+    {
+        // Sorting allocates its temporary buffers with the container's allocator;
+        // this resource counts allocations made through it and, since its upstream
+        // cannot fall back to global memory, checks they fit in the arena
+        struct counting_resource : std::pmr::memory_resource {
+            std::pmr::memory_resource* upstream;
+            std::size_t allocations = 0;
+            explicit counting_resource(std::pmr::memory_resource* up) : upstream(up) { }
+            void* do_allocate(std::size_t bytes, std::size_t align) override {
+                ++allocations;
+                return upstream->allocate(bytes, align);
+            }
+            void do_deallocate(void* ptr, std::size_t bytes, std::size_t align) override {
+                upstream->deallocate(ptr, bytes, align);
+            }
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+                return this == &other;
+            }
+        };
+        static char buffer[1 << 20];
+        std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+        counting_resource counting(&arena);
+        coveo::lazy::pmr::map<int, int> local(&counting);
+        coveo::lazy::pmr::multimap<int, int> multi(&counting);
+        local.reserve(2000);
+        multi.reserve(2000);
+        for (int i = 0; i < 1000; ++i) {
+            local.emplace((i * 7919) % 1009, i);
+            multi.emplace(i % 17, i);
+        }
+        local.sort();
+        multi.sort();
+        for (int i = 0; i < 1000; ++i) {
+            local.emplace((i * 7919) % 2003, -i);
+            multi.emplace(i % 19, -i);
+        }
+        std::size_t allocations = counting.allocations;
+        local.sort();
+        COVEO_ASSERT(counting.allocations > allocations);
+        allocations = counting.allocations;
+        multi.sort();
+        COVEO_ASSERT(counting.allocations > allocations);
+        COVEO_ASSERT(std::is_sorted(local.cbegin(), local.cend()));
+        COVEO_ASSERT(multi.size() == 2000);
+        COVEO_ASSERT(std::is_sorted(multi.cbegin(), multi.cend(), [](const auto& left, const auto& right) {
+            return left.first < right.first;
+        }));
+    }
+#endif
+
+    // Merging and set operations
+    {
+        int_string_map left({ { 42, "Life" }, { 23, "Hangar" } });
+        int_string_map right({ { 23, "Skidoo" }, { 66, "Route" } });
+        left.merge(right);
+        COVEO_ASSERT(left.size() == 3);
+        COVEO_ASSERT(left.at(23) == "Hangar");
+        COVEO_ASSERT(left.at(66) == "Route");
+        COVEO_ASSERT(right.size() == 1);
+        COVEO_ASSERT(right.at(23) == "Skidoo");
+
+        auto common = set_intersection(std::move(right), int_string_map(left));
+        COVEO_ASSERT(common.size() == 1);
+        COVEO_ASSERT(common.at(23) == "Skidoo");
+        auto extracted = left.extract(66);
+        COVEO_ASSERT(extracted.size() == 1);
+        COVEO_ASSERT(extracted.begin()->second == "Route");
+        COVEO_ASSERT(left.count(66) == 0);
+    }
+
     // Lookups
     {
         COVEO_ASSERT(fromstdvector.count(23) == 1);
@@ -302,6 +632,41 @@ void map_tests()
         it_pair = localfromstdvector.equal_range(Int(99));
         COVEO_ASSERT(it_pair.first == localfromstdvector.end());
         COVEO_ASSERT(it_pair.second == localfromstdvector.end());
+
+        COVEO_ASSERT(localfromstdvector.at(Int(23)) == "Hangar");
+        const tr_int_string_map& clocalfromstdvector = localfromstdvector;
+        COVEO_ASSERT(clocalfromstdvector.at(Int(42)) == "Life");
+        try {
+            localfromstdvector.at(Int(24));
+            COVEO_ASSERT_FALSE();
+        } catch (const coveo::lazy::out_of_range&) {
+            // normal
+        }
+        COVEO_ASSERT(localfromstdvector.erase(Int(24)) == 0);
+        COVEO_ASSERT(localfromstdvector.erase(Int(23)) == 1);
+        COVEO_ASSERT(localfromstdvector.count(23) == 0);
+    }
+    {
+        // Keys are only constructed when elements are added
+        typedef coveo::lazy::map<std::string, int, std::less<>> tr_string_int_map;
+        tr_string_int_map local;
+        const char* const life = "Life";
+        local[life] = 42;
+        ++local["Life"];
+        COVEO_ASSERT(local.at("Life") == 43);
+        auto res = local.try_emplace("Hangar", 23);
+        COVEO_ASSERT(res.second);
+        res = local.try_emplace(life, 0);
+        COVEO_ASSERT(!res.second);
+        COVEO_ASSERT(res.first->second == 43);
+        res = local.insert_or_assign(life, 42);
+        COVEO_ASSERT(!res.second);
+        res = local.insert_or_assign("Skidoo", 23);
+        COVEO_ASSERT(res.second);
+        COVEO_ASSERT(local.erase("Hangar") == 1);
+        COVEO_ASSERT(containers_are_equal(local, std::map<std::string, int>({ { "Life", 42 }, { "Skidoo", 23 } })));
+        local.erase(local.begin());
+        COVEO_ASSERT(local.size() == 1);
     }
 
     // Modifiers
@@ -440,6 +805,55 @@ void map_tests()
         COVEO_ASSERT(res.first != local.end());
         COVEO_ASSERT(*res.first == value_type(23, "Hangar"));
     }
+    {
+        // Misses do not move existing elements; new ones remain reachable until merged
+        typedef coveo::lazy::map<int, int> int_int_map;
+        for (bool tail_lookups : { false, true }) {
+            int_int_map local;
+            local.set_tail_lookups(tail_lookups);
+            std::map<int, int> expected;
+            std::mt19937 rand;
+            std::uniform_int_distribution<int> dist(0, 3000);
+            for (int i = 0; i < 5000; ++i) {
+                const int key = dist(rand);
+                switch (i % 5) {
+                    case 0: {
+                        auto res = local.try_emplace(key, i);
+                        COVEO_ASSERT(res.second == expected.emplace(key, i).second);
+                        COVEO_ASSERT(res.first != local.end() && res.first->first == key);
+                        break;
+                    }
+                    case 1: {
+                        auto res = local.insert_or_assign(key, i);
+                        COVEO_ASSERT(res.second == (expected.count(key) == 0));
+                        COVEO_ASSERT(res.first->second == i);
+                        expected[key] = i;
+                        break;
+                    }
+                    case 2: {
+                        if (i % 35 == 2) {
+                            local.insert(std::make_pair(key, i));
+                            expected.emplace(key, i);
+                        } else {
+                            COVEO_ASSERT(local.count(key) == expected.count(key));
+                            COVEO_ASSERT((local.find(key) == local.end()) == (expected.find(key) == expected.end()));
+                        }
+                        break;
+                    }
+                    default: {
+                        int& val = local[key];
+                        COVEO_ASSERT(val == expected[key]);
+                        val = i;
+                        expected[key] = i;
+                        COVEO_ASSERT(local.at(key) == i);
+                        break;
+                    }
+                }
+                COVEO_ASSERT(local.size() == expected.size());
+            }
+            COVEO_ASSERT(containers_are_equal(local, expected));
+        }
+    }
 
     // Predicates / allocator
     {
@@ -479,6 +893,782 @@ void map_tests()
         local.emplace(42, "Life");
         COVEO_ASSERT(local.sorted());
     }
+    {
+        typedef coveo::lazy::map<int, int, std::less<int>, std::vector,
+                                 coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>>,
+                                 coveo::lazy::map_allocator<int, int>,
+                                 coveo::lazy::default_sort_policy,
+                                 coveo::lazy::no_sort_stats,
+                                 coveo::lazy::eytzinger_search_policy<2>> eytzinger_int_int_map;
+        eytzinger_int_int_map local;
+        for (int i = 0; i < 50; ++i) {
+            local.emplace(i * 2, i);
+        }
+        COVEO_ASSERT(local.at(20) == 10);
+        COVEO_ASSERT(local.find(21) == local.end());
+        local[21] = 42;
+        COVEO_ASSERT(local.at(21) == 42);
+        COVEO_ASSERT(local.at(22) == 11);
+        COVEO_ASSERT(local.try_emplace(-1, 7).second);
+        COVEO_ASSERT(local.lower_bound(-5)->first == -1);
+        COVEO_ASSERT(local.upper_bound(96)->first == 98);
+        local.erase(98);
+        COVEO_ASSERT(local.upper_bound(96) == local.end());
+    }
+    {
+        // Sorting and looking up elements should never copy mapped values
+        coveo::lazy::map<int, copy_counter> local;
+        for (int i = 0; i < 100; ++i) {
+            local.emplace(100 - i, copy_counter());
+        }
+        local.emplace(50, copy_counter());
+        copy_counter::copies = 0;
+        local.sort();
+        for (int i = 0; i <= 101; ++i) {
+            local.find(i);
+            local.count(i);
+        }
+        COVEO_ASSERT(copy_counter::copies == 0);
+    }
+    {
+        // Growing the internal container should move elements instead of copying them
+        coveo::lazy::map<int, copy_counter> local;
+        copy_counter::copies = 0;
+        for (int i = 0; i < 100; ++i) {
+            local.emplace(100 - i, copy_counter());
+        }
+        COVEO_ASSERT(copy_counter::copies == 0);
+    }
+    {
+        // Indirect sorting moves each element at most once
+        typedef coveo::lazy::map<std::string, copy_counter, std::less<std::string>, std::vector,
+                                 coveo::lazy::detail::equal_to_using_less_if_needed<std::string, std::less<std::string>>,
+                                 coveo::lazy::map_allocator<std::string, copy_counter>,
+                                 coveo::lazy::indirect_sort_policy<>> indirect_string_map;
+        indirect_string_map local;
+        std::map<std::string, copy_counter> expected;
+        local.reserve(500);
+        for (int i = 0; i < 500; ++i) {
+            const std::string key = std::to_string((i * 7919) % 1009);
+            local.emplace(key, copy_counter());
+            expected.emplace(key, copy_counter());
+        }
+        copy_counter::copies = 0;
+        local.sort();
+        COVEO_ASSERT(copy_counter::copies == 0);
+        COVEO_ASSERT(std::equal(local.cbegin(), local.cend(), expected.cbegin(), [](const auto& left, const auto& right) {
+            return left.first == right.first;
+        }));
+    }
+    {
+        // Arithmetic keys use a branchless search in the pairs themselves
+        coveo::lazy::map<std::uint32_t, int> local;
+        for (std::uint32_t i = 0; i < 100; ++i) {
+            local.emplace(i * 3, static_cast<int>(i));
+        }
+        for (std::uint32_t key = 0; key <= 297; ++key) {
+            auto it = local.lower_bound(key);
+            COVEO_ASSERT(it != local.end() && it->first == (key + 2) / 3 * 3);
+            COVEO_ASSERT((local.find(key) != local.end()) == (key % 3 == 0));
+            COVEO_ASSERT(local.count(key) == (key % 3 == 0 ? 1u : 0u));
+        }
+        COVEO_ASSERT(local.upper_bound(297) == local.end());
+        local[31] = -1;
+        COVEO_ASSERT(local.find(31)->second == -1);
+        COVEO_ASSERT(std::next(local.lower_bound(30))->second == -1);
+    }
+    {
+        // Iterators returned after operator[] inserts in the middle enumerate elements in order
+        typedef coveo::lazy::map<int, int> int_int_map;
+        auto collect = [](int_int_map::const_iterator first, int_int_map::const_iterator last) {
+            std::vector<int> keys;
+            for (; first != last; ++first) {
+                keys.push_back(first->first);
+            }
+            return keys;
+        };
+        int_int_map local = { { 1, 1 }, { 3, 3 }, { 5, 5 } };
+        local.sort();
+        local[2] = 2;
+        COVEO_ASSERT(local.at(2) == 2);
+        COVEO_ASSERT(local.count(2) == 1);
+        COVEO_ASSERT(collect(local.find(3), local.end()) == std::vector<int>({ 3, 5 }));
+        local[4] = 4;
+        COVEO_ASSERT(collect(local.lower_bound(3), local.end()) == std::vector<int>({ 3, 4, 5 }));
+        local[0] = 0;
+        COVEO_ASSERT(collect(local.find(0), local.end()) == std::vector<int>({ 0, 1, 2, 3, 4, 5 }));
+        auto res = local.try_emplace(6, 6);
+        COVEO_ASSERT(res.second);
+        local[-1] = -1;
+        res = local.insert_or_assign(-2, -2);
+        COVEO_ASSERT(collect(res.first, local.end()) == std::vector<int>({ -2, -1, 0, 1, 2, 3, 4, 5, 6 }));
+    }
+
+    // Serialization and views
+    {
+        struct record {
+            std::uint32_t count;
+            double weight;
+        };
+        typedef coveo::lazy::map<std::uint64_t, record> record_map;
+
+        record_map local;
+        for (std::uint64_t i = 0; i < 1000; ++i) {
+            local.emplace((i * 7919) % 1000 * 3, record{ static_cast<std::uint32_t>(i), i / 2.0 });
+        }
+        std::ostringstream oss;
+        local.serialize(oss);
+        const std::string bytes = oss.str();
+
+        // View shares ownership of the buffer, as it would with a mapped file.
+        auto buffer = std::make_shared<std::vector<std::uint64_t>>((bytes.size() + 7) / 8);
+        std::memcpy(buffer->data(), bytes.data(), bytes.size());
+        coveo::lazy::map_view<std::uint64_t, record> view(buffer->data(), bytes.size(), buffer);
+        buffer.reset();
+
+        COVEO_ASSERT(view.size() == 1000);
+        COVEO_ASSERT(std::equal(view.cbegin(), view.cend(), local.cbegin(), [](const auto& left, const auto& right) {
+            return left.first == right.first && left.second.count == right.second.count;
+        }));
+        COVEO_ASSERT(view.at(3).count == local.at(3).count);
+        COVEO_ASSERT(view.find(2997)->second.weight == local.at(2997).weight);
+        COVEO_ASSERT(view.find(4) == view.end());
+        COVEO_ASSERT(view.count(2997) == 1 && view.count(2998) == 0);
+        COVEO_ASSERT(view.lower_bound(4)->first == 6);
+        COVEO_ASSERT(view.upper_bound(6)->first == 9);
+        COVEO_ASSERT(view.crbegin()->first == 2997);
+        try {
+            view.at(1);
+            COVEO_ASSERT_FALSE();
+        } catch (const coveo::lazy::out_of_range&) {
+        }
+
+        coveo::lazy::multimap<std::uint64_t, record> multi;
+        multi.emplace(1, record{ 1, 1.0 });
+        multi.emplace(1, record{ 2, 2.0 });
+        std::ostringstream multi_oss;
+        multi.serialize(multi_oss);
+        auto multi_buffer = std::vector<std::uint64_t>((multi_oss.str().size() + 7) / 8);
+        std::memcpy(multi_buffer.data(), multi_oss.str().data(), multi_oss.str().size());
+        coveo::lazy::multimap_view<std::uint64_t, record> multi_view(multi_buffer.data(), multi_oss.str().size());
+        COVEO_ASSERT(multi_view.count(1) == 2);
+        COVEO_ASSERT(multi_view.equal_range(1).first->second.count == 1);
+        try {
+            coveo::lazy::map_view<std::uint64_t, record> not_multi(multi_buffer.data(), multi_oss.str().size());
+            COVEO_ASSERT_FALSE();
+        } catch (const coveo::lazy::format_error&) {
+        }
+    }
+
+    // Frozen views
+    {
+        int_string_map local({ { 42, "Life" }, { 23, "Hangar" } });
+        local[66] = "Route";
+        auto frozen = local.freeze();
+        local[23] = "Changed";
+        COVEO_ASSERT(frozen.size() == 3);
+        COVEO_ASSERT(frozen.at(23) == "Hangar");
+        COVEO_ASSERT(frozen.find(66)->second == "Route");
+        COVEO_ASSERT(frozen.lower_bound(24)->first == 42);
+
+        auto moved = std::move(local).freeze();
+        COVEO_ASSERT(local.empty());
+        COVEO_ASSERT(moved.at(23) == "Changed");
+        try {
+            moved.at(24);
+            COVEO_ASSERT_FALSE();
+        } catch (const coveo::lazy::out_of_range&) {
+        }
+    }
+
+    // Asynchronous sort
+    {
+        int_string_map local({ { 42, "Life" }, { 23, "Hangar" } });
+        local.insert(std::make_pair(66, "Route"));
+        auto done = local.sort_async();
+        COVEO_ASSERT(local.at(66) == "Route");
+        COVEO_ASSERT(done.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+        local.insert(std::make_pair(7, "Seven"));
+        local.sort_async();
+        local[11] = "Eleven";
+        COVEO_ASSERT(local.size() == 5);
+        COVEO_ASSERT(local.begin()->second == "Seven");
+        local.insert(std::make_pair(1, "One"));
+        local.sort_async();
+        auto res = local.try_emplace(1, "Uno");
+        COVEO_ASSERT(!res.second && res.first->second == "One");
+    }
+
+    // Concurrent use
+    {
+        coveo::lazy::concurrent_map<int, std::string> local;
+        local.emplace(42, "Life");
+        COVEO_ASSERT(local.count(42) == 1);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&local, t]() {
+                for (int i = 0; i < 500; ++i) {
+                    local.insert(std::make_pair(t * 1000 + i, std::to_string(i)));
+                }
+                local.emplace(42, "Universe");
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        auto snapshot = local.snapshot();
+        COVEO_ASSERT(snapshot.size() == 4 * 500);
+        COVEO_ASSERT(snapshot.at(42) == "Life");
+        COVEO_ASSERT(snapshot.at(3499) == "499");
+        COVEO_ASSERT(snapshot.find(500) == snapshot.end());
+
+        coveo::lazy::concurrent_multimap<int, std::string> multi;
+        multi.emplace(1, "One");
+        multi.emplace(1, "Uno");
+        COVEO_ASSERT(multi.count(1) == 2);
+        COVEO_ASSERT(multi.snapshot().begin()->second == "One");
+    }
+
+    // Duplicate policies
+    {
+        typedef coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>> int_eq;
+        typedef coveo::lazy::map<int, std::string, std::less<int>, std::vector, int_eq,
+                                 coveo::lazy::map_allocator<int, std::string>,
+                                 coveo::lazy::default_sort_policy,
+                                 coveo::lazy::no_sort_stats,
+                                 coveo::lazy::binary_search_policy,
+                                 coveo::lazy::first_wins_duplicate_policy> first_wins_map;
+        typedef coveo::lazy::map<int, std::string, std::less<int>, std::vector, int_eq,
+                                 coveo::lazy::map_allocator<int, std::string>,
+                                 coveo::lazy::default_sort_policy,
+                                 coveo::lazy::no_sort_stats,
+                                 coveo::lazy::binary_search_policy,
+                                 coveo::lazy::last_wins_duplicate_policy> last_wins_map;
+        typedef coveo::lazy::map<int, int, std::less<int>, std::vector, int_eq,
+                                 coveo::lazy::map_allocator<int, int>,
+                                 coveo::lazy::default_sort_policy,
+                                 coveo::lazy::no_sort_stats,
+                                 coveo::lazy::binary_search_policy,
+                                 coveo::lazy::combine_duplicate_policy<>> sum_map;
+        typedef coveo::lazy::map<int, int, std::less<int>, coveo::lazy::small_vector_impl<8>::type, int_eq,
+                                 coveo::lazy::map_allocator<int, int>,
+                                 coveo::lazy::default_sort_policy,
+                                 coveo::lazy::no_sort_stats,
+                                 coveo::lazy::binary_search_policy,
+                                 coveo::lazy::combine_duplicate_policy<>> small_sum_map;
+
+        first_wins_map first;
+        last_wins_map last;
+        for (int i = 0; i < 1000; ++i) {
+            first.emplace(i % 10, std::to_string(i));
+            last.emplace(i % 10, std::to_string(i));
+        }
+        COVEO_ASSERT(first.size() == 10 && last.size() == 10);
+        COVEO_ASSERT(first.at(3) == "3");
+        COVEO_ASSERT(last.at(3) == "993");
+        first.emplace(3, "New");
+        last.emplace(3, "New");
+        last.emplace(3, "Newer");
+        COVEO_ASSERT(first.at(3) == "3");
+        COVEO_ASSERT(last.at(3) == "Newer");
+
+        sum_map sums;
+        for (int i = 0; i < 1000; ++i) {
+            sums.emplace(i % 10, i);
+        }
+        COVEO_ASSERT(sums.size() == 10);
+        COVEO_ASSERT(sums.at(3) == 100 * 3 + 49500);
+        sums.emplace(3, 1);
+        sums[3] += 1;
+        COVEO_ASSERT(sums.at(3) == 49802);
+        sum_map partial({ { 3, 10 }, { 100, 1 } });
+        sums.splice(partial);
+        COVEO_ASSERT(partial.empty());
+        COVEO_ASSERT(sums.at(3) == 49812 && sums.at(100) == 1);
+
+        small_sum_map small;
+        small.emplace(1, 1);
+        small.sort();
+        small.emplace(2, 2);
+        small.emplace(0, 0);
+        small.emplace(1, 10);
+        small.emplace(2, 20);
+        small.emplace(0, 5);
+        COVEO_ASSERT(!small.sorted());
+        COVEO_ASSERT(small.at(1) == 11 && small.at(2) == 22 && small.at(0) == 5);
+        COVEO_ASSERT(small.count(2) == 1);
+        COVEO_ASSERT(!small.sorted());
+        COVEO_ASSERT(small.size() == 3);
+    }
+
+    // Adaptive storage
+    {
+        coveo::lazy::adaptive_thresholds thresholds;
+        thresholds.thrashing_sorts = 3;
+        thresholds.min_tree_size = 100;
+        thresholds.bulk_inserts = 50;
+        coveo::lazy::adaptive_map<int, std::string> local(std::less<int>(), thresholds);
+        for (int i = 0; i < 200; ++i) {
+            local.insert(std::make_pair(i * 2, std::to_string(i)));
+        }
+        COVEO_ASSERT(local.mode() == coveo::lazy::adaptive_mode::lazy);
+        COVEO_ASSERT(local.at(10) == "5");
+
+        // Interleaved insertions and lookups move elements to the tree.
+        for (int i = 0; i < 5; ++i) {
+            local.insert(std::make_pair(i * 2 + 1, "Odd"));
+            COVEO_ASSERT(local.find(i * 2 + 1) != local.end());
+        }
+        COVEO_ASSERT(local.mode() == coveo::lazy::adaptive_mode::tree);
+        COVEO_ASSERT(local.size() == 205);
+        local[11] = "Eleven";
+        COVEO_ASSERT(local.try_emplace(11, "Other").first->second == "Eleven");
+        COVEO_ASSERT(local.insert_or_assign(13, "Thirteen").second);
+        COVEO_ASSERT(local.at(13) == "Thirteen");
+        COVEO_ASSERT(local.erase(13) == 1);
+        COVEO_ASSERT(local.count(13) == 0);
+        COVEO_ASSERT(local.lower_bound(12)->first == 12);
+        COVEO_ASSERT(local.upper_bound(12)->first == 14);
+        try {
+            local.at(13);
+            COVEO_ASSERT_FALSE();
+        } catch (const coveo::lazy::out_of_range&) {
+        }
+        const auto& clocal = local;
+        COVEO_ASSERT(std::distance(clocal.begin(), clocal.end()) == 206);
+        COVEO_ASSERT(std::is_sorted(clocal.begin(), clocal.end(),
+                                    [](const std::pair<const int, std::string>& left, const std::pair<const int, std::string>& right) {
+                                        return left.first < right.first;
+                                    }));
+
+        // Bulk insertions move them back to the lazy-sorted container.
+        for (int i = 0; i < 100; ++i) {
+            local.insert(std::make_pair(1000 + i, "Bulk"));
+        }
+        COVEO_ASSERT(local.mode() == coveo::lazy::adaptive_mode::lazy);
+        COVEO_ASSERT(local.size() == 306);
+        COVEO_ASSERT(local.at(11) == "Eleven" && local.at(1099) == "Bulk");
+        local.clear();
+        COVEO_ASSERT(local.empty());
+
+        // Duplicates are resolved the same way in both storages.
+        typedef coveo::lazy::map<int, int, std::less<int>, std::vector,
+                                 coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>>,
+                                 coveo::lazy::map_allocator<int, int>,
+                                 coveo::lazy::default_sort_policy,
+                                 coveo::lazy::no_sort_stats,
+                                 coveo::lazy::binary_search_policy,
+                                 coveo::lazy::combine_duplicate_policy<>> sum_map;
+        coveo::lazy::adaptive_container<sum_map> sums(std::less<int>(), thresholds);
+        for (int i = 0; i < 200; ++i) {
+            sums.insert(std::make_pair(i, 1));
+        }
+        for (int i = 0; i < 5; ++i) {
+            sums.insert(std::make_pair(i, 1));
+            COVEO_ASSERT(sums.at(i) == 2);
+        }
+        COVEO_ASSERT(sums.mode() == coveo::lazy::adaptive_mode::tree);
+        sums.insert(std::make_pair(0, 1));
+        COVEO_ASSERT(sums.at(0) == 3);
+
+        coveo::lazy::adaptive_multimap<int, int> multi;
+        multi.insert(std::make_pair(1, 1));
+        multi.insert(std::make_pair(1, 2));
+        COVEO_ASSERT(multi.count(1) == 2);
+        auto mit = multi.rbegin();
+        COVEO_ASSERT(mit->second == 2 && (++mit)->second == 1);
+        multi.emplace_hint(multi.cend(), 0, 0);
+        COVEO_ASSERT(multi.begin()->first == 0);
+        multi.lazy_erase(1);
+        COVEO_ASSERT(multi.size() == 1 && multi.count(1) == 0);
+
+        // Transparent lookups in both storages
+        coveo::lazy::adaptive_map<std::string, int, std::less<>> tr(std::less<>(), thresholds);
+        for (int i = 100; i < 300; ++i) {
+            tr.insert(std::make_pair(std::to_string(i), i));
+        }
+        COVEO_ASSERT(tr.mode() == coveo::lazy::adaptive_mode::lazy);
+        COVEO_ASSERT(tr.find("150")->second == 150 && tr.count("150") == 1);
+        for (int i = 0; i < 5; ++i) {
+            tr.insert(std::make_pair("0" + std::to_string(4 - i), i));
+            COVEO_ASSERT(tr.find("0" + std::to_string(4 - i)) != tr.end());
+        }
+        COVEO_ASSERT(tr.mode() == coveo::lazy::adaptive_mode::tree);
+        COVEO_ASSERT(tr.find("150")->second == 150 && tr.count("150") == 1);
+        COVEO_ASSERT(tr.lower_bound("1505")->first == "151" && tr.upper_bound("151")->first == "152");
+        COVEO_ASSERT(tr.erase("150") == 1 && tr.find("150") == tr.end());
+        tr.lazy_erase("151");
+        COVEO_ASSERT(tr.count("151") == 0 && tr.size() == 203);
+        COVEO_ASSERT(tr.erase(tr.find("04"))->first == "100" && tr.rbegin()->first == "299");
+    }
+
+    // Small-buffer internal container
+    {
+        typedef coveo::lazy::map<int, std::string, std::less<int>, coveo::lazy::small_vector_impl<8>::type> small_int_string_map;
+
+        small_int_string_map local({ { 42, "Life" }, { 23, "Hangar" } });
+        COVEO_ASSERT(local.pending_limit() == 8);
+        local[66] = "Route";
+        local.emplace(11, "Eleven");
+        COVEO_ASSERT(local.at(23) == "Hangar");
+        COVEO_ASSERT(local.find(12) == local.end());
+        COVEO_ASSERT(local.count(66) == 1);
+        for (int i = 100; i < 120; ++i) {
+            local.try_emplace(i, std::to_string(i));
+        }
+        COVEO_ASSERT(local.size() == 24);
+        COVEO_ASSERT(local.begin()->first == 11 && local.crbegin()->first == 119);
+        auto it = local.erase(local.find(42));
+        COVEO_ASSERT(it->first == 66);
+        it->second = "66";
+        COVEO_ASSERT(local.at(66) == "66");
+    }
+
+    // Append policies
+    {
+        typedef coveo::lazy::map<std::int64_t, double, std::less<std::int64_t>, std::vector,
+                                 coveo::lazy::detail::equal_to_using_less_if_needed<std::int64_t, std::less<std::int64_t>>,
+                                 coveo::lazy::map_allocator<std::int64_t, double>,
+                                 coveo::lazy::default_sort_policy,
+                                 coveo::lazy::no_sort_stats,
+                                 coveo::lazy::binary_search_policy,
+                                 coveo::lazy::default_duplicate_policy,
+                                 coveo::lazy::monotonic_append_policy> series_map;
+        series_map series;
+        for (std::int64_t ts = 1000; ts < 2000; ts += 10) {
+            series.emplace(ts, ts / 10.0);
+        }
+        COVEO_ASSERT(series.sorted());
+        COVEO_ASSERT(series.size() == 100);
+        COVEO_ASSERT(series.at(1500) == 150.0);
+        COVEO_ASSERT(series.lower_bound(1505)->first == 1510);
+    }
+    {
+        typedef coveo::lazy::map<int, std::string, std::less<int>, std::vector,
+                                 coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>>,
+                                 coveo::lazy::map_allocator<int, std::string>,
+                                 coveo::lazy::default_sort_policy,
+                                 coveo::lazy::no_sort_stats,
+                                 coveo::lazy::binary_search_policy,
+                                 coveo::lazy::last_wins_duplicate_policy,
+                                 coveo::lazy::run_tracking_append_policy<>> run_last_wins_map;
+        run_last_wins_map local;
+        for (int i = 0; i < 10; ++i) {
+            local.emplace(i, "first");
+        }
+        for (int i = 0; i < 10; i += 2) {
+            local.emplace(i, "second");
+        }
+        COVEO_ASSERT(!local.sorted());
+        COVEO_ASSERT(local.size() == 10);
+        for (int i = 0; i < 10; ++i) {
+            COVEO_ASSERT(local.at(i) == (i % 2 == 0 ? "second" : "first"));
+        }
+    }
+    {
+        typedef coveo::lazy::multimap<int, int, std::less<int>, std::vector,
+                                      coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>>,
+                                      coveo::lazy::map_allocator<int, int>,
+                                      coveo::lazy::default_sort_policy,
+                                      coveo::lazy::no_sort_stats,
+                                      coveo::lazy::binary_search_policy,
+                                      coveo::lazy::run_tracking_append_policy<>> run_int_int_multimap;
+        run_int_int_multimap local;
+        for (int run = 0; run < 3; ++run) {
+            for (int i = 0; i < 20; ++i) {
+                local.emplace(i / 2, run);
+            }
+        }
+        COVEO_ASSERT(local.size() == 60);
+        int prev_key = -1;
+        int prev_run = -1;
+        for (auto&& elem : local) {
+            // Equivalent keys keep the order in which they were inserted.
+            COVEO_ASSERT(elem.first > prev_key || (elem.first == prev_key && elem.second >= prev_run));
+            prev_key = elem.first;
+            prev_run = elem.second;
+        }
+    }
+    {
+        // Parallel sort with duplicates must not leave moved-from mapped values behind
+        typedef coveo::lazy::map<int, std::vector<int>, std::less<int>, std::vector,
+                                 coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>>,
+                                 coveo::lazy::map_allocator<int, std::vector<int>>,
+                                 coveo::lazy::parallel_sort_policy<4, 4>> parallel_int_vector_map;
+        typedef coveo::lazy::map<int, std::string, std::less<int>, std::vector,
+                                 coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>>,
+                                 coveo::lazy::map_allocator<int, std::string>,
+                                 coveo::lazy::parallel_sort_policy<4, 4>> parallel_int_string_map;
+        parallel_int_vector_map vectors;
+        parallel_int_string_map strings;
+        for (int i = 0; i < 100; ++i) {
+            // Only the last keys have duplicates, so the first chunks stay in place
+            const int key = i < 80 ? i : 80 + (i - 80) / 2;
+            vectors.emplace(key, std::vector<int>(10, key));
+            strings.emplace(key, std::string(32, static_cast<char>('a' + key % 26)));
+        }
+        COVEO_ASSERT(!vectors.sorted());
+        COVEO_ASSERT(vectors.size() == 90);
+        COVEO_ASSERT(strings.size() == 90);
+        for (auto&& elem : vectors) {
+            COVEO_ASSERT(elem.second == std::vector<int>(10, elem.first));
+        }
+        for (auto&& elem : strings) {
+            COVEO_ASSERT(elem.second == std::string(32, static_cast<char>('a' + elem.first % 26)));
+        }
+    }
+}
+
+// Tests for coveo::lazy::soa_map class
+void soa_map_tests()
+{
+    using namespace coveo_tests::lazy::detail;
+
+    typedef coveo::lazy::soa_map<int, std::string> int_string_soa_map;
+
+    // Constructors and iteration
+    {
+        int_string_soa_map local({ { 42, "Life" }, { 23, "Hangar" }, { 42, "Universe" } });
+        COVEO_ASSERT(!local.sorted());
+        COVEO_ASSERT(local.size() == 2);
+        COVEO_ASSERT(local.sorted());
+        auto it = local.cbegin();
+        COVEO_ASSERT(it->first == 23 && it->second == "Hangar");
+        ++it;
+        COVEO_ASSERT((*it).first == 42 && (*it).second == "Life");
+        COVEO_ASSERT(++it == local.cend());
+        COVEO_ASSERT(local.crbegin()->first == 42);
+        COVEO_ASSERT(std::distance(local.begin(), local.end()) == 2);
+
+        std::vector<int> expected_keys({ 23, 42 });
+        COVEO_ASSERT(local.keys() == expected_keys);
+        COVEO_ASSERT(local.values()[1] == "Life");
+
+        int_string_soa_map copy(local);
+        COVEO_ASSERT(copy == local);
+        copy.begin()->second = "Shuck";
+        COVEO_ASSERT(copy != local);
+        COVEO_ASSERT(local.at(23) == "Hangar");
+    }
+
+    // Lookups and modifiers
+    {
+        int_string_soa_map local;
+        for (int i = 0; i < 10; ++i) {
+            local.emplace(20 - i * 2, std::to_string(i));
+        }
+        COVEO_ASSERT(local.find(4) != local.end() && local.find(4)->second == "8");
+        COVEO_ASSERT(local.find(5) == local.end());
+        COVEO_ASSERT(local.count(20) == 1);
+        COVEO_ASSERT(local.count(21) == 0);
+        COVEO_ASSERT(local.lower_bound(5)->first == 6);
+        COVEO_ASSERT(local.upper_bound(6)->first == 8);
+        COVEO_ASSERT(std::distance(local.equal_range(6).first, local.equal_range(6).second) == 1);
+        bool thrown = false;
+        try {
+            local.at(3);
+        } catch (const coveo::lazy::out_of_range&) {
+            thrown = true;
+        }
+        COVEO_ASSERT(thrown);
+
+        local[5] = "Five";
+        COVEO_ASSERT(local.sorted());
+        COVEO_ASSERT(local.size() == 11);
+        COVEO_ASSERT(std::next(local.find(4))->second == "Five");
+        local[5] += "!";
+        COVEO_ASSERT(local.at(5) == "Five!");
+
+        COVEO_ASSERT(local.erase(5) == 1);
+        COVEO_ASSERT(local.erase(5) == 0);
+        auto it = local.erase(local.find(2));
+        COVEO_ASSERT(it->first == 4);
+        local.erase(local.begin(), local.lower_bound(10));
+        COVEO_ASSERT(local.begin()->first == 10);
+        COVEO_ASSERT(local.size() == 6);
+        local.clear();
+        COVEO_ASSERT(local.empty());
+    }
+
+    // Arithmetic keys are radix-sorted; only the first of equivalent keys is kept
+    {
+        coveo::lazy::soa_map<std::int64_t, std::size_t, std::greater<std::int64_t>> local;
+        std::map<std::int64_t, std::size_t, std::greater<std::int64_t>> expected;
+        for (std::size_t i = 0; i < 2000; ++i) {
+            const std::int64_t key = static_cast<std::int64_t>((i * 7919) % 1500) - 750;
+            local.emplace(key, i);
+            expected.emplace(key, i);
+        }
+        COVEO_ASSERT(local.size() == expected.size());
+        auto eit = expected.cbegin();
+        for (auto&& elem : local) {
+            COVEO_ASSERT(elem.first == eit->first && elem.second == eit->second);
+            ++eit;
+        }
+    }
+
+    // Mapped values are not copied by sorting or lookups
+    {
+        coveo::lazy::soa_map<int, copy_counter> local;
+        for (int i = 0; i < 100; ++i) {
+            local.emplace(100 - i);
+        }
+        copy_counter::copies = 0;
+        local.sort();
+        for (int i = 0; i <= 101; ++i) {
+            local.find(i);
+        }
+        COVEO_ASSERT(copy_counter::copies == 0);
+    }
+
+    // Radix sort keeps the first of +0.0 and -0.0, which compare equal
+    {
+        coveo::lazy::soa_map<double, int> local;
+        for (int i = 0; i < 300; ++i) {
+            local.emplace(i - 150.5, i);
+            if (i == 100) {
+                local.emplace(0.0, -1);
+                local.emplace(-0.0, -2);
+            }
+        }
+        auto it = local.find(0.0);
+        COVEO_ASSERT(it != local.end() && it->second == -1 && !std::signbit(it->first));
+        COVEO_ASSERT(local.size() == 301);
+    }
+
+#ifdef COVEO_LAZY_HAS_MEMORY_RESOURCE
+    // Sorting allocates its temporary buffers with the key allocator, whether keys are radix-sorted or not
+    {
+        struct counting_resource : std::pmr::memory_resource {
+            std::size_t allocations = 0;
+            void* do_allocate(std::size_t bytes, std::size_t align) override {
+                ++allocations;
+                return std::pmr::new_delete_resource()->allocate(bytes, align);
+            }
+            void do_deallocate(void* ptr, std::size_t bytes, std::size_t align) override {
+                std::pmr::new_delete_resource()->deallocate(ptr, bytes, align);
+            }
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+                return this == &other;
+            }
+        };
+        struct int_less {
+            bool operator()(int left, int right) const { return left < right; }
+        };
+        counting_resource counting;
+        std::pmr::memory_resource* previous = std::pmr::set_default_resource(&counting);
+        auto check_sort_allocations = [&counting](auto& local) {
+            local.reserve(2000);
+            for (int i = 0; i < 1000; ++i) {
+                local.emplace((i * 7919) % 1009, i);
+            }
+            // Mapped values use std::allocator, so only key buffers are counted
+            const std::size_t allocations = counting.allocations;
+            local.sort();
+            COVEO_ASSERT(counting.allocations >= allocations + 2);
+            COVEO_ASSERT(local.size() == 1000);
+            COVEO_ASSERT(std::is_sorted(local.cbegin(), local.cend(), [](const auto& left, const auto& right) {
+                return left.first < right.first;
+            }));
+        };
+        coveo::lazy::soa_map<int, int, std::less<int>, std::pmr::polymorphic_allocator<int>> radix_sorted;
+        check_sort_allocations(radix_sorted);
+        coveo::lazy::soa_map<int, int, int_less, std::pmr::polymorphic_allocator<int>> stable_sorted;
+        check_sort_allocations(stable_sorted);
+        std::pmr::set_default_resource(previous);
+    }
+#endif
+}
+
+// Tests for coveo::lazy::string_map class
+void string_map_tests()
+{
+    using namespace coveo_tests::lazy::detail;
+
+    typedef coveo::lazy::string_map<int> string_int_map;
+
+    // Constructors and iteration
+    {
+        string_int_map local({ { "Life", 42 }, { "Hangar", 23 }, { "Life", 66 } });
+        COVEO_ASSERT(!local.sorted());
+        COVEO_ASSERT(local.size() == 2);
+        COVEO_ASSERT(local.sorted());
+        auto it = local.cbegin();
+        COVEO_ASSERT(it->first == "Hangar" && it->second == 23);
+        ++it;
+        COVEO_ASSERT((*it).first == "Life" && (*it).second == 42);
+        COVEO_ASSERT(++it == local.cend());
+        COVEO_ASSERT(local.crbegin()->first == "Life");
+
+        string_int_map copy(local);
+        COVEO_ASSERT(copy == local);
+        copy.begin()->second = 11;
+        COVEO_ASSERT(copy != local);
+        COVEO_ASSERT(local.at("Hangar") == 23);
+        std::map<std::string, int> converted(local.begin(), local.end());
+        COVEO_ASSERT(converted.at("Life") == 42);
+    }
+
+    // Lookups and modifiers
+    {
+        string_int_map local;
+        for (int i = 0; i < 10; ++i) {
+            local.emplace("key/" + std::to_string(20 - i * 2), i);
+        }
+        local.insert(std::make_pair(std::string("key/08"), 99));
+        COVEO_ASSERT(local.find("key/4") != local.end() && local.find("key/4")->second == 8);
+        COVEO_ASSERT(local.find("key/5") == local.end());
+        COVEO_ASSERT(local.count("key/08") == 1);
+        COVEO_ASSERT(local.lower_bound("key/19")->first == "key/2");
+        COVEO_ASSERT(local.upper_bound("key/2")->first == "key/20");
+        bool thrown = false;
+        try {
+            local.at("key/3");
+        } catch (const coveo::lazy::out_of_range&) {
+            thrown = true;
+        }
+        COVEO_ASSERT(thrown);
+
+        local["key/5"] = 5;
+        COVEO_ASSERT(local.sorted());
+        COVEO_ASSERT(local.size() == 12);
+        COVEO_ASSERT(std::next(local.find("key/4"))->second == 5);
+        local["key/5"] += 1;
+        COVEO_ASSERT(local.at("key/5") == 6);
+        local[local.begin()->first] = 7;
+        COVEO_ASSERT(local.begin()->second == 7);
+
+        COVEO_ASSERT(local.erase("key/5") == 1);
+        COVEO_ASSERT(local.erase("key/5") == 0);
+        auto it = local.erase(local.find("key/10"));
+        COVEO_ASSERT(it->first == "key/12");
+        local.erase(local.begin(), local.lower_bound("key/2"));
+        COVEO_ASSERT(local.begin()->first == "key/2");
+        COVEO_ASSERT(local.size() == 5);
+        local.clear();
+        COVEO_ASSERT(local.empty());
+    }
+
+    // Compare with std::map; only the first of duplicate keys is kept
+    {
+        std::mt19937 rand;
+        std::uniform_int_distribution<int> dist(0, 3000);
+        string_int_map local;
+        std::map<std::string, int> expected;
+        for (int i = 0; i < 20000; ++i) {
+            const std::string key = "a/very/long/common/prefix/" + std::to_string(dist(rand));
+            local.emplace(key, i);
+            expected.emplace(key, i);
+            if (i % 1999 == 0) {
+                COVEO_ASSERT(local.at(key) == expected.at(key));
+            }
+        }
+        COVEO_ASSERT(local.size() == expected.size());
+        COVEO_ASSERT(std::equal(local.begin(), local.end(), expected.begin(),
+                                [](string_int_map::const_reference left, const std::pair<const std::string, int>& right) {
+                                    return left.first == right.first && left.second == right.second;
+                                }));
+    }
 }
 
 // Tests for coveo::lazy::multimap class
@@ -886,6 +2076,179 @@ void multimap_tests()
         local.emplace(42, "Life");
         COVEO_ASSERT(local.sorted());
     }
+    {
+        int_string_multimap local;
+
+        local.emplace(42, "Life");
+        local.emplace(23, "Shuck");
+        local.sort();
+        local.emplace(66, "Route");
+        local.emplace(23, "Hangar");
+        local.insert({ value_type(42, "Universe"), value_type(11, "Math"), value_type(23, "Skidoo") });
+        COVEO_ASSERT(!local.sorted());
+
+        testcontainer<value_type> expected({
+            std::make_pair(11, "Math"),
+            std::make_pair(23, "Shuck"),
+            std::make_pair(23, "Hangar"),
+            std::make_pair(23, "Skidoo"),
+            std::make_pair(42, "Life"),
+            std::make_pair(42, "Universe"),
+            std::make_pair(66, "Route"),
+        });
+        COVEO_ASSERT(containers_are_equal(local, expected));
+        COVEO_ASSERT(local.sorted());
+    }
+    {
+        typedef coveo::lazy::multimap<int, int, std::less<int>, std::vector,
+                                      coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>>,
+                                      coveo::lazy::map_allocator<int, int>,
+                                      coveo::lazy::parallel_sort_policy<8, 4>> parallel_int_int_multimap;
+        parallel_int_int_multimap local;
+        for (int i = 0; i < 200; ++i) {
+            local.emplace((i * 7) % 13, i);
+        }
+        COVEO_ASSERT(!local.sorted());
+        COVEO_ASSERT(local.size() == 200);
+        auto it = local.cbegin();
+        auto prev = it++;
+        for (; it != local.cend(); prev = it++) {
+            COVEO_ASSERT(prev->first < it->first || (prev->first == it->first && prev->second < it->second));
+        }
+    }
+    {
+        // Indirect sorting of positions, keys and positions, and radix keys and positions
+        typedef coveo::lazy::multimap<std::string, int, std::less<std::string>, std::vector,
+                                      coveo::lazy::detail::equal_to_using_less_if_needed<std::string, std::less<std::string>>,
+                                      coveo::lazy::map_allocator<std::string, int>,
+                                      coveo::lazy::indirect_sort_policy<8>> indirect_string_int_multimap;
+        typedef coveo::lazy::multimap<int, int, std::less<int>, std::vector,
+                                      coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>>,
+                                      coveo::lazy::map_allocator<int, int>,
+                                      coveo::lazy::indirect_sort_policy<8>> indirect_int_int_multimap;
+        typedef coveo::lazy::multimap<int, int, last_digit_less, std::vector,
+                                      coveo::lazy::detail::equal_to_using_less<int, last_digit_less>,
+                                      coveo::lazy::map_allocator<int, int>,
+                                      coveo::lazy::indirect_sort_policy<8>> indirect_last_digit_multimap;
+        indirect_string_int_multimap strings;
+        indirect_int_int_multimap ints;
+        indirect_last_digit_multimap digits;
+        for (int i = 0; i < 1000; ++i) {
+            const int key = (i * 7919) % 101;
+            strings.emplace(std::to_string(key), i);
+            ints.emplace(key - 50, i);
+            digits.emplace(key, i);
+        }
+        auto check_order = [](const auto& local, const auto& key_less) {
+            COVEO_ASSERT(local.size() == 1000);
+            auto it = local.cbegin();
+            auto prev = it++;
+            for (; it != local.cend(); prev = it++) {
+                COVEO_ASSERT(key_less(prev->first, it->first) ||
+                             (!key_less(it->first, prev->first) && prev->second < it->second));
+            }
+        };
+        check_order(strings, std::less<std::string>());
+        check_order(ints, std::less<int>());
+        check_order(digits, last_digit_less());
+    }
+    {
+        coveo::lazy::multimap<std::int32_t, int> local;
+        for (int i = 0; i < 5000; ++i) {
+            local.emplace(((i * 7919) % 1013) - 500, i);
+        }
+        COVEO_ASSERT(!local.sorted());
+        COVEO_ASSERT(local.size() == 5000);
+        auto it = local.cbegin();
+        auto prev = it++;
+        for (; it != local.cend(); prev = it++) {
+            COVEO_ASSERT(prev->first < it->first || (prev->first == it->first && prev->second < it->second));
+        }
+    }
+    {
+        testcontainer<value_type> sorted_values({
+            std::make_pair(11, "Math"),
+            std::make_pair(23, "Shuck"),
+            std::make_pair(23, "Hangar"),
+        });
+        int_string_multimap local(coveo::lazy::sorted_equivalent, sorted_values.begin(), sorted_values.end());
+        COVEO_ASSERT(local.sorted());
+        testcontainer<value_type> more_values({
+            std::make_pair(23, "Skidoo"),
+            std::make_pair(42, "Life"),
+        });
+        local.insert(coveo::lazy::sorted_equivalent, more_values.begin(), more_values.end());
+        COVEO_ASSERT(local.sorted());
+        testcontainer<value_type> other_values({
+            std::make_pair(1, "One"),
+            std::make_pair(23, "Route"),
+        });
+        local.insert(coveo::lazy::sorted_equivalent, other_values.begin(), other_values.end());
+        COVEO_ASSERT(!local.sorted());
+
+        testcontainer<value_type> expected({
+            std::make_pair(1, "One"),
+            std::make_pair(11, "Math"),
+            std::make_pair(23, "Shuck"),
+            std::make_pair(23, "Hangar"),
+            std::make_pair(23, "Skidoo"),
+            std::make_pair(23, "Route"),
+            std::make_pair(42, "Life"),
+        });
+        COVEO_ASSERT(containers_are_equal(local, expected));
+        COVEO_ASSERT(local.sorted());
+    }
+    {
+        int_string_multimap local;
+        local.insert(coveo::lazy::check_sorted, { value_type(11, "Math"), value_type(23, "Shuck"), value_type(23, "Hangar") });
+        COVEO_ASSERT(local.sorted());
+        local.insert(coveo::lazy::check_sorted, { value_type(23, "Skidoo"), value_type(42, "Life"), value_type(1, "One") });
+        COVEO_ASSERT(!local.sorted());
+
+        testcontainer<value_type> expected({
+            std::make_pair(1, "One"),
+            std::make_pair(11, "Math"),
+            std::make_pair(23, "Shuck"),
+            std::make_pair(23, "Hangar"),
+            std::make_pair(23, "Skidoo"),
+            std::make_pair(42, "Life"),
+        });
+        COVEO_ASSERT(containers_are_equal(local, expected));
+    }
+    {
+        int_string_multimap local({ value_type(11, "Math"), value_type(23, "Shuck") });
+        local.sort();
+        local.set_pending_limit(8);
+        local.emplace(23, "Hangar");
+        local.emplace(1, "One");
+        local.emplace(23, "Skidoo");
+        COVEO_ASSERT(!local.sorted());
+        COVEO_ASSERT(local.count(23) == 3);
+        COVEO_ASSERT(local.count(1) == 1);
+        COVEO_ASSERT(local.count(42) == 0);
+        auto it = local.find(1);
+        COVEO_ASSERT(it != local.end());
+        it->second = "Uno";
+        COVEO_ASSERT(local.find(23)->second == "Shuck");
+        COVEO_ASSERT(!local.sorted());
+
+        testcontainer<value_type> expected({
+            std::make_pair(1, "Uno"),
+            std::make_pair(11, "Math"),
+            std::make_pair(23, "Shuck"),
+            std::make_pair(23, "Hangar"),
+            std::make_pair(23, "Skidoo"),
+        });
+        COVEO_ASSERT(containers_are_equal(local, expected));
+    }
+}
+
+// Benchmarks for coveo::lazy::map and coveo::lazy::multimap classes
+// Compares them with std::map, std::unordered_map and std::multimap
+void map_benchmarks()
+{
+    detail::benchmark_map_suites_for_key<std::size_t>();
+    detail::benchmark_map_suites_for_key<std::string>();
 }
 
 } // lazy
@@ -9,6 +9,10 @@ namespace lazy {
 
 void map_tests();
 void multimap_tests();
+void soa_map_tests();
+void string_map_tests();
+
+void map_benchmarks();
 
 } // lazy
 } // coveo_tests
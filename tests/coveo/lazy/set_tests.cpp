@@ -3,20 +3,33 @@
 
 #include "coveo/lazy/set_tests.h"
 
+#include <coveo/lazy/adaptive.h>
+#include <coveo/lazy/concurrent.h>
 #include <coveo/lazy/iterator.h>
 #include <coveo/lazy/set.h>
+#include <coveo/lazy/small_vector.h>
+#include <coveo/lazy/string_set.h>
+#include <coveo/benchmark_framework.h>
 #include <coveo/test_framework.h>
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <initializer_list>
 #include <iterator>
+#include <numeric>
 #include <random>
 #include <set>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <typeinfo>
+#include <unordered_set>
 #include <vector>
 #include <utility>
 
@@ -34,6 +47,13 @@ bool container_is_less_than(const C1& c1, const C2& c2) {
     return std::lexicographical_compare(std::begin(c1), std::end(c1), std::begin(c2), std::end(c2));
 }
 
+// Copies bytes written by serialize() in a buffer suitably aligned for a sorted_view.
+inline std::vector<std::uint64_t> to_aligned_buffer(const std::string& bytes) {
+    std::vector<std::uint64_t> buffer((bytes.size() + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+    std::memcpy(buffer.data(), bytes.data(), bytes.size());
+    return buffer;
+}
+
 // Simple class that can be compared with ints.
 class Int
 {
@@ -169,6 +189,105 @@ void benchmark_mixed_set_operations(const char* const test_name)
     std::cout << "Benchmark completed in " << elapsed_s.count() << "s" << std::endl;
 }
 
+// Performs a suite of benchmarks on a set-like container: bulk load,
+// insert then lookup, interleaved inserts and lookups, iteration and erase.
+template<class SetT, class K>
+void benchmark_set_suite(const std::string& container_name, const coveo_tests::benchmark_keys<K>& bk)
+{
+    typedef SetT set_type;
+    const size_t size = bk.keys.size();
+
+    coveo_tests::run_benchmark("bulk load", container_name, size, [&]() {
+        set_type s(bk.keys.cbegin(), bk.keys.cend());
+        return static_cast<size_t>(s.count(bk.keys.front()));
+    });
+    coveo_tests::run_benchmark("insert then lookup", container_name, size, [&]() {
+        set_type s;
+        for (auto&& key : bk.keys) {
+            s.insert(key);
+        }
+        size_t num_found = 0;
+        for (auto&& key : bk.lookups) {
+            if (s.find(key) != s.end()) {
+                ++num_found;
+            }
+        }
+        return num_found;
+    });
+
+    // Interleaving inserts and lookups is the worst case for lazy containers,
+    // since they need to sort often; limit the number of inserts to keep it reasonable.
+    const size_t interleaved_size = std::min<size_t>(size, 10000);
+    const std::pair<size_t, size_t> ratios[] = { { 1, 1 }, { 1, 10 }, { 10, 1 }, { 100, 1 } };
+    for (auto&& ratio : ratios) {
+        const std::string benchmark_name = "interleaved " + std::to_string(ratio.first) +
+                                           ":" + std::to_string(ratio.second);
+        coveo_tests::run_benchmark(benchmark_name, container_name, interleaved_size, [&]() {
+            set_type s;
+            size_t num_found = 0;
+            size_t key_idx = 0, lookup_idx = 0;
+            while (key_idx < interleaved_size) {
+                for (size_t i = 0; i < ratio.first && key_idx < interleaved_size; ++i) {
+                    s.insert(bk.keys[key_idx++]);
+                }
+                for (size_t i = 0; i < ratio.second; ++i) {
+                    if (s.find(bk.lookups[lookup_idx++ % interleaved_size]) != s.end()) {
+                        ++num_found;
+                    }
+                }
+            }
+            return num_found;
+        });
+    }
+
+    {
+        set_type s(bk.keys.cbegin(), bk.keys.cend());
+        s.find(bk.keys.front());
+        coveo_tests::run_benchmark("iteration", container_name, size, [&]() {
+            size_t checksum = 0;
+            for (auto&& elem : s) {
+                checksum += coveo_tests::benchmark_key<K>::checksum(elem);
+            }
+            return checksum;
+        });
+        coveo_tests::run_benchmark("erase(key)", container_name, size, [&]() {
+            size_t num_erased = 0;
+            for (auto&& key : bk.lookups) {
+                num_erased += s.erase(key);
+            }
+            return num_erased;
+        });
+    }
+}
+
+// Performs benchmark suite for coveo::lazy::string_set, which only supports string keys.
+template<class K>
+void benchmark_string_set_suite(const coveo_tests::benchmark_keys<K>&)
+{
+}
+inline void benchmark_string_set_suite(const coveo_tests::benchmark_keys<std::string>& bk)
+{
+    benchmark_set_suite<coveo::lazy::string_set>("coveo::lazy::string_set", bk);
+}
+
+// Performs benchmark suites for set-like containers using keys of the given type.
+template<class K>
+void benchmark_set_suites_for_key()
+{
+    const std::string key_name = coveo_tests::benchmark_key<K>::name();
+    const size_t sizes[] = { 1000, 100000, 1000000 };
+    for (size_t size : sizes) {
+        coveo_tests::benchmark_keys<K> bk(size);
+        benchmark_set_suite<std::set<K>>("std::set<" + key_name + ">", bk);
+        benchmark_set_suite<std::unordered_set<K>>("std::unordered_set<" + key_name + ">", bk);
+        benchmark_set_suite<coveo::lazy::set<K>>("coveo::lazy::set<" + key_name + ">", bk);
+        benchmark_set_suite<std::multiset<K>>("std::multiset<" + key_name + ">", bk);
+        benchmark_set_suite<coveo::lazy::multiset<K>>("coveo::lazy::multiset<" + key_name + ">", bk);
+        benchmark_string_set_suite(bk);
+        std::cout << std::endl;
+    }
+}
+
 } // namespace detail
 
 // Tests for coveo::lazy::set class
@@ -280,6 +399,38 @@ void set_tests()
         COVEO_ASSERT(local.capacity() >= 0);
     }
 
+    // Memory stats
+    {
+        int_set local({ 11, 23, 42 });
+        COVEO_ASSERT(local.pending_size() == 3);
+        local.sort();
+        local.reserve(16);
+        local.insert(7);
+        local.insert(23);
+        COVEO_ASSERT(local.pending_size() == 2);
+        auto stats = local.memory_stats();
+        COVEO_ASSERT(!local.sorted());
+        COVEO_ASSERT(stats.stored_elements == 5);
+        COVEO_ASSERT(stats.sorted_elements == 3);
+        COVEO_ASSERT(stats.pending_elements == 2);
+        COVEO_ASSERT(stats.possible_duplicates == 2);
+        COVEO_ASSERT(stats.pending_erasures == 0);
+        COVEO_ASSERT(stats.capacity == local.capacity());
+        COVEO_ASSERT(stats.element_size == sizeof(int));
+        COVEO_ASSERT(stats.bytes_used == 5 * sizeof(int));
+        COVEO_ASSERT(stats.bytes_allocated >= 16 * sizeof(int));
+        local.lazy_erase(11);
+        stats = local.memory_stats();
+        COVEO_ASSERT(stats.pending_erasures == 1);
+        COVEO_ASSERT(stats.bytes_used > 5 * sizeof(int));
+        COVEO_ASSERT(!local.sorted());
+        COVEO_ASSERT(local.size() == 3);
+        COVEO_ASSERT(local.pending_size() == 0);
+        stats = local.memory_stats();
+        COVEO_ASSERT(stats.stored_elements == 3 && stats.sorted_elements == 3);
+        COVEO_ASSERT(stats.possible_duplicates == 0 && stats.pending_erasures == 0);
+    }
+
     // Lookups
     {
         COVEO_ASSERT(fromstdvector.count(23) == 1);
@@ -333,6 +484,724 @@ void set_tests()
         COVEO_ASSERT(it_pair.second == fromstdvector.end());
     }
 
+    // Batched lookups
+    {
+        std::vector<int> keys({ 42, 24, 23, 99 });
+        std::vector<int_set::const_iterator> found;
+        const int_set& cfromstdvector = fromstdvector;
+        cfromstdvector.find_all(keys.cbegin(), keys.cend(), std::back_inserter(found));
+        COVEO_ASSERT(found.size() == 4);
+        COVEO_ASSERT(found[0] != fromstdvector.cend() && *found[0] == 42);
+        COVEO_ASSERT(found[1] == fromstdvector.cend());
+        COVEO_ASSERT(found[2] != fromstdvector.cend() && *found[2] == 23);
+        COVEO_ASSERT(found[3] == fromstdvector.cend());
+        COVEO_ASSERT(fromstdvector.count_all(keys.cbegin(), keys.cend()) == 2);
+        COVEO_ASSERT(!fromstdvector.contains_all(keys.cbegin(), keys.cend()));
+        COVEO_ASSERT(fromstdvector.contains_all(keys.cbegin(), keys.cbegin() + 1));
+        COVEO_ASSERT(fromstdvector.contains_all(keys.cbegin(), keys.cbegin()));
+
+        // Sorted, unsorted, arithmetic and non-arithmetic keys take different paths
+        std::mt19937 rand;
+        std::uniform_int_distribution<int> dist(0, 2000);
+        int_set local;
+        coveo::lazy::set<std::string> string_local;
+        std::set<int> expected;
+        for (int i = 0; i < 1000; ++i) {
+            int val = dist(rand);
+            local.insert(val);
+            string_local.insert(std::to_string(val));
+            expected.insert(val);
+        }
+        std::vector<int> probes;
+        for (int i = 0; i < 500; ++i) {
+            probes.push_back(dist(rand));
+        }
+        std::vector<int> sorted_probes(probes);
+        std::sort(sorted_probes.begin(), sorted_probes.end());
+        std::vector<std::string> string_probes;
+        for (int probe : probes) {
+            string_probes.push_back(std::to_string(probe));
+        }
+        std::size_t expected_count = 0;
+        for (int probe : probes) {
+            expected_count += expected.count(probe);
+        }
+        for (auto* probe_keys : { &probes, &sorted_probes }) {
+            std::vector<int_set::iterator> local_found;
+            local.find_all(probe_keys->cbegin(), probe_keys->cend(), std::back_inserter(local_found));
+            COVEO_ASSERT(local_found.size() == probe_keys->size());
+            for (std::size_t i = 0; i < local_found.size(); ++i) {
+                COVEO_ASSERT(local_found[i] == local.find((*probe_keys)[i]));
+            }
+            COVEO_ASSERT(local.count_all(probe_keys->cbegin(), probe_keys->cend()) == expected_count);
+        }
+        COVEO_ASSERT(string_local.count_all(string_probes.cbegin(), string_probes.cend()) == expected_count);
+        std::sort(string_probes.begin(), string_probes.end());
+        COVEO_ASSERT(string_local.count_all(string_probes.cbegin(), string_probes.cend()) == expected_count);
+        std::vector<int> present(expected.cbegin(), expected.cend());
+        std::shuffle(present.begin(), present.end(), rand);
+        COVEO_ASSERT(local.contains_all(present.cbegin(), present.cend()));
+    }
+
+    // Lazy erasure
+    {
+        int_set local({ 42, 23, 11, 7, 99 });
+        local.lazy_erase(23);
+        local.lazy_erase(24);
+        local.insert(66);
+        COVEO_ASSERT(!local.sorted());
+        COVEO_ASSERT(local.find(23) == local.end());
+        COVEO_ASSERT(local.size() == 5);
+        COVEO_ASSERT(containers_are_equal(local, std::vector<int>({ 7, 11, 42, 66, 99 })));
+
+        // Keys inserted after they are erased are kept
+        local.lazy_erase(42);
+        local.insert(42);
+        local.lazy_erase(7);
+        COVEO_ASSERT(local.count(42) == 1);
+        COVEO_ASSERT(local.count(7) == 0);
+
+        // Lookups that scan pending elements see erasures
+        local.set_pending_limit(8);
+        local.insert(5);
+        local.lazy_erase(11);
+        COVEO_ASSERT(local.find(11) == local.end());
+        COVEO_ASSERT(local.find(5) != local.end());
+        local.lazy_erase(5);
+        local.insert(5);
+        COVEO_ASSERT(local.count(5) == 1);
+
+        COVEO_ASSERT(local.erase_if([](int val) { return val % 2 == 0; }) == 2);
+        COVEO_ASSERT(containers_are_equal(local, std::vector<int>({ 5, 99 })));
+        local.lazy_erase(99);
+        COVEO_ASSERT(erase_if(local, [](int val) { return val == 99; }) == 0);
+        COVEO_ASSERT(containers_are_equal(local, std::vector<int>({ 5 })));
+        local.lazy_erase(5);
+        COVEO_ASSERT(local.empty());
+
+        std::mt19937 rand;
+        std::uniform_int_distribution<int> dist(0, 500);
+        std::set<int> expected;
+        local.set_pending_limit(0);
+        for (int i = 0; i < 5000; ++i) {
+            int val = dist(rand);
+            if (i % 3 == 0) {
+                local.lazy_erase(val);
+                expected.erase(val);
+            } else {
+                local.insert(val);
+                expected.insert(val);
+            }
+            if (i % 701 == 0) {
+                COVEO_ASSERT(containers_are_equal(local, expected));
+            }
+        }
+        COVEO_ASSERT(containers_are_equal(local, expected));
+    }
+    {
+        // Erasing with iterators returned while elements are pending
+        int_set local;
+        local.set_pending_limit(8);
+        local.insert({ 1, 2, 3, 4 });
+        local.sort();
+        local.insert(0);
+        local.erase(local.find(2));
+        COVEO_ASSERT(local.find(0) != local.end());
+        COVEO_ASSERT(containers_are_equal(local, std::vector<int>({ 0, 1, 3, 4 })));
+
+        local.insert({ 7, 6 });
+        local.erase(local.find(1), local.find(4));
+        COVEO_ASSERT(local.find(6) != local.end());
+        COVEO_ASSERT(containers_are_equal(local, std::vector<int>({ 0, 4, 6, 7 })));
+
+        local.insert({ 9, 8 });
+        auto extracted = local.extract(local.find(6), local.end());
+        COVEO_ASSERT(containers_are_equal(extracted, std::vector<int>({ 6, 7, 8, 9 })));
+        COVEO_ASSERT(containers_are_equal(local, std::vector<int>({ 0, 4 })));
+
+        typedef coveo::lazy::set<int, std::less<int>, coveo::lazy::small_vector_impl<16>::type> small_int_set;
+        small_int_set small({ 1, 2, 3, 4 });
+        small.sort();
+        small.insert(0);
+        small.erase(small.find(2));
+        COVEO_ASSERT(small.find(0) != small.end());
+        COVEO_ASSERT(containers_are_equal(small, std::vector<int>({ 0, 1, 3, 4 })));
+    }
+
+    // Bulk erasure
+    {
+        int_set local;
+        for (int i = 100; i > 0; --i) {
+            local.insert(i);
+        }
+        std::vector<std::pair<int, int>> ranges({ { 0, 11 }, { 5, 21 }, { 50, 50 }, { 90, 95 }, { 99, 200 } });
+        COVEO_ASSERT(local.erase_ranges(ranges.cbegin(), ranges.cend()) == 27);
+        COVEO_ASSERT(local.size() == 73 && *local.begin() == 21 && *local.rbegin() == 98);
+        COVEO_ASSERT(local.count(89) == 1 && local.count(90) == 0 && local.count(95) == 1);
+
+        std::vector<int> keys({ 1, 21, 22, 50, 96 });
+        COVEO_ASSERT(local.erase_keys(keys.cbegin(), keys.cend()) == 4);
+        COVEO_ASSERT(local.size() == 69 && *local.begin() == 23);
+
+        int_set other({ 2, 23, 24, 60, 97, 300 });
+        local.insert(5);
+        local.lazy_erase(24);
+        COVEO_ASSERT(local.retain_keys(other.cbegin(), other.cend()) == 66);
+        COVEO_ASSERT(containers_are_equal(local, std::vector<int>({ 23, 60, 97 })));
+        COVEO_ASSERT(local.retain_keys(keys.cend(), keys.cend()) == 3);
+        COVEO_ASSERT(local.empty());
+    }
+
+#ifdef COVEO_LAZY_HAS_MEMORY_RESOURCE
+    // Polymorphic allocators
+    {
+        static char buffer[1 << 16];
+        std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+        coveo::lazy::pmr::set<int> local(&arena);
+        for (int i = 0; i < 100; ++i) {
+            local.insert((i * 37) % 101);
+        }
+        local.lazy_erase(37);
+        COVEO_ASSERT(local.size() == 99);
+        COVEO_ASSERT(local.get_allocator().resource() == &arena);
+
+        std::pmr::unsynchronized_pool_resource other;
+        coveo::lazy::pmr::set<int> copy(local, &other);
+        COVEO_ASSERT(copy.get_allocator().resource() == &other);
+        COVEO_ASSERT(containers_are_equal(copy, local));
+        coveo::lazy::pmr::set<int> moved(std::move(copy), &arena);
+        COVEO_ASSERT(moved.get_allocator().resource() == &arena);
+        COVEO_ASSERT(copy.empty());
+        COVEO_ASSERT(containers_are_equal(moved, local));
+
+        // Allocators do not propagate, so elements are moved one by one
+        coveo::lazy::pmr::set<int> assigned(&other);
+        assigned = std::move(moved);
+        COVEO_ASSERT(assigned.get_allocator().resource() == &other);
+        COVEO_ASSERT(moved.empty());
+        COVEO_ASSERT(containers_are_equal(assigned, local));
+
+        coveo::lazy::pmr::set<int> swapped({ 1, 2 }, &arena);
+        swapped.swap(local);
+        COVEO_ASSERT(swapped.size() == 99);
+        COVEO_ASSERT(containers_are_equal(local, std::vector<int>({ 1, 2 })));
+        COVEO_ASSERT(set_union(local, swapped).get_allocator().resource() == &arena);
+    }
+    {
+        // Sorting allocates its temporary buffers with the container's allocator;
+        // this resource counts allocations made through it and, since its upstream
+        // cannot fall back to global memory, checks they fit in the arena
+        struct counting_resource : std::pmr::memory_resource {
+            std::pmr::memory_resource* upstream;
+            std::size_t allocations = 0;
+            explicit counting_resource(std::pmr::memory_resource* up) : upstream(up) { }
+            void* do_allocate(std::size_t bytes, std::size_t align) override {
+                ++allocations;
+                return upstream->allocate(bytes, align);
+            }
+            void do_deallocate(void* ptr, std::size_t bytes, std::size_t align) override {
+                upstream->deallocate(ptr, bytes, align);
+            }
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+                return this == &other;
+            }
+        };
+        static char buffer[1 << 20];
+        std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+        counting_resource counting(&arena);
+        coveo::lazy::pmr::set<int> local(&counting);
+        coveo::lazy::pmr::multiset<int> multi(&counting);
+        coveo::lazy::pmr::multiset<std::pair<int, int>> pairs(&counting);
+        local.reserve(2000);
+        multi.reserve(2000);
+        pairs.reserve(2000);
+        for (int i = 0; i < 1000; ++i) {
+            local.insert((i * 7919) % 1009);
+            multi.insert(i % 17);
+            pairs.emplace(i % 13, i);
+        }
+        local.sort();
+        multi.sort();
+        pairs.sort();
+        for (int i = 0; i < 1000; ++i) {
+            local.insert((i * 7919) % 2003);
+            multi.insert(i % 19);
+            pairs.emplace(i % 11, -i);
+        }
+        std::size_t allocations = counting.allocations;
+        local.sort();
+        COVEO_ASSERT(counting.allocations > allocations);
+        allocations = counting.allocations;
+        multi.sort();
+        COVEO_ASSERT(counting.allocations > allocations);
+        allocations = counting.allocations;
+        pairs.sort();
+        COVEO_ASSERT(counting.allocations > allocations);
+        COVEO_ASSERT(std::is_sorted(local.cbegin(), local.cend()));
+        COVEO_ASSERT(std::adjacent_find(local.cbegin(), local.cend()) == local.cend());
+        COVEO_ASSERT(multi.size() == 2000);
+        COVEO_ASSERT(std::is_sorted(multi.cbegin(), multi.cend()));
+        COVEO_ASSERT(pairs.size() == 2000);
+        COVEO_ASSERT(std::is_sorted(pairs.cbegin(), pairs.cend()));
+
+        // Eytzinger index is allocated with the container's allocator when sorting, never by lookups
+        typedef coveo::lazy::set<int, std::less<int>, std::vector,
+                                 coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>>,
+                                 std::pmr::polymorphic_allocator<int>,
+                                 coveo::lazy::default_sort_policy,
+                                 coveo::lazy::no_sort_stats,
+                                 coveo::lazy::eytzinger_search_policy<4>> pmr_eytzinger_int_set;
+        pmr_eytzinger_int_set indexed(&counting);
+        for (int i = 0; i < 100; ++i) {
+            indexed.insert(i * 2);
+        }
+        COVEO_ASSERT(indexed.sorted());
+        allocations = counting.allocations;
+        COVEO_ASSERT(indexed.find(42) != indexed.end());
+        COVEO_ASSERT(counting.allocations == allocations);
+        indexed.sort();
+        COVEO_ASSERT(counting.allocations > allocations);
+        allocations = counting.allocations;
+        COVEO_ASSERT(*indexed.find(42) == 42);
+        COVEO_ASSERT(indexed.find(43) == indexed.end());
+        COVEO_ASSERT(counting.allocations == allocations);
+    }
+#endif
+
+    // Merging and set operations
+    {
+        int_set left({ 42, 23, 11, 7 });
+        int_set right({ 24, 11, 99, 42 });
+        std::set<int> stdleft(left.cbegin(), left.cend());
+        std::set<int> stdright(right.cbegin(), right.cend());
+        left.insert(66);
+        stdleft.insert(66);
+
+        std::vector<int> expected;
+        std::set_union(stdleft.cbegin(), stdleft.cend(), stdright.cbegin(), stdright.cend(), std::back_inserter(expected));
+        COVEO_ASSERT(containers_are_equal(set_union(left, right), expected));
+        expected.clear();
+        std::set_intersection(stdleft.cbegin(), stdleft.cend(), stdright.cbegin(), stdright.cend(), std::back_inserter(expected));
+        COVEO_ASSERT(containers_are_equal(set_intersection(left, right), expected));
+        expected.clear();
+        std::set_difference(stdleft.cbegin(), stdleft.cend(), stdright.cbegin(), stdright.cend(), std::back_inserter(expected));
+        COVEO_ASSERT(containers_are_equal(set_difference(left, right), expected));
+        COVEO_ASSERT(containers_are_equal(set_difference(int_set(left), int_set(right)), expected));
+
+        int_set merged(left);
+        int_set others(right);
+        merged.merge(others);
+        COVEO_ASSERT(containers_are_equal(merged, std::vector<int>({ 7, 11, 23, 24, 42, 66, 99 })));
+        COVEO_ASSERT(containers_are_equal(others, std::vector<int>({ 11, 42 })));
+
+        int_set spliced(left);
+        spliced.splice(int_set(right));
+        COVEO_ASSERT(containers_are_equal(spliced, merged));
+
+        int_set appended({ 1, 2 });
+        appended.merge(int_set({ 4, 3 }));
+        COVEO_ASSERT(containers_are_equal(appended, std::vector<int>({ 1, 2, 3, 4 })));
+
+        auto extracted = merged.extract(42);
+        COVEO_ASSERT(containers_are_equal(extracted, std::vector<int>({ 42 })));
+        COVEO_ASSERT(merged.count(42) == 0);
+        extracted = merged.extract(merged.lower_bound(24), merged.end());
+        COVEO_ASSERT(containers_are_equal(extracted, std::vector<int>({ 24, 66, 99 })));
+        COVEO_ASSERT(containers_are_equal(merged, std::vector<int>({ 7, 11, 23 })));
+        COVEO_ASSERT(merged.extract(10).empty());
+    }
+
+    // Serialization and views
+    {
+        int_set local({ 42, 23, 11, 7, 66 });
+        local.insert(1);
+        std::ostringstream oss;
+        local.serialize(oss);
+        COVEO_ASSERT(local.sorted());
+        const std::string bytes = oss.str();
+        auto buffer = to_aligned_buffer(bytes);
+
+        int_set::view_type view(buffer.data(), bytes.size());
+        COVEO_ASSERT(view.size() == local.size());
+        COVEO_ASSERT(containers_are_equal(view, local));
+        COVEO_ASSERT(*view.crbegin() == 66);
+        COVEO_ASSERT(view.find(23) != view.end() && *view.find(23) == 23);
+        COVEO_ASSERT(view.find(24) == view.end());
+        COVEO_ASSERT(view.count(42) == 1 && view.count(43) == 0);
+        COVEO_ASSERT(*view.lower_bound(24) == 42);
+        COVEO_ASSERT(*view.upper_bound(42) == 66);
+        COVEO_ASSERT(view.upper_bound(66) == view.end());
+        auto range = view.equal_range(11);
+        COVEO_ASSERT(range.first != range.second && std::next(range.first) == range.second);
+
+        coveo::lazy::multiset_view<int> multi_view(buffer.data(), bytes.size());
+        COVEO_ASSERT(containers_are_equal(multi_view, local));
+
+        std::vector<int> sorted({ 1, 3, 5 });
+        coveo::lazy::set_view<int> local_view(sorted.data(), sorted.data() + sorted.size());
+        COVEO_ASSERT(local_view.count(3) == 1 && local_view.count(4) == 0);
+        coveo::lazy::set_view<int> empty_view;
+        COVEO_ASSERT(empty_view.empty() && empty_view.find(1) == empty_view.end());
+        swap(empty_view, local_view);
+        COVEO_ASSERT(local_view.empty() && empty_view.size() == 3);
+
+        int_set empty_set;
+        std::ostringstream empty_oss;
+        empty_set.serialize(empty_oss);
+        auto empty_buffer = to_aligned_buffer(empty_oss.str());
+        COVEO_ASSERT(int_set::view_type(empty_buffer.data(), empty_oss.str().size()).empty());
+
+        auto assert_invalid = [](auto&& make_view) {
+            try {
+                make_view();
+                COVEO_ASSERT_FALSE();
+            } catch (const coveo::lazy::format_error&) {
+            }
+        };
+        assert_invalid([&]() { int_set::view_type(buffer.data(), bytes.size() - 1); });
+        assert_invalid([&]() { int_set::view_type(buffer.data(), 10); });
+        assert_invalid([&]() { coveo::lazy::set_view<int, std::greater<int>>(buffer.data(), bytes.size()); });
+        assert_invalid([&]() { coveo::lazy::set_view<std::int64_t>(buffer.data(), bytes.size()); });
+        auto bad_magic = buffer;
+        reinterpret_cast<char*>(bad_magic.data())[0] = 'X';
+        assert_invalid([&]() { int_set::view_type(bad_magic.data(), bytes.size()); });
+
+        std::vector<char> misaligned(bytes.size() + 1);
+        std::memcpy(misaligned.data() + 1, bytes.data(), bytes.size());
+        assert_invalid([&]() { int_set::view_type(misaligned.data() + 1, bytes.size()); });
+
+        coveo::lazy::multiset<int> multi({ 1, 1, 2 });
+        std::ostringstream multi_oss;
+        multi.serialize(multi_oss);
+        auto multi_buffer = to_aligned_buffer(multi_oss.str());
+        assert_invalid([&]() { int_set::view_type(multi_buffer.data(), multi_oss.str().size()); });
+        coveo::lazy::multiset<int>::view_type multi_from_multi(multi_buffer.data(), multi_oss.str().size());
+        COVEO_ASSERT(multi_from_multi.count(1) == 2);
+    }
+
+    // Frozen views
+    {
+        int_set local({ 42, 23, 11 });
+        local.insert(7);
+        auto frozen = local.freeze();
+        COVEO_ASSERT(local.size() == 4);
+        local.insert(1);
+        COVEO_ASSERT(containers_are_equal(frozen, std::vector<int>({ 7, 11, 23, 42 })));
+
+        auto moved = std::move(local).freeze();
+        COVEO_ASSERT(local.empty());
+        COVEO_ASSERT(containers_are_equal(moved, std::vector<int>({ 1, 7, 11, 23, 42 })));
+        local.insert(2);
+        COVEO_ASSERT(local.size() == 1 && moved.size() == 5);
+
+        coveo::lazy::set_view<int> outlived;
+        {
+            int_set temp({ 3, 2, 1 });
+            outlived = temp.freeze();
+        }
+        COVEO_ASSERT(outlived.count(2) == 1 && *outlived.rbegin() == 3);
+
+        int_set big;
+        for (int i = 0; i < 10000; ++i) {
+            big.insert((i * 7919) % 10000);
+        }
+        const auto shared = std::move(big).freeze();
+        bool readers_ok = true;
+        std::mutex readers_ok_mutex;
+        std::vector<std::thread> readers;
+        for (int r = 0; r < 4; ++r) {
+            readers.emplace_back([&shared, &readers_ok, &readers_ok_mutex, r]() {
+                bool ok = true;
+                for (int i = r; i < 10000; i += 4) {
+                    ok = ok && shared.find(i) != shared.end() && *shared.lower_bound(i) == i;
+                }
+                std::lock_guard<std::mutex> lock(readers_ok_mutex);
+                readers_ok = readers_ok && ok;
+            });
+        }
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        COVEO_ASSERT(readers_ok);
+
+        coveo::lazy::multiset<int> multi({ 2, 1, 2 });
+        auto multi_frozen = multi.freeze();
+        COVEO_ASSERT(multi_frozen.count(2) == 2);
+    }
+
+    // Asynchronous sort
+    {
+        int_set local({ 42, 23, 11 });
+        auto done = local.sort_async([](auto&& task) { task(); });
+        COVEO_ASSERT(done.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+        COVEO_ASSERT(local.sorted());
+        COVEO_ASSERT(containers_are_equal(local, std::vector<int>({ 11, 23, 42 })));
+        bool scheduled = false;
+        local.sort_async([&scheduled](auto&&) { scheduled = true; }).get();
+        COVEO_ASSERT(!scheduled);
+
+        // Run sort as a later pipeline stage; lookups wait for it.
+        std::vector<std::function<void()>> stage;
+        local.insert(7);
+        local.insert(3);
+        local.sort_async([&stage](auto&& task) { stage.emplace_back(std::forward<decltype(task)>(task)); });
+        COVEO_ASSERT(stage.size() == 1);
+        COVEO_ASSERT(!local.sorted());
+        std::thread worker([&stage]() {
+            for (auto& task : stage) {
+                task();
+            }
+        });
+        COVEO_ASSERT(local.count(7) == 1);
+        worker.join();
+        COVEO_ASSERT(local.sorted());
+        COVEO_ASSERT(containers_are_equal(local, std::vector<int>({ 3, 7, 11, 23, 42 })));
+
+        int_set big;
+        for (int i = 0; i < 10000; ++i) {
+            big.insert((i * 7919) % 10000);
+        }
+        auto big_done = big.sort_async();
+        int_set copy(big);
+        COVEO_ASSERT(copy.sorted() && copy.size() == 10000);
+        big_done.get();
+        COVEO_ASSERT(big.sorted() && *big.lower_bound(5000) == 5000);
+        big.insert(-1);
+        big.sort_async();
+        int_set moved(std::move(big));
+        COVEO_ASSERT(moved.sorted() && *moved.begin() == -1);
+        COVEO_ASSERT(big.empty());
+        moved.insert(-2);
+        moved.sort_async();
+        moved.insert(-3);
+        COVEO_ASSERT(moved.size() == 10003 && *moved.begin() == -3);
+        moved.insert(-4);
+        moved.sort_async();
+        copy = moved;
+        COVEO_ASSERT(copy.size() == 10004);
+
+        // Copies wait for the sort before copying sort stats
+        typedef coveo::lazy::set<int, std::less<int>, std::vector,
+                                 coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>>,
+                                 std::allocator<int>,
+                                 coveo::lazy::default_sort_policy,
+                                 coveo::lazy::counting_sort_stats> counted_int_set;
+        auto delayed = [](auto&& task) {
+            std::thread([task = std::forward<decltype(task)>(task)]() mutable {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                task();
+            }).detach();
+        };
+        counted_int_set counted({ 3, 1, 2 });
+        counted.sort_async(delayed);
+        counted_int_set counted_copy(counted);
+        COVEO_ASSERT(counted_copy.sort_stats().sort_count() == 1);
+        counted.insert(0);
+        counted.sort_async(delayed);
+        counted_int_set counted_alloc_copy(counted, std::allocator<int>());
+        COVEO_ASSERT(counted_alloc_copy.sort_stats().sort_count() == 2);
+        counted.insert(-1);
+        counted.sort_async(delayed);
+        counted_copy = counted;
+        COVEO_ASSERT(counted_copy.sort_stats().sort_count() == 3);
+        COVEO_ASSERT(containers_are_equal(counted_copy, std::vector<int>({ -1, 0, 1, 2, 3 })));
+
+        // If task is never run, container remains usable but unsorted.
+        int_set dropped({ 3, 1, 2 });
+        dropped.sort_async([](auto&&) { });
+        try {
+            dropped.find(1);
+            COVEO_ASSERT_FALSE();
+        } catch (const std::future_error&) {
+        }
+        COVEO_ASSERT(!dropped.sorted());
+        COVEO_ASSERT(containers_are_equal(dropped, std::vector<int>({ 1, 2, 3 })));
+    }
+
+    // Duplicate policies
+    {
+        // Elements with the same id are duplicates; which one is kept is visible through rank.
+        struct ranked {
+            int id;
+            int rank;
+        };
+        struct ranked_less {
+            bool operator()(const ranked& left, const ranked& right) const { return left.id < right.id; }
+        };
+        struct ranked_eq {
+            bool operator()(const ranked& left, const ranked& right) const { return left.id == right.id; }
+        };
+        struct ranked_max {
+            ranked operator()(ranked&& left, ranked&& right) const { return left.rank >= right.rank ? left : right; }
+        };
+        typedef coveo::lazy::set<ranked, ranked_less, std::vector, ranked_eq, std::allocator<ranked>,
+                                 coveo::lazy::default_sort_policy,
+                                 coveo::lazy::no_sort_stats,
+                                 coveo::lazy::binary_search_policy,
+                                 coveo::lazy::first_wins_duplicate_policy> first_wins_set;
+        typedef coveo::lazy::set<ranked, ranked_less, std::vector, ranked_eq, std::allocator<ranked>,
+                                 coveo::lazy::default_sort_policy,
+                                 coveo::lazy::no_sort_stats,
+                                 coveo::lazy::binary_search_policy,
+                                 coveo::lazy::last_wins_duplicate_policy> last_wins_set;
+        typedef coveo::lazy::set<ranked, ranked_less, std::vector, ranked_eq, std::allocator<ranked>,
+                                 coveo::lazy::default_sort_policy,
+                                 coveo::lazy::no_sort_stats,
+                                 coveo::lazy::binary_search_policy,
+                                 coveo::lazy::combine_duplicate_policy<ranked_max>> max_rank_set;
+
+        std::vector<ranked> values;
+        for (int i = 0; i < 500; ++i) {
+            values.push_back(ranked{ (i * 7) % 5, i % 97 });
+        }
+        first_wins_set first(values.begin(), values.end());
+        last_wins_set last(values.begin(), values.end());
+        max_rank_set max_rank(values.begin(), values.end());
+        COVEO_ASSERT(first.size() == 5 && last.size() == 5 && max_rank.size() == 5);
+        for (int id = 0; id < 5; ++id) {
+            auto first_it = std::find_if(values.begin(), values.end(), [id](const ranked& r) { return r.id == id; });
+            auto last_it = std::find_if(values.rbegin(), values.rend(), [id](const ranked& r) { return r.id == id; });
+            COVEO_ASSERT(first.find(ranked{ id, 0 })->rank == first_it->rank);
+            COVEO_ASSERT(last.find(ranked{ id, 0 })->rank == last_it->rank);
+            COVEO_ASSERT(max_rank.find(ranked{ id, 0 })->rank == 96);
+        }
+        first.insert(ranked{ 2, 1000 });
+        last.insert(ranked{ 2, 1000 });
+        COVEO_ASSERT(first.find(ranked{ 2, 0 })->rank != 1000);
+        COVEO_ASSERT(last.find(ranked{ 2, 0 })->rank == 1000);
+    }
+
+    // Adaptive storage
+    {
+        coveo::lazy::adaptive_thresholds thresholds;
+        thresholds.thrashing_sorts = 2;
+        thresholds.min_tree_size = 10;
+        thresholds.bulk_inserts = 10;
+        coveo::lazy::adaptive_set<int> local({ 42, 23, 11 }, std::less<int>(), thresholds);
+        for (int i = 100; i < 120; ++i) {
+            local.insert(i);
+        }
+        for (int i = 0; i < 3; ++i) {
+            local.insert(i);
+            COVEO_ASSERT(local.count(i) == 1);
+        }
+        COVEO_ASSERT(local.mode() == coveo::lazy::adaptive_mode::tree);
+        local.insert(42);
+        COVEO_ASSERT(local.size() == 26);
+        COVEO_ASSERT(*local.begin() == 0 && *std::prev(local.end()) == 119);
+        auto range = local.equal_range(23);
+        COVEO_ASSERT(std::distance(range.first, range.second) == 1);
+        std::vector<int> more({ 7, 300, 301, 302, 303, 304, 305, 306, 307, 308, 309 });
+        local.insert(more.begin(), more.end());
+        COVEO_ASSERT(local.mode() == coveo::lazy::adaptive_mode::lazy);
+        COVEO_ASSERT(local.size() == 37);
+        COVEO_ASSERT(*local.lower_bound(8) == 11);
+
+        coveo::lazy::adaptive_multiset<int> multi({ 2, 1, 2 });
+        COVEO_ASSERT(multi.count(2) == 2);
+
+        // Same methods in both storages
+        coveo::lazy::adaptive_set<std::string, std::less<>> tr(std::less<>(), thresholds);
+        for (int i = 10; i < 40; ++i) {
+            tr.insert(std::to_string(i));
+        }
+        for (int pass = 0; pass < 2; ++pass) {
+            const auto mode = pass == 0 ? coveo::lazy::adaptive_mode::lazy : coveo::lazy::adaptive_mode::tree;
+            COVEO_ASSERT(tr.mode() == mode);
+            COVEO_ASSERT(tr.size() == 30);
+            COVEO_ASSERT(*tr.rbegin() == "39" && *std::prev(tr.crend()) == "10");
+            COVEO_ASSERT(std::is_sorted(tr.crbegin(), tr.crend(), std::greater<std::string>()));
+            COVEO_ASSERT(tr.find("25") != tr.end() && tr.count("25") == 1);
+            COVEO_ASSERT(*tr.lower_bound("255") == "26" && *tr.upper_bound("26") == "27");
+            auto trange = tr.equal_range("26");
+            COVEO_ASSERT(std::distance(trange.first, trange.second) == 1);
+            COVEO_ASSERT(*tr.erase(tr.find("25")) == "26");
+            COVEO_ASSERT(tr.erase("26") == 1 && tr.erase("26") == 0);
+            COVEO_ASSERT(*tr.erase(tr.find("30"), tr.find("35")) == "35");
+            tr.lazy_erase("10");
+            tr.lazy_erase(std::string("11"));
+            COVEO_ASSERT(tr.size() == 21 && *tr.begin() == "12");
+            tr.emplace_hint(tr.end(), "25");
+            tr.insert(tr.cbegin(), std::string("26"));
+            for (int i = 30; i < 35; ++i) {
+                tr.insert(tr.cend(), std::to_string(i));
+            }
+            tr.insert("10");
+            tr.insert("11");
+            COVEO_ASSERT(tr.size() == 30);
+            for (int i = 0; i < 3 && pass == 0; ++i) {
+                // Interleave insertions and lookups to move to the tree
+                tr.insert(std::to_string(i));
+                COVEO_ASSERT(tr.count(std::to_string(i)) == 1);
+            }
+            for (int i = 0; i < 3 && pass == 0; ++i) {
+                tr.erase(std::to_string(i));
+            }
+        }
+    }
+
+    // Concurrent use
+    {
+        coveo::lazy::concurrent_set<int> local;
+        COVEO_ASSERT(local.size() == 0);
+        auto empty_snapshot = local.snapshot();
+        local.insert(42);
+        local.emplace(23);
+        local.insert(42);
+        COVEO_ASSERT(local.count(42) == 1);
+        auto snapshot = local.snapshot();
+        COVEO_ASSERT(containers_are_equal(snapshot, std::vector<int>({ 23, 42 })));
+        COVEO_ASSERT(empty_snapshot.empty());
+
+        // Writers insert distinct ranges while readers check that snapshots are sorted
+        // and that they include every element inserted by the reader itself.
+        const int num_writers = 4;
+        const int per_writer = 2000;
+        std::vector<std::thread> threads;
+        for (int w = 0; w < num_writers; ++w) {
+            threads.emplace_back([&local, w]() {
+                for (int i = 0; i < per_writer; ++i) {
+                    local.insert(1000 + w * per_writer + i);
+                }
+            });
+        }
+        bool readers_ok = true;
+        std::mutex readers_ok_mutex;
+        for (int r = 0; r < 2; ++r) {
+            threads.emplace_back([&local, &readers_ok, &readers_ok_mutex, r]() {
+                bool ok = true;
+                for (int i = 0; i < 200; ++i) {
+                    const int own = -1 - (r * 1000 + i);
+                    local.insert(own);
+                    auto snap = local.snapshot();
+                    ok = ok && snap.count(own) == 1 && snap.count(42) == 1;
+                    ok = ok && std::is_sorted(snap.begin(), snap.end());
+                    ok = ok && std::adjacent_find(snap.begin(), snap.end()) == snap.end();
+                }
+                std::lock_guard<std::mutex> lock(readers_ok_mutex);
+                readers_ok = readers_ok && ok;
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        COVEO_ASSERT(readers_ok);
+        COVEO_ASSERT(local.size() == 2 + num_writers * per_writer + 2 * 200);
+        COVEO_ASSERT(containers_are_equal(snapshot, std::vector<int>({ 23, 42 })));
+        COVEO_ASSERT(local.snapshot().count(1000 + num_writers * per_writer - 1) == 1);
+
+        local.clear();
+        COVEO_ASSERT(local.size() == 0);
+        COVEO_ASSERT(snapshot.size() == 2);
+
+        coveo::lazy::concurrent_multiset<int, std::less<int>, 2> multi;
+        multi.insert(3);
+        multi.insert(3);
+        std::vector<int> more({ 1, 3 });
+        multi.insert(more.begin(), more.end());
+        COVEO_ASSERT(containers_are_equal(multi.snapshot(), std::vector<int>({ 1, 3, 3, 3 })));
+    }
+
     // Lookups with transparent comparator
     {
         typedef coveo::lazy::set<int, std::less<>> tr_int_set;
@@ -534,6 +1403,316 @@ void set_tests()
         local.emplace(42);
         COVEO_ASSERT(local.sorted());
     }
+    {
+        int_set local({ 11, 42, 23, 66 });
+        local.sort();
+        local.emplace(99);
+        local.emplace(42);
+        local.insert({ 1, 23, 50, 1 });
+        COVEO_ASSERT(!local.sorted());
+
+        std::vector<int> expected({ 1, 11, 23, 42, 50, 66, 99 });
+        COVEO_ASSERT(containers_are_equal(local, expected));
+        COVEO_ASSERT(local.sorted());
+        COVEO_ASSERT(local.size() == 7);
+    }
+    {
+        typedef coveo::lazy::set<int, std::less<int>, std::vector,
+                                 coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>>,
+                                 std::allocator<int>,
+                                 coveo::lazy::parallel_sort_policy<16, 4>> parallel_int_set;
+        std::mt19937 rand;
+        std::uniform_int_distribution<int> dist(0, 500);
+        parallel_int_set local;
+        std::set<int> expected;
+        for (int i = 0; i < 1000; ++i) {
+            int val = dist(rand);
+            local.insert(val);
+            expected.insert(val);
+        }
+        COVEO_ASSERT(!local.sorted());
+        COVEO_ASSERT(containers_are_equal(local, expected));
+        COVEO_ASSERT(local.size() == expected.size());
+    }
+    {
+        typedef coveo::lazy::set<std::string, std::less<std::string>, std::vector,
+                                 coveo::lazy::detail::equal_to_using_less_if_needed<std::string, std::less<std::string>>,
+                                 std::allocator<std::string>,
+                                 coveo::lazy::indirect_sort_policy<16>> indirect_string_set;
+        std::mt19937 rand;
+        std::uniform_int_distribution<int> dist(0, 500);
+        indirect_string_set local;
+        std::set<std::string> expected;
+        for (int pass = 0; pass < 3; ++pass) {
+            for (int i = 0; i < 300; ++i) {
+                std::string val = std::to_string(dist(rand));
+                local.insert(val);
+                expected.insert(val);
+            }
+            COVEO_ASSERT(containers_are_equal(local, expected));
+        }
+    }
+    {
+        std::mt19937_64 rand;
+        std::uniform_int_distribution<std::uint64_t> dist;
+        coveo::lazy::set<std::uint64_t> local;
+        std::set<std::uint64_t> expected;
+        for (int i = 0; i < 5000; ++i) {
+            auto val = dist(rand);
+            local.insert(val);
+            expected.insert(val);
+        }
+        COVEO_ASSERT(containers_are_equal(local, expected));
+    }
+    {
+        std::mt19937 rand;
+        std::uniform_int_distribution<int> dist(-1000, 1000);
+        coveo::lazy::set<int> local;
+        std::set<int> expected;
+        for (int i = 0; i < 5000; ++i) {
+            int val = dist(rand);
+            local.insert(val);
+            expected.insert(val);
+        }
+        COVEO_ASSERT(containers_are_equal(local, expected));
+        COVEO_ASSERT(local.size() == expected.size());
+    }
+    {
+        std::mt19937 rand;
+        std::uniform_real_distribution<double> dist(-1e6, 1e6);
+        coveo::lazy::set<double, std::greater<double>> local;
+        std::set<double, std::greater<double>> expected;
+        for (int i = 0; i < 5000; ++i) {
+            double val = dist(rand);
+            local.insert(val);
+            expected.insert(val);
+        }
+        local.insert(0.0);
+        expected.insert(0.0);
+        COVEO_ASSERT(containers_are_equal(local, expected));
+    }
+    {
+        std::vector<int> sorted_values({ 1, 11, 23, 42 });
+        int_set local(coveo::lazy::sorted_unique, sorted_values.begin(), sorted_values.end());
+        COVEO_ASSERT(local.sorted());
+        local.insert(coveo::lazy::sorted_unique, { 50, 66 });
+        COVEO_ASSERT(local.sorted());
+        local.insert(coveo::lazy::sorted_unique, { 5, 23, 99 });
+        COVEO_ASSERT(!local.sorted());
+        local.insert(coveo::lazy::sorted_unique, { 100, 101 });
+        COVEO_ASSERT(!local.sorted());
+
+        std::vector<int> expected({ 1, 5, 11, 23, 42, 50, 66, 99, 100, 101 });
+        COVEO_ASSERT(containers_are_equal(local, expected));
+        COVEO_ASSERT(local.sorted());
+    }
+    {
+        int_set local(coveo::lazy::sorted_unique, { 11, 42 });
+        local.insert(coveo::lazy::sorted_unique, { 23, 66 });
+        local.insert(coveo::lazy::sorted_unique, { 1, 42 });
+        local.emplace(7);
+
+        std::vector<int> expected({ 1, 7, 11, 23, 42, 66 });
+        COVEO_ASSERT(containers_are_equal(local, expected));
+    }
+    {
+        int_set local;
+        local.insert(coveo::lazy::check_sorted, { 1, 11, 23 });
+        COVEO_ASSERT(local.sorted());
+        local.insert(coveo::lazy::check_sorted, { 42, 66 });
+        COVEO_ASSERT(local.sorted());
+        local.insert(coveo::lazy::check_sorted, { 66, 99 });
+        COVEO_ASSERT(!local.sorted());
+
+        std::vector<int> expected({ 1, 11, 23, 42, 66, 99 });
+        COVEO_ASSERT(containers_are_equal(local, expected));
+        COVEO_ASSERT(local.sorted());
+        std::vector<int> values({ 100, 101, 50, 102, 7 });
+        local.insert(coveo::lazy::check_sorted, values.begin(), values.end());
+        COVEO_ASSERT(!local.sorted());
+        local.insert(coveo::lazy::check_sorted, { 5, 6 });
+
+        std::vector<int> expected_after({ 1, 5, 6, 7, 11, 23, 42, 50, 66, 99, 100, 101, 102 });
+        COVEO_ASSERT(containers_are_equal(local, expected_after));
+    }
+    {
+        typedef coveo::lazy::set<int, std::less<int>, std::vector,
+                                 coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>>,
+                                 std::allocator<int>,
+                                 coveo::lazy::default_sort_policy,
+                                 coveo::lazy::counting_sort_stats> counted_int_set;
+        counted_int_set local({ 42, 23, 11 });
+        std::size_t callbacks = 0;
+        local.sort_stats().set_callback([&](const coveo::lazy::sort_stats_event& event) {
+            ++callbacks;
+            COVEO_ASSERT(event.size_before >= event.sorted_prefix + event.elements_sorted);
+        });
+        COVEO_ASSERT(local.sort_stats().sort_count() == 0);
+        COVEO_ASSERT(local.find(23) != local.end());
+        COVEO_ASSERT(local.sort_stats().sort_count() == 1);
+        COVEO_ASSERT(local.sort_stats().elements_sorted() == 3);
+        local.insert({ 1, 23, 11 });
+        COVEO_ASSERT(local.size() == 4);
+        COVEO_ASSERT(local.find(11) != local.end());
+        COVEO_ASSERT(local.sort_stats().sort_count() == 2);
+        COVEO_ASSERT(local.sort_stats().elements_sorted() == 6);
+        COVEO_ASSERT(local.sort_stats().elements_merged() == 3);
+        COVEO_ASSERT(local.sort_stats().duplicates_removed() == 2);
+        COVEO_ASSERT(callbacks == 2);
+
+        local.sort_stats().reset();
+        COVEO_ASSERT(local.sort_stats().sort_count() == 0);
+        COVEO_ASSERT(local.sort_stats().sort_time() == std::chrono::steady_clock::duration::zero());
+        static_assert(!int_set::sort_stats_policy::enabled, "sort stats should be disabled by default");
+
+        // Empty sort stats policy and search index must not take room
+        struct stateful_sort_stats : coveo::lazy::no_sort_stats {
+            std::size_t state = 0;
+        };
+        typedef coveo::lazy::set<int, std::less<int>, std::vector,
+                                 coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>>,
+                                 std::allocator<int>,
+                                 coveo::lazy::default_sort_policy,
+                                 stateful_sort_stats> stateful_int_set;
+        static_assert(sizeof(stateful_int_set) == sizeof(int_set) + sizeof(std::size_t),
+                      "empty sort stats policy and search index should not take room");
+    }
+    {
+        int_set local({ 11, 23, 42 });
+        local.sort();
+        COVEO_ASSERT(local.pending_limit() == 0);
+        local.set_pending_limit(2);
+        local.emplace(7);
+        local.emplace(23);
+        COVEO_ASSERT(!local.sorted());
+        COVEO_ASSERT(local.find(7) != local.end());
+        COVEO_ASSERT(*local.find(7) == 7);
+        COVEO_ASSERT(local.find(42) != local.end());
+        COVEO_ASSERT(local.find(8) == local.end());
+        COVEO_ASSERT(local.count(23) == 1);
+        COVEO_ASSERT(local.count(7) == 1);
+        COVEO_ASSERT(local.count(8) == 0);
+        COVEO_ASSERT(local.size() == 4);
+        COVEO_ASSERT(!local.sorted());
+        local.emplace(1);
+        local.emplace(5);
+        COVEO_ASSERT(local.find(1) != local.end());
+        COVEO_ASSERT(local.sorted());
+
+        std::vector<int> expected({ 1, 5, 7, 11, 23, 42 });
+        COVEO_ASSERT(containers_are_equal(local, expected));
+    }
+    {
+        typedef coveo::lazy::set<int, std::less<int>, std::vector,
+                                 coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>>,
+                                 std::allocator<int>,
+                                 coveo::lazy::default_sort_policy,
+                                 coveo::lazy::no_sort_stats,
+                                 coveo::lazy::eytzinger_search_policy<4>> eytzinger_int_set;
+        std::mt19937 rand;
+        std::uniform_int_distribution<int> dist(0, 200);
+        eytzinger_int_set local;
+        std::set<int> expected;
+        for (int pass = 0; pass < 3; ++pass) {
+            for (int i = 0; i < 100; ++i) {
+                int val = dist(rand);
+                local.insert(val);
+                expected.insert(val);
+            }
+            local.erase(*expected.begin());
+            expected.erase(expected.begin());
+            // Erasing keeps elements sorted, so lookups first binary search, then use the index rebuilt by sort()
+            for (int indexed = 0; indexed < 2; ++indexed) {
+                if (indexed != 0) {
+                    local.sort();
+                }
+                for (int key = -1; key <= 201; ++key) {
+                    COVEO_ASSERT(std::distance(local.begin(), local.lower_bound(key)) ==
+                                 std::distance(expected.begin(), expected.lower_bound(key)));
+                    COVEO_ASSERT(std::distance(local.begin(), local.upper_bound(key)) ==
+                                 std::distance(expected.begin(), expected.upper_bound(key)));
+                    COVEO_ASSERT((local.find(key) != local.end()) == (expected.find(key) != expected.end()));
+                    COVEO_ASSERT(local.count(key) == expected.count(key));
+                }
+            }
+        }
+
+        // Lookups do not modify the index, so they can run concurrently in a sorted container
+        const eytzinger_int_set& shared = local;
+        std::vector<std::future<bool>> lookups;
+        for (int t = 0; t < 4; ++t) {
+            lookups.push_back(std::async(std::launch::async, [&shared, &expected]() {
+                bool ok = true;
+                for (int key = -1; key <= 201; ++key) {
+                    ok = ok && (shared.find(key) != shared.end()) == (expected.find(key) != expected.end());
+                }
+                return ok;
+            }));
+        }
+        for (auto& lookup : lookups) {
+            COVEO_ASSERT(lookup.get());
+        }
+        eytzinger_int_set copy(local);
+        COVEO_ASSERT(copy.find(*expected.rbegin()) != copy.end());
+        local.clear();
+        COVEO_ASSERT(local.find(*expected.rbegin()) == local.end());
+    }
+
+    // Append policies
+    {
+        typedef coveo::lazy::set<int, std::less<int>, std::vector,
+                                 coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>>,
+                                 std::allocator<int>,
+                                 coveo::lazy::default_sort_policy,
+                                 coveo::lazy::no_sort_stats,
+                                 coveo::lazy::binary_search_policy,
+                                 coveo::lazy::default_duplicate_policy,
+                                 coveo::lazy::monotonic_append_policy> monotonic_int_set;
+        monotonic_int_set local;
+        for (int i = 0; i < 100; ++i) {
+            local.insert(i * 2);
+        }
+        COVEO_ASSERT(local.sorted());
+        COVEO_ASSERT(local.size() == 100);
+        COVEO_ASSERT(*local.lower_bound(51) == 52);
+        local.erase(52);
+        local.insert(200);
+        COVEO_ASSERT(local.sorted());
+        COVEO_ASSERT(*local.crbegin() == 200);
+    }
+    {
+        typedef coveo::lazy::set<int, std::less<int>, std::vector,
+                                 coveo::lazy::detail::equal_to_using_less_if_needed<int, std::less<int>>,
+                                 std::allocator<int>,
+                                 coveo::lazy::default_sort_policy,
+                                 coveo::lazy::no_sort_stats,
+                                 coveo::lazy::binary_search_policy,
+                                 coveo::lazy::default_duplicate_policy,
+                                 coveo::lazy::run_tracking_append_policy<4>> run_int_set;
+        std::mt19937 rand;
+        std::uniform_int_distribution<int> dist(0, 500);
+        run_int_set local;
+        std::set<int> expected;
+        for (int pass = 0; pass < 6; ++pass) {
+            // Each pass appends a few sorted runs, then more runs than can be merged.
+            const int runs = pass < 3 ? pass + 2 : pass + 4;
+            for (int run = 0; run < runs; ++run) {
+                std::vector<int> vals(50);
+                std::generate(vals.begin(), vals.end(), [&]() { return dist(rand); });
+                std::sort(vals.begin(), vals.end());
+                for (int val : vals) {
+                    local.insert(val);
+                    expected.insert(val);
+                }
+            }
+            COVEO_ASSERT(!local.sorted());
+            COVEO_ASSERT(local.size() == expected.size());
+            COVEO_ASSERT(std::equal(local.begin(), local.end(), expected.begin(), expected.end()));
+        }
+        local.clear();
+        local.insert({ 3, 1, 2 });
+        COVEO_ASSERT(containers_are_equal(local, std::vector<int>({ 1, 2, 3 })));
+    }
 }
 
 // Tests for coveo::lazy::multiset class
@@ -651,6 +1830,18 @@ void multiset_tests()
         COVEO_ASSERT(local.capacity() >= 0);
     }
 
+    // Memory stats
+    {
+        int_multiset local({ 11, 23, 42 });
+        local.sort();
+        local.insert(23);
+        auto stats = local.memory_stats();
+        COVEO_ASSERT(stats.pending_elements == 1 && local.pending_size() == 1);
+        COVEO_ASSERT(stats.possible_duplicates == 0);
+        COVEO_ASSERT(local.size() == 4);
+        COVEO_ASSERT(local.pending_size() == 1);
+    }
+
     // Lookups
     {
         COVEO_ASSERT(fromstdvector.count(23) == 2);
@@ -707,6 +1898,72 @@ void multiset_tests()
         COVEO_ASSERT(it_pair.second == fromstdvector.end());
     }
 
+    // Batched lookups
+    {
+        int_multiset local({ 23, 42, 23, 11, 42, 23 });
+        std::vector<int> keys({ 23, 42, 11, 24, 23 });
+        COVEO_ASSERT(local.count_all(keys.cbegin(), keys.cend()) == 9);
+        std::vector<int_multiset::iterator> found;
+        local.find_all(keys.cbegin(), keys.cend(), std::back_inserter(found));
+        COVEO_ASSERT(found[0] == local.lower_bound(23));
+        COVEO_ASSERT(found[3] == local.end());
+        std::sort(keys.begin(), keys.end());
+        COVEO_ASSERT(local.count_all(keys.cbegin(), keys.cend()) == 9);
+        COVEO_ASSERT(!local.contains_all(keys.cbegin(), keys.cend()));
+    }
+
+    // Lazy erasure
+    {
+        int_multiset local({ 23, 42, 23, 11, 42, 23 });
+        local.lazy_erase(23);
+        local.insert(23);
+        COVEO_ASSERT(local.size() == 4);
+        COVEO_ASSERT(local.count(23) == 1);
+        COVEO_ASSERT(local.erase_if([](int val) { return val == 42; }) == 2);
+        COVEO_ASSERT(containers_are_equal(local, std::vector<int>({ 11, 23 })));
+    }
+
+    // Bulk erasure
+    {
+        int_multiset local({ 23, 42, 23, 11, 42, 23, 7, 99 });
+        std::vector<std::pair<int, int>> ranges({ { 0, 10 }, { 40, 50 } });
+        COVEO_ASSERT(local.erase_ranges(ranges.cbegin(), ranges.cend()) == 3);
+        std::vector<int> keys({ 11, 23 });
+        COVEO_ASSERT(local.retain_keys(keys.cbegin(), keys.cend()) == 1);
+        COVEO_ASSERT(containers_are_equal(local, std::vector<int>({ 11, 23, 23, 23 })));
+        COVEO_ASSERT(local.erase_keys(keys.cend() - 1, keys.cend()) == 3);
+        COVEO_ASSERT(containers_are_equal(local, std::vector<int>({ 11 })));
+    }
+
+    // Merging and set operations
+    {
+        int_multiset left({ 23, 42, 23, 11, 42, 23 });
+        int_multiset right({ 42, 23, 99, 11, 11 });
+        std::multiset<int> stdleft(left.cbegin(), left.cend());
+        std::multiset<int> stdright(right.cbegin(), right.cend());
+
+        std::vector<int> expected;
+        std::set_union(stdleft.cbegin(), stdleft.cend(), stdright.cbegin(), stdright.cend(), std::back_inserter(expected));
+        COVEO_ASSERT(containers_are_equal(set_union(left, right), expected));
+        COVEO_ASSERT(containers_are_equal(set_union(int_multiset(left), int_multiset(right)), expected));
+        expected.clear();
+        std::set_intersection(stdleft.cbegin(), stdleft.cend(), stdright.cbegin(), stdright.cend(), std::back_inserter(expected));
+        COVEO_ASSERT(containers_are_equal(set_intersection(left, right), expected));
+        expected.clear();
+        std::set_difference(stdleft.cbegin(), stdleft.cend(), stdright.cbegin(), stdright.cend(), std::back_inserter(expected));
+        COVEO_ASSERT(containers_are_equal(set_difference(left, right), expected));
+
+        left.merge(right);
+        stdleft.insert(stdright.cbegin(), stdright.cend());
+        COVEO_ASSERT(containers_are_equal(left, stdleft));
+        COVEO_ASSERT(right.empty());
+
+        auto extracted = left.extract(23);
+        COVEO_ASSERT(extracted.size() == 4);
+        COVEO_ASSERT(left.count(23) == 0);
+        COVEO_ASSERT(left.size() == 7);
+    }
+
     // Lookups with transparent comparator
     {
         typedef coveo::lazy::multiset<int, std::less<>> tr_int_multiset;
@@ -922,10 +2179,273 @@ void multiset_tests()
         local.emplace(42);
         COVEO_ASSERT(local.sorted());
     }
+    {
+        // Arithmetic keys use a branchless search; check it against std::multiset
+        // for sizes around the size where it switches to a linear scan.
+        typedef coveo::lazy::multiset<double, std::greater<double>> double_multiset;
+        std::mt19937 rand;
+        std::uniform_int_distribution<int> dist(0, 40);
+        for (int size = 0; size <= 70; size += 7) {
+            double_multiset local;
+            std::multiset<double, std::greater<double>> expected;
+            for (int i = 0; i < size; ++i) {
+                double val = dist(rand) / 2.0;
+                local.insert(val);
+                expected.insert(val);
+            }
+            for (int key = -1; key <= 41; ++key) {
+                double val = key / 2.0;
+                COVEO_ASSERT(std::distance(local.begin(), local.lower_bound(val)) ==
+                             std::distance(expected.begin(), expected.lower_bound(val)));
+                COVEO_ASSERT(std::distance(local.begin(), local.upper_bound(val)) ==
+                             std::distance(expected.begin(), expected.upper_bound(val)));
+                auto range = local.equal_range(val);
+                COVEO_ASSERT(static_cast<std::size_t>(std::distance(range.first, range.second)) == expected.count(val));
+                COVEO_ASSERT((local.find(val) != local.end()) == (expected.find(val) != expected.end()));
+                COVEO_ASSERT(local.count(val) == expected.count(val));
+            }
+        }
+    }
+    {
+        // Radix sort keeps +0.0 and -0.0, which compare equal, in insertion order
+        std::vector<double> values;
+        for (int i = 0; i < 300; ++i) {
+            values.push_back(i - 150.5);
+        }
+        values.insert(values.begin() + 100, { 0.0, -0.0, 0.0 });
+        coveo::lazy::multiset<double> multi(values.begin(), values.end());
+        std::multiset<double> expected_multi(values.begin(), values.end());
+        COVEO_ASSERT(std::equal(multi.begin(), multi.end(), expected_multi.begin(), expected_multi.end(),
+                                [](double left, double right) {
+                                    return left == right && std::signbit(left) == std::signbit(right);
+                                }));
+
+        values[101] = 0.0;
+        values[100] = values[102] = -0.0;
+        coveo::lazy::set<double> local(values.begin(), values.end());
+        COVEO_ASSERT(local.size() == 301);
+        COVEO_ASSERT(local.find(0.0) != local.end() && std::signbit(*local.find(0.0)));
+    }
+}
+
+// Unit tests for coveo::lazy::small_vector class and its use in coveo::lazy::set and coveo::lazy::multiset
+void small_vector_tests()
+{
+    typedef coveo::lazy::small_vector<std::string, 4> string_small_vector;
+
+    // Inline and allocated storage
+    {
+        string_small_vector local;
+        COVEO_ASSERT(local.empty());
+        COVEO_ASSERT(local.is_inline());
+        COVEO_ASSERT(local.capacity() == 4);
+
+        std::vector<std::string> expected;
+        for (int i = 0; i < 10; ++i) {
+            local.push_back(std::to_string(i));
+            expected.push_back(std::to_string(i));
+            COVEO_ASSERT(local.is_inline() == (i < 4));
+            COVEO_ASSERT(std::equal(local.begin(), local.end(), expected.begin(), expected.end()));
+        }
+        COVEO_ASSERT(local.at(9) == "9");
+        try {
+            local.at(10);
+            COVEO_ASSERT_FALSE();
+        } catch (const std::out_of_range&) {
+        }
+
+        local.erase(local.begin() + 2, local.end() - 1);
+        COVEO_ASSERT(local == string_small_vector({ "0", "1", "9" }));
+        COVEO_ASSERT(!local.is_inline());
+        local.shrink_to_fit();
+        COVEO_ASSERT(local.is_inline());
+        COVEO_ASSERT(local == string_small_vector({ "0", "1", "9" }));
+
+        local.insert(local.begin() + 1, { "a", "b" });
+        local.emplace(local.begin(), "c");
+        local.insert(local.end(), local.front());
+        COVEO_ASSERT(local == string_small_vector({ "c", "0", "a", "b", "1", "9", "c" }));
+        COVEO_ASSERT(*local.crbegin() == "c" && *std::next(local.crbegin()) == "9");
+        local.pop_back();
+        local.erase(local.begin());
+        COVEO_ASSERT(local.front() == "0" && local.back() == "9" && local.size() == 5);
+        local.resize(2);
+        COVEO_ASSERT(local == string_small_vector({ "0", "a" }));
+        local.clear();
+        COVEO_ASSERT(local.empty());
+    }
+
+    // Copy, move and swap
+    {
+        string_small_vector small({ "1", "2" });
+        string_small_vector large({ "1", "2", "3", "4", "5", "6" });
+        string_small_vector small_copy(small);
+        string_small_vector large_copy(large);
+        COVEO_ASSERT(small_copy == small && small_copy.is_inline());
+        COVEO_ASSERT(large_copy == large && !large_copy.is_inline());
+
+        string_small_vector small_moved(std::move(small_copy));
+        COVEO_ASSERT(small_moved == small && small_copy.empty());
+        const std::string* large_data = large_copy.data();
+        string_small_vector large_moved(std::move(large_copy));
+        COVEO_ASSERT(large_moved == large && large_copy.empty() && large_copy.is_inline());
+        COVEO_ASSERT(large_moved.data() == large_data);
+
+        swap(small_moved, large_moved);
+        COVEO_ASSERT(small_moved == large && large_moved == small);
+        COVEO_ASSERT(!small_moved.is_inline() && large_moved.is_inline());
+        small_moved.swap(large_moved);
+        COVEO_ASSERT(small_moved == small && large_moved == large);
+
+        small_moved = large;
+        COVEO_ASSERT(small_moved == large);
+        small_moved = std::move(large_moved);
+        COVEO_ASSERT(small_moved == large && large_moved.empty());
+        small_moved = { "7" };
+        COVEO_ASSERT(small_moved == string_small_vector({ "7" }));
+    }
+
+    // Use as internal container of lazy-sorted containers
+    {
+        typedef coveo::lazy::set<int, std::less<int>, coveo::lazy::small_vector_impl<16>::type> small_int_set;
+        typedef coveo::lazy::multiset<int, std::less<int>, coveo::lazy::small_vector_impl<16>::type> small_int_multiset;
+
+        small_int_set local;
+        small_int_multiset local_multi;
+        COVEO_ASSERT(local.pending_limit() == 16);
+        COVEO_ASSERT(local_multi.pending_limit() == 16);
+
+        // While elements are stored inline, lookups scan them instead of sorting.
+        local.insert({ 42, 23, 11, 42 });
+        COVEO_ASSERT(local.find(23) != local.end());
+        COVEO_ASSERT(local.find(24) == local.end());
+        COVEO_ASSERT(local.count(42) == 1);
+        COVEO_ASSERT(!local.sorted());
+
+        std::mt19937 rand;
+        std::uniform_int_distribution<int> dist(0, 50);
+        std::set<int> expected({ 42, 23, 11 });
+        std::multiset<int> expected_multi;
+        for (int i = 0; i < 100; ++i) {
+            int val = dist(rand);
+            local.insert(val);
+            expected.insert(val);
+            local_multi.insert(val);
+            expected_multi.insert(val);
+            int key = dist(rand);
+            COVEO_ASSERT((local.find(key) != local.end()) == (expected.count(key) != 0));
+            COVEO_ASSERT(local_multi.count(key) == expected_multi.count(key));
+        }
+        COVEO_ASSERT(std::equal(local.begin(), local.end(), expected.begin(), expected.end()));
+        COVEO_ASSERT(std::equal(local_multi.begin(), local_multi.end(), expected_multi.begin(), expected_multi.end()));
+
+        small_int_set copy(local);
+        COVEO_ASSERT(copy == local);
+        small_int_set moved(std::move(copy));
+        COVEO_ASSERT(moved == local);
+        small_int_set small({ 3, 1, 2 });
+        swap(small, moved);
+        COVEO_ASSERT(small == local);
+        COVEO_ASSERT(std::equal(moved.begin(), moved.end(), std::begin({ 1, 2, 3 })));
+        moved.erase(2);
+        COVEO_ASSERT(moved.size() == 2 && moved.count(2) == 0);
+    }
+}
+
+// Tests for coveo::lazy::string_set class
+void string_set_tests()
+{
+    using namespace coveo_tests::lazy::detail;
+
+    typedef coveo::lazy::string_set string_set;
+
+    // Constructors and iteration
+    {
+        string_set local({ "Life", "Hangar", "Life", std::string("Universe") });
+        COVEO_ASSERT(!local.sorted());
+        COVEO_ASSERT(local.size() == 3);
+        COVEO_ASSERT(local.sorted());
+        COVEO_ASSERT(local.char_count() == 18);
+        auto it = local.cbegin();
+        COVEO_ASSERT(*it == "Hangar" && it->size() == 6);
+        std::string second = *++it;
+        COVEO_ASSERT(second == "Life");
+        COVEO_ASSERT(*local.crbegin() == "Universe");
+        COVEO_ASSERT(containers_are_equal(local, std::vector<std::string>({ "Hangar", "Life", "Universe" })));
+
+        string_set copy(local);
+        COVEO_ASSERT(copy == local);
+        copy.insert("Answer");
+        COVEO_ASSERT(copy != local);
+        std::ostringstream oss;
+        oss << *copy.begin();
+        COVEO_ASSERT(oss.str() == "Answer");
+        swap(copy, local);
+        COVEO_ASSERT(local.size() == 4 && copy.size() == 3);
+    }
+
+    // Lookups and modifiers
+    {
+        // Strings sharing long prefixes, embedded null characters and strings
+        // shorter than prefixes are compared past their cached prefix.
+        const std::string with_null("abc\0", 4);
+        string_set local({ "abcdefgh2", "abcdefgh10", "abcdefgh", "abc", with_null, "", "b" });
+        COVEO_ASSERT(containers_are_equal(local, std::vector<std::string>({
+            "", "abc", with_null, "abcdefgh", "abcdefgh10", "abcdefgh2", "b" })));
+        COVEO_ASSERT(local.count("abc") == 1);
+        COVEO_ASSERT(local.count(with_null) == 1);
+        COVEO_ASSERT(local.count("abcdefgh1") == 0);
+        COVEO_ASSERT(*local.lower_bound("abcdefgh1") == "abcdefgh10");
+        COVEO_ASSERT(*local.upper_bound("abcdefgh10") == "abcdefgh2");
+        COVEO_ASSERT(local.find("b") != local.end() && local.find("c") == local.end());
+        auto range = local.equal_range("abc");
+        COVEO_ASSERT(std::distance(range.first, range.second) == 1);
+
+        // Strings can be inserted from the set itself.
+        local.insert(*local.find("abcdefgh2"));
+        local.insert(*local.rbegin());
+        COVEO_ASSERT(local.size() == 7);
+
+        COVEO_ASSERT(local.erase("abc") == 1);
+        COVEO_ASSERT(local.erase("abc") == 0);
+        auto it = local.erase(local.find(with_null));
+        COVEO_ASSERT(*it == "abcdefgh");
+        local.erase(local.begin(), local.lower_bound("abcdefgh2"));
+        COVEO_ASSERT(local.size() == 2 && *local.begin() == "abcdefgh2");
+        local.shrink_to_fit();
+        COVEO_ASSERT(local.char_count() == 10);
+        COVEO_ASSERT(*local.begin() == "abcdefgh2");
+        local.clear();
+        COVEO_ASSERT(local.empty());
+    }
+
+    // Compare with std::set, interleaving inserts, lookups and erasures
+    {
+        std::mt19937 rand;
+        std::uniform_int_distribution<int> dist(0, 2000);
+        string_set local;
+        std::set<std::string> expected;
+        for (int i = 0; i < 20000; ++i) {
+            // Identical prefixes, to exercise multikey quicksort past them.
+            const std::string str = (i % 2 == 0 ? "identical/prefix/" : "") + std::to_string(dist(rand));
+            if (i % 5 == 0) {
+                COVEO_ASSERT(local.erase(str) == expected.erase(str));
+            } else {
+                local.insert(str);
+                expected.insert(str);
+            }
+            if (i % 997 == 0) {
+                COVEO_ASSERT(containers_are_equal(local, expected));
+            }
+        }
+        COVEO_ASSERT(containers_are_equal(local, expected));
+        COVEO_ASSERT(local.char_count() == std::accumulate(expected.begin(), expected.end(), std::size_t(0),
+                                                          [](std::size_t n, const std::string& str) { return n + str.size(); }));
+    }
 }
 
-// Benchmarks for coveo::lazy::set class
-// Compares it with std::set
+// Benchmarks for coveo::lazy::set and coveo::lazy::multiset classes
+// Compares them with std::set, std::unordered_set and std::multiset
 void set_benchmarks()
 {
     typedef std::set<size_t>            set_type;
@@ -938,6 +2458,11 @@ void set_benchmarks()
 
     detail::benchmark_mixed_set_operations<set_type>("std::set");
     detail::benchmark_mixed_set_operations<lazy_set_type>("coveo::lazy::set");
+
+    std::cout << std::endl;
+
+    detail::benchmark_set_suites_for_key<size_t>();
+    detail::benchmark_set_suites_for_key<std::string>();
 }
 
 } // lazy
@@ -9,6 +9,8 @@ namespace lazy {
 
 void set_tests();
 void multiset_tests();
+void small_vector_tests();
+void string_set_tests();
 
 void set_benchmarks();
 
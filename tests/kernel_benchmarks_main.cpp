@@ -0,0 +1,109 @@
+// Copyright (c) 2015-2016, Coveo Solutions Inc.
+// Distributed under the Apache License, Version 2.0 (see LICENSE).
+
+#include <coveo/lazy/kernel_benchmarks.h>
+#include <coveo/kernel_benchmark_framework.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+void print_usage()
+{
+    std::cout << "Usage: kernel_benchmarks.out [options]" << std::endl
+              << "  --min-size N           Smallest container size (default: 10)" << std::endl
+              << "  --max-size N           Largest container size, up to 100000000 (default: 1000000)" << std::endl
+              << "  --min-ops N            Minimum number of timed operations per benchmark (default: 1000000)" << std::endl
+              << "  --kernel NAME          Only run kernel NAME (sort, lower_bound, operator_brackets, map_pair_move)" << std::endl
+              << "  --distribution NAME    Only use distribution NAME (random, sorted, reverse, nearly_sorted, duplicates)" << std::endl
+              << "  --json FILE            Write results as JSON to FILE (- for standard output)" << std::endl
+              << "  --baseline FILE        Compare results with JSON results in FILE; fail on regressions" << std::endl
+              << "  --tolerance F          Allowed increase of comparisons, moves and copies (default: 0.05)" << std::endl
+              << "  --time-tolerance F     Allowed increase of ns/op; 0 to ignore times (default: 0)" << std::endl;
+}
+
+} // namespace
+
+// Kernel benchmarks program entry point.
+int main(int argc, char* argv[])
+{
+    coveo_tests::lazy::kernel_benchmark_options options;
+    std::string json_path;
+    std::string baseline_path;
+    double tolerance = 0.05;
+    double time_tolerance = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage();
+            return arg == "--help" ? 0 : 1;
+        }
+        const std::string value = argv[++i];
+        if (arg == "--min-size") {
+            options.min_size = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--max-size") {
+            options.max_size = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--min-ops") {
+            options.min_ops = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--kernel") {
+            options.kernel = value;
+        } else if (arg == "--distribution") {
+            options.distribution = value;
+        } else if (arg == "--json") {
+            json_path = value;
+        } else if (arg == "--baseline") {
+            baseline_path = value;
+        } else if (arg == "--tolerance") {
+            tolerance = std::strtod(value.c_str(), nullptr);
+        } else if (arg == "--time-tolerance") {
+            time_tolerance = std::strtod(value.c_str(), nullptr);
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    // Report is written to standard error if JSON goes to standard output.
+    std::streambuf* cout_buf = nullptr;
+    if (json_path == "-") {
+        cout_buf = std::cout.rdbuf(std::cerr.rdbuf());
+    }
+    std::cout << "Running kernel benchmarks..." << std::endl;
+    const auto results = coveo_tests::lazy::kernel_benchmarks(options);
+    std::cout << "Done." << std::endl;
+    if (cout_buf != nullptr) {
+        std::cout.rdbuf(cout_buf);
+    }
+
+    if (json_path == "-") {
+        coveo_tests::write_kernel_results_json(std::cout, results);
+    } else if (!json_path.empty()) {
+        std::ofstream ofs(json_path);
+        coveo_tests::write_kernel_results_json(ofs, results);
+        if (!ofs) {
+            std::cerr << "Cannot write " << json_path << std::endl;
+            return 1;
+        }
+    }
+
+    int ret = 0;
+    if (!baseline_path.empty()) {
+        std::map<std::string, coveo_tests::kernel_result> baseline;
+        if (!coveo_tests::read_kernel_baseline(baseline_path, baseline)) {
+            std::cerr << "Cannot read " << baseline_path << std::endl;
+            return 1;
+        }
+        const std::size_t regressions = coveo_tests::check_kernel_regressions(results, baseline, tolerance, time_tolerance);
+        if (regressions != 0) {
+            std::cerr << regressions << " regression(s) found." << std::endl;
+            ret = 2;
+        }
+    }
+    return ret;
+}